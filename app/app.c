@@ -67,16 +67,34 @@
 #include "gimp-intl.h"
 
 
+/*  with --verbose, steps taking longer than this are reported  */
+#define APP_INIT_MIN_STEP_TIME 0.01
+
+
 /*  local prototypes  */
 
 static void       app_init_update_noop    (const gchar  *text1,
                                            const gchar  *text2,
                                            gdouble       percentage);
+static void       app_init_update_verbose (const gchar  *text1,
+                                           const gchar  *text2,
+                                           gdouble       percentage);
+static void       app_init_end_step       (gboolean      end_phase);
 static gboolean   app_exit_after_callback (Gimp         *gimp,
                                            gboolean      kill_it,
                                            GMainLoop   **loop);
 
 
+/*  startup timing for --verbose  */
+
+static GimpInitStatusFunc  app_init_status_func = NULL;
+static GTimer             *app_init_timer       = NULL;
+static gchar              *app_init_phase       = NULL;
+static gdouble             app_init_phase_start = 0.0;
+static gchar              *app_init_step        = NULL;
+static gdouble             app_init_step_start  = 0.0;
+
+
 /*  public functions  */
 
 void
@@ -222,6 +240,14 @@ app_run (const gchar         *full_prog_name,
   if (! update_status_func)
     update_status_func = app_init_update_noop;
 
+  if (be_verbose)
+    {
+      app_init_status_func = update_status_func;
+      update_status_func   = app_init_update_verbose;
+
+      app_init_timer = g_timer_new ();
+    }
+
   /*  Create all members of the global Gimp instance which need an already
    *  parsed gimprc, e.g. the data factories
    */
@@ -231,6 +257,17 @@ app_run (const gchar         *full_prog_name,
    */
   gimp_restore (gimp, update_status_func);
 
+  if (app_init_timer)
+    {
+      app_init_end_step (TRUE);
+
+      g_print ("Startup took %.3f seconds\n",
+               g_timer_elapsed (app_init_timer, NULL));
+
+      g_timer_destroy (app_init_timer);
+      app_init_timer = NULL;
+    }
+
   /*  enable autosave late so we don't autosave when the
    *  monitor resolution is set in gui_init()
    */
@@ -286,6 +323,61 @@ app_init_update_noop (const gchar *text1,
   /*  deliberately do nothing  */
 }
 
+/*  reports the time spent in each phase of the startup, and in the
+ *  steps of a phase which took noticeably long
+ */
+static void
+app_init_update_verbose (const gchar *text1,
+                         const gchar *text2,
+                         gdouble      percentage)
+{
+  if (text1 || text2)
+    {
+      gdouble now = g_timer_elapsed (app_init_timer, NULL);
+
+      app_init_end_step (text1 != NULL);
+
+      if (text1)
+        {
+          app_init_phase       = g_strdup (text1);
+          app_init_phase_start = now;
+        }
+
+      if (text2 && *text2)
+        {
+          app_init_step       = g_strdup (text2);
+          app_init_step_start = now;
+        }
+    }
+
+  app_init_status_func (text1, text2, percentage);
+}
+
+static void
+app_init_end_step (gboolean end_phase)
+{
+  gdouble now = g_timer_elapsed (app_init_timer, NULL);
+
+  if (app_init_step)
+    {
+      if (now - app_init_step_start >= APP_INIT_MIN_STEP_TIME)
+        g_print ("  %s: %.3f seconds\n",
+                 app_init_step, now - app_init_step_start);
+
+      g_free (app_init_step);
+      app_init_step = NULL;
+    }
+
+  if (end_phase && app_init_phase)
+    {
+      g_print ("%s: %.3f seconds\n",
+               app_init_phase, now - app_init_phase_start);
+
+      g_free (app_init_phase);
+      app_init_phase = NULL;
+    }
+}
+
 static gboolean
 app_exit_after_callback (Gimp       *gimp,
                          gboolean    kill_it,
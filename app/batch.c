@@ -144,8 +144,12 @@ batch_run_cmd (Gimp          *gimp,
   GimpValueArray *args;
   GimpValueArray *return_vals;
   GError         *error = NULL;
+  GTimer         *timer = NULL;
   gint            i     = 0;
 
+  if (gimp->be_verbose)
+    timer = g_timer_new ();
+
   args = gimp_procedure_get_arguments (procedure);
 
   if (procedure->num_args > i &&
@@ -193,6 +197,14 @@ batch_run_cmd (Gimp          *gimp,
       break;
     }
 
+  if (timer)
+    {
+      g_print ("Batch command took %.3f seconds\n",
+               g_timer_elapsed (timer, NULL));
+
+      g_timer_destroy (timer);
+    }
+
   gimp_value_array_unref (return_vals);
   gimp_value_array_unref (args);
 
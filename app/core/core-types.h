@@ -198,7 +198,9 @@ typedef struct _GimpTagged          GimpTagged;      /* dummy typedef */
 /*  non-object types  */
 
 typedef struct _GimpArea            GimpArea;
+typedef struct _GimpBoundCache      GimpBoundCache;
 typedef struct _GimpBoundSeg        GimpBoundSeg;
+typedef struct _GimpBoundIndex      GimpBoundIndex;
 typedef struct _GimpCoords          GimpCoords;
 typedef struct _GimpGradientSegment GimpGradientSegment;
 typedef struct _GimpPaletteEntry    GimpPaletteEntry;
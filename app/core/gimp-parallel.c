@@ -0,0 +1,396 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-parallel.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl.h>
+
+#include "core-types.h"
+
+#include "config/gimpgeglconfig.h"
+
+#include "gimp.h"
+#include "gimp-parallel.h"
+
+
+typedef struct _GimpParallelDistributeTask GimpParallelDistributeTask;
+typedef struct _GimpParallelDistributeItem GimpParallelDistributeItem;
+
+struct _GimpParallelDistributeTask
+{
+  GimpParallelDistributeFunc  func;
+  gpointer                    user_data;
+  gint                        n;
+
+  GMutex                      mutex;
+  GCond                       cond;
+  gint                        remaining;
+};
+
+struct _GimpParallelDistributeItem
+{
+  GimpParallelDistributeTask *task;
+  gint                        i;
+};
+
+typedef struct
+{
+  gsize                           size;
+  GimpParallelDistributeRangeFunc func;
+  gpointer                        user_data;
+} GimpParallelDistributeRangeData;
+
+typedef struct
+{
+  const GeglRectangle            *area;
+  gboolean                        by_rows;
+  GimpParallelDistributeAreaFunc  func;
+  gpointer                        user_data;
+} GimpParallelDistributeAreaData;
+
+
+/*  local function prototypes  */
+
+static void   gimp_parallel_notify_num_processors (GimpGeglConfig                  *config);
+static void   gimp_parallel_set_n_threads         (gint                             n_threads);
+
+static void   gimp_parallel_worker_func           (GimpParallelDistributeItem      *item,
+                                                   gpointer                         data);
+
+static void   gimp_parallel_distribute_range_func (gint                             i,
+                                                   gint                             n,
+                                                   GimpParallelDistributeRangeData *data);
+static void   gimp_parallel_distribute_area_func  (gint                             i,
+                                                   gint                             n,
+                                                   GimpParallelDistributeAreaData  *data);
+
+
+/*  local variables  */
+
+static GThreadPool *gimp_parallel_pool      = NULL;
+static gint         gimp_parallel_n_threads = 1;
+
+/*  set in threads which are already executing a distributed task, nested
+ *  distribution is done serially so that the pool can't starve itself
+ */
+static GPrivate     gimp_parallel_busy      = G_PRIVATE_INIT (NULL);
+
+
+/*  public functions  */
+
+void
+gimp_parallel_init (Gimp *gimp)
+{
+  GimpGeglConfig *config;
+
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+  g_return_if_fail (gimp_parallel_pool == NULL);
+
+  config = GIMP_GEGL_CONFIG (gimp->config);
+
+  gimp_parallel_pool = g_thread_pool_new ((GFunc) gimp_parallel_worker_func,
+                                          NULL, 1, TRUE, NULL);
+
+  gimp_parallel_set_n_threads (config->num_processors);
+
+  g_signal_connect (config, "notify::num-processors",
+                    G_CALLBACK (gimp_parallel_notify_num_processors),
+                    NULL);
+}
+
+void
+gimp_parallel_exit (Gimp *gimp)
+{
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  g_signal_handlers_disconnect_by_func (gimp->config,
+                                        gimp_parallel_notify_num_processors,
+                                        NULL);
+
+  if (gimp_parallel_pool)
+    {
+      g_thread_pool_free (gimp_parallel_pool, FALSE, TRUE);
+      gimp_parallel_pool = NULL;
+    }
+
+  gimp_parallel_n_threads = 1;
+}
+
+/**
+ * gimp_parallel_get_n_threads:
+ *
+ * Return value: the number of threads distributed work is split
+ *               across, which is the "num-processors" preference.
+ **/
+gint
+gimp_parallel_get_n_threads (void)
+{
+  return gimp_parallel_n_threads;
+}
+
+/**
+ * gimp_parallel_distribute:
+ * @max_n:     the maximal number of parts to split the work into, or
+ *             -1 for as many as there are threads
+ * @func:      the function to call for each part
+ * @user_data: data to pass to @func
+ *
+ * Calls @func (i, n, @user_data) for all i in [0, n), each on its own
+ * thread, where n is at most @max_n. The calling thread takes part in
+ * the work, and the function returns when all parts are done.
+ *
+ * @func must not use GTK+ or anything else that is bound to the main
+ * thread. When called from within a distributed function, or when
+ * only a single thread is configured, @func is simply called once
+ * with n == 1.
+ **/
+void
+gimp_parallel_distribute (gint                       max_n,
+                          GimpParallelDistributeFunc func,
+                          gpointer                   user_data)
+{
+  GimpParallelDistributeTask  task;
+  GimpParallelDistributeItem *items;
+  gint                        n;
+  gint                        i;
+
+  g_return_if_fail (func != NULL);
+
+  if (max_n == 0)
+    return;
+
+  n = gimp_parallel_n_threads;
+
+  if (max_n > 0)
+    n = MIN (n, max_n);
+
+  if (n <= 1 || ! gimp_parallel_pool || g_private_get (&gimp_parallel_busy))
+    {
+      func (0, 1, user_data);
+
+      return;
+    }
+
+  task.func      = func;
+  task.user_data = user_data;
+  task.n         = n;
+  task.remaining = n - 1;
+
+  g_mutex_init (&task.mutex);
+  g_cond_init (&task.cond);
+
+  items = g_newa (GimpParallelDistributeItem, n);
+
+  for (i = 1; i < n; i++)
+    {
+      items[i].task = &task;
+      items[i].i    = i;
+
+      g_thread_pool_push (gimp_parallel_pool, &items[i], NULL);
+    }
+
+  g_private_set (&gimp_parallel_busy, GINT_TO_POINTER (TRUE));
+
+  func (0, n, user_data);
+
+  g_private_set (&gimp_parallel_busy, NULL);
+
+  g_mutex_lock (&task.mutex);
+
+  while (task.remaining > 0)
+    g_cond_wait (&task.cond, &task.mutex);
+
+  g_mutex_unlock (&task.mutex);
+
+  g_cond_clear (&task.cond);
+  g_mutex_clear (&task.mutex);
+}
+
+/**
+ * gimp_parallel_distribute_range:
+ * @size:         the size of the range
+ * @min_sub_size: the minimal size of each part, or 0
+ * @func:         the function to call for each part
+ * @user_data:    data to pass to @func
+ *
+ * Splits [0, @size) into consecutive parts of at least @min_sub_size
+ * and calls @func for each of them, using gimp_parallel_distribute().
+ **/
+void
+gimp_parallel_distribute_range (gsize                           size,
+                                gsize                           min_sub_size,
+                                GimpParallelDistributeRangeFunc func,
+                                gpointer                        user_data)
+{
+  GimpParallelDistributeRangeData data;
+  gint                            max_n;
+
+  g_return_if_fail (func != NULL);
+
+  if (size == 0)
+    return;
+
+  data.size      = size;
+  data.func      = func;
+  data.user_data = user_data;
+
+  if (min_sub_size > 1)
+    max_n = MIN (size / min_sub_size, G_MAXINT);
+  else
+    max_n = MIN (size, G_MAXINT);
+
+  gimp_parallel_distribute (MAX (max_n, 1),
+                            (GimpParallelDistributeFunc)
+                            gimp_parallel_distribute_range_func,
+                            &data);
+}
+
+/**
+ * gimp_parallel_distribute_area:
+ * @area:         the area to split
+ * @min_sub_area: the minimal number of pixels of each part, or 0
+ * @func:         the function to call for each part
+ * @user_data:    data to pass to @func
+ *
+ * Splits @area into strips of at least @min_sub_area pixels and calls
+ * @func for each of them, using gimp_parallel_distribute(). Areas are
+ * split into full-width strips whenever possible, which keeps each
+ * part on as few tile rows as possible.
+ **/
+void
+gimp_parallel_distribute_area (const GeglRectangle            *area,
+                               gsize                           min_sub_area,
+                               GimpParallelDistributeAreaFunc  func,
+                               gpointer                        user_data)
+{
+  GimpParallelDistributeAreaData data;
+  gsize                          n_pixels;
+  gint                           max_n;
+
+  g_return_if_fail (area != NULL);
+  g_return_if_fail (func != NULL);
+
+  if (area->width <= 0 || area->height <= 0)
+    return;
+
+  n_pixels = (gsize) area->width * (gsize) area->height;
+
+  data.area      = area;
+  data.by_rows   = area->height >= gimp_parallel_n_threads;
+  data.func      = func;
+  data.user_data = user_data;
+
+  if (min_sub_area > 1)
+    max_n = MIN (n_pixels / min_sub_area, G_MAXINT);
+  else
+    max_n = MIN (n_pixels, G_MAXINT);
+
+  max_n = MIN (max_n, data.by_rows ? area->height : area->width);
+
+  gimp_parallel_distribute (MAX (max_n, 1),
+                            (GimpParallelDistributeFunc)
+                            gimp_parallel_distribute_area_func,
+                            &data);
+}
+
+
+/*  private functions  */
+
+static void
+gimp_parallel_notify_num_processors (GimpGeglConfig *config)
+{
+  gimp_parallel_set_n_threads (config->num_processors);
+}
+
+static void
+gimp_parallel_set_n_threads (gint n_threads)
+{
+  gimp_parallel_n_threads = MAX (n_threads, 1);
+
+  if (gimp_parallel_pool)
+    {
+      /*  the calling thread always does its share of the work  */
+      g_thread_pool_set_max_threads (gimp_parallel_pool,
+                                     MAX (gimp_parallel_n_threads - 1, 1),
+                                     NULL);
+    }
+}
+
+static void
+gimp_parallel_worker_func (GimpParallelDistributeItem *item,
+                           gpointer                    data)
+{
+  GimpParallelDistributeTask *task = item->task;
+
+  g_private_set (&gimp_parallel_busy, GINT_TO_POINTER (TRUE));
+
+  task->func (item->i, task->n, task->user_data);
+
+  g_private_set (&gimp_parallel_busy, NULL);
+
+  g_mutex_lock (&task->mutex);
+
+  if (--task->remaining == 0)
+    g_cond_signal (&task->cond);
+
+  g_mutex_unlock (&task->mutex);
+}
+
+static void
+gimp_parallel_distribute_range_func (gint                             i,
+                                     gint                             n,
+                                     GimpParallelDistributeRangeData *data)
+{
+  gsize offset;
+  gsize end;
+
+  offset = data->size * i       / n;
+  end    = data->size * (i + 1) / n;
+
+  if (end > offset)
+    data->func (offset, end - offset, data->user_data);
+}
+
+static void
+gimp_parallel_distribute_area_func (gint                            i,
+                                    gint                            n,
+                                    GimpParallelDistributeAreaData *data)
+{
+  GeglRectangle area = *data->area;
+
+  if (data->by_rows)
+    {
+      gint y1 = data->area->height * i       / n;
+      gint y2 = data->area->height * (i + 1) / n;
+
+      area.y      += y1;
+      area.height  = y2 - y1;
+    }
+  else
+    {
+      gint x1 = data->area->width * i       / n;
+      gint x2 = data->area->width * (i + 1) / n;
+
+      area.x     += x1;
+      area.width  = x2 - x1;
+    }
+
+  if (area.width > 0 && area.height > 0)
+    data->func (&area, data->user_data);
+}
@@ -45,6 +45,7 @@
 #include "gimp-contexts.h"
 #include "gimp-gradients.h"
 #include "gimp-modules.h"
+#include "gimp-parallel.h"
 #include "gimp-parasites.h"
 #include "gimp-templates.h"
 #include "gimp-units.h"
@@ -113,6 +114,9 @@ static void      gimp_edit_config_notify   (GObject           *edit_config,
                                             GParamSpec        *param_spec,
                                             GObject           *global_config);
 
+static void      gimp_restore_data_factory (Gimp              *gimp,
+                                            GimpDataFactory   *factory);
+
 
 G_DEFINE_TYPE (Gimp, gimp, GIMP_TYPE_OBJECT)
 
@@ -477,6 +481,9 @@ gimp_finalize (GObject *object)
 
   gimp_units_exit (gimp);
 
+  if (gimp->config)
+    gimp_parallel_exit (gimp);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -896,6 +903,21 @@ gimp_edit_config_notify (GObject    *edit_config,
   g_value_unset (&global_value);
 }
 
+/*  without a user interface, the data files are only loaded when
+ *  something asks for them, most batch jobs never do
+ */
+static void
+gimp_restore_data_factory (Gimp            *gimp,
+                           GimpDataFactory *factory)
+{
+  if (gimp->no_interface)
+    gimp_data_factory_data_init_lazy (factory, gimp->user_context,
+                                      gimp->no_data);
+  else
+    gimp_data_factory_data_init (factory, gimp->user_context,
+                                 gimp->no_data);
+}
+
 void
 gimp_load_config (Gimp        *gimp,
                   const gchar *alternate_system_gimprc,
@@ -961,40 +983,39 @@ gimp_restore (Gimp               *gimp,
 
   /*  initialize the list of gimp brushes    */
   status_callback (NULL, _("Brushes"), 0.1);
-  gimp_data_factory_data_init (gimp->brush_factory, gimp->user_context,
-                               gimp->no_data);
+  gimp_restore_data_factory (gimp, gimp->brush_factory);
 
   /*  initialize the list of gimp dynamics   */
   status_callback (NULL, _("Dynamics"), 0.2);
-  gimp_data_factory_data_init (gimp->dynamics_factory, gimp->user_context,
-                               gimp->no_data);
+  gimp_restore_data_factory (gimp, gimp->dynamics_factory);
 
   /*  initialize the list of gimp patterns   */
   status_callback (NULL, _("Patterns"), 0.3);
-  gimp_data_factory_data_init (gimp->pattern_factory, gimp->user_context,
-                               gimp->no_data);
+  gimp_restore_data_factory (gimp, gimp->pattern_factory);
 
   /*  initialize the list of gimp palettes   */
   status_callback (NULL, _("Palettes"), 0.4);
-  gimp_data_factory_data_init (gimp->palette_factory, gimp->user_context,
-                               gimp->no_data);
+  gimp_restore_data_factory (gimp, gimp->palette_factory);
 
   /*  initialize the list of gimp gradients  */
   status_callback (NULL, _("Gradients"), 0.5);
-  gimp_data_factory_data_init (gimp->gradient_factory, gimp->user_context,
-                               gimp->no_data);
+  gimp_restore_data_factory (gimp, gimp->gradient_factory);
 
   /*  initialize the list of fonts  */
   status_callback (NULL, _("Fonts (this may take a while)"), 0.6);
   if (! gimp->no_fonts)
-    gimp_fonts_load (gimp);
+    {
+      if (gimp->no_interface)
+        gimp_fonts_load_lazy (gimp);
+      else
+        gimp_fonts_load (gimp);
+    }
 
   /*  initialize the list of gimp tool presets if we have a GUI  */
   if (! gimp->no_interface)
     {
       status_callback (NULL, _("Tool Presets"), 0.65);
-      gimp_data_factory_data_init (gimp->tool_preset_factory, gimp->user_context,
-                                   gimp->no_data);
+      gimp_restore_data_factory (gimp, gimp->tool_preset_factory);
     }
 
   /*  initialize the template list  */
@@ -1009,17 +1030,17 @@ gimp_restore (Gimp               *gimp,
   status_callback (NULL, _("Updating tag cache"), 0.9);
   gimp_tag_cache_load (gimp->tag_cache);
   gimp_tag_cache_add_container (gimp->tag_cache,
-                                gimp_data_factory_get_container (gimp->brush_factory));
+                                gimp_data_factory_peek_container (gimp->brush_factory));
   gimp_tag_cache_add_container (gimp->tag_cache,
-                                gimp_data_factory_get_container (gimp->dynamics_factory));
+                                gimp_data_factory_peek_container (gimp->dynamics_factory));
   gimp_tag_cache_add_container (gimp->tag_cache,
-                                gimp_data_factory_get_container (gimp->pattern_factory));
+                                gimp_data_factory_peek_container (gimp->pattern_factory));
   gimp_tag_cache_add_container (gimp->tag_cache,
-                                gimp_data_factory_get_container (gimp->gradient_factory));
+                                gimp_data_factory_peek_container (gimp->gradient_factory));
   gimp_tag_cache_add_container (gimp->tag_cache,
-                                gimp_data_factory_get_container (gimp->palette_factory));
+                                gimp_data_factory_peek_container (gimp->palette_factory));
   gimp_tag_cache_add_container (gimp->tag_cache,
-                                gimp_data_factory_get_container (gimp->tool_preset_factory));
+                                gimp_data_factory_peek_container (gimp->tool_preset_factory));
 
   g_signal_emit (gimp, gimp_signals[RESTORE], 0, status_callback);
 }
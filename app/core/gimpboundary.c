@@ -26,12 +26,20 @@
 
 #include "core-types.h"
 
+#include "gimp-parallel.h"
 #include "gimpboundary.h"
 
 
 /* GimpBoundSeg array growth parameter */
 #define MAX_SEGS_INC  2048
 
+/* number of scanlines scanned as a unit, and cached by GimpBoundCache */
+#define BAND_HEIGHT   64
+
+/* GimpBoundIndex grid parameters */
+#define INDEX_MIN_CELL_SIZE   32
+#define INDEX_SEGS_PER_CELL   16
+
 
 typedef struct _GimpBoundary GimpBoundary;
 
@@ -44,12 +52,101 @@ struct _GimpBoundary
 
   /*  The array of vertical segments  */
   gint         *vert_segs;
+};
+
+typedef struct _GimpBoundaryParams GimpBoundaryParams;
+
+struct _GimpBoundaryParams
+{
+  GeglBuffer       *buffer;
+  GeglRectangle     region;
+  const Babl       *format;
+  GimpBoundaryType  type;
+  gint              x1;
+  gint              y1;
+  gint              x2;
+  gint              y2;
+  gfloat            threshold;
+
+  /*  The range of scanlines to scan  */
+  gint              start;
+  gint              end;
+};
+
+typedef struct _GimpBoundaryScanner GimpBoundaryScanner;
+
+struct _GimpBoundaryScanner
+{
+  const GimpBoundCache     *cache;
+  const GimpBoundaryParams *params;
 
   /*  The empty segment arrays */
-  gint         *empty_segs_n;
-  gint         *empty_segs_c;
-  gint         *empty_segs_l;
-  gint          max_empty_segs;
+  gint                     *empty_segs_n;
+  gint                     *empty_segs_c;
+  gint                     *empty_segs_l;
+  gint                      max_empty_segs;
+};
+
+typedef struct _GimpBoundBand GimpBoundBand;
+
+struct _GimpBoundBand
+{
+  /*  The runs of pixels above the threshold in the scanlines of the
+   *  band, as pairs of start and end x; the runs of scanline i occupy
+   *  runs[row_start[i]..row_start[i+1]]
+   */
+  gint  row_start[BAND_HEIGHT + 1];
+  gint *runs;
+};
+
+struct _GimpBoundCache
+{
+  /*  The mask the cached bands were scanned from  */
+  GeglBuffer     *buffer;
+  const Babl     *format;
+  gfloat          threshold;
+  gint            width;
+  gint            height;
+
+  /*  The bands of BAND_HEIGHT scanlines covering the buffer, NULL
+   *  for bands which need to be (re)scanned
+   */
+  gint            n_bands;
+  GimpBoundBand **bands;
+};
+
+typedef struct
+{
+  GimpBoundCache *cache;
+  gint           *dirty;
+  gint            n_dirty;
+} GimpBoundaryScanData;
+
+typedef struct
+{
+  const GimpBoundCache     *cache;
+  const GimpBoundaryParams *params;
+  gint                      n_bands;
+  GimpBoundary            **bands;
+} GimpBoundarySegsData;
+
+struct _GimpBoundIndex
+{
+  /*  The indexed segments, not owned by the index  */
+  const GimpBoundSeg *segs;
+  gint                num_segs;
+
+  /*  The extents of all segments, and the grid laid over them  */
+  GeglRectangle       bounds;
+  gint                cell_size;
+  gint                n_cols;
+  gint                n_rows;
+
+  /*  The segment indices of each cell, cell_start has n_cols * n_rows + 1
+   *  entries and cell i occupies cell_segs[cell_start[i]..cell_start[i+1]]
+   */
+  gint               *cell_start;
+  gint               *cell_segs;
 };
 
 
@@ -66,18 +163,16 @@ static void           gimp_boundary_add_seg    (GimpBoundary        *bounrady,
                                                 gint                 y2,
                                                 gboolean             open);
 
-static void           find_empty_segs          (const GeglRectangle *region,
-                                                const gfloat        *line_data,
+static GimpBoundaryScanner * gimp_boundary_scanner_new  (const GimpBoundCache     *cache,
+                                                         const GimpBoundaryParams *params);
+static void                  gimp_boundary_scanner_free (GimpBoundaryScanner      *scanner);
+
+static void           gimp_bound_band_free     (GimpBoundBand       *band);
+
+static void           find_empty_segs          (GimpBoundaryScanner *scanner,
                                                 gint                 scanline,
                                                 gint                 empty_segs[],
-                                                gint                 max_empty,
-                                                gint                *num_empty,
-                                                GimpBoundaryType     type,
-                                                gint                 x1,
-                                                gint                 y1,
-                                                gint                 x2,
-                                                gint                 y2,
-                                                gfloat               threshold);
+                                                gint                *num_empty);
 static void           process_horiz_seg        (GimpBoundary        *boundary,
                                                 gint                 x1,
                                                 gint                 y1,
@@ -91,15 +186,24 @@ static void           make_horiz_segs          (GimpBoundary        *boundary,
                                                 gint                 empty[],
                                                 gint                 num_empty,
                                                 gint                 top);
-static GimpBoundary * generate_boundary        (GeglBuffer          *buffer,
-                                                const GeglRectangle *region,
-                                                const Babl          *format,
-                                                GimpBoundaryType     type,
-                                                gint                 x1,
-                                                gint                 y1,
-                                                gint                 x2,
-                                                gint                 y2,
-                                                gfloat               threshold);
+static GimpBoundBand * scan_band               (GimpBoundCache      *cache,
+                                                gint                 band,
+                                                gfloat              *band_data,
+                                                GArray              *runs);
+static void           scan_bands_func          (gint                 i,
+                                                gint                 n,
+                                                GimpBoundaryScanData *data);
+static void           update_bands             (GimpBoundCache      *cache,
+                                                const GimpBoundaryParams *params);
+static void           make_band_segs           (GimpBoundaryScanner *scanner,
+                                                gint                 band_start,
+                                                gint                 band_end,
+                                                GimpBoundary        *band);
+static void           make_segs_func           (gint                 i,
+                                                gint                 n,
+                                                GimpBoundarySegsData *data);
+static GimpBoundary * generate_boundary        (GimpBoundCache      *cache,
+                                                const GimpBoundaryParams *params);
 
 static gint       cmp_segptr_xy1_addr     (const GimpBoundSeg **seg_ptr_a,
                                            const GimpBoundSeg **seg_ptr_b);
@@ -127,6 +231,13 @@ static void       simplify_subdivide  (const GimpBoundSeg  *segs,
                                        gint                 end_idx,
                                        GArray             **ret_points);
 
+static inline void index_seg_cells    (const GimpBoundIndex *index,
+                                       const GimpBoundSeg   *seg,
+                                       gint                 *col1,
+                                       gint                 *row1,
+                                       gint                 *col2,
+                                       gint                 *row2);
+
 
 /*  public functions  */
 
@@ -164,8 +275,53 @@ gimp_boundary_find (GeglBuffer          *buffer,
                     gfloat               threshold,
                     int                 *num_segs)
 {
-  GimpBoundary  *boundary;
-  GeglRectangle  rect = { 0, };
+  return gimp_boundary_find_cached (NULL, buffer, region, format, type,
+                                    x1, y1, x2, y2, threshold, num_segs);
+}
+
+/**
+ * gimp_boundary_find_cached:
+ * @cache:     a #GimpBoundCache, or %NULL
+ * @buffer:    a #GeglBuffer
+ * @region:    the region of @buffer to analyze, or %NULL for all of it
+ * @format:    a #Babl float format representing the component to analyze
+ * @type:      type of bounds
+ * @x1:        left side of bounds
+ * @y1:        top side of bounds
+ * @x2:        right side of bounds
+ * @y2:        botton side of bounds
+ * @threshold: pixel value of boundary line
+ * @num_segs:  number of returned #GimpBoundSeg's
+ *
+ * Like gimp_boundary_find(), but keeps the scanned rows of the mask
+ * in @cache. The cache doesn't depend on @region, @type or the
+ * bounds, so as long as it is called on the same @buffer with the
+ * same @format and @threshold, only the rows passed to
+ * gimp_boundary_cache_invalidate() since the last call are read
+ * again, even if the bounds have changed.
+ *
+ * The mask is scanned, and the segments are generated, in bands of
+ * scanlines which are processed in parallel; the result is identical
+ * to scanning it in one go.
+ *
+ * Return value: the boundary array.
+ **/
+GimpBoundSeg *
+gimp_boundary_find_cached (GimpBoundCache      *cache,
+                           GeglBuffer          *buffer,
+                           const GeglRectangle *region,
+                           const Babl          *format,
+                           GimpBoundaryType     type,
+                           gint                 x1,
+                           gint                 y1,
+                           gint                 x2,
+                           gint                 y2,
+                           gfloat               threshold,
+                           gint                *num_segs)
+{
+  GimpBoundCache     *tmp_cache = NULL;
+  GimpBoundary       *boundary;
+  GimpBoundaryParams  params    = { 0, };
 
   g_return_val_if_fail (GEGL_IS_BUFFER (buffer), NULL);
   g_return_val_if_fail (num_segs != NULL, NULL);
@@ -175,22 +331,131 @@ gimp_boundary_find (GeglBuffer          *buffer,
 
   if (region)
     {
-      rect = *region;
+      params.region = *region;
     }
   else
     {
-      rect.width  = gegl_buffer_get_width  (buffer);
-      rect.height = gegl_buffer_get_height (buffer);
+      params.region.width  = gegl_buffer_get_width  (buffer);
+      params.region.height = gegl_buffer_get_height (buffer);
+    }
+
+  params.buffer    = buffer;
+  params.format    = format;
+  params.type      = type;
+  params.x1        = x1;
+  params.y1        = y1;
+  params.x2        = x2;
+  params.y2        = y2;
+  params.threshold = threshold;
+
+  if (type == GIMP_BOUNDARY_WITHIN_BOUNDS)
+    {
+      params.start = y1;
+      params.end   = y2;
     }
+  else if (type == GIMP_BOUNDARY_IGNORE_BOUNDS)
+    {
+      params.start = params.region.y;
+      params.end   = params.region.y + params.region.height;
+    }
+
+  if (! cache)
+    cache = tmp_cache = gimp_boundary_cache_new ();
+
+  update_bands (cache, &params);
 
-  boundary = generate_boundary (buffer, &rect, format, type,
-                                x1, y1, x2, y2, threshold);
+  boundary = generate_boundary (cache, &params);
+
+  if (tmp_cache)
+    gimp_boundary_cache_free (tmp_cache);
 
   *num_segs = boundary->num_segs;
 
   return gimp_boundary_free (boundary, FALSE);
 }
 
+/**
+ * gimp_boundary_cache_new:
+ *
+ * Creates an empty cache for gimp_boundary_find_cached(). The cache
+ * doesn't reference the buffer it is used with, the caller has to
+ * call gimp_boundary_cache_clear() when switching to a different
+ * buffer and gimp_boundary_cache_invalidate() when the buffer's
+ * contents change.
+ *
+ * Return value: a new #GimpBoundCache.
+ **/
+GimpBoundCache *
+gimp_boundary_cache_new (void)
+{
+  return g_slice_new0 (GimpBoundCache);
+}
+
+void
+gimp_boundary_cache_free (GimpBoundCache *cache)
+{
+  g_return_if_fail (cache != NULL);
+
+  gimp_boundary_cache_clear (cache);
+
+  g_slice_free (GimpBoundCache, cache);
+}
+
+void
+gimp_boundary_cache_clear (GimpBoundCache *cache)
+{
+  gint i;
+
+  g_return_if_fail (cache != NULL);
+
+  for (i = 0; i < cache->n_bands; i++)
+    {
+      if (cache->bands[i])
+        gimp_bound_band_free (cache->bands[i]);
+    }
+
+  g_free (cache->bands);
+
+  cache->buffer  = NULL;
+  cache->bands   = NULL;
+  cache->n_bands = 0;
+}
+
+/**
+ * gimp_boundary_cache_invalidate:
+ * @cache:  a #GimpBoundCache
+ * @y:      the first changed row of the buffer
+ * @height: the number of changed rows
+ *
+ * Marks rows [@y, @y + @height) of the cached buffer for rescanning
+ * by the next gimp_boundary_find_cached().
+ **/
+void
+gimp_boundary_cache_invalidate (GimpBoundCache *cache,
+                                gint            y,
+                                gint            height)
+{
+  gint band1, band2;
+  gint i;
+
+  g_return_if_fail (cache != NULL);
+
+  if (height <= 0 || y + height <= 0 || cache->n_bands == 0)
+    return;
+
+  band1 = MAX (y, 0) / BAND_HEIGHT;
+  band2 = MIN ((y + height - 1) / BAND_HEIGHT, cache->n_bands - 1);
+
+  for (i = band1; i <= band2; i++)
+    {
+      if (cache->bands[i])
+        {
+          gimp_bound_band_free (cache->bands[i]);
+          cache->bands[i] = NULL;
+        }
+    }
+}
+
 /**
  * gimp_boundary_sort:
  * @segs:       unsorted input segs.
@@ -403,6 +668,193 @@ gimp_boundary_offset (GimpBoundSeg *segs,
     }
 }
 
+/**
+ * gimp_boundary_index_new:
+ * @segs:     the segments to index
+ * @num_segs: number of segments in @segs
+ *
+ * Builds a uniform grid over the extents of @segs, so that the
+ * segments intersecting a given rectangle can be found without
+ * looking at all of them. The index references @segs, which must
+ * stay valid and unchanged for the lifetime of the index.
+ *
+ * Return value: a new #GimpBoundIndex, free with
+ *               gimp_boundary_index_free().
+ **/
+GimpBoundIndex *
+gimp_boundary_index_new (const GimpBoundSeg *segs,
+                         gint                num_segs)
+{
+  GimpBoundIndex *index;
+  gint            x1, y1, x2, y2;
+  gint            n_cells;
+  gint           *fill;
+  gint            i;
+
+  g_return_val_if_fail (segs != NULL || num_segs == 0, NULL);
+
+  index = g_slice_new0 (GimpBoundIndex);
+
+  index->segs     = segs;
+  index->num_segs = num_segs;
+
+  x1 = y1 = G_MAXINT;
+  x2 = y2 = G_MININT;
+
+  for (i = 0; i < num_segs; i++)
+    {
+      x1 = MIN (x1, MIN (segs[i].x1, segs[i].x2));
+      y1 = MIN (y1, MIN (segs[i].y1, segs[i].y2));
+      x2 = MAX (x2, MAX (segs[i].x1, segs[i].x2));
+      y2 = MAX (y2, MAX (segs[i].y1, segs[i].y2));
+    }
+
+  if (num_segs == 0)
+    x1 = y1 = x2 = y2 = 0;
+
+  index->bounds.x      = x1;
+  index->bounds.y      = y1;
+  index->bounds.width  = x2 - x1 + 1;
+  index->bounds.height = y2 - y1 + 1;
+
+  /*  aim for a handful of segments per cell, but don't let the cells
+   *  get so small that long segments end up in too many of them
+   */
+  index->cell_size = sqrt ((gdouble) index->bounds.width *
+                           (gdouble) index->bounds.height *
+                           INDEX_SEGS_PER_CELL / MAX (num_segs, 1));
+  index->cell_size = MAX (index->cell_size, INDEX_MIN_CELL_SIZE);
+
+  index->n_cols = (index->bounds.width  + index->cell_size - 1) /
+                  index->cell_size;
+  index->n_rows = (index->bounds.height + index->cell_size - 1) /
+                  index->cell_size;
+
+  n_cells = index->n_cols * index->n_rows;
+
+  index->cell_start = g_new0 (gint, n_cells + 1);
+
+  /*  count the segments of each cell...  */
+  for (i = 0; i < num_segs; i++)
+    {
+      gint col1, row1, col2, row2;
+      gint row, col;
+
+      index_seg_cells (index, &segs[i], &col1, &row1, &col2, &row2);
+
+      for (row = row1; row <= row2; row++)
+        for (col = col1; col <= col2; col++)
+          index->cell_start[row * index->n_cols + col + 1]++;
+    }
+
+  for (i = 0; i < n_cells; i++)
+    index->cell_start[i + 1] += index->cell_start[i];
+
+  /*  ...and fill them in, in ascending segment order  */
+  index->cell_segs = g_new (gint, index->cell_start[n_cells]);
+
+  fill = g_memdup (index->cell_start, sizeof (gint) * n_cells);
+
+  for (i = 0; i < num_segs; i++)
+    {
+      gint col1, row1, col2, row2;
+      gint row, col;
+
+      index_seg_cells (index, &segs[i], &col1, &row1, &col2, &row2);
+
+      for (row = row1; row <= row2; row++)
+        for (col = col1; col <= col2; col++)
+          index->cell_segs[fill[row * index->n_cols + col]++] = i;
+    }
+
+  g_free (fill);
+
+  return index;
+}
+
+void
+gimp_boundary_index_free (GimpBoundIndex *index)
+{
+  g_return_if_fail (index != NULL);
+
+  g_free (index->cell_start);
+  g_free (index->cell_segs);
+
+  g_slice_free (GimpBoundIndex, index);
+}
+
+/**
+ * gimp_boundary_index_query:
+ * @index:   a #GimpBoundIndex
+ * @rect:    the rectangle to look up
+ * @indices: return location for the segment indices, must have room
+ *           for as many segments as the index was created with
+ *
+ * Finds all indexed segments which touch @rect, edges included. Each
+ * segment is returned only once, even if it spans multiple cells of
+ * the index.
+ *
+ * Return value: the number of indices stored in @indices.
+ **/
+gint
+gimp_boundary_index_query (const GimpBoundIndex *index,
+                           const GeglRectangle  *rect,
+                           gint                 *indices)
+{
+  gint x1, y1, x2, y2;
+  gint qcol1, qrow1, qcol2, qrow2;
+  gint row, col;
+  gint n = 0;
+
+  g_return_val_if_fail (index != NULL, 0);
+  g_return_val_if_fail (rect != NULL, 0);
+  g_return_val_if_fail (indices != NULL || index->num_segs == 0, 0);
+
+  x1 = MAX (rect->x, index->bounds.x);
+  y1 = MAX (rect->y, index->bounds.y);
+  x2 = MIN (rect->x + rect->width,
+            index->bounds.x + index->bounds.width  - 1);
+  y2 = MIN (rect->y + rect->height,
+            index->bounds.y + index->bounds.height - 1);
+
+  if (index->num_segs == 0 || x1 > x2 || y1 > y2)
+    return 0;
+
+  qcol1 = (x1 - index->bounds.x) / index->cell_size;
+  qrow1 = (y1 - index->bounds.y) / index->cell_size;
+  qcol2 = (x2 - index->bounds.x) / index->cell_size;
+  qrow2 = (y2 - index->bounds.y) / index->cell_size;
+
+  for (row = qrow1; row <= qrow2; row++)
+    {
+      for (col = qcol1; col <= qcol2; col++)
+        {
+          gint cell = row * index->n_cols + col;
+          gint i;
+
+          for (i = index->cell_start[cell]; i < index->cell_start[cell + 1]; i++)
+            {
+              const GimpBoundSeg *seg = &index->segs[index->cell_segs[i]];
+              gint                col1, row1, col2, row2;
+
+              if (MAX (seg->x1, seg->x2) < x1 || MIN (seg->x1, seg->x2) > x2 ||
+                  MAX (seg->y1, seg->y2) < y1 || MIN (seg->y1, seg->y2) > y2)
+                continue;
+
+              /*  a segment spanning several cells is only reported by
+               *  the first of its cells which is part of the query
+               */
+              index_seg_cells (index, seg, &col1, &row1, &col2, &row2);
+
+              if (col == MAX (col1, qcol1) && row == MAX (row1, qrow1))
+                indices[n++] = index->cell_segs[i];
+            }
+        }
+    }
+
+  return n;
+}
+
 
 /*  private functions  */
 
@@ -422,15 +874,6 @@ gimp_boundary_new (const GeglRectangle *region)
 
       for (i = 0; i <= (region->width + region->x); i++)
         boundary->vert_segs[i] = -1;
-
-      /*  find the maximum possible number of empty segments
-       *  given the current mask
-       */
-      boundary->max_empty_segs = region->width + 3;
-
-      boundary->empty_segs_n = g_new (gint, boundary->max_empty_segs);
-      boundary->empty_segs_c = g_new (gint, boundary->max_empty_segs);
-      boundary->empty_segs_l = g_new (gint, boundary->max_empty_segs);
     }
 
   return boundary;
@@ -448,15 +891,52 @@ gimp_boundary_free (GimpBoundary *boundary,
     segs = boundary->segs;
 
   g_free (boundary->vert_segs);
-  g_free (boundary->empty_segs_n);
-  g_free (boundary->empty_segs_c);
-  g_free (boundary->empty_segs_l);
 
   g_slice_free (GimpBoundary, boundary);
 
   return segs;
 }
 
+static GimpBoundaryScanner *
+gimp_boundary_scanner_new (const GimpBoundCache     *cache,
+                           const GimpBoundaryParams *params)
+{
+  GimpBoundaryScanner *scanner = g_slice_new0 (GimpBoundaryScanner);
+
+  scanner->cache  = cache;
+  scanner->params = params;
+
+  /*  find the maximum possible number of empty segments
+   *  given the current mask
+   */
+  scanner->max_empty_segs = MAX (params->region.width,
+                                 params->x2 - params->x1) + 3;
+
+  scanner->empty_segs_n = g_new (gint, scanner->max_empty_segs);
+  scanner->empty_segs_c = g_new (gint, scanner->max_empty_segs);
+  scanner->empty_segs_l = g_new (gint, scanner->max_empty_segs);
+
+  return scanner;
+}
+
+static void
+gimp_boundary_scanner_free (GimpBoundaryScanner *scanner)
+{
+  g_free (scanner->empty_segs_n);
+  g_free (scanner->empty_segs_c);
+  g_free (scanner->empty_segs_l);
+
+  g_slice_free (GimpBoundaryScanner, scanner);
+}
+
+static void
+gimp_bound_band_free (GimpBoundBand *band)
+{
+  g_free (band->runs);
+
+  g_slice_free (GimpBoundBand, band);
+}
+
 static void
 gimp_boundary_add_seg (GimpBoundary *boundary,
                        gint          x1,
@@ -482,116 +962,83 @@ gimp_boundary_add_seg (GimpBoundary *boundary,
 }
 
 static void
-find_empty_segs (const GeglRectangle *region,
-                 const gfloat        *line_data,
+find_empty_segs (GimpBoundaryScanner *scanner,
                  gint                 scanline,
                  gint                 empty_segs[],
-                 gint                 max_empty,
-                 gint                *num_empty,
-                 GimpBoundaryType     type,
-                 gint                 x1,
-                 gint                 y1,
-                 gint                 x2,
-                 gint                 y2,
-                 gfloat               threshold)
-{
-  gint start = 0;
-  gint end   = 0;
-  gint endx  = 0;
-  gint last  = -1;
-  gint l_num_empty;
-  gint x;
+                 gint                *num_empty)
+{
+  const GimpBoundCache     *cache      = scanner->cache;
+  const GimpBoundaryParams *params     = scanner->params;
+  const GimpBoundBand      *band;
+  gint                      start      = 0;
+  gint                      end        = 0;
+  gint                      hole_start = 0;
+  gint                      hole_end   = 0;
+  gint                      row;
+  gint                      i;
 
   *num_empty = 0;
 
-  if (scanline < region->y || scanline >= (region->y + region->height))
+  empty_segs[(*num_empty)++] = 0;
+
+  if (scanline <  params->start                             ||
+      scanline >= params->end                               ||
+      scanline <  params->region.y                          ||
+      scanline >= params->region.y + params->region.height  ||
+      scanline <  0                                         ||
+      scanline >= cache->height)
     {
-      empty_segs[(*num_empty)++] = 0;
       empty_segs[(*num_empty)++] = G_MAXINT;
       return;
     }
 
-  if (type == GIMP_BOUNDARY_WITHIN_BOUNDS)
+  /*  clip the cached runs of the scanline to the bounds  */
+  if (params->type == GIMP_BOUNDARY_WITHIN_BOUNDS)
     {
-      if (scanline < y1 || scanline >= y2)
-        {
-          empty_segs[(*num_empty)++] = 0;
-          empty_segs[(*num_empty)++] = G_MAXINT;
-          return;
-        }
-
-      start = x1;
-      end   = x2;
+      start = params->x1;
+      end   = params->x2;
     }
-  else if (type == GIMP_BOUNDARY_IGNORE_BOUNDS)
+  else if (params->type == GIMP_BOUNDARY_IGNORE_BOUNDS)
     {
-      start = region->x;
-      end   = region->x + region->width;
-      if (scanline < y1 || scanline >= y2)
-        x2 = -1;
-    }
-
-  empty_segs[(*num_empty)++] = 0;
+      start = params->region.x;
+      end   = params->region.x + params->region.width;
 
-  l_num_empty = *num_empty;
-
-  endx = end;
-
-  line_data += start;
-
-  for (x = start; x < end;)
-    {
-      if (type == GIMP_BOUNDARY_IGNORE_BOUNDS && (endx > x1 || x < x2))
+      if (scanline >= params->y1 && scanline < params->y2 &&
+          params->x1 < params->x2)
         {
-          for (; x < endx; x++)
-            {
-              gint val;
+          hole_start = params->x1;
+          hole_end   = params->x2;
+        }
+    }
 
-              if (*line_data > threshold)
-                {
-                  if (x >= x1 && x < x2)
-                    val = -1;
-                  else
-                    val = 1;
-                }
-              else
-                {
-                  val = -1;
-                }
+  band = cache->bands[scanline / BAND_HEIGHT];
+  row  = scanline % BAND_HEIGHT;
 
-              line_data++;
+  for (i = band->row_start[row]; i < band->row_start[row + 1]; i += 2)
+    {
+      gint run_start = MAX (band->runs[i],     start);
+      gint run_end   = MIN (band->runs[i + 1], end);
 
-              if (last != val)
-                empty_segs[l_num_empty++] = x;
+      if (run_start >= run_end)
+        continue;
 
-              last = val;
-            }
-        }
-      else
+      if (run_start < hole_end && run_end > hole_start)
         {
-          for (; x < endx; x++)
+          if (run_start < hole_start)
             {
-              gint val;
-
-              if (*line_data > threshold)
-                val = 1;
-              else
-                val = -1;
-
-              line_data++;
+              empty_segs[(*num_empty)++] = run_start;
+              empty_segs[(*num_empty)++] = hole_start;
+            }
 
-              if (last != val)
-                empty_segs[l_num_empty++] = x;
+          run_start = hole_end;
 
-              last = val;
-            }
+          if (run_start >= run_end)
+            continue;
         }
-    }
-
-  *num_empty = l_num_empty;
 
-  if (last > 0)
-    empty_segs[(*num_empty)++] = x;
+      empty_segs[(*num_empty)++] = run_start;
+      empty_segs[(*num_empty)++] = run_end;
+    }
 
   empty_segs[(*num_empty)++] = G_MAXINT;
 }
@@ -645,122 +1092,285 @@ make_horiz_segs (GimpBoundary *boundary,
 
       if (e_s <= start && e_e >= end)
         {
-          process_horiz_seg (boundary,
-                             start, scanline, end, scanline, top);
+          gimp_boundary_add_seg (boundary,
+                                 start, scanline, end, scanline, top);
         }
       else if ((e_s > start && e_s < end) ||
                (e_e < end && e_e > start))
         {
-          process_horiz_seg (boundary,
-                             MAX (e_s, start), scanline,
-                             MIN (e_e, end), scanline, top);
+          gimp_boundary_add_seg (boundary,
+                                 MAX (e_s, start), scanline,
+                                 MIN (e_e, end), scanline, top);
         }
     }
 }
 
-static GimpBoundary *
-generate_boundary (GeglBuffer          *buffer,
-                   const GeglRectangle *region,
-                   const Babl          *format,
-                   GimpBoundaryType     type,
-                   gint                 x1,
-                   gint                 y1,
-                   gint                 x2,
-                   gint                 y2,
-                   gfloat               threshold)
-{
-  GimpBoundary  *boundary;
-  GeglRectangle  line_rect = { 0, };
-  gfloat        *line_data;
-  gint           scanline;
-  gint           i;
-  gint           start, end;
-  gint          *tmp_segs;
-
-  gint          num_empty_n = 0;
-  gint          num_empty_c = 0;
-  gint          num_empty_l = 0;
-
-  boundary = gimp_boundary_new (region);
-
-  line_rect.width  = gegl_buffer_get_width (buffer);
-  line_rect.height = 1;
-
-  line_data = g_alloca (sizeof (gfloat) * line_rect.width);
-
-  start = 0;
-  end   = 0;
+static GimpBoundBand *
+scan_band (GimpBoundCache *cache,
+           gint            band,
+           gfloat         *band_data,
+           GArray         *runs)
+{
+  GimpBoundBand *bound_band = g_slice_new (GimpBoundBand);
+  GeglRectangle  band_rect;
+  gint           row;
 
-  if (type == GIMP_BOUNDARY_WITHIN_BOUNDS)
+  band_rect.x      = 0;
+  band_rect.y      = band * BAND_HEIGHT;
+  band_rect.width  = cache->width;
+  band_rect.height = MIN (BAND_HEIGHT, cache->height - band_rect.y);
+
+  gegl_buffer_get (cache->buffer, &band_rect, 1.0, cache->format,
+                   band_data, GEGL_AUTO_ROWSTRIDE,
+                   GEGL_ABYSS_NONE);
+
+  g_array_set_size (runs, 0);
+
+  for (row = 0; row < BAND_HEIGHT; row++)
+    {
+      bound_band->row_start[row] = runs->len;
+
+      if (row < band_rect.height)
+        {
+          const gfloat *line_data = band_data + row * cache->width;
+          gint          run_start = -1;
+          gint          x;
+
+          for (x = 0; x < cache->width; x++)
+            {
+              if (line_data[x] > cache->threshold)
+                {
+                  if (run_start < 0)
+                    run_start = x;
+                }
+              else if (run_start >= 0)
+                {
+                  g_array_append_val (runs, run_start);
+                  g_array_append_val (runs, x);
+
+                  run_start = -1;
+                }
+            }
+
+          if (run_start >= 0)
+            {
+              g_array_append_val (runs, run_start);
+              g_array_append_val (runs, x);
+            }
+        }
+    }
+
+  bound_band->row_start[BAND_HEIGHT] = runs->len;
+
+  bound_band->runs = g_memdup (runs->data, runs->len * sizeof (gint));
+
+  return bound_band;
+}
+
+static void
+scan_bands_func (gint                  i,
+                 gint                  n,
+                 GimpBoundaryScanData *data)
+{
+  GimpBoundCache *cache = data->cache;
+  gfloat         *band_data;
+  GArray         *runs;
+  gint            j;
+
+  band_data = g_new (gfloat, (gsize) cache->width * BAND_HEIGHT);
+  runs      = g_array_new (FALSE, FALSE, sizeof (gint));
+
+  for (j = i; j < data->n_dirty; j += n)
     {
-      start = y1;
-      end   = y2;
+      gint band = data->dirty[j];
+
+      cache->bands[band] = scan_band (cache, band, band_data, runs);
     }
-  else if (type == GIMP_BOUNDARY_IGNORE_BOUNDS)
+
+  g_array_free (runs, TRUE);
+  g_free (band_data);
+}
+
+static void
+update_bands (GimpBoundCache           *cache,
+              const GimpBoundaryParams *params)
+{
+  GimpBoundaryScanData data;
+  gint                 y1, y2;
+  gint                 i;
+
+  if (cache->buffer    != params->buffer                          ||
+      cache->format    != params->format                          ||
+      cache->threshold != params->threshold                       ||
+      cache->width     != gegl_buffer_get_width  (params->buffer) ||
+      cache->height    != gegl_buffer_get_height (params->buffer))
     {
-      start = region->y;
-      end   = region->y + region->height;
+      gimp_boundary_cache_clear (cache);
+
+      cache->buffer    = params->buffer;
+      cache->format    = params->format;
+      cache->threshold = params->threshold;
+      cache->width     = gegl_buffer_get_width  (params->buffer);
+      cache->height    = gegl_buffer_get_height (params->buffer);
+
+      cache->n_bands   = (cache->height + BAND_HEIGHT - 1) / BAND_HEIGHT;
+      cache->bands     = g_new0 (GimpBoundBand *, MAX (cache->n_bands, 1));
     }
 
-  /*  Find the empty segments for the previous and current scanlines  */
-  find_empty_segs (region, NULL,
-                   start - 1, boundary->empty_segs_l,
-                   boundary->max_empty_segs, &num_empty_l,
-                   type, x1, y1, x2, y2,
-                   threshold);
-
-  line_rect.y = start;
-  gegl_buffer_get (buffer, &line_rect, 1.0, format,
-                   line_data, GEGL_AUTO_ROWSTRIDE,
-                   GEGL_ABYSS_NONE);
+  if (params->end <= params->start)
+    return;
+
+  /*  the segments of the scanned range depend on the scanlines just
+   *  above and below it too
+   */
+  y1 = MAX (params->start - 1, 0);
+  y2 = MIN (params->end + 1,   cache->height);
 
-  find_empty_segs (region, line_data,
-                   start, boundary->empty_segs_c,
-                   boundary->max_empty_segs, &num_empty_c,
-                   type, x1, y1, x2, y2,
-                   threshold);
+  if (y2 <= y1)
+    return;
+
+  data.cache   = cache;
+  data.dirty   = g_new (gint, cache->n_bands);
+  data.n_dirty = 0;
+
+  for (i = y1 / BAND_HEIGHT; i <= (y2 - 1) / BAND_HEIGHT; i++)
+    {
+      if (! cache->bands[i])
+        data.dirty[data.n_dirty++] = i;
+    }
 
-  for (scanline = start; scanline < end; scanline++)
+  if (data.n_dirty > 0)
+    {
+      gimp_parallel_distribute (data.n_dirty,
+                                (GimpParallelDistributeFunc) scan_bands_func,
+                                &data);
+    }
+
+  g_free (data.dirty);
+}
+
+static void
+make_band_segs (GimpBoundaryScanner *scanner,
+                gint                 band_start,
+                gint                 band_end,
+                GimpBoundary        *band)
+{
+  gint  scanline;
+  gint  i;
+  gint *tmp_segs;
+
+  gint  num_empty_n = 0;
+  gint  num_empty_c = 0;
+  gint  num_empty_l = 0;
+
+  /*  Find the empty segments for the previous and current scanlines  */
+  find_empty_segs (scanner, band_start - 1,
+                   scanner->empty_segs_l, &num_empty_l);
+  find_empty_segs (scanner, band_start,
+                   scanner->empty_segs_c, &num_empty_c);
+
+  for (scanline = band_start; scanline < band_end; scanline++)
     {
       /*  find the empty segment list for the next scanline  */
-      line_rect.y = scanline + 1;
-      if (scanline + 1 == end)
-        line_data = NULL;
-      else
-        gegl_buffer_get (buffer, &line_rect, 1.0, format,
-                         line_data, GEGL_AUTO_ROWSTRIDE,
-                         GEGL_ABYSS_NONE);
-
-      find_empty_segs (region, line_data,
-                       scanline + 1, boundary->empty_segs_n,
-                       boundary->max_empty_segs, &num_empty_n,
-                       type, x1, y1, x2, y2,
-                       threshold);
+      find_empty_segs (scanner, scanline + 1,
+                       scanner->empty_segs_n, &num_empty_n);
 
       /*  process the segments on the current scanline  */
       for (i = 1; i < num_empty_c - 1; i += 2)
         {
-          make_horiz_segs (boundary,
-                           boundary->empty_segs_c [i],
-                           boundary->empty_segs_c [i+1],
+          make_horiz_segs (band,
+                           scanner->empty_segs_c [i],
+                           scanner->empty_segs_c [i+1],
                            scanline,
-                           boundary->empty_segs_l, num_empty_l, 1);
-          make_horiz_segs (boundary,
-                           boundary->empty_segs_c [i],
-                           boundary->empty_segs_c [i+1],
+                           scanner->empty_segs_l, num_empty_l, 1);
+          make_horiz_segs (band,
+                           scanner->empty_segs_c [i],
+                           scanner->empty_segs_c [i+1],
                            scanline + 1,
-                           boundary->empty_segs_n, num_empty_n, 0);
+                           scanner->empty_segs_n, num_empty_n, 0);
         }
 
       /*  get the next scanline of empty segments, swap others  */
-      tmp_segs               = boundary->empty_segs_l;
-      boundary->empty_segs_l = boundary->empty_segs_c;
-      num_empty_l            = num_empty_c;
-      boundary->empty_segs_c = boundary->empty_segs_n;
-      num_empty_c            = num_empty_n;
-      boundary->empty_segs_n = tmp_segs;
+      tmp_segs              = scanner->empty_segs_l;
+      scanner->empty_segs_l = scanner->empty_segs_c;
+      num_empty_l           = num_empty_c;
+      scanner->empty_segs_c = scanner->empty_segs_n;
+      num_empty_c           = num_empty_n;
+      scanner->empty_segs_n = tmp_segs;
+    }
+}
+
+static void
+make_segs_func (gint                  i,
+                gint                  n,
+                GimpBoundarySegsData *data)
+{
+  const GimpBoundaryParams *params = data->params;
+  GimpBoundaryScanner      *scanner;
+  gint                      j;
+
+  scanner = gimp_boundary_scanner_new (data->cache, params);
+
+  for (j = i; j < data->n_bands; j += n)
+    {
+      gint          band_start = params->start + j * BAND_HEIGHT;
+      gint          band_end   = MIN (band_start + BAND_HEIGHT, params->end);
+      GimpBoundary *boundary   = gimp_boundary_new (NULL);
+
+      make_band_segs (scanner, band_start, band_end, boundary);
+
+      data->bands[j] = boundary;
     }
 
+  gimp_boundary_scanner_free (scanner);
+}
+
+static GimpBoundary *
+generate_boundary (GimpBoundCache           *cache,
+                   const GimpBoundaryParams *params)
+{
+  GimpBoundary         *boundary;
+  GimpBoundarySegsData  data;
+  gint                  i;
+
+  boundary = gimp_boundary_new (&params->region);
+
+  if (params->end <= params->start)
+    return boundary;
+
+  data.cache   = cache;
+  data.params  = params;
+  data.n_bands = (params->end - params->start + BAND_HEIGHT - 1) /
+                 BAND_HEIGHT;
+  data.bands   = g_new0 (GimpBoundary *, data.n_bands);
+
+  /*  find the horizontal segments of each band of the bounds...  */
+  gimp_parallel_distribute (data.n_bands,
+                            (GimpParallelDistributeFunc) make_segs_func,
+                            &data);
+
+  /*  ...and join them in scanline order, adding the vertical segments
+   *  which close them
+   */
+  for (i = 0; i < data.n_bands; i++)
+    {
+      GimpBoundary *band = data.bands[i];
+      gint          j;
+
+      for (j = 0; j < band->num_segs; j++)
+        {
+          const GimpBoundSeg *seg = &band->segs[j];
+
+          process_horiz_seg (boundary,
+                             seg->x1, seg->y1, seg->x2, seg->y2,
+                             seg->open);
+        }
+
+      gimp_boundary_free (band, TRUE);
+    }
+
+  g_free (data.bands);
+
   return boundary;
 }
 
@@ -1009,3 +1619,17 @@ simplify_subdivide (const GimpBoundSeg *segs,
   simplify_subdivide (segs, start_idx, maxdist_idx, ret_points);
   simplify_subdivide (segs, maxdist_idx, end_idx, ret_points);
 }
+
+static inline void
+index_seg_cells (const GimpBoundIndex *index,
+                 const GimpBoundSeg   *seg,
+                 gint                 *col1,
+                 gint                 *row1,
+                 gint                 *col2,
+                 gint                 *row2)
+{
+  *col1 = (MIN (seg->x1, seg->x2) - index->bounds.x) / index->cell_size;
+  *row1 = (MIN (seg->y1, seg->y2) - index->bounds.y) / index->cell_size;
+  *col2 = (MAX (seg->x1, seg->x2) - index->bounds.x) / index->cell_size;
+  *row2 = (MAX (seg->y1, seg->y2) - index->bounds.y) / index->cell_size;
+}
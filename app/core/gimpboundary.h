@@ -64,5 +64,31 @@ void       gimp_boundary_offset        (GimpBoundSeg        *segs,
                                         gint                 off_x,
                                         gint                 off_y);
 
+GimpBoundSeg   * gimp_boundary_find_cached      (GimpBoundCache      *cache,
+                                                 GeglBuffer          *buffer,
+                                                 const GeglRectangle *region,
+                                                 const Babl          *format,
+                                                 GimpBoundaryType     type,
+                                                 gint                 x1,
+                                                 gint                 y1,
+                                                 gint                 x2,
+                                                 gint                 y2,
+                                                 gfloat               threshold,
+                                                 gint                *num_segs);
+
+GimpBoundCache * gimp_boundary_cache_new        (void);
+void             gimp_boundary_cache_free       (GimpBoundCache      *cache);
+void             gimp_boundary_cache_clear      (GimpBoundCache      *cache);
+void             gimp_boundary_cache_invalidate (GimpBoundCache      *cache,
+                                                 gint                 y,
+                                                 gint                 height);
+
+GimpBoundIndex * gimp_boundary_index_new   (const GimpBoundSeg   *segs,
+                                            gint                  num_segs);
+void             gimp_boundary_index_free  (GimpBoundIndex       *index);
+gint             gimp_boundary_index_query (const GimpBoundIndex *index,
+                                            const GeglRectangle  *rect,
+                                            gint                 *indices);
+
 
 #endif  /*  __GIMP_BOUNDARY_H__  */
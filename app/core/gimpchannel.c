@@ -46,6 +46,7 @@
 #include "gimpchannel.h"
 #include "gimpchannel-select.h"
 #include "gimpcontext.h"
+#include "gimpdrawable-convert.h"
 #include "gimpdrawable-stroke.h"
 #include "gimpmarshal.h"
 #include "gimppaintinfo.h"
@@ -137,6 +138,11 @@ static void       gimp_channel_convert_type  (GimpDrawable      *drawable,
                                               gint               mask_dither_type,
                                               gboolean           push_undo);
 static void gimp_channel_invalidate_boundary   (GimpDrawable       *drawable);
+static void gimp_channel_update              (GimpDrawable       *drawable,
+                                              gint                x,
+                                              gint                y,
+                                              gint                width,
+                                              gint                height);
 static void gimp_channel_get_active_components (const GimpDrawable *drawable,
                                                 gboolean           *active);
 static GimpComponentMask
@@ -290,6 +296,7 @@ gimp_channel_class_init (GimpChannelClass *klass)
   item_class->lower_failed         = _("Channel cannot be lowered more.");
 
   drawable_class->convert_type          = gimp_channel_convert_type;
+  drawable_class->update                = gimp_channel_update;
   drawable_class->invalidate_boundary   = gimp_channel_invalidate_boundary;
   drawable_class->get_active_components = gimp_channel_get_active_components;
   drawable_class->get_active_mask       = gimp_channel_get_active_mask;
@@ -333,6 +340,7 @@ gimp_channel_init (GimpChannel *channel)
   channel->segs_out       = NULL;
   channel->num_segs_in    = 0;
   channel->num_segs_out   = 0;
+  channel->bound_cache    = gimp_boundary_cache_new ();
   channel->empty          = FALSE;
   channel->bounds_known   = FALSE;
   channel->x1             = 0;
@@ -364,6 +372,12 @@ gimp_channel_finalize (GObject *object)
       channel->segs_out = NULL;
     }
 
+  if (channel->bound_cache)
+    {
+      gimp_boundary_cache_free (channel->bound_cache);
+      channel->bound_cache = NULL;
+    }
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -864,31 +878,26 @@ gimp_channel_convert_type (GimpDrawable      *drawable,
 {
   GeglBuffer *dest_buffer;
 
-  dest_buffer =
-    gegl_buffer_new (GEGL_RECTANGLE (0, 0,
-                                     gimp_item_get_width  (GIMP_ITEM (drawable)),
-                                     gimp_item_get_height (GIMP_ITEM (drawable))),
-                     new_format);
+  dest_buffer = gimp_drawable_convert_buffer (drawable, new_format,
+                                              mask_dither_type);
 
-  if (mask_dither_type == 0)
-    {
-      gegl_buffer_copy (gimp_drawable_get_buffer (drawable), NULL,
-                        dest_buffer, NULL);
-    }
-  else
-    {
-      gint bits;
+  gimp_drawable_set_buffer (drawable, push_undo, NULL, dest_buffer);
+  g_object_unref (dest_buffer);
+}
 
-      bits = (babl_format_get_bytes_per_pixel (new_format) * 8 /
-              babl_format_get_n_components (new_format));
+static void
+gimp_channel_update (GimpDrawable *drawable,
+                     gint          x,
+                     gint          y,
+                     gint          width,
+                     gint          height)
+{
+  GimpChannel *channel = GIMP_CHANNEL (drawable);
 
-      gimp_gegl_apply_color_reduction (gimp_drawable_get_buffer (drawable),
-                                       NULL, NULL,
-                                       dest_buffer, bits, mask_dither_type);
-    }
+  /*  only the changed rows need to be rescanned  */
+  gimp_boundary_cache_invalidate (channel->bound_cache, y, height);
 
-  gimp_drawable_set_buffer (drawable, push_undo, NULL, dest_buffer);
-  g_object_unref (dest_buffer);
+  GIMP_DRAWABLE_CLASS (parent_class)->update (drawable, x, y, width, height);
 }
 
 static void
@@ -969,12 +978,16 @@ gimp_channel_set_buffer (GimpDrawable *drawable,
                          gint          offset_x,
                          gint          offset_y)
 {
+  GimpChannel *channel = GIMP_CHANNEL (drawable);
+
   GIMP_DRAWABLE_CLASS (parent_class)->set_buffer (drawable,
                                                   push_undo, undo_desc,
                                                   buffer,
                                                   offset_x, offset_y);
 
-  GIMP_CHANNEL (drawable)->bounds_known = FALSE;
+  gimp_boundary_cache_clear (channel->bound_cache);
+
+  channel->bounds_known = FALSE;
 }
 
 static void
@@ -1043,12 +1056,14 @@ gimp_channel_real_boundary (GimpChannel         *channel,
 
           buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (channel));
 
-          channel->segs_out = gimp_boundary_find (buffer, &rect,
-                                                  babl_format ("Y float"),
-                                                  GIMP_BOUNDARY_IGNORE_BOUNDS,
-                                                  x1, y1, x2, y2,
-                                                  GIMP_BOUNDARY_HALF_WAY,
-                                                  &channel->num_segs_out);
+          channel->segs_out =
+            gimp_boundary_find_cached (channel->bound_cache,
+                                       buffer, &rect,
+                                       babl_format ("Y float"),
+                                       GIMP_BOUNDARY_IGNORE_BOUNDS,
+                                       x1, y1, x2, y2,
+                                       GIMP_BOUNDARY_HALF_WAY,
+                                       &channel->num_segs_out);
           x1 = MAX (x1, x3);
           y1 = MAX (y1, y3);
           x2 = MIN (x2, x4);
@@ -1056,12 +1071,14 @@ gimp_channel_real_boundary (GimpChannel         *channel,
 
           if (x2 > x1 && y2 > y1)
             {
-              channel->segs_in = gimp_boundary_find (buffer, NULL,
-                                                     babl_format ("Y float"),
-                                                     GIMP_BOUNDARY_WITHIN_BOUNDS,
-                                                     x1, y1, x2, y2,
-                                                     GIMP_BOUNDARY_HALF_WAY,
-                                                     &channel->num_segs_in);
+              channel->segs_in =
+                gimp_boundary_find_cached (channel->bound_cache,
+                                           buffer, NULL,
+                                           babl_format ("Y float"),
+                                           GIMP_BOUNDARY_WITHIN_BOUNDS,
+                                           x1, y1, x2, y2,
+                                           GIMP_BOUNDARY_HALF_WAY,
+                                           &channel->num_segs_in);
             }
           else
             {
@@ -51,6 +51,7 @@
 #include "gimptoolinfo.h"
 #include "gimptoolpreset.h"
 
+#include "text/gimp-fonts.h"
 #include "text/gimpfont.h"
 
 #include "gimp-intl.h"
@@ -804,7 +805,7 @@ gimp_context_constructed (GObject *object)
                            G_CALLBACK (gimp_context_paint_info_list_thaw),
                            object, 0);
 
-  container = gimp_data_factory_get_container (gimp->brush_factory);
+  container = gimp_data_factory_peek_container (gimp->brush_factory);
   g_signal_connect_object (container, "remove",
                            G_CALLBACK (gimp_context_brush_removed),
                            object, 0);
@@ -812,7 +813,7 @@ gimp_context_constructed (GObject *object)
                            G_CALLBACK (gimp_context_brush_list_thaw),
                            object, 0);
 
-  container = gimp_data_factory_get_container (gimp->dynamics_factory);
+  container = gimp_data_factory_peek_container (gimp->dynamics_factory);
   g_signal_connect_object (container, "remove",
                            G_CALLBACK (gimp_context_dynamics_removed),
                            object, 0);
@@ -820,7 +821,7 @@ gimp_context_constructed (GObject *object)
                            G_CALLBACK (gimp_context_dynamics_list_thaw),
                            object, 0);
 
-  container = gimp_data_factory_get_container (gimp->pattern_factory);
+  container = gimp_data_factory_peek_container (gimp->pattern_factory);
   g_signal_connect_object (container, "remove",
                            G_CALLBACK (gimp_context_pattern_removed),
                            object, 0);
@@ -828,7 +829,7 @@ gimp_context_constructed (GObject *object)
                            G_CALLBACK (gimp_context_pattern_list_thaw),
                            object, 0);
 
-  container = gimp_data_factory_get_container (gimp->gradient_factory);
+  container = gimp_data_factory_peek_container (gimp->gradient_factory);
   g_signal_connect_object (container, "remove",
                            G_CALLBACK (gimp_context_gradient_removed),
                            object, 0);
@@ -836,7 +837,7 @@ gimp_context_constructed (GObject *object)
                            G_CALLBACK (gimp_context_gradient_list_thaw),
                            object, 0);
 
-  container = gimp_data_factory_get_container (gimp->palette_factory);
+  container = gimp_data_factory_peek_container (gimp->palette_factory);
   g_signal_connect_object (container, "remove",
                            G_CALLBACK (gimp_context_palette_removed),
                            object, 0);
@@ -844,7 +845,7 @@ gimp_context_constructed (GObject *object)
                            G_CALLBACK (gimp_context_palette_list_thaw),
                            object, 0);
 
-  container = gimp_data_factory_get_container (gimp->tool_preset_factory);
+  container = gimp_data_factory_peek_container (gimp->tool_preset_factory);
   g_signal_connect_object (container, "remove",
                            G_CALLBACK (gimp_context_tool_preset_removed),
                            object, 0);
@@ -1172,26 +1173,29 @@ gimp_context_get_property (GObject    *object,
     case GIMP_CONTEXT_PROP_PAINT_MODE:
       g_value_set_enum (value, gimp_context_get_paint_mode (context));
       break;
+    /*  not using the getters here, copying a context must not load
+     *  data which is loaded lazily
+     */
     case GIMP_CONTEXT_PROP_BRUSH:
-      g_value_set_object (value, gimp_context_get_brush (context));
+      g_value_set_object (value, context->brush);
       break;
     case GIMP_CONTEXT_PROP_DYNAMICS:
-      g_value_set_object (value, gimp_context_get_dynamics (context));
+      g_value_set_object (value, context->dynamics);
       break;
     case GIMP_CONTEXT_PROP_PATTERN:
-      g_value_set_object (value, gimp_context_get_pattern (context));
+      g_value_set_object (value, context->pattern);
       break;
     case GIMP_CONTEXT_PROP_GRADIENT:
-      g_value_set_object (value, gimp_context_get_gradient (context));
+      g_value_set_object (value, context->gradient);
       break;
     case GIMP_CONTEXT_PROP_PALETTE:
-      g_value_set_object (value, gimp_context_get_palette (context));
+      g_value_set_object (value, context->palette);
       break;
     case GIMP_CONTEXT_PROP_TOOL_PRESET:
-      g_value_set_object (value, gimp_context_get_tool_preset (context));
+      g_value_set_object (value, context->tool_preset);
       break;
     case GIMP_CONTEXT_PROP_FONT:
-      g_value_set_object (value, gimp_context_get_font (context));
+      g_value_set_object (value, context->font);
       break;
     case GIMP_CONTEXT_PROP_BUFFER:
       g_value_set_object (value, gimp_context_get_buffer (context));
@@ -1351,6 +1355,7 @@ gimp_context_deserialize_property (GimpConfig *object,
       break;
 
     case GIMP_CONTEXT_PROP_FONT:
+      gimp_fonts_load_pending (context->gimp);
       container = context->gimp->fonts;
       current   = (GimpObject *) context->font;
       name_loc  = &context->font_name;
@@ -2517,6 +2522,8 @@ gimp_context_get_brush (GimpContext *context)
 {
   g_return_val_if_fail (GIMP_IS_CONTEXT (context), NULL);
 
+  gimp_data_factory_data_load_pending (context->gimp->brush_factory);
+
   return context->brush;
 }
 
@@ -2638,6 +2645,8 @@ gimp_context_get_dynamics (GimpContext *context)
 {
   g_return_val_if_fail (GIMP_IS_CONTEXT (context), NULL);
 
+  gimp_data_factory_data_load_pending (context->gimp->dynamics_factory);
+
   return context->dynamics;
 }
 
@@ -2756,6 +2765,8 @@ gimp_context_get_pattern (GimpContext *context)
 {
   g_return_val_if_fail (GIMP_IS_CONTEXT (context), NULL);
 
+  gimp_data_factory_data_load_pending (context->gimp->pattern_factory);
+
   return context->pattern;
 }
 
@@ -2876,6 +2887,8 @@ gimp_context_get_gradient (GimpContext *context)
 {
   g_return_val_if_fail (GIMP_IS_CONTEXT (context), NULL);
 
+  gimp_data_factory_data_load_pending (context->gimp->gradient_factory);
+
   return context->gradient;
 }
 
@@ -2996,6 +3009,8 @@ gimp_context_get_palette (GimpContext *context)
 {
   g_return_val_if_fail (GIMP_IS_CONTEXT (context), NULL);
 
+  gimp_data_factory_data_load_pending (context->gimp->palette_factory);
+
   return context->palette;
 }
 
@@ -3116,6 +3131,8 @@ gimp_context_get_tool_preset (GimpContext *context)
 {
   g_return_val_if_fail (GIMP_IS_CONTEXT (context), NULL);
 
+  gimp_data_factory_data_load_pending (context->gimp->tool_preset_factory);
+
   return context->tool_preset;
 }
 
@@ -3228,6 +3245,8 @@ gimp_context_get_font (GimpContext *context)
 {
   g_return_val_if_fail (GIMP_IS_CONTEXT (context), NULL);
 
+  gimp_fonts_load_pending (context->gimp);
+
   return context->font;
 }
 
@@ -3257,6 +3276,8 @@ gimp_context_set_font_name (GimpContext *context,
 
   g_return_if_fail (GIMP_IS_CONTEXT (context));
 
+  gimp_fonts_load_pending (context->gimp);
+
   font = gimp_container_get_child_by_name (context->gimp->fonts, name);
 
   if (font)
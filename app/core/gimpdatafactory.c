@@ -68,6 +68,9 @@ struct _GimpDataFactoryPriv
 
   GimpDataNewFunc                   data_new_func;
   GimpDataGetStandardFunc           data_get_standard_func;
+
+  /*  set while loading the data files is deferred to first use  */
+  GimpContext                      *pending_context;
 };
 
 
@@ -130,6 +133,12 @@ gimp_data_factory_finalize (GObject *object)
 {
   GimpDataFactory *factory = GIMP_DATA_FACTORY (object);
 
+  if (factory->priv->pending_context)
+    {
+      g_object_unref (factory->priv->pending_context);
+      factory->priv->pending_context = NULL;
+    }
+
   if (factory->priv->container)
     {
       g_object_unref (factory->priv->container);
@@ -229,19 +238,69 @@ gimp_data_factory_data_init (GimpDataFactory *factory,
 
   if (! no_data)
     {
+      GTimer *timer = NULL;
+
       if (factory->priv->gimp->be_verbose)
         {
           const gchar *name = gimp_object_get_name (factory);
 
           g_print ("Loading '%s' data\n", name ? name : "???");
+
+          timer = g_timer_new ();
         }
 
       gimp_data_factory_data_load (factory, context, NULL);
+
+      if (timer)
+        {
+          g_print ("  %d items in %.3f seconds\n",
+                   gimp_container_get_n_children (factory->priv->container),
+                   g_timer_elapsed (timer, NULL));
+
+          g_timer_destroy (timer);
+        }
     }
 
   gimp_container_thaw (factory->priv->container);
 }
 
+/*  Creates only the standard data, the data files are loaded when
+ *  the container is first asked for, or by
+ *  gimp_data_factory_data_load_pending().
+ */
+void
+gimp_data_factory_data_init_lazy (GimpDataFactory *factory,
+                                  GimpContext     *context,
+                                  gboolean         no_data)
+{
+  g_return_if_fail (GIMP_IS_DATA_FACTORY (factory));
+  g_return_if_fail (GIMP_IS_CONTEXT (context));
+
+  gimp_data_factory_data_init (factory, context, TRUE);
+
+  if (! no_data)
+    factory->priv->pending_context = g_object_ref (context);
+}
+
+void
+gimp_data_factory_data_load_pending (GimpDataFactory *factory)
+{
+  GimpContext *context;
+
+  g_return_if_fail (GIMP_IS_DATA_FACTORY (factory));
+
+  context = factory->priv->pending_context;
+
+  if (G_LIKELY (! context))
+    return;
+
+  factory->priv->pending_context = NULL;
+
+  gimp_data_factory_data_init (factory, context, FALSE);
+
+  g_object_unref (context);
+}
+
 static void
 gimp_data_factory_refresh_cache_add (GimpDataFactory *factory,
                                      GimpData        *data,
@@ -379,6 +438,13 @@ gimp_data_factory_data_refresh (GimpDataFactory *factory,
   g_return_if_fail (GIMP_IS_DATA_FACTORY (factory));
   g_return_if_fail (GIMP_IS_CONTEXT (context));
 
+  /*  a refresh loads everything anyway  */
+  if (factory->priv->pending_context)
+    {
+      g_object_unref (factory->priv->pending_context);
+      factory->priv->pending_context = NULL;
+    }
+
   gimp_container_freeze (factory->priv->container);
 
   /*  First, save all dirty data objects  */
@@ -478,6 +544,12 @@ gimp_data_factory_data_free (GimpDataFactory *factory)
 {
   g_return_if_fail (GIMP_IS_DATA_FACTORY (factory));
 
+  if (factory->priv->pending_context)
+    {
+      g_object_unref (factory->priv->pending_context);
+      factory->priv->pending_context = NULL;
+    }
+
   gimp_container_freeze (factory->priv->container);
 
   gimp_data_factory_data_foreach (factory, TRUE,
@@ -496,6 +568,9 @@ gimp_data_factory_data_new (GimpDataFactory *factory,
   g_return_val_if_fail (name != NULL, NULL);
   g_return_val_if_fail (*name != '\0', NULL);
 
+  /*  new data must be named uniquely among the loaded data  */
+  gimp_data_factory_data_load_pending (factory);
+
   if (factory->priv->data_new_func)
     {
       GimpData *data = factory->priv->data_new_func (context, name);
@@ -664,6 +739,19 @@ gimp_data_factory_get_container (GimpDataFactory *factory)
 {
   g_return_val_if_fail (GIMP_IS_DATA_FACTORY (factory), NULL);
 
+  gimp_data_factory_data_load_pending (factory);
+
+  return factory->priv->container;
+}
+
+/*  returns the container without loading deferred data, for code
+ *  which only connects to it and doesn't look at its contents
+ */
+GimpContainer *
+gimp_data_factory_peek_container (GimpDataFactory *factory)
+{
+  g_return_val_if_fail (GIMP_IS_DATA_FACTORY (factory), NULL);
+
   return factory->priv->container;
 }
 
@@ -672,6 +760,8 @@ gimp_data_factory_get_container_obsolete (GimpDataFactory *factory)
 {
   g_return_val_if_fail (GIMP_IS_DATA_FACTORY (factory), NULL);
 
+  gimp_data_factory_data_load_pending (factory);
+
   return factory->priv->container_obsolete;
 }
 
@@ -81,6 +81,10 @@ GimpDataFactory * gimp_data_factory_new      (Gimp                             *
 void            gimp_data_factory_data_init         (GimpDataFactory  *factory,
                                                      GimpContext      *context,
                                                      gboolean          no_data);
+void            gimp_data_factory_data_init_lazy    (GimpDataFactory  *factory,
+                                                     GimpContext      *context,
+                                                     gboolean          no_data);
+void            gimp_data_factory_data_load_pending (GimpDataFactory  *factory);
 void            gimp_data_factory_data_refresh      (GimpDataFactory  *factory,
                                                      GimpContext      *context);
 void            gimp_data_factory_data_save         (GimpDataFactory  *factory);
@@ -102,6 +106,7 @@ gboolean        gimp_data_factory_data_save_single  (GimpDataFactory  *factory,
                                                      GError          **error);
 GType           gimp_data_factory_get_data_type     (GimpDataFactory  *factory);
 GimpContainer * gimp_data_factory_get_container     (GimpDataFactory  *factory);
+GimpContainer * gimp_data_factory_peek_container    (GimpDataFactory  *factory);
 GimpContainer * gimp_data_factory_get_container_obsolete
                                                     (GimpDataFactory  *factory);
 Gimp          * gimp_data_factory_get_gimp          (GimpDataFactory  *factory);
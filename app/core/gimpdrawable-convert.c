@@ -0,0 +1,600 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gegl.h>
+
+#include "libgimpmath/gimpmath.h"
+
+#include "core-types.h"
+
+#include "gegl/gimp-babl.h"
+#include "gegl/gimp-gegl-apply-operation.h"
+
+#include "gimp-parallel.h"
+#include "gimpdrawable.h"
+#include "gimpdrawable-convert.h"
+#include "gimpprogress.h"
+
+
+#define CONVERT_MIN_AREA     (256 * 256)
+#define CONVERT_PREPARED_KEY "gimp-drawable-convert-prepared"
+
+/*  the blue noise mask is tiled over the drawable, its size must be a
+ *  power of two
+ */
+#define BLUE_NOISE_SIZE      64
+#define BLUE_NOISE_SIGMA     1.5
+
+
+typedef struct
+{
+  GeglBuffer *src_buffer;
+  GeglBuffer *dest_buffer;
+} ConvertAreaData;
+
+typedef struct
+{
+  GeglBuffer   *src_buffer;
+  GeglBuffer   *dest_buffer;
+  const Babl   *format;
+  gint          n_components;
+  gdouble       max_value;
+  const gfloat *mask;
+} ConvertDitherData;
+
+typedef struct
+{
+  GimpDrawable **drawables;
+  const Babl   **formats;
+  const gint    *dither_types;
+  GeglBuffer   **buffers;
+  gint          *order;
+  gint           n_drawables;
+  GimpProgress  *progress;
+  gint           next;
+  gint           n_done;
+} ConvertPrepareData;
+
+
+static GeglBuffer * gimp_drawable_convert_real (GimpDrawable        *drawable,
+                                                const Babl          *format,
+                                                gint                 dither_type);
+static void   gimp_drawable_convert_area_func  (const GeglRectangle *area,
+                                                ConvertAreaData     *data);
+static gboolean gimp_drawable_convert_can_blue_noise
+                                               (const Babl          *format);
+static void   gimp_drawable_convert_blue_noise_func
+                                               (const GeglRectangle *area,
+                                                ConvertDitherData   *data);
+static const gfloat * gimp_drawable_convert_get_blue_noise
+                                               (void);
+static gpointer gimp_drawable_convert_blue_noise_new
+                                               (gpointer             data);
+static gint   gimp_drawable_convert_blue_noise_find
+                                               (const gfloat        *energy,
+                                                const guchar        *pattern,
+                                                gboolean             cluster);
+static void   gimp_drawable_convert_blue_noise_toggle
+                                               (gfloat              *energy,
+                                                guchar              *pattern,
+                                                const gfloat        *kernel,
+                                                gint                 index);
+static void   gimp_drawable_convert_prepare_func
+                                               (gint                 i,
+                                                gint                 n,
+                                                ConvertPrepareData  *data);
+static gint   gimp_drawable_convert_compare    (gconstpointer        a,
+                                                gconstpointer        b,
+                                                gpointer             user_data);
+
+
+/*  public functions  */
+
+/*  Returns a new buffer holding @drawable's pixels in @format, reduced
+ *  with @dither_type unless it is 0.  A buffer converted beforehand by
+ *  gimp_drawable_convert_prepare() is returned instead, if it matches.
+ */
+GeglBuffer *
+gimp_drawable_convert_buffer (GimpDrawable *drawable,
+                              const Babl   *format,
+                              gint          dither_type)
+{
+  GeglBuffer *buffer;
+
+  g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), NULL);
+  g_return_val_if_fail (format != NULL, NULL);
+
+  buffer = g_object_steal_data (G_OBJECT (drawable), CONVERT_PREPARED_KEY);
+
+  if (buffer)
+    {
+      if (gegl_buffer_get_format (buffer) == format)
+        return buffer;
+
+      g_object_unref (buffer);
+    }
+
+  return gimp_drawable_convert_real (drawable, format, dither_type);
+}
+
+/*  Converts all @drawables at once on the thread pool, so the
+ *  following convert_type() calls, which have to run one after the
+ *  other because they push undo and emit signals, only swap buffers.
+ *  @progress is set to the fraction of drawables converted.
+ */
+void
+gimp_drawable_convert_prepare (GimpDrawable **drawables,
+                               const Babl   **formats,
+                               const gint    *dither_types,
+                               gint           n_drawables,
+                               GimpProgress  *progress)
+{
+  ConvertPrepareData data;
+  gint               i;
+
+  g_return_if_fail (n_drawables == 0 || drawables != NULL);
+  g_return_if_fail (n_drawables == 0 || formats != NULL);
+  g_return_if_fail (n_drawables == 0 || dither_types != NULL);
+  g_return_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress));
+
+  if (n_drawables == 0)
+    return;
+
+  data.drawables    = drawables;
+  data.formats      = formats;
+  data.dither_types = dither_types;
+  data.buffers      = g_new0 (GeglBuffer *, n_drawables);
+  data.order        = g_new (gint, n_drawables);
+  data.n_drawables  = n_drawables;
+  data.progress     = progress;
+  data.next         = 0;
+  data.n_done       = 0;
+
+  /*  biggest first, so the small ones fill up the gaps at the end  */
+  for (i = 0; i < n_drawables; i++)
+    data.order[i] = i;
+
+  g_qsort_with_data (data.order, n_drawables, sizeof (gint),
+                     gimp_drawable_convert_compare, drawables);
+
+  gimp_parallel_distribute (n_drawables,
+                            (GimpParallelDistributeFunc)
+                            gimp_drawable_convert_prepare_func,
+                            &data);
+
+  for (i = 0; i < n_drawables; i++)
+    {
+      g_object_set_data_full (G_OBJECT (drawables[i]), CONVERT_PREPARED_KEY,
+                              data.buffers[i],
+                              (GDestroyNotify) g_object_unref);
+    }
+
+  g_free (data.buffers);
+  g_free (data.order);
+}
+
+void
+gimp_drawable_convert_unprepare (GimpDrawable **drawables,
+                                 gint           n_drawables)
+{
+  gint i;
+
+  g_return_if_fail (n_drawables == 0 || drawables != NULL);
+
+  for (i = 0; i < n_drawables; i++)
+    g_object_set_data (G_OBJECT (drawables[i]), CONVERT_PREPARED_KEY, NULL);
+}
+
+
+/*  private functions  */
+
+static GeglBuffer *
+gimp_drawable_convert_real (GimpDrawable *drawable,
+                            const Babl   *format,
+                            gint          dither_type)
+{
+  GeglBuffer *src_buffer = gimp_drawable_get_buffer (drawable);
+  GeglBuffer *dest_buffer;
+
+  dest_buffer =
+    gegl_buffer_new (GEGL_RECTANGLE (0, 0,
+                                     gimp_item_get_width  (GIMP_ITEM (drawable)),
+                                     gimp_item_get_height (GIMP_ITEM (drawable))),
+                     format);
+
+  if (dither_type == GIMP_DRAWABLE_CONVERT_DITHER_BLUE_NOISE &&
+      ! gimp_drawable_convert_can_blue_noise (format))
+    dither_type = 0;
+
+  if (dither_type == 0)
+    {
+      ConvertAreaData data;
+
+      data.src_buffer  = src_buffer;
+      data.dest_buffer = dest_buffer;
+
+      gimp_parallel_distribute_area (gegl_buffer_get_extent (dest_buffer),
+                                     CONVERT_MIN_AREA,
+                                     (GimpParallelDistributeAreaFunc)
+                                     gimp_drawable_convert_area_func,
+                                     &data);
+    }
+  else if (dither_type == GIMP_DRAWABLE_CONVERT_DITHER_BLUE_NOISE)
+    {
+      ConvertDitherData data;
+
+      data.src_buffer  = src_buffer;
+      data.dest_buffer = dest_buffer;
+
+      /*  the noise is added in the destination's TRC, so it spreads
+       *  the rounding error evenly over the destination's steps
+       */
+      data.format =
+        gimp_babl_format (gimp_babl_format_get_base_type (format),
+                          gimp_babl_precision (GIMP_COMPONENT_TYPE_FLOAT,
+                                               gimp_babl_format_get_linear (format)),
+                          babl_format_has_alpha (format));
+      data.n_components = babl_format_get_n_components (format);
+      data.mask         = gimp_drawable_convert_get_blue_noise ();
+
+      switch (gimp_babl_format_get_component_type (format))
+        {
+        case GIMP_COMPONENT_TYPE_U8:
+          data.max_value = 255.0;
+          break;
+
+        case GIMP_COMPONENT_TYPE_U16:
+          data.max_value = 65535.0;
+          break;
+
+        default:
+          data.max_value = 4294967295.0;
+          break;
+        }
+
+      gimp_parallel_distribute_area (gegl_buffer_get_extent (dest_buffer),
+                                     CONVERT_MIN_AREA,
+                                     (GimpParallelDistributeAreaFunc)
+                                     gimp_drawable_convert_blue_noise_func,
+                                     &data);
+    }
+  else
+    {
+      gint bits;
+
+      bits = (babl_format_get_bytes_per_pixel (format) * 8 /
+              babl_format_get_n_components (format));
+
+      gimp_gegl_apply_color_reduction (src_buffer, NULL, NULL,
+                                       dest_buffer, bits, dither_type);
+    }
+
+  return dest_buffer;
+}
+
+static void
+gimp_drawable_convert_area_func (const GeglRectangle *area,
+                                 ConvertAreaData     *data)
+{
+  gegl_buffer_copy (data->src_buffer,  area,
+                    data->dest_buffer, area);
+}
+
+static void
+gimp_drawable_convert_prepare_func (gint                i,
+                                    gint                n,
+                                    ConvertPrepareData *data)
+{
+  gint next;
+
+  while ((next = g_atomic_int_add (&data->next, 1)) < data->n_drawables)
+    {
+      gint index = data->order[next];
+
+      data->buffers[index] =
+        gimp_drawable_convert_real (data->drawables[index],
+                                    data->formats[index],
+                                    data->dither_types[index]);
+
+      g_atomic_int_inc (&data->n_done);
+
+      /*  only the calling thread may report progress, it reports
+       *  the drawables done by all threads
+       */
+      if (i == 0 && data->progress)
+        gimp_progress_set_value (data->progress,
+                                 (gdouble) g_atomic_int_get (&data->n_done) /
+                                 data->n_drawables);
+    }
+}
+
+static gint
+gimp_drawable_convert_compare (gconstpointer a,
+                               gconstpointer b,
+                               gpointer      user_data)
+{
+  GimpDrawable **drawables = user_data;
+  GimpItem      *item_a    = GIMP_ITEM (drawables[*(const gint *) a]);
+  GimpItem      *item_b    = GIMP_ITEM (drawables[*(const gint *) b]);
+  gint64         area_a;
+  gint64         area_b;
+
+  area_a = (gint64) gimp_item_get_width (item_a) * gimp_item_get_height (item_a);
+  area_b = (gint64) gimp_item_get_width (item_b) * gimp_item_get_height (item_b);
+
+  if (area_a > area_b)
+    return -1;
+  else if (area_a < area_b)
+    return 1;
+
+  return 0;
+}
+
+/*  blue noise only makes sense when rounding to an integer type  */
+static gboolean
+gimp_drawable_convert_can_blue_noise (const Babl *format)
+{
+  if (babl_format_is_palette (format))
+    return FALSE;
+
+  switch (gimp_babl_format_get_component_type (format))
+    {
+    case GIMP_COMPONENT_TYPE_U8:
+    case GIMP_COMPONENT_TYPE_U16:
+    case GIMP_COMPONENT_TYPE_U32:
+      return TRUE;
+
+    default:
+      return FALSE;
+    }
+}
+
+/*  adds a threshold from the blue noise mask, at most half a step of
+ *  the destination, to every component before it gets rounded.  The
+ *  mask is indexed by image position, so areas are independent, and
+ *  offset per component so the channels don't dither in lockstep.
+ */
+static void
+gimp_drawable_convert_blue_noise_func (const GeglRectangle *area,
+                                       ConvertDitherData   *data)
+{
+  gint    n_components = data->n_components;
+  gfloat *buf;
+  gint    y;
+
+  buf = g_new (gfloat, area->width * BLUE_NOISE_SIZE * n_components);
+
+  for (y = area->y; y < area->y + area->height; y += BLUE_NOISE_SIZE)
+    {
+      GeglRectangle  rect;
+      gfloat        *p = buf;
+      gint           row;
+
+      rect.x      = area->x;
+      rect.y      = y;
+      rect.width  = area->width;
+      rect.height = MIN (BLUE_NOISE_SIZE, area->y + area->height - y);
+
+      gegl_buffer_get (data->src_buffer, &rect, 1.0,
+                       data->format, buf,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      for (row = rect.y; row < rect.y + rect.height; row++)
+        {
+          gint x;
+
+          for (x = rect.x; x < rect.x + rect.width; x++)
+            {
+              gint c;
+
+              for (c = 0; c < n_components; c++)
+                {
+                  gint mx = (x   + 17 * c) & (BLUE_NOISE_SIZE - 1);
+                  gint my = (row + 29 * c) & (BLUE_NOISE_SIZE - 1);
+
+                  *p++ += data->mask[my * BLUE_NOISE_SIZE + mx] /
+                          data->max_value;
+                }
+            }
+        }
+
+      gegl_buffer_set (data->dest_buffer, &rect, 0,
+                       data->format, buf, GEGL_AUTO_ROWSTRIDE);
+    }
+
+  g_free (buf);
+}
+
+static const gfloat *
+gimp_drawable_convert_get_blue_noise (void)
+{
+  static GOnce once = G_ONCE_INIT;
+
+  g_once (&once, gimp_drawable_convert_blue_noise_new, NULL);
+
+  return once.retval;
+}
+
+/*  finds the set pixel with the most energy around it (the tightest
+ *  cluster), or the unset pixel with the least (the largest void)
+ */
+static gint
+gimp_drawable_convert_blue_noise_find (const gfloat *energy,
+                                       const guchar *pattern,
+                                       gboolean      cluster)
+{
+  gint   best     = -1;
+  gfloat best_val = 0.0;
+  gint   i;
+
+  for (i = 0; i < SQR (BLUE_NOISE_SIZE); i++)
+    {
+      if (pattern[i] != cluster)
+        continue;
+
+      if (best < 0                             ||
+          (  cluster && energy[i] > best_val) ||
+          (! cluster && energy[i] < best_val))
+        {
+          best     = i;
+          best_val = energy[i];
+        }
+    }
+
+  return best;
+}
+
+/*  sets or unsets pixel @index, and adds or removes its gaussian
+ *  energy, wrapped around the edges
+ */
+static void
+gimp_drawable_convert_blue_noise_toggle (gfloat       *energy,
+                                         guchar       *pattern,
+                                         const gfloat *kernel,
+                                         gint          index)
+{
+  gint   px   = index % BLUE_NOISE_SIZE;
+  gint   py   = index / BLUE_NOISE_SIZE;
+  gfloat sign = pattern[index] ? -1.0 : 1.0;
+  gint   x, y;
+
+  pattern[index] = ! pattern[index];
+
+  for (y = 0; y < BLUE_NOISE_SIZE; y++)
+    {
+      const gfloat *k = kernel + ((y - py) & (BLUE_NOISE_SIZE - 1)) *
+                                 BLUE_NOISE_SIZE;
+
+      for (x = 0; x < BLUE_NOISE_SIZE; x++)
+        energy[y * BLUE_NOISE_SIZE + x] +=
+          sign * k[(x - px) & (BLUE_NOISE_SIZE - 1)];
+    }
+}
+
+/*  builds the threshold mask with Ulichney's void-and-cluster method,
+ *  the thresholds are spread evenly over [-0.5, 0.5)
+ */
+static gpointer
+gimp_drawable_convert_blue_noise_new (gpointer data)
+{
+  const gint  n = SQR (BLUE_NOISE_SIZE);
+  gfloat     *kernel;
+  gfloat     *energy;
+  gfloat     *proto_energy;
+  guchar     *pattern;
+  guchar     *proto;
+  gfloat     *mask;
+  GRand      *rand;
+  gint        n_ones = 0;
+  gint        rank;
+  gint        i;
+
+  kernel       = g_new  (gfloat, n);
+  energy       = g_new0 (gfloat, n);
+  proto_energy = g_new  (gfloat, n);
+  pattern      = g_new0 (guchar, n);
+  proto        = g_new  (guchar, n);
+  mask         = g_new  (gfloat, n);
+
+  for (i = 0; i < n; i++)
+    {
+      gint dx = i % BLUE_NOISE_SIZE;
+      gint dy = i / BLUE_NOISE_SIZE;
+
+      dx = MIN (dx, BLUE_NOISE_SIZE - dx);
+      dy = MIN (dy, BLUE_NOISE_SIZE - dy);
+
+      kernel[i] = exp (- (SQR (dx) + SQR (dy)) /
+                       (2.0 * SQR (BLUE_NOISE_SIGMA)));
+    }
+
+  /*  a fixed seed, so the mask is the same on every run  */
+  rand = g_rand_new_with_seed (0x5eed);
+
+  while (n_ones < n / 10)
+    {
+      i = g_rand_int_range (rand, 0, n);
+
+      if (! pattern[i])
+        {
+          gimp_drawable_convert_blue_noise_toggle (energy, pattern, kernel, i);
+          n_ones++;
+        }
+    }
+
+  g_rand_free (rand);
+
+  /*  move the tightest cluster into the largest void until that
+   *  changes nothing anymore
+   */
+  for (i = 0; i < n; i++)
+    {
+      gint cluster = gimp_drawable_convert_blue_noise_find (energy, pattern, TRUE);
+      gint v;
+
+      gimp_drawable_convert_blue_noise_toggle (energy, pattern, kernel, cluster);
+
+      v = gimp_drawable_convert_blue_noise_find (energy, pattern, FALSE);
+
+      gimp_drawable_convert_blue_noise_toggle (energy, pattern, kernel, v);
+
+      if (v == cluster)
+        break;
+    }
+
+  memcpy (proto,        pattern, n);
+  memcpy (proto_energy, energy,  n * sizeof (gfloat));
+
+  /*  rank the prototype's pixels by removing the tightest clusters  */
+  for (rank = n_ones - 1; rank >= 0; rank--)
+    {
+      i = gimp_drawable_convert_blue_noise_find (energy, pattern, TRUE);
+
+      gimp_drawable_convert_blue_noise_toggle (energy, pattern, kernel, i);
+      mask[i] = rank;
+    }
+
+  /*  and the rest by filling the largest voids, which for the second
+   *  half is the same as taking the tightest clusters of the unset
+   *  pixels
+   */
+  memcpy (pattern, proto,        n);
+  memcpy (energy,  proto_energy, n * sizeof (gfloat));
+
+  for (rank = n_ones; rank < n; rank++)
+    {
+      i = gimp_drawable_convert_blue_noise_find (energy, pattern, FALSE);
+
+      gimp_drawable_convert_blue_noise_toggle (energy, pattern, kernel, i);
+      mask[i] = rank;
+    }
+
+  for (i = 0; i < n; i++)
+    mask[i] = (mask[i] + 0.5) / n - 0.5;
+
+  g_free (kernel);
+  g_free (energy);
+  g_free (proto_energy);
+  g_free (pattern);
+  g_free (proto);
+
+  return mask;
+}
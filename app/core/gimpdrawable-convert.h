@@ -0,0 +1,39 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_DRAWABLE_CONVERT_H__
+#define __GIMP_DRAWABLE_CONVERT_H__
+
+
+/*  a dither type on top of gegl:color-reduction's strategies  */
+#define GIMP_DRAWABLE_CONVERT_DITHER_BLUE_NOISE 256
+
+
+GeglBuffer * gimp_drawable_convert_buffer    (GimpDrawable  *drawable,
+                                              const Babl    *format,
+                                              gint           dither_type);
+
+void         gimp_drawable_convert_prepare   (GimpDrawable **drawables,
+                                              const Babl   **formats,
+                                              const gint    *dither_types,
+                                              gint           n_drawables,
+                                              GimpProgress  *progress);
+void         gimp_drawable_convert_unprepare (GimpDrawable **drawables,
+                                              gint           n_drawables);
+
+
+#endif  /*  __GIMP_DRAWABLE_CONVERT_H__  */
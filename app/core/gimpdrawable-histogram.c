@@ -25,12 +25,66 @@
 
 #include "gegl/gimp-gegl-nodes.h"
 
+#include "pdb/gimppdb-scheduler.h"
+
+#include "gimp.h"
+#include "gimp-parallel.h"
 #include "gimpchannel.h"
 #include "gimpdrawable-histogram.h"
 #include "gimphistogram.h"
 #include "gimpimage.h"
 
 
+/*  the cache keeps one partial histogram per cell, cells are a
+ *  multiple of the tile size so updates dirty few of them
+ */
+#define HISTOGRAM_CACHE_CELL_SIZE 512
+#define HISTOGRAM_CACHE_KEY       "gimp-drawable-histogram-cache"
+
+
+typedef struct
+{
+  GimpDrawable   *drawable;
+  GeglBuffer     *buffer;
+  gulong          update_id;
+
+  gint            width;
+  gint            height;
+  gint            n_cells_x;
+  gint            n_cells_y;
+
+  /*  indexed by gamma_correct, NULL cells are dirty  */
+  GimpHistogram **cells[2];
+} HistogramCache;
+
+typedef struct
+{
+  HistogramCache *cache;
+  gboolean        gamma_correct;
+  gint           *dirty;
+  gint            n_dirty;
+  gint            next;
+} HistogramCacheCalculateData;
+
+
+static void   gimp_drawable_histogram_cache_calculate (GimpDrawable   *drawable,
+                                                       GimpHistogram  *histogram);
+static HistogramCache *
+              gimp_drawable_histogram_cache_get       (GimpDrawable   *drawable);
+static void   gimp_drawable_histogram_cache_free      (HistogramCache *cache);
+static void   gimp_drawable_histogram_cache_update    (GimpDrawable   *drawable,
+                                                       gint            x,
+                                                       gint            y,
+                                                       gint            width,
+                                                       gint            height,
+                                                       HistogramCache *cache);
+static void   gimp_drawable_histogram_cache_func      (gint            i,
+                                                       gint            n,
+                                                       HistogramCacheCalculateData *data);
+
+
+/*  public functions  */
+
 void
 gimp_drawable_calculate_histogram (GimpDrawable  *drawable,
                                    GimpHistogram *histogram)
@@ -113,10 +167,212 @@ gimp_drawable_calculate_histogram (GimpDrawable  *drawable,
         }
       else
         {
-          gimp_histogram_calculate (histogram,
-                                    gimp_drawable_get_buffer (drawable),
-                                    GEGL_RECTANGLE (x, y, width, height),
-                                    NULL, NULL);
+          gimp_drawable_histogram_cache_calculate (drawable, histogram);
+        }
+    }
+}
+
+
+/*  private functions  */
+
+/*  histograms of the whole drawable are merged from the cached
+ *  partial histograms of its cells, only cells which were updated
+ *  since the last call are calculated again
+ *
+ *  The cells are dropped from the drawable's "update" handler, which
+ *  runs on the thread of a scheduled procedure that is changing the
+ *  image, so the cache is only used with the image locked.
+ */
+static void
+gimp_drawable_histogram_cache_calculate (GimpDrawable  *drawable,
+                                         GimpHistogram *histogram)
+{
+  GimpImage                   *image = gimp_item_get_image (GIMP_ITEM (drawable));
+  HistogramCache              *cache;
+  HistogramCacheCalculateData  data;
+  GimpHistogram              **cells;
+  gint                         n_cells;
+  gint                         i;
+
+  gimp_pdb_lock_image (image->gimp->pdb, image);
+
+  cache   = gimp_drawable_histogram_cache_get (drawable);
+  n_cells = cache->n_cells_x * cache->n_cells_y;
+
+  data.cache         = cache;
+  data.gamma_correct = gimp_histogram_get_gamma_correct (histogram) ? 1 : 0;
+  data.dirty         = g_new (gint, n_cells);
+  data.n_dirty       = 0;
+  data.next          = 0;
+
+  if (! cache->cells[data.gamma_correct])
+    cache->cells[data.gamma_correct] = g_new0 (GimpHistogram *, n_cells);
+
+  cells = cache->cells[data.gamma_correct];
+
+  for (i = 0; i < n_cells; i++)
+    {
+      if (! cells[i])
+        data.dirty[data.n_dirty++] = i;
+    }
+
+  if (data.n_dirty > 0)
+    gimp_parallel_distribute (data.n_dirty,
+                              (GimpParallelDistributeFunc)
+                              gimp_drawable_histogram_cache_func,
+                              &data);
+
+  g_free (data.dirty);
+
+  gimp_histogram_merge (histogram, cells, n_cells);
+
+  gimp_pdb_unlock_image (image->gimp->pdb, image);
+}
+
+static HistogramCache *
+gimp_drawable_histogram_cache_get (GimpDrawable *drawable)
+{
+  HistogramCache *cache;
+  GeglBuffer     *buffer = gimp_drawable_get_buffer (drawable);
+  gint            width  = gegl_buffer_get_width  (buffer);
+  gint            height = gegl_buffer_get_height (buffer);
+
+  cache = g_object_get_data (G_OBJECT (drawable), HISTOGRAM_CACHE_KEY);
+
+  if (cache &&
+      (cache->buffer != buffer  ||
+       cache->width  != width   ||
+       cache->height != height))
+    {
+      g_object_set_data (G_OBJECT (drawable), HISTOGRAM_CACHE_KEY, NULL);
+      cache = NULL;
+    }
+
+  if (! cache)
+    {
+      cache = g_slice_new0 (HistogramCache);
+
+      cache->drawable  = drawable;
+      cache->buffer    = buffer;
+      cache->width     = width;
+      cache->height    = height;
+      cache->n_cells_x = (width  + HISTOGRAM_CACHE_CELL_SIZE - 1) /
+                         HISTOGRAM_CACHE_CELL_SIZE;
+      cache->n_cells_y = (height + HISTOGRAM_CACHE_CELL_SIZE - 1) /
+                         HISTOGRAM_CACHE_CELL_SIZE;
+
+      /*  a new buffer, even at the same address, drops the cache  */
+      g_object_add_weak_pointer (G_OBJECT (buffer),
+                                 (gpointer) &cache->buffer);
+
+      cache->update_id =
+        g_signal_connect (drawable, "update",
+                          G_CALLBACK (gimp_drawable_histogram_cache_update),
+                          cache);
+
+      g_object_set_data_full (G_OBJECT (drawable), HISTOGRAM_CACHE_KEY, cache,
+                              (GDestroyNotify) gimp_drawable_histogram_cache_free);
+    }
+
+  return cache;
+}
+
+static void
+gimp_drawable_histogram_cache_free (HistogramCache *cache)
+{
+  gint n_cells = cache->n_cells_x * cache->n_cells_y;
+  gint i, j;
+
+  if (g_signal_handler_is_connected (cache->drawable, cache->update_id))
+    g_signal_handler_disconnect (cache->drawable, cache->update_id);
+
+  if (cache->buffer)
+    g_object_remove_weak_pointer (G_OBJECT (cache->buffer),
+                                  (gpointer) &cache->buffer);
+
+  for (i = 0; i < G_N_ELEMENTS (cache->cells); i++)
+    {
+      if (! cache->cells[i])
+        continue;
+
+      for (j = 0; j < n_cells; j++)
+        {
+          if (cache->cells[i][j])
+            g_object_unref (cache->cells[i][j]);
         }
+
+      g_free (cache->cells[i]);
+    }
+
+  g_slice_free (HistogramCache, cache);
+}
+
+static void
+gimp_drawable_histogram_cache_update (GimpDrawable   *drawable,
+                                      gint            x,
+                                      gint            y,
+                                      gint            width,
+                                      gint            height,
+                                      HistogramCache *cache)
+{
+  gint x1, y1, x2, y2;
+  gint cell_x, cell_y;
+  gint i;
+
+  x1 = MAX (x, 0);
+  y1 = MAX (y, 0);
+  x2 = MIN (x + width,  cache->width);
+  y2 = MIN (y + height, cache->height);
+
+  if (x1 >= x2 || y1 >= y2)
+    return;
+
+  for (cell_y = y1 / HISTOGRAM_CACHE_CELL_SIZE;
+       cell_y <= (y2 - 1) / HISTOGRAM_CACHE_CELL_SIZE;
+       cell_y++)
+    {
+      for (cell_x = x1 / HISTOGRAM_CACHE_CELL_SIZE;
+           cell_x <= (x2 - 1) / HISTOGRAM_CACHE_CELL_SIZE;
+           cell_x++)
+        {
+          gint index = cell_y * cache->n_cells_x + cell_x;
+
+          for (i = 0; i < G_N_ELEMENTS (cache->cells); i++)
+            {
+              if (cache->cells[i] && cache->cells[i][index])
+                {
+                  g_object_unref (cache->cells[i][index]);
+                  cache->cells[i][index] = NULL;
+                }
+            }
+        }
+    }
+}
+
+static void
+gimp_drawable_histogram_cache_func (gint                         i,
+                                    gint                         n,
+                                    HistogramCacheCalculateData *data)
+{
+  HistogramCache  *cache = data->cache;
+  GimpHistogram  **cells = cache->cells[data->gamma_correct];
+  gint             next;
+
+  while ((next = g_atomic_int_add (&data->next, 1)) < data->n_dirty)
+    {
+      GimpHistogram *cell;
+      GeglRectangle  rect;
+      gint           index = data->dirty[next];
+
+      rect.x      = (index % cache->n_cells_x) * HISTOGRAM_CACHE_CELL_SIZE;
+      rect.y      = (index / cache->n_cells_x) * HISTOGRAM_CACHE_CELL_SIZE;
+      rect.width  = MIN (HISTOGRAM_CACHE_CELL_SIZE, cache->width  - rect.x);
+      rect.height = MIN (HISTOGRAM_CACHE_CELL_SIZE, cache->height - rect.y);
+
+      cell = gimp_histogram_new (data->gamma_correct);
+
+      gimp_histogram_calculate (cell, cache->buffer, &rect, NULL, NULL);
+
+      cells[index] = cell;
     }
 }
@@ -31,6 +31,7 @@
 #include "gegl/gimp-gegl-utils.h"
 
 #include "gimp.h"
+#include "gimp-parallel.h"
 #include "gimpcontext.h"
 #include "gimpdrawable.h"
 #include "gimpdrawable-offset.h"
@@ -39,6 +40,37 @@
 #include "gimp-intl.h"
 
 
+#define OFFSET_MIN_AREA (256 * 256)
+
+
+typedef struct
+{
+  GeglRectangle src;
+  GeglRectangle dest;
+} OffsetPiece;
+
+typedef struct
+{
+  GeglBuffer  *src_buffer;
+  GeglBuffer  *dest_buffer;
+  OffsetPiece  pieces[4];
+  gint         n_pieces;
+} OffsetData;
+
+
+static void   gimp_drawable_offset_add_piece (OffsetData          *data,
+                                              gint                 src_x,
+                                              gint                 src_y,
+                                              gint                 dest_x,
+                                              gint                 dest_y,
+                                              gint                 width,
+                                              gint                 height);
+static void   gimp_drawable_offset_copy_area (const GeglRectangle *area,
+                                              OffsetData          *data);
+
+
+/*  public functions  */
+
 void
 gimp_drawable_offset (GimpDrawable   *drawable,
                       GimpContext    *context,
@@ -47,14 +79,13 @@ gimp_drawable_offset (GimpDrawable   *drawable,
                       gint            offset_x,
                       gint            offset_y)
 {
-  GimpItem      *item;
-  GeglBuffer    *src_buffer;
-  GeglBuffer    *new_buffer;
-  GeglRectangle  src_rect;
-  GeglRectangle  dest_rect;
-  gint           width, height;
-  gint           src_x, src_y;
-  gint           dest_x, dest_y;
+  GimpItem   *item;
+  GeglBuffer *src_buffer;
+  GeglBuffer *new_buffer;
+  OffsetData  data;
+  gint        width, height;
+  gint        tile_width, tile_height;
+  gint        i;
 
   g_return_if_fail (GIMP_IS_DRAWABLE (drawable));
   g_return_if_fail (GIMP_IS_CONTEXT (context));
@@ -104,137 +135,77 @@ gimp_drawable_offset (GimpDrawable   *drawable,
         }
     }
 
-  if (offset_x >= 0)
-    {
-      src_x = 0;
-      dest_x = offset_x;
-      width = CLAMP ((width - offset_x), 0, width);
-    }
-  else
-    {
-      src_x = -offset_x;
-      dest_x = 0;
-      width = CLAMP ((width + offset_x), 0, width);
-    }
+  data.src_buffer  = src_buffer;
+  data.dest_buffer = new_buffer;
+  data.n_pieces    = 0;
 
-  if (offset_y >= 0)
+  if (wrap_around)
     {
-      src_y = 0;
-      dest_y = offset_y;
-      height = CLAMP ((height - offset_y), 0, height);
+      /*  the offset lines split the result into up to four pieces,
+       *  each of them a plain translation of a part of the source
+       */
+      gimp_drawable_offset_add_piece (&data,
+                                      0, 0,
+                                      offset_x, offset_y,
+                                      width - offset_x, height - offset_y);
+      gimp_drawable_offset_add_piece (&data,
+                                      width - offset_x, 0,
+                                      0, offset_y,
+                                      offset_x, height - offset_y);
+      gimp_drawable_offset_add_piece (&data,
+                                      0, height - offset_y,
+                                      offset_x, 0,
+                                      width - offset_x, offset_y);
+      gimp_drawable_offset_add_piece (&data,
+                                      width - offset_x, height - offset_y,
+                                      0, 0,
+                                      offset_x, offset_y);
     }
   else
     {
-      src_y = -offset_y;
-      dest_y = 0;
-      height = CLAMP ((height + offset_y), 0, height);
+      gimp_drawable_offset_add_piece (&data,
+                                      MAX (-offset_x, 0), MAX (-offset_y, 0),
+                                      MAX (offset_x, 0),  MAX (offset_y, 0),
+                                      width  - ABS (offset_x),
+                                      height - ABS (offset_y));
     }
 
-  /*  Copy the center region  */
-  if (width && height)
-    {
-      gegl_buffer_copy (src_buffer,
-                        GEGL_RECTANGLE (src_x,  src_y,  width, height),
-                        new_buffer,
-                        GEGL_RECTANGLE (dest_x,dest_y,  width, height));
-    }
+  g_object_get (new_buffer,
+                "tile-width",  &tile_width,
+                "tile-height", &tile_height,
+                NULL);
 
-  if (wrap_around)
+  /*  pieces which move by whole tiles are copied by GEGL sharing the
+   *  source tiles, copy-on-write, without touching any pixels
+   */
+  for (i = 0; i < data.n_pieces; )
     {
-      /*  Copy appropriately for wrap around  */
+      OffsetPiece *piece = &data.pieces[i];
 
-      if (offset_x >= 0 && offset_y >= 0)
-        {
-          src_x = gimp_item_get_width  (item) - offset_x;
-          src_y = gimp_item_get_height (item) - offset_y;
-        }
-      else if (offset_x >= 0 && offset_y < 0)
+      if ((piece->dest.x - piece->src.x) % tile_width  == 0 &&
+          (piece->dest.y - piece->src.y) % tile_height == 0)
         {
-          src_x = gimp_item_get_width (item) - offset_x;
-          src_y = 0;
-        }
-      else if (offset_x < 0 && offset_y >= 0)
-        {
-          src_x = 0;
-          src_y = gimp_item_get_height (item) - offset_y;
-        }
-      else if (offset_x < 0 && offset_y < 0)
-        {
-          src_x = 0;
-          src_y = 0;
-        }
-
-      dest_x = (src_x + offset_x) % gimp_item_get_width (item);
-      if (dest_x < 0)
-        dest_x = gimp_item_get_width (item) + dest_x;
+          gegl_buffer_copy (src_buffer,  &piece->src,
+                            new_buffer, &piece->dest);
 
-      dest_y = (src_y + offset_y) % gimp_item_get_height (item);
-      if (dest_y < 0)
-        dest_y = gimp_item_get_height (item) + dest_y;
-
-      /*  intersecting region  */
-      if (offset_x != 0 && offset_y != 0)
-        {
-          gegl_buffer_copy (src_buffer,
-                            GEGL_RECTANGLE (src_x, src_y,
-                                            ABS (offset_x), ABS (offset_y)),
-                            new_buffer,
-                            GEGL_RECTANGLE (dest_x, dest_y, 0, 0));
+          data.pieces[i] = data.pieces[--data.n_pieces];
         }
-
-      /*  X offset  */
-      if (offset_x != 0)
+      else
         {
-          if (offset_y >= 0)
-            {
-              src_rect.x      = src_x;
-              src_rect.y      = 0;
-              src_rect.width  = ABS (offset_x);
-              src_rect.height = gimp_item_get_height (item) - ABS (offset_y);
-
-              dest_rect.x = dest_x;
-              dest_rect.y = dest_y + offset_y;
-            }
-          else if (offset_y < 0)
-            {
-              src_rect.x      = src_x;
-              src_rect.y      = src_y - offset_y;
-              src_rect.width  = ABS (offset_x);
-              src_rect.height = gimp_item_get_height (item) - ABS (offset_y);
-
-              dest_rect.x = dest_x;
-              dest_rect.y = 0;
-            }
-
-          gegl_buffer_copy (src_buffer, &src_rect, new_buffer, &dest_rect);
+          i++;
         }
+    }
 
-      /*  X offset  */
-      if (offset_y != 0)
-        {
-          if (offset_x >= 0)
-            {
-              src_rect.x      = 0;
-              src_rect.y      = src_y;
-              src_rect.width  = gimp_item_get_width (item) - ABS (offset_x);
-              src_rect.height = ABS (offset_y);
-
-              dest_rect.x = dest_x + offset_x;
-              dest_rect.y = dest_y;
-            }
-          else if (offset_x < 0)
-            {
-              src_rect.x      = src_x - offset_x;
-              src_rect.y      = src_y;
-              src_rect.width  = gimp_item_get_width (item) - ABS (offset_x);
-              src_rect.height = ABS (offset_y);
-
-              dest_rect.x = 0;
-              dest_rect.y = dest_y;
-            }
-
-          gegl_buffer_copy (src_buffer, &src_rect, new_buffer, &dest_rect);
-        }
+  /*  everything else really has to be moved, do that in parallel
+   *  over bands of the new buffer
+   */
+  if (data.n_pieces > 0)
+    {
+      gimp_parallel_distribute_area (GEGL_RECTANGLE (0, 0, width, height),
+                                     OFFSET_MIN_AREA,
+                                     (GimpParallelDistributeAreaFunc)
+                                     gimp_drawable_offset_copy_area,
+                                     &data);
     }
 
   gimp_drawable_set_buffer (drawable,
@@ -243,3 +214,58 @@ gimp_drawable_offset (GimpDrawable   *drawable,
                             new_buffer);
   g_object_unref (new_buffer);
 }
+
+
+/*  private functions  */
+
+static void
+gimp_drawable_offset_add_piece (OffsetData *data,
+                                gint        src_x,
+                                gint        src_y,
+                                gint        dest_x,
+                                gint        dest_y,
+                                gint        width,
+                                gint        height)
+{
+  OffsetPiece *piece;
+
+  if (width <= 0 || height <= 0)
+    return;
+
+  piece = &data->pieces[data->n_pieces++];
+
+  piece->src.x       = src_x;
+  piece->src.y       = src_y;
+  piece->src.width   = width;
+  piece->src.height  = height;
+
+  piece->dest.x      = dest_x;
+  piece->dest.y      = dest_y;
+  piece->dest.width  = width;
+  piece->dest.height = height;
+}
+
+static void
+gimp_drawable_offset_copy_area (const GeglRectangle *area,
+                                OffsetData          *data)
+{
+  gint i;
+
+  for (i = 0; i < data->n_pieces; i++)
+    {
+      const OffsetPiece *piece = &data->pieces[i];
+      GeglRectangle      dest;
+      GeglRectangle      src;
+
+      if (! gegl_rectangle_intersect (&dest, &piece->dest, area))
+        continue;
+
+      src.x      = piece->src.x + (dest.x - piece->dest.x);
+      src.y      = piece->src.y + (dest.y - piece->dest.y);
+      src.width  = dest.width;
+      src.height = dest.height;
+
+      gegl_buffer_copy (data->src_buffer,  &src,
+                        data->dest_buffer, &dest);
+    }
+}
@@ -59,16 +59,17 @@ gimp_drawable_apply_operation (GimpDrawable *drawable,
 
   dest_buffer = gimp_drawable_get_shadow_buffer (drawable);
 
-  gimp_gegl_apply_operation (gimp_drawable_get_buffer (drawable),
-                             progress, undo_desc,
-                             operation,
-                             dest_buffer, &rect);
+  if (gimp_gegl_apply_cancelable_operation (gimp_drawable_get_buffer (drawable),
+                                            progress, undo_desc,
+                                            operation,
+                                            dest_buffer, &rect))
+    {
+      gimp_drawable_merge_shadow_buffer (drawable, TRUE, undo_desc);
+      gimp_drawable_update (drawable, rect.x, rect.y, rect.width, rect.height);
+    }
 
-  gimp_drawable_merge_shadow_buffer (drawable, TRUE, undo_desc);
   gimp_drawable_free_shadow_buffer (drawable);
 
-  gimp_drawable_update (drawable, rect.x, rect.y, rect.width, rect.height);
-
   if (progress)
     gimp_progress_end (progress);
 }
@@ -20,19 +20,23 @@
 
 struct _GimpDrawablePrivate
 {
-  GeglBuffer     *buffer; /* buffer for drawable data */
-  GeglBuffer     *shadow; /* shadow buffer            */
+  GeglBuffer           *buffer;             /* buffer for drawable data */
+  GeglBuffer           *shadow;             /* shadow buffer            */
 
-  GeglNode       *source_node;
-  GeglNode       *buffer_source_node;
-  GimpContainer  *filter_stack;
+  GeglNode             *source_node;
+  GeglNode             *buffer_source_node;
+  GimpContainer        *filter_stack;
 
-  GimpLayer      *floating_selection;
-  GimpFilter     *fs_filter;
-  GeglNode       *fs_crop_node;
-  GimpApplicator *fs_applicator;
+  GimpLayer            *floating_selection;
+  GimpFilter           *fs_filter;
+  GeglNode             *fs_crop_node;
+  GimpApplicator       *fs_applicator;
 
-  GeglNode       *mode_node;
+  GeglNode             *mode_node;
+
+  GeglBuffer           *prescaled;          /* see gimp_drawable_prescale()   */
+  GeglBuffer           *prescaled_source;   /* the buffer it was scaled from */
+  GimpInterpolationType prescaled_interpolation;
 };
 
 #endif /* __GIMP_DRAWABLE_PRIVATE_H__ */
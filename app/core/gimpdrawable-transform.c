@@ -34,6 +34,7 @@
 #include "gegl/gimp-gegl-utils.h"
 
 #include "gimp.h"
+#include "gimp-parallel.h"
 #include "gimp-transform-resize.h"
 #include "gimpchannel.h"
 #include "gimpcontext.h"
@@ -61,6 +62,47 @@
 #endif
 
 
+/*  the size of the blocks pixels are reordered in, small enough for a
+ *  source and a destination block to stay in the cache
+ */
+#define BLOCK_SIZE      64
+
+/*  the minimal area handled by one thread  */
+#define MIN_THREAD_AREA (4 * BLOCK_SIZE * BLOCK_SIZE)
+
+
+typedef enum
+{
+  REORDER_FLIP_HORIZONTAL,
+  REORDER_FLIP_VERTICAL,
+  REORDER_ROTATE_90,
+  REORDER_ROTATE_180,
+  REORDER_ROTATE_270
+} ReorderType;
+
+typedef struct
+{
+  GeglBuffer    *src_buffer;
+  GeglBuffer    *dest_buffer;
+  const Babl    *format;
+  gint           bpp;
+  GeglRectangle  src_rect;
+  GeglRectangle  dest_rect;
+  ReorderType    type;
+} ReorderData;
+
+
+/*  local function prototypes  */
+
+static void   gimp_drawable_transform_reorder      (GeglBuffer          *src_buffer,
+                                                    const GeglRectangle *src_rect,
+                                                    GeglBuffer          *dest_buffer,
+                                                    const GeglRectangle *dest_rect,
+                                                    ReorderType          type);
+static void   gimp_drawable_transform_reorder_area (const GeglRectangle *area,
+                                                    ReorderData         *data);
+
+
 /*  public functions  */
 
 GeglBuffer *
@@ -154,7 +196,6 @@ gimp_drawable_transform_buffer_flip (GimpDrawable        *drawable,
   gint           orig_width, orig_height;
   gint           new_x, new_y;
   gint           new_width, new_height;
-  gint           i;
 
   g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), NULL);
   g_return_val_if_fail (gimp_item_is_attached (GIMP_ITEM (drawable)), NULL);
@@ -238,48 +279,28 @@ gimp_drawable_transform_buffer_flip (GimpDrawable        *drawable,
   if (new_width == 0 && new_height == 0)
     return new_buffer;
 
+  src_rect.x      = orig_x;
+  src_rect.y      = orig_y;
+  src_rect.width  = orig_width;
+  src_rect.height = orig_height;
+
+  dest_rect.x      = new_x;
+  dest_rect.y      = new_y;
+  dest_rect.width  = new_width;
+  dest_rect.height = new_height;
+
   switch (flip_type)
     {
     case GIMP_ORIENTATION_HORIZONTAL:
-      src_rect.x      = orig_x;
-      src_rect.y      = orig_y;
-      src_rect.width  = 1;
-      src_rect.height = orig_height;
-
-      dest_rect.x      = new_x + new_width - 1;
-      dest_rect.y      = new_y;
-      dest_rect.width  = 1;
-      dest_rect.height = new_height;
-
-      for (i = 0; i < orig_width; i++)
-        {
-          src_rect.x  = i + orig_x;
-          dest_rect.x = new_x + new_width - i - 1;
-
-          gegl_buffer_copy (orig_buffer, &src_rect,
-                            new_buffer, &dest_rect);
-        }
+      gimp_drawable_transform_reorder (orig_buffer, &src_rect,
+                                       new_buffer, &dest_rect,
+                                       REORDER_FLIP_HORIZONTAL);
       break;
 
     case GIMP_ORIENTATION_VERTICAL:
-      src_rect.x      = orig_x;
-      src_rect.y      = orig_y;
-      src_rect.width  = orig_width;
-      src_rect.height = 1;
-
-      dest_rect.x      = new_x;
-      dest_rect.y      = new_y + new_height - 1;
-      dest_rect.width  = new_width;
-      dest_rect.height = 1;
-
-      for (i = 0; i < orig_height; i++)
-        {
-          src_rect.y  = i + orig_y;
-          dest_rect.y = new_y + new_height - i - 1;
-
-          gegl_buffer_copy (orig_buffer, &src_rect,
-                            new_buffer, &dest_rect);
-        }
+      gimp_drawable_transform_reorder (orig_buffer, &src_rect,
+                                       new_buffer, &dest_rect,
+                                       REORDER_FLIP_VERTICAL);
       break;
 
     case GIMP_ORIENTATION_UNKNOWN:
@@ -341,7 +362,6 @@ gimp_drawable_transform_buffer_rotate (GimpDrawable     *drawable,
   GeglRectangle  dest_rect;
   gint           orig_x, orig_y;
   gint           orig_width, orig_height;
-  gint           orig_bpp;
   gint           new_x, new_y;
   gint           new_width, new_height;
 
@@ -354,7 +374,6 @@ gimp_drawable_transform_buffer_rotate (GimpDrawable     *drawable,
   orig_y      = orig_offset_y;
   orig_width  = gegl_buffer_get_width (orig_buffer);
   orig_height = gegl_buffer_get_height (orig_buffer);
-  orig_bpp    = babl_format_get_bytes_per_pixel (gegl_buffer_get_format (orig_buffer));
 
   switch (rotate_type)
     {
@@ -505,101 +524,27 @@ gimp_drawable_transform_buffer_rotate (GimpDrawable     *drawable,
   switch (rotate_type)
     {
     case GIMP_ROTATE_90:
-      {
-        guchar *buf = g_new (guchar, new_height * orig_bpp);
-        gint    i;
-
-        g_assert (new_height == orig_width);
-
-        src_rect.y      = orig_y + orig_height - 1;
-        src_rect.height = 1;
+      g_assert (new_height == orig_width);
 
-        dest_rect.x     = new_x;
-        dest_rect.width = 1;
-
-        for (i = 0; i < orig_height; i++)
-          {
-            src_rect.y  = orig_y + orig_height - 1 - i;
-            dest_rect.x = new_x + i;
-
-            gegl_buffer_get (orig_buffer, &src_rect, 1.0, NULL, buf,
-                             GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-            gegl_buffer_set (new_buffer, &dest_rect, 0, NULL, buf,
-                             GEGL_AUTO_ROWSTRIDE);
-          }
-
-        g_free (buf);
-      }
+      gimp_drawable_transform_reorder (orig_buffer, &src_rect,
+                                       new_buffer, &dest_rect,
+                                       REORDER_ROTATE_90);
       break;
 
     case GIMP_ROTATE_180:
-      {
-        guchar *buf = g_new (guchar, new_width * orig_bpp);
-        gint    i, j, k;
-
-        g_assert (new_width == orig_width);
-
-        src_rect.y      = orig_y + orig_height - 1;
-        src_rect.height = 1;
-
-        dest_rect.y      = new_y;
-        dest_rect.height = 1;
-
-        for (i = 0; i < orig_height; i++)
-          {
-            src_rect.y  = orig_y + orig_height - 1 - i;
-            dest_rect.y = new_y + i;
+      g_assert (new_width == orig_width);
 
-            gegl_buffer_get (orig_buffer, &src_rect, 1.0, NULL, buf,
-                             GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-
-            for (j = 0; j < orig_width / 2; j++)
-              {
-                guchar *left  = buf + j * orig_bpp;
-                guchar *right = buf + (orig_width - 1 - j) * orig_bpp;
-
-                for (k = 0; k < orig_bpp; k++)
-                  {
-                    guchar tmp = left[k];
-                    left[k]    = right[k];
-                    right[k]   = tmp;
-                  }
-              }
-
-            gegl_buffer_set (new_buffer, &dest_rect, 0, NULL, buf,
-                             GEGL_AUTO_ROWSTRIDE);
-          }
-
-        g_free (buf);
-      }
+      gimp_drawable_transform_reorder (orig_buffer, &src_rect,
+                                       new_buffer, &dest_rect,
+                                       REORDER_ROTATE_180);
       break;
 
     case GIMP_ROTATE_270:
-      {
-        guchar *buf = g_new (guchar, new_width * orig_bpp);
-        gint    i;
-
-        g_assert (new_width == orig_height);
-
-        src_rect.x     = orig_x + orig_width - 1;
-        src_rect.width = 1;
-
-        dest_rect.y      = new_y;
-        dest_rect.height = 1;
+      g_assert (new_width == orig_height);
 
-        for (i = 0; i < orig_width; i++)
-          {
-            src_rect.x  = orig_x + orig_width - 1 - i;
-            dest_rect.y = new_y + i;
-
-            gegl_buffer_get (orig_buffer, &src_rect, 1.0, NULL, buf,
-                             GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-            gegl_buffer_set (new_buffer, &dest_rect, 0, NULL, buf,
-                             GEGL_AUTO_ROWSTRIDE);
-          }
-
-        g_free (buf);
-      }
+      gimp_drawable_transform_reorder (orig_buffer, &src_rect,
+                                       new_buffer, &dest_rect,
+                                       REORDER_ROTATE_270);
       break;
     }
 
@@ -980,3 +925,212 @@ gimp_drawable_transform_paste (GimpDrawable *drawable,
 
   return drawable;
 }
+
+
+/*  private functions  */
+
+/*  copies @src_rect of @src_buffer to @dest_rect of @dest_buffer,
+ *  mirrored or rotated according to @type, in blocks that are
+ *  reordered in memory and distributed over all threads
+ */
+static void
+gimp_drawable_transform_reorder (GeglBuffer          *src_buffer,
+                                 const GeglRectangle *src_rect,
+                                 GeglBuffer          *dest_buffer,
+                                 const GeglRectangle *dest_rect,
+                                 ReorderType          type)
+{
+  ReorderData data;
+
+  data.src_buffer  = src_buffer;
+  data.dest_buffer = dest_buffer;
+  data.format      = gegl_buffer_get_format (src_buffer);
+  data.bpp         = babl_format_get_bytes_per_pixel (data.format);
+  data.src_rect    = *src_rect;
+  data.dest_rect   = *dest_rect;
+  data.type        = type;
+
+  gimp_parallel_distribute_area (dest_rect, MIN_THREAD_AREA,
+                                 (GimpParallelDistributeAreaFunc)
+                                 gimp_drawable_transform_reorder_area,
+                                 &data);
+}
+
+static inline void
+gimp_drawable_transform_reorder_row (guchar       *dest,
+                                     const guchar *src,
+                                     gint          step,
+                                     gint          n_pixels,
+                                     gint          bpp)
+{
+  if (step == bpp)
+    {
+      memcpy (dest, src, n_pixels * bpp);
+      return;
+    }
+
+  switch (bpp)
+    {
+    case 1:
+      for (; n_pixels; n_pixels--, dest += 1, src += step)
+        *dest = *src;
+      break;
+
+    case 2:
+      for (; n_pixels; n_pixels--, dest += 2, src += step)
+        *(guint16 *) dest = *(const guint16 *) src;
+      break;
+
+    case 4:
+      for (; n_pixels; n_pixels--, dest += 4, src += step)
+        *(guint32 *) dest = *(const guint32 *) src;
+      break;
+
+    case 8:
+      for (; n_pixels; n_pixels--, dest += 8, src += step)
+        *(guint64 *) dest = *(const guint64 *) src;
+      break;
+
+    default:
+      for (; n_pixels; n_pixels--, dest += bpp, src += step)
+        memcpy (dest, src, bpp);
+      break;
+    }
+}
+
+static void
+gimp_drawable_transform_reorder_area (const GeglRectangle *area,
+                                      ReorderData         *data)
+{
+  const gint  bpp       = data->bpp;
+  const gint  src_w     = data->src_rect.width;
+  const gint  src_h     = data->src_rect.height;
+  guchar     *src_buf;
+  guchar     *dest_buf;
+  gint        bx, by;
+
+  src_buf  = g_malloc (BLOCK_SIZE * BLOCK_SIZE * bpp);
+  dest_buf = g_malloc (BLOCK_SIZE * BLOCK_SIZE * bpp);
+
+  for (by = area->y; by < area->y + area->height; by += BLOCK_SIZE)
+    {
+      for (bx = area->x; bx < area->x + area->width; bx += BLOCK_SIZE)
+        {
+          GeglRectangle  dest_block;
+          GeglRectangle  src_block;
+          gint           u0, v0;    /*  block origin relative to dest_rect  */
+          gint           bw, bh;
+          gint           src_stride;
+          gint           y;
+
+          bw = MIN (BLOCK_SIZE, area->x + area->width  - bx);
+          bh = MIN (BLOCK_SIZE, area->y + area->height - by);
+
+          u0 = bx - data->dest_rect.x;
+          v0 = by - data->dest_rect.y;
+
+          dest_block.x      = bx;
+          dest_block.y      = by;
+          dest_block.width  = bw;
+          dest_block.height = bh;
+
+          switch (data->type)
+            {
+            case REORDER_FLIP_HORIZONTAL:
+              src_block.x      = src_w - u0 - bw;
+              src_block.y      = v0;
+              src_block.width  = bw;
+              src_block.height = bh;
+              break;
+
+            case REORDER_FLIP_VERTICAL:
+              src_block.x      = u0;
+              src_block.y      = src_h - v0 - bh;
+              src_block.width  = bw;
+              src_block.height = bh;
+              break;
+
+            case REORDER_ROTATE_180:
+              src_block.x      = src_w - u0 - bw;
+              src_block.y      = src_h - v0 - bh;
+              src_block.width  = bw;
+              src_block.height = bh;
+              break;
+
+            case REORDER_ROTATE_90:
+              src_block.x      = v0;
+              src_block.y      = src_h - u0 - bw;
+              src_block.width  = bh;
+              src_block.height = bw;
+              break;
+
+            case REORDER_ROTATE_270:
+              src_block.x      = src_w - v0 - bh;
+              src_block.y      = u0;
+              src_block.width  = bh;
+              src_block.height = bw;
+              break;
+
+            default:
+              g_assert_not_reached ();
+            }
+
+          src_block.x += data->src_rect.x;
+          src_block.y += data->src_rect.y;
+
+          src_stride = src_block.width * bpp;
+
+          gegl_buffer_get (data->src_buffer, &src_block, 1.0,
+                           data->format, src_buf,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+          for (y = 0; y < bh; y++)
+            {
+              const guchar *src;
+              gint          step;
+
+              /*  the source pixel of the row's first pixel, and the
+               *  distance between the sources of adjacent pixels
+               */
+              switch (data->type)
+                {
+                case REORDER_FLIP_HORIZONTAL:
+                  src  = src_buf + y * src_stride + (bw - 1) * bpp;
+                  step = -bpp;
+                  break;
+
+                case REORDER_FLIP_VERTICAL:
+                  src  = src_buf + (bh - 1 - y) * src_stride;
+                  step = bpp;
+                  break;
+
+                case REORDER_ROTATE_90:
+                  src  = src_buf + (bw - 1) * src_stride + y * bpp;
+                  step = -src_stride;
+                  break;
+
+                case REORDER_ROTATE_180:
+                  src  = src_buf + (bh - 1 - y) * src_stride + (bw - 1) * bpp;
+                  step = -bpp;
+                  break;
+
+                case REORDER_ROTATE_270:
+                default:
+                  src  = src_buf + (bh - 1 - y) * bpp;
+                  step = src_stride;
+                  break;
+                }
+
+              gimp_drawable_transform_reorder_row (dest_buf + y * bw * bpp,
+                                                   src, step, bw, bpp);
+            }
+
+          gegl_buffer_set (data->dest_buffer, &dest_block, 0,
+                           data->format, dest_buf,
+                           GEGL_AUTO_ROWSTRIDE);
+        }
+    }
+
+  g_free (src_buf);
+  g_free (dest_buf);
+}
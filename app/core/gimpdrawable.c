@@ -36,6 +36,7 @@
 #include "gimpchannel.h"
 #include "gimpcontext.h"
 #include "gimpdrawable-combine.h"
+#include "gimpdrawable-convert.h"
 #include "gimpdrawable-filter.h"
 #include "gimpdrawable-preview.h"
 #include "gimpdrawable-private.h"
@@ -314,6 +315,7 @@ gimp_drawable_finalize (GObject *object)
     }
 
   gimp_drawable_free_shadow_buffer (drawable);
+  gimp_drawable_clear_prescaled (drawable);
 
   if (drawable->private->source_node)
     {
@@ -504,21 +506,35 @@ gimp_drawable_scale (GimpItem              *item,
                      GimpInterpolationType  interpolation_type,
                      GimpProgress          *progress)
 {
-  GimpDrawable *drawable = GIMP_DRAWABLE (item);
-  GeglBuffer   *new_buffer;
+  GimpDrawable        *drawable = GIMP_DRAWABLE (item);
+  GimpDrawablePrivate *private  = drawable->private;
+  GeglBuffer          *new_buffer;
 
-  new_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0,
-                                                new_width, new_height),
-                                gimp_drawable_get_format (drawable));
+  if (private->prescaled                                              &&
+      private->prescaled_source        == gimp_drawable_get_buffer (drawable) &&
+      private->prescaled_interpolation == interpolation_type          &&
+      gegl_buffer_get_width  (private->prescaled) == new_width        &&
+      gegl_buffer_get_height (private->prescaled) == new_height)
+    {
+      new_buffer = g_object_ref (private->prescaled);
+    }
+  else
+    {
+      new_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0,
+                                                    new_width, new_height),
+                                    gimp_drawable_get_format (drawable));
+
+      gimp_gegl_apply_scale (gimp_drawable_get_buffer (drawable),
+                             progress, C_("undo-type", "Scale"),
+                             new_buffer,
+                             interpolation_type,
+                             ((gdouble) new_width /
+                              gimp_item_get_width  (item)),
+                             ((gdouble) new_height /
+                              gimp_item_get_height (item)));
+    }
 
-  gimp_gegl_apply_scale (gimp_drawable_get_buffer (drawable),
-                         progress, C_("undo-type", "Scale"),
-                         new_buffer,
-                         interpolation_type,
-                         ((gdouble) new_width /
-                          gimp_item_get_width  (item)),
-                         ((gdouble) new_height /
-                          gimp_item_get_height (item)));
+  gimp_drawable_clear_prescaled (drawable);
 
   gimp_drawable_set_buffer_full (drawable, gimp_item_is_attached (item), NULL,
                                  new_buffer,
@@ -777,14 +793,7 @@ gimp_drawable_real_convert_type (GimpDrawable      *drawable,
                                   new_precision,
                                   gimp_drawable_has_alpha (drawable));
 
-  dest_buffer =
-    gegl_buffer_new (GEGL_RECTANGLE (0, 0,
-                                     gimp_item_get_width  (GIMP_ITEM (drawable)),
-                                     gimp_item_get_height (GIMP_ITEM (drawable))),
-                     format);
-
-  gegl_buffer_copy (gimp_drawable_get_buffer (drawable), NULL,
-                    dest_buffer, NULL);
+  dest_buffer = gimp_drawable_convert_buffer (drawable, format, 0);
 
   gimp_drawable_set_buffer (drawable, push_undo, NULL, dest_buffer);
   g_object_unref (dest_buffer);
@@ -1381,6 +1390,74 @@ gimp_drawable_set_buffer_full (GimpDrawable *drawable,
                         gimp_item_get_height (item));
 }
 
+/**
+ * gimp_drawable_prescale:
+ * @drawable:           a #GimpDrawable
+ * @new_width:          the width the drawable is going to be scaled to
+ * @new_height:         the height the drawable is going to be scaled to
+ * @interpolation_type: the interpolation that is going to be used
+ *
+ * Scales the drawable's pixels ahead of a gimp_item_scale() with the
+ * same size and interpolation, which then only swaps the buffers.
+ * Touches nothing but the drawable's buffers and may therefore be
+ * called from any thread, for different drawables at the same time.
+ * A prescaled buffer that doesn't get used must be released with
+ * gimp_drawable_clear_prescaled().
+ **/
+void
+gimp_drawable_prescale (GimpDrawable          *drawable,
+                        gint                   new_width,
+                        gint                   new_height,
+                        GimpInterpolationType  interpolation_type)
+{
+  GimpDrawablePrivate *private;
+  GeglBuffer          *buffer;
+
+  g_return_if_fail (GIMP_IS_DRAWABLE (drawable));
+  g_return_if_fail (new_width > 0 && new_height > 0);
+
+  private = drawable->private;
+  buffer  = gimp_drawable_get_buffer (drawable);
+
+  gimp_drawable_clear_prescaled (drawable);
+
+  private->prescaled =
+    gegl_buffer_new (GEGL_RECTANGLE (0, 0, new_width, new_height),
+                     gimp_drawable_get_format (drawable));
+  private->prescaled_source        = g_object_ref (buffer);
+  private->prescaled_interpolation = interpolation_type;
+
+  gimp_gegl_apply_scale (buffer, NULL, NULL,
+                         private->prescaled,
+                         interpolation_type,
+                         ((gdouble) new_width /
+                          gegl_buffer_get_width  (buffer)),
+                         ((gdouble) new_height /
+                          gegl_buffer_get_height (buffer)));
+}
+
+void
+gimp_drawable_clear_prescaled (GimpDrawable *drawable)
+{
+  GimpDrawablePrivate *private;
+
+  g_return_if_fail (GIMP_IS_DRAWABLE (drawable));
+
+  private = drawable->private;
+
+  if (private->prescaled)
+    {
+      g_object_unref (private->prescaled);
+      private->prescaled = NULL;
+    }
+
+  if (private->prescaled_source)
+    {
+      g_object_unref (private->prescaled_source);
+      private->prescaled_source = NULL;
+    }
+}
+
 GeglNode *
 gimp_drawable_get_source_node (GimpDrawable *drawable)
 {
@@ -177,6 +177,12 @@ void            gimp_drawable_set_buffer_full    (GimpDrawable       *drawable,
                                                   gint                offset_x,
                                                   gint                offset_y);
 
+void            gimp_drawable_prescale           (GimpDrawable       *drawable,
+                                                  gint                new_width,
+                                                  gint                new_height,
+                                                  GimpInterpolationType interpolation_type);
+void            gimp_drawable_clear_prescaled    (GimpDrawable       *drawable);
+
 GeglNode      * gimp_drawable_get_source_node    (GimpDrawable       *drawable);
 GeglNode      * gimp_drawable_get_mode_node      (GimpDrawable       *drawable);
 
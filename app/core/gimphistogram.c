@@ -29,9 +29,14 @@
 
 #include "gegl/gimp-babl.h"
 
+#include "gimp-parallel.h"
 #include "gimphistogram.h"
 
 
+#define HISTOGRAM_MIN_AREA         (128 * 128)
+#define HISTOGRAM_MERGE_MIN_VALUES 1024
+
+
 enum
 {
   PROP_0,
@@ -49,6 +54,25 @@ struct _GimpHistogramPrivate
 };
 
 
+typedef struct
+{
+  GimpHistogram       *histogram;
+  GeglBuffer          *buffer;
+  const GeglRectangle *buffer_rect;
+  GeglBuffer          *mask;
+  const GeglRectangle *mask_rect;
+  const Babl          *format;
+  GMutex               mutex;
+} CalculateData;
+
+typedef struct
+{
+  GimpHistogram       *histogram;
+  GimpHistogram      **partials;
+  gint                 n_partials;
+} MergeData;
+
+
 /*  local function prototypes  */
 
 static void     gimp_histogram_finalize     (GObject       *object);
@@ -68,6 +92,13 @@ static void     gimp_histogram_alloc_values (GimpHistogram *histogram,
                                              gint           n_components,
                                              gint           n_bins);
 
+static void     gimp_histogram_calculate_area
+                                            (const GeglRectangle *area,
+                                             CalculateData       *data);
+static void     gimp_histogram_merge_range  (gsize          offset,
+                                             gsize          size,
+                                             MergeData     *data);
+
 
 G_DEFINE_TYPE (GimpHistogram, gimp_histogram, GIMP_TYPE_OBJECT)
 
@@ -231,7 +262,7 @@ gimp_histogram_calculate (GimpHistogram       *histogram,
                           const GeglRectangle *mask_rect)
 {
   GimpHistogramPrivate *priv;
-  GeglBufferIterator   *iter;
+  CalculateData         data;
   const Babl           *format;
   gint                  n_components;
   gint                  n_bins;
@@ -316,164 +347,76 @@ gimp_histogram_calculate (GimpHistogram       *histogram,
 
   gimp_histogram_alloc_values (histogram, n_components, n_bins);
 
-  iter = gegl_buffer_iterator_new (buffer, buffer_rect, 0, format,
-                                   GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
-
-  if (mask)
-    gegl_buffer_iterator_add (iter, mask, mask_rect, 0,
-                              babl_format ("Y float"),
-                              GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
-
-#define VALUE(c,i) (priv->values[(c) * priv->n_bins + \
-                                 (gint) (CLAMP ((i), 0.0, 1.0) * \
-                                         (priv->n_bins - 0.0001))])
-
-  while (gegl_buffer_iterator_next (iter))
-    {
-      const gfloat *data = iter->data[0];
-      gfloat        max;
-
-      if (mask)
-        {
-          const gfloat *mask_data = iter->data[1];
-
-          switch (n_components)
-            {
-            case 1:
-              while (iter->length--)
-                {
-                  const gdouble masked = *mask_data;
-
-                  VALUE (0, data[0]) += masked;
-
-                  data += n_components;
-                  mask_data += 1;
-                }
-              break;
-
-            case 2:
-              while (iter->length--)
-                {
-                  const gdouble masked = *mask_data;
-                  const gdouble weight = data[1];
-
-                  VALUE (0, data[0]) += weight * masked;
-                  VALUE (1, data[1]) += masked;
-
-                  data += n_components;
-                  mask_data += 1;
-                }
-              break;
-
-            case 3: /* calculate separate value values */
-              while (iter->length--)
-                {
-                  const gdouble masked = *mask_data;
-
-                  VALUE (1, data[0]) += masked;
-                  VALUE (2, data[1]) += masked;
-                  VALUE (3, data[2]) += masked;
-
-                  max = MAX (data[0], data[1]);
-                  max = MAX (data[2], max);
-
-                  VALUE (0, max) += masked;
-
-                  data += n_components;
-                  mask_data += 1;
-                }
-              break;
-
-            case 4: /* calculate separate value values */
-              while (iter->length--)
-                {
-                  const gdouble masked = *mask_data;
-                  const gdouble weight = data[3];
-
-                  VALUE (1, data[0]) += weight * masked;
-                  VALUE (2, data[1]) += weight * masked;
-                  VALUE (3, data[2]) += weight * masked;
-                  VALUE (4, data[3]) += masked;
-
-                  max = MAX (data[0], data[1]);
-                  max = MAX (data[2], max);
-
-                  VALUE (0, max) += weight * masked;
+  data.histogram   = histogram;
+  data.buffer      = buffer;
+  data.buffer_rect = buffer_rect;
+  data.mask        = mask;
+  data.mask_rect   = mask_rect;
+  data.format      = format;
 
-                  data += n_components;
-                  mask_data += 1;
-                }
-              break;
-            }
-        }
-      else /* no mask */
-        {
-          switch (n_components)
-            {
-            case 1:
-              while (iter->length--)
-                {
-                  VALUE (0, data[0]) += 1.0;
+  g_mutex_init (&data.mutex);
 
-                  data += n_components;
-                }
-              break;
+  gimp_parallel_distribute_area (buffer_rect, HISTOGRAM_MIN_AREA,
+                                 (GimpParallelDistributeAreaFunc)
+                                 gimp_histogram_calculate_area,
+                                 &data);
 
-            case 2:
-              while (iter->length--)
-                {
-                  const gdouble weight = data[1];
-
-                  VALUE (0, data[0]) += weight;
-                  VALUE (1, data[1]) += 1.0;
-
-                  data += n_components;
-                }
-              break;
+  g_mutex_clear (&data.mutex);
 
-            case 3: /* calculate separate value values */
-              while (iter->length--)
-                {
-                  VALUE (1, data[0]) += 1.0;
-                  VALUE (2, data[1]) += 1.0;
-                  VALUE (3, data[2]) += 1.0;
+  g_object_notify (G_OBJECT (histogram), "values");
 
-                  max = MAX (data[0], data[1]);
-                  max = MAX (data[2], max);
+  g_object_thaw_notify (G_OBJECT (histogram));
+}
 
-                  VALUE (0, max) += 1.0;
+/**
+ * gimp_histogram_merge:
+ * @histogram:  a #GimpHistogram
+ * @partials:   an array of #GimpHistogram
+ * @n_partials: the number of histograms in @partials
+ *
+ * Sets @histogram to the sum of @partials, which must all have been
+ * calculated from buffers of the same format.
+ **/
+void
+gimp_histogram_merge (GimpHistogram  *histogram,
+                      GimpHistogram **partials,
+                      gint            n_partials)
+{
+  GimpHistogramPrivate *priv;
+  MergeData             data;
 
-                  data += n_components;
-                }
-              break;
+  g_return_if_fail (GIMP_IS_HISTOGRAM (histogram));
+  g_return_if_fail (partials != NULL && n_partials > 0);
 
-            case 4: /* calculate separate value values */
-              while (iter->length--)
-                {
-                  const gdouble weight = data[3];
+  priv = histogram->priv;
 
-                  VALUE (1, data[0]) += weight;
-                  VALUE (2, data[1]) += weight;
-                  VALUE (3, data[2]) += weight;
-                  VALUE (4, data[3]) += 1.0;
+  g_object_freeze_notify (G_OBJECT (histogram));
 
-                  max = MAX (data[0], data[1]);
-                  max = MAX (data[2], max);
+  gimp_histogram_alloc_values (histogram,
+                               partials[0]->priv->n_channels - 1,
+                               partials[0]->priv->n_bins);
 
-                  VALUE (0, max) += weight;
+  data.histogram  = histogram;
+  data.partials   = partials;
+  data.n_partials = n_partials;
 
-                  data += n_components;
-                }
-              break;
-            }
-        }
-    }
+  gimp_parallel_distribute_range (priv->n_channels * priv->n_bins,
+                                  HISTOGRAM_MERGE_MIN_VALUES,
+                                  (GimpParallelDistributeRangeFunc)
+                                  gimp_histogram_merge_range,
+                                  &data);
 
   g_object_notify (G_OBJECT (histogram), "values");
 
   g_object_thaw_notify (G_OBJECT (histogram));
+}
 
-#undef VALUE
+gboolean
+gimp_histogram_get_gamma_correct (GimpHistogram *histogram)
+{
+  g_return_val_if_fail (GIMP_IS_HISTOGRAM (histogram), FALSE);
+
+  return histogram->priv->gamma_correct;
 }
 
 void
@@ -948,3 +891,210 @@ gimp_histogram_alloc_values (GimpHistogram *histogram,
               priv->n_channels * priv->n_bins * sizeof (gdouble));
     }
 }
+
+/*  accumulates @area into a local histogram, and adds that to the
+ *  result when done, so the threads don't fight over the bins
+ */
+static void
+gimp_histogram_calculate_area (const GeglRectangle *area,
+                               CalculateData       *data)
+{
+  GimpHistogramPrivate *priv         = data->histogram->priv;
+  gint                  n_components = babl_format_get_n_components (data->format);
+  gint                  n_bins       = priv->n_bins;
+  gint                  n_values     = priv->n_channels * priv->n_bins;
+  GeglBufferIterator   *iter;
+  gdouble              *values;
+  gint                  i;
+
+  values = g_new0 (gdouble, n_values);
+
+  iter = gegl_buffer_iterator_new (data->buffer, area, 0, data->format,
+                                   GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+
+  if (data->mask)
+    {
+      GeglRectangle mask_area = *area;
+
+      mask_area.x += data->mask_rect->x - data->buffer_rect->x;
+      mask_area.y += data->mask_rect->y - data->buffer_rect->y;
+
+      gegl_buffer_iterator_add (iter, data->mask, &mask_area, 0,
+                                babl_format ("Y float"),
+                                GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+    }
+
+#define VALUE(c,i) (values[(c) * n_bins + \
+                           (gint) (CLAMP ((i), 0.0, 1.0) * \
+                                   (n_bins - 0.0001))])
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const gfloat *src = iter->data[0];
+      gfloat        max;
+
+      if (data->mask)
+        {
+          const gfloat *mask_data = iter->data[1];
+
+          switch (n_components)
+            {
+            case 1:
+              while (iter->length--)
+                {
+                  const gdouble masked = *mask_data;
+
+                  VALUE (0, src[0]) += masked;
+
+                  src += n_components;
+                  mask_data += 1;
+                }
+              break;
+
+            case 2:
+              while (iter->length--)
+                {
+                  const gdouble masked = *mask_data;
+                  const gdouble weight = src[1];
+
+                  VALUE (0, src[0]) += weight * masked;
+                  VALUE (1, src[1]) += masked;
+
+                  src += n_components;
+                  mask_data += 1;
+                }
+              break;
+
+            case 3: /* calculate separate value values */
+              while (iter->length--)
+                {
+                  const gdouble masked = *mask_data;
+
+                  VALUE (1, src[0]) += masked;
+                  VALUE (2, src[1]) += masked;
+                  VALUE (3, src[2]) += masked;
+
+                  max = MAX (src[0], src[1]);
+                  max = MAX (src[2], max);
+
+                  VALUE (0, max) += masked;
+
+                  src += n_components;
+                  mask_data += 1;
+                }
+              break;
+
+            case 4: /* calculate separate value values */
+              while (iter->length--)
+                {
+                  const gdouble masked = *mask_data;
+                  const gdouble weight = src[3];
+
+                  VALUE (1, src[0]) += weight * masked;
+                  VALUE (2, src[1]) += weight * masked;
+                  VALUE (3, src[2]) += weight * masked;
+                  VALUE (4, src[3]) += masked;
+
+                  max = MAX (src[0], src[1]);
+                  max = MAX (src[2], max);
+
+                  VALUE (0, max) += weight * masked;
+
+                  src += n_components;
+                  mask_data += 1;
+                }
+              break;
+            }
+        }
+      else /* no mask */
+        {
+          switch (n_components)
+            {
+            case 1:
+              while (iter->length--)
+                {
+                  VALUE (0, src[0]) += 1.0;
+
+                  src += n_components;
+                }
+              break;
+
+            case 2:
+              while (iter->length--)
+                {
+                  const gdouble weight = src[1];
+
+                  VALUE (0, src[0]) += weight;
+                  VALUE (1, src[1]) += 1.0;
+
+                  src += n_components;
+                }
+              break;
+
+            case 3: /* calculate separate value values */
+              while (iter->length--)
+                {
+                  VALUE (1, src[0]) += 1.0;
+                  VALUE (2, src[1]) += 1.0;
+                  VALUE (3, src[2]) += 1.0;
+
+                  max = MAX (src[0], src[1]);
+                  max = MAX (src[2], max);
+
+                  VALUE (0, max) += 1.0;
+
+                  src += n_components;
+                }
+              break;
+
+            case 4: /* calculate separate value values */
+              while (iter->length--)
+                {
+                  const gdouble weight = src[3];
+
+                  VALUE (1, src[0]) += weight;
+                  VALUE (2, src[1]) += weight;
+                  VALUE (3, src[2]) += weight;
+                  VALUE (4, src[3]) += 1.0;
+
+                  max = MAX (src[0], src[1]);
+                  max = MAX (src[2], max);
+
+                  VALUE (0, max) += weight;
+
+                  src += n_components;
+                }
+              break;
+            }
+        }
+    }
+
+#undef VALUE
+
+  g_mutex_lock (&data->mutex);
+
+  for (i = 0; i < n_values; i++)
+    priv->values[i] += values[i];
+
+  g_mutex_unlock (&data->mutex);
+
+  g_free (values);
+}
+
+static void
+gimp_histogram_merge_range (gsize      offset,
+                            gsize      size,
+                            MergeData *data)
+{
+  gdouble *values = data->histogram->priv->values + offset;
+  gint     i;
+
+  for (i = 0; i < data->n_partials; i++)
+    {
+      const gdouble *partial = data->partials[i]->priv->values + offset;
+      gsize          j;
+
+      for (j = 0; j < size; j++)
+        values[j] += partial[j];
+    }
+}
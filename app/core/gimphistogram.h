@@ -60,8 +60,15 @@ void            gimp_histogram_calculate     (GimpHistogram        *histogram,
                                               GeglBuffer           *mask,
                                               const GeglRectangle  *mask_rect);
 
+void            gimp_histogram_merge         (GimpHistogram        *histogram,
+                                              GimpHistogram       **partials,
+                                              gint                  n_partials);
+
 void            gimp_histogram_clear_values  (GimpHistogram        *histogram);
 
+gboolean        gimp_histogram_get_gamma_correct
+                                             (GimpHistogram        *histogram);
+
 gdouble         gimp_histogram_get_maximum   (GimpHistogram        *histogram,
                                               GimpHistogramChannel  channel);
 gdouble         gimp_histogram_get_count     (GimpHistogram        *histogram,
@@ -36,6 +36,11 @@ struct _GimpIdTablePriv
 {
   GHashTable *id_table;
   gint        next_id;
+
+  /*  procedures scheduled on other threads look up and free items
+   *  while the main thread creates new ones, see gimppdb-scheduler.c
+   */
+  GMutex      mutex;
 };
 
 
@@ -73,6 +78,8 @@ gimp_id_table_init (GimpIdTable *id_table)
 
   id_table->priv->id_table = g_hash_table_new (g_direct_hash, NULL);
   id_table->priv->next_id  = GIMP_ID_TABLE_START_ID;
+
+  g_mutex_init (&id_table->priv->mutex);
 }
 
 static void
@@ -86,6 +93,8 @@ gimp_id_table_finalize (GObject *object)
       id_table->priv->id_table = NULL;
     }
 
+  g_mutex_clear (&id_table->priv->mutex);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -130,6 +139,8 @@ gimp_id_table_insert (GimpIdTable *id_table, gpointer data)
 
   g_return_val_if_fail (GIMP_IS_ID_TABLE (id_table), 0);
 
+  g_mutex_lock (&id_table->priv->mutex);
+
   do
     {
       new_id = id_table->priv->next_id++;
@@ -137,9 +148,15 @@ gimp_id_table_insert (GimpIdTable *id_table, gpointer data)
       if (id_table->priv->next_id == GIMP_ID_TABLE_END_ID)
         id_table->priv->next_id = GIMP_ID_TABLE_START_ID;
     }
-  while (gimp_id_table_lookup (id_table, new_id));
+  while (g_hash_table_lookup (id_table->priv->id_table,
+                              GINT_TO_POINTER (new_id)));
+
+  g_hash_table_insert (id_table->priv->id_table,
+                       GINT_TO_POINTER (new_id), data);
+
+  g_mutex_unlock (&id_table->priv->mutex);
 
-  return gimp_id_table_insert_with_id (id_table, new_id, data);
+  return new_id;
 }
 
 /**
@@ -159,10 +176,19 @@ gimp_id_table_insert_with_id (GimpIdTable *id_table, gint id, gpointer data)
   g_return_val_if_fail (GIMP_IS_ID_TABLE (id_table), 0);
   g_return_val_if_fail (id > 0, 0);
 
-  if (gimp_id_table_lookup (id_table, id))
-    return -1;
+  g_mutex_lock (&id_table->priv->mutex);
+
+  if (g_hash_table_lookup (id_table->priv->id_table, GINT_TO_POINTER (id)))
+    {
+      id = -1;
+    }
+  else
+    {
+      g_hash_table_insert (id_table->priv->id_table,
+                           GINT_TO_POINTER (id), data);
+    }
 
-  g_hash_table_insert (id_table->priv->id_table, GINT_TO_POINTER (id), data);
+  g_mutex_unlock (&id_table->priv->mutex);
 
   return id;
 }
@@ -182,7 +208,11 @@ gimp_id_table_replace (GimpIdTable *id_table, gint id, gpointer data)
   g_return_if_fail (GIMP_IS_ID_TABLE (id_table));
   g_return_if_fail (id > 0);
 
+  g_mutex_lock (&id_table->priv->mutex);
+
   g_hash_table_replace (id_table->priv->id_table, GINT_TO_POINTER (id), data);
+
+  g_mutex_unlock (&id_table->priv->mutex);
 }
 
 /**
@@ -197,9 +227,17 @@ gimp_id_table_replace (GimpIdTable *id_table, gint id, gpointer data)
 gpointer
 gimp_id_table_lookup (GimpIdTable *id_table, gint id)
 {
+  gpointer data;
+
   g_return_val_if_fail (GIMP_IS_ID_TABLE (id_table), NULL);
 
-  return g_hash_table_lookup (id_table->priv->id_table, GINT_TO_POINTER (id));
+  g_mutex_lock (&id_table->priv->mutex);
+
+  data = g_hash_table_lookup (id_table->priv->id_table, GINT_TO_POINTER (id));
+
+  g_mutex_unlock (&id_table->priv->mutex);
+
+  return data;
 }
 
 
@@ -216,9 +254,18 @@ gimp_id_table_lookup (GimpIdTable *id_table, gint id)
 gboolean
 gimp_id_table_remove (GimpIdTable *id_table, gint id)
 {
+  gboolean removed;
+
   g_return_val_if_fail (GIMP_IS_ID_TABLE (id_table), FALSE);
 
   g_return_val_if_fail (id_table != NULL, FALSE);
 
-  return g_hash_table_remove (id_table->priv->id_table, GINT_TO_POINTER (id));
+  g_mutex_lock (&id_table->priv->mutex);
+
+  removed = g_hash_table_remove (id_table->priv->id_table,
+                                 GINT_TO_POINTER (id));
+
+  g_mutex_unlock (&id_table->priv->mutex);
+
+  return removed;
 }
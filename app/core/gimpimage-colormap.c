@@ -88,7 +88,7 @@ gimp_image_colormap_init (GimpImage *image)
 
   gimp_data_make_internal (GIMP_DATA (private->palette), palette_id);
 
-  palettes = gimp_data_factory_get_container (image->gimp->palette_factory);
+  palettes = gimp_data_factory_peek_container (image->gimp->palette_factory);
 
   gimp_container_add (palettes, GIMP_OBJECT (private->palette));
 
@@ -109,7 +109,7 @@ gimp_image_colormap_dispose (GimpImage *image)
   g_return_if_fail (private->colormap != NULL);
   g_return_if_fail (GIMP_IS_PALETTE (private->palette));
 
-  palettes = gimp_data_factory_get_container (image->gimp->palette_factory);
+  palettes = gimp_data_factory_peek_container (image->gimp->palette_factory);
 
   gimp_container_remove (palettes, GIMP_OBJECT (private->palette));
 }
@@ -24,20 +24,37 @@
 
 #include "core-types.h"
 
+#include "gegl/gimp-babl.h"
 #include "gegl/gimp-gegl-utils.h"
 
 #include "gimpdrawable.h"
+#include "gimpdrawable-convert.h"
 #include "gimpimage.h"
 #include "gimpimage-convert-precision.h"
 #include "gimpimage-undo.h"
 #include "gimpimage-undo-push.h"
+#include "gimplayer.h"
 #include "gimpprogress.h"
+#include "gimpsubprogress.h"
 
 #include "text/gimptextlayer.h"
 
 #include "gimp-intl.h"
 
 
+static gint   gimp_image_convert_precision_prepare (GimpImage      *image,
+                                                    GList          *drawables,
+                                                    GimpPrecision   precision,
+                                                    gint            layer_dither_type,
+                                                    gint            text_layer_dither_type,
+                                                    gint            mask_dither_type,
+                                                    gint            progress_steps,
+                                                    GimpProgress   *progress,
+                                                    GimpDrawable ***prepared);
+
+
+/*  public functions  */
+
 void
 gimp_image_convert_precision (GimpImage     *image,
                               GimpPrecision  precision,
@@ -46,10 +63,13 @@ gimp_image_convert_precision (GimpImage     *image,
                               gint           mask_dither_type,
                               GimpProgress  *progress)
 {
-  GList       *all_drawables;
-  GList       *list;
-  const gchar *undo_desc = NULL;
-  gint         nth_drawable, n_drawables;
+  GList         *all_drawables;
+  GList         *list;
+  GimpDrawable **prepared;
+  gint           n_prepared;
+  GimpProgress  *sub_progress;
+  const gchar   *undo_desc = NULL;
+  gint           nth_drawable, n_drawables;
 
   g_return_if_fail (GIMP_IS_IMAGE (image));
   g_return_if_fail (precision != gimp_image_get_precision (image));
@@ -99,6 +119,8 @@ gimp_image_convert_precision (GimpImage     *image,
   if (progress)
     gimp_progress_start (progress, undo_desc, FALSE);
 
+  sub_progress = gimp_sub_progress_new (progress);
+
   g_object_freeze_notify (G_OBJECT (image));
 
   gimp_image_undo_group_start (image, GIMP_UNDO_GROUP_IMAGE_CONVERT,
@@ -110,6 +132,18 @@ gimp_image_convert_precision (GimpImage     *image,
   /*  Set the new precision  */
   g_object_set (image, "precision", precision, NULL);
 
+  /*  Convert the pixels of all drawables in parallel up front, the
+   *  convert_type() calls below then only push undo and swap buffers
+   */
+  n_prepared = gimp_image_convert_precision_prepare (image, all_drawables,
+                                                     precision,
+                                                     layer_dither_type,
+                                                     text_layer_dither_type,
+                                                     mask_dither_type,
+                                                     n_drawables,
+                                                     sub_progress,
+                                                     &prepared);
+
   for (list = all_drawables, nth_drawable = 0;
        list;
        list = g_list_next (list), nth_drawable++)
@@ -117,6 +151,10 @@ gimp_image_convert_precision (GimpImage     *image,
       GimpDrawable *drawable = list->data;
       gint          dither_type;
 
+      gimp_sub_progress_set_step (GIMP_SUB_PROGRESS (sub_progress),
+                                  n_prepared + nth_drawable,
+                                  n_prepared + n_drawables);
+
       if (gimp_item_is_text_layer (GIMP_ITEM (drawable)))
         dither_type = text_layer_dither_type;
       else
@@ -128,10 +166,6 @@ gimp_image_convert_precision (GimpImage     *image,
                                   dither_type,
                                   mask_dither_type,
                                   TRUE);
-
-      if (progress)
-        gimp_progress_set_value (progress,
-                                 (gdouble) nth_drawable / (gdouble) n_drawables);
     }
   g_list_free (all_drawables);
 
@@ -140,25 +174,25 @@ gimp_image_convert_precision (GimpImage     *image,
     GimpChannel *mask = gimp_image_get_mask (image);
     GeglBuffer  *buffer;
 
-    gimp_image_undo_push_mask_precision (image, NULL, mask);
+    gimp_sub_progress_set_step (GIMP_SUB_PROGRESS (sub_progress),
+                                n_prepared + nth_drawable,
+                                n_prepared + n_drawables);
 
-    buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0,
-                                              gimp_image_get_width  (image),
-                                              gimp_image_get_height (image)),
-                              gimp_image_get_mask_format (image));
+    gimp_image_undo_push_mask_precision (image, NULL, mask);
 
-    gegl_buffer_copy (gimp_drawable_get_buffer (GIMP_DRAWABLE (mask)), NULL,
-                      buffer, NULL);
+    buffer = gimp_drawable_convert_buffer (GIMP_DRAWABLE (mask),
+                                           gimp_image_get_mask_format (image),
+                                           0);
 
     gimp_drawable_set_buffer (GIMP_DRAWABLE (mask), FALSE, NULL, buffer);
     g_object_unref (buffer);
+  }
 
-    nth_drawable++;
+  /*  drop whatever was prepared but not used  */
+  gimp_drawable_convert_unprepare (prepared, n_prepared);
+  g_free (prepared);
 
-    if (progress)
-      gimp_progress_set_value (progress,
-                               (gdouble) nth_drawable / (gdouble) n_drawables);
-  }
+  g_object_unref (sub_progress);
 
   gimp_image_undo_group_end (image);
 
@@ -168,3 +202,96 @@ gimp_image_convert_precision (GimpImage     *image,
   if (progress)
     gimp_progress_end (progress);
 }
+
+
+/*  private functions  */
+
+/*  converts the pixels of all drawables that need it, reporting on
+ *  @progress as many steps as drawables are converted, out of those
+ *  plus @progress_steps for the rest of the conversion
+ */
+static gint
+gimp_image_convert_precision_prepare (GimpImage      *image,
+                                      GList          *drawables,
+                                      GimpPrecision   precision,
+                                      gint            layer_dither_type,
+                                      gint            text_layer_dither_type,
+                                      gint            mask_dither_type,
+                                      gint            progress_steps,
+                                      GimpProgress   *progress,
+                                      GimpDrawable ***prepared)
+{
+  GimpDrawable **list;
+  const Babl   **formats;
+  gint          *dither_types;
+  gint           n_max;
+  gint           n = 0;
+  GList         *iter;
+
+  /*  every drawable, maybe its mask, and the selection  */
+  n_max = 2 * g_list_length (drawables) + 1;
+
+  list         = g_new (GimpDrawable *, n_max);
+  formats      = g_new (const Babl *, n_max);
+  dither_types = g_new (gint, n_max);
+
+  for (iter = drawables; iter; iter = g_list_next (iter))
+    {
+      GimpDrawable  *drawable = iter->data;
+      GimpLayerMask *mask     = NULL;
+
+      if (GIMP_IS_LAYER (drawable))
+        mask = gimp_layer_get_mask (GIMP_LAYER (drawable));
+
+      if (mask)
+        {
+          list[n]         = GIMP_DRAWABLE (mask);
+          formats[n]      = gimp_babl_mask_format (precision);
+          dither_types[n] = mask_dither_type;
+          n++;
+        }
+
+      /*  groups render their projection, unmodified text layers
+       *  render their text again, there is nothing to convert
+       */
+      if (gimp_viewable_get_children (GIMP_VIEWABLE (drawable)))
+        continue;
+
+      if (gimp_item_is_text_layer (GIMP_ITEM (drawable)) &&
+          text_layer_dither_type == 0)
+        continue;
+
+      list[n]    = drawable;
+      formats[n] = gimp_image_get_format (image,
+                                          gimp_drawable_get_base_type (drawable),
+                                          precision,
+                                          gimp_drawable_has_alpha (drawable));
+
+      if (gimp_item_is_text_layer (GIMP_ITEM (drawable)))
+        dither_types[n] = text_layer_dither_type;
+      else if (GIMP_IS_LAYER (drawable))
+        dither_types[n] = layer_dither_type;
+      else
+        dither_types[n] = mask_dither_type;
+
+      n++;
+    }
+
+  list[n]         = GIMP_DRAWABLE (gimp_image_get_mask (image));
+  formats[n]      = gimp_image_get_mask_format (image);
+  dither_types[n] = 0;
+  n++;
+
+  gimp_sub_progress_set_range (GIMP_SUB_PROGRESS (progress),
+                               0.0,
+                               (gdouble) n / (n + progress_steps));
+
+  gimp_drawable_convert_prepare (list, formats, dither_types, n, progress);
+
+  g_free (formats);
+  g_free (dither_types);
+
+  *prepared = list;
+
+  return n;
+}
@@ -144,6 +144,7 @@
 #include "gegl/gimp-gegl-utils.h"
 
 #include "gimp.h"
+#include "gimp-parallel.h"
 #include "gimpcontainer.h"
 #include "gimpdrawable.h"
 #include "gimperror.h"
@@ -187,6 +188,12 @@
 #define G_SCALE 24              /*  scale G (a*) distances by this much  */
 #define B_SCALE 26              /*  and B (b*) by this much              */
 
+/* minimum number of rows each thread handles when processing a layer */
+#define PARALLEL_MIN_ROWS         64
+/* private RGB histograms are 8 MB each, limit how many we allocate */
+#define HISTOGRAM_MAX_THREADS     4
+#define HISTOGRAM_MERGE_MIN_CELLS 16384
+
 
 typedef struct _Color Color;
 typedef struct _QuantizeObj QuantizeObj;
@@ -516,6 +523,15 @@ static void generate_histogram_rgb  (CFHistogram   histogram,
                                      gint          nth_layer,
                                      gint          n_layers);
 
+static void          median_cut_pass2_fs_dither_rgb (QuantizeObj *quantobj,
+                                                     GimpLayer   *layer,
+                                                     GeglBuffer  *new_buffer);
+static GeglBuffer ** median_cut_pass2_fs_dither_rgb_layers
+                                                    (QuantizeObj *quantobj,
+                                                     GimpImage   *image,
+                                                     GList       *layers,
+                                                     gboolean     text_layer_dither);
+
 static QuantizeObj * initialize_median_cut (GimpImageBaseType      old_type,
                                             gint                   num_cols,
                                             GimpConvertDitherType  dither_type,
@@ -752,7 +768,8 @@ gimp_image_convert_type (GimpImage               *image,
   GimpImageBaseType  old_type;
   GList             *all_layers;
   GList             *list;
-  const gchar       *undo_desc = NULL;
+  const gchar       *undo_desc   = NULL;
+  GeglBuffer       **new_buffers = NULL;
   gint               nth_layer, n_layers;
 
   g_return_val_if_fail (GIMP_IS_IMAGE (image), FALSE);
@@ -969,6 +986,14 @@ gimp_image_convert_type (GimpImage               *image,
   if (quantobj)
     quantobj->n_layers = n_layers;
 
+  if (new_type == GIMP_INDEXED &&
+      quantobj->second_pass == median_cut_pass2_fs_dither_rgb)
+    {
+      new_buffers = median_cut_pass2_fs_dither_rgb_layers (quantobj, image,
+                                                           all_layers,
+                                                           text_layer_dither);
+    }
+
   for (list = all_layers, nth_layer = 0;
        list;
        list = g_list_next (list), nth_layer++)
@@ -999,17 +1024,25 @@ gimp_image_convert_type (GimpImage               *image,
           GeglBuffer *new_buffer;
           gboolean    has_alpha;
 
-          has_alpha = gimp_drawable_has_alpha (GIMP_DRAWABLE (layer));
+          if (new_buffers)
+            {
+              /*  already dithered above  */
+              new_buffer = new_buffers[nth_layer];
+            }
+          else
+            {
+              has_alpha = gimp_drawable_has_alpha (GIMP_DRAWABLE (layer));
 
-          new_buffer =
-            gegl_buffer_new (GEGL_RECTANGLE (0, 0,
-                                             gimp_item_get_width  (GIMP_ITEM (layer)),
-                                             gimp_item_get_height (GIMP_ITEM (layer))),
-                             gimp_image_get_layer_format (image,
-                                                          has_alpha));
+              new_buffer =
+                gegl_buffer_new (GEGL_RECTANGLE (0, 0,
+                                                 gimp_item_get_width  (GIMP_ITEM (layer)),
+                                                 gimp_item_get_height (GIMP_ITEM (layer))),
+                                 gimp_image_get_layer_format (image,
+                                                              has_alpha));
 
-          quantobj->nth_layer = nth_layer;
-          quantobj->second_pass (quantobj, layer, new_buffer);
+              quantobj->nth_layer = nth_layer;
+              quantobj->second_pass (quantobj, layer, new_buffer);
+            }
 
           gimp_drawable_set_buffer (GIMP_DRAWABLE (layer), TRUE, NULL,
                                     new_buffer);
@@ -1024,6 +1057,8 @@ gimp_image_convert_type (GimpImage               *image,
         }
     }
 
+  g_free (new_buffers);
+
   /*  Set the final palette on the image  */
   switch (new_type)
     {
@@ -1128,54 +1163,349 @@ zero_histogram_rgb (CFHistogram histogram)
 }
 
 
+/* Return the @i-th of @n horizontal bands of the @rect_index-th
+ * rectangle of @region, so that @n threads can cover @region without
+ * overlapping.  Returns FALSE if the band is empty.
+ */
+static gboolean
+convert_region_get_band (const cairo_region_t *region,
+                         gint                  rect_index,
+                         gint                  i,
+                         gint                  n,
+                         GeglRectangle        *band)
+{
+  cairo_rectangle_int_t rect;
+  gint                  y1, y2;
+
+  cairo_region_get_rectangle (region, rect_index, &rect);
+
+  y1 = rect.y + (gint64) rect.height * i       / n;
+  y2 = rect.y + (gint64) rect.height * (i + 1) / n;
+
+  gegl_rectangle_set (band, rect.x, y1, rect.width, y2 - y1);
+
+  return ! gegl_rectangle_is_empty (band);
+}
+
+static glong
+convert_region_get_band_size (const cairo_region_t *region,
+                              gint                  i,
+                              gint                  n)
+{
+  gint  n_rects = cairo_region_num_rectangles (region);
+  glong size    = 0;
+  gint  r;
+
+  for (r = 0; r < n_rects; r++)
+    {
+      GeglRectangle band;
+
+      if (convert_region_get_band (region, r, i, n, &band))
+        size += (glong) band.width * band.height;
+    }
+
+  return size;
+}
+
+static gint
+convert_region_get_max_threads (const cairo_region_t *region,
+                                gint                  limit)
+{
+  gint n_rects = cairo_region_num_rectangles (region);
+  gint rows    = 0;
+  gint r;
+
+  for (r = 0; r < n_rects; r++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (region, r, &rect);
+
+      rows = MAX (rows, rect.height);
+    }
+
+  return CLAMP (MIN (gimp_parallel_get_n_threads (),
+                     rows / PARALLEL_MIN_ROWS),
+                1, limit);
+}
+
+
+typedef struct
+{
+  GeglBuffer     *buffer;
+  const Babl     *format;
+  cairo_region_t *region;
+  ColorFreq      *histograms;   /* n_histograms gray histograms */
+  gint            n_histograms;
+} HistogramGrayData;
+
+static void
+generate_histogram_gray_func (gint               i,
+                              gint               n,
+                              HistogramGrayData *data)
+{
+  ColorFreq *histogram = data->histograms + i * 256;
+  gint       n_rects   = cairo_region_num_rectangles (data->region);
+  gint       bpp       = babl_format_get_bytes_per_pixel (data->format);
+  gboolean   has_alpha = babl_format_has_alpha (data->format);
+  gint       r;
+
+  for (r = 0; r < n_rects; r++)
+    {
+      GeglBufferIterator *iter;
+      GeglRectangle       band;
+
+      if (! convert_region_get_band (data->region, r, i, n, &band))
+        continue;
+
+      iter = gegl_buffer_iterator_new (data->buffer, &band, 0, data->format,
+                                       GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+
+      while (gegl_buffer_iterator_next (iter))
+        {
+          const guchar *src    = iter->data[0];
+          gint          length = iter->length;
+
+          if (has_alpha)
+            {
+              while (length--)
+                {
+                  if (src[ALPHA_G] > 127)
+                    histogram[*src]++;
+
+                  src += bpp;
+                }
+            }
+          else
+            {
+              while (length--)
+                {
+                  histogram[*src]++;
+
+                  src += bpp;
+                }
+            }
+        }
+    }
+}
+
 static void
 generate_histogram_gray (CFHistogram  histogram,
                          GimpLayer   *layer,
                          gboolean     alpha_dither)
 {
-  GeglBufferIterator *iter;
-  const Babl         *format;
-  gint                bpp;
-  gboolean            has_alpha;
+  HistogramGrayData data;
+  GeglBuffer       *buffer;
+  const Babl       *format;
+  gint              i, j;
 
   format = gimp_drawable_get_format (GIMP_DRAWABLE (layer));
 
   g_return_if_fail (format == babl_format ("Y' u8") ||
                     format == babl_format ("Y'A u8"));
 
-  bpp       = babl_format_get_bytes_per_pixel (format);
-  has_alpha = babl_format_has_alpha (format);
+  buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
 
-  iter = gegl_buffer_iterator_new (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
-                                   NULL, 0, format,
-                                   GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+  data.buffer = buffer;
+  data.format = format;
+  data.region =
+    cairo_region_create_rectangle ((cairo_rectangle_int_t *)
+                                   gegl_buffer_get_extent (buffer));
 
-  while (gegl_buffer_iterator_next (iter))
+  /*  each thread counts into a private histogram, which are summed up
+   *  afterwards
+   */
+  data.n_histograms = convert_region_get_max_threads (data.region, G_MAXINT);
+  data.histograms   = g_new0 (ColorFreq, data.n_histograms * 256);
+
+  gimp_parallel_distribute (data.n_histograms,
+                            (GimpParallelDistributeFunc)
+                            generate_histogram_gray_func,
+                            &data);
+
+  for (i = 0; i < data.n_histograms; i++)
+    for (j = 0; j < 256; j++)
+      histogram[j] += data.histograms[i * 256 + j];
+
+  g_free (data.histograms);
+  cairo_region_destroy (data.region);
+}
+
+
+static inline void
+histogram_rgb_add_pixels (CFHistogram          histogram,
+                          const guchar        *data,
+                          gint                 length,
+                          const GeglRectangle *roi,
+                          gint                 bpp,
+                          gboolean             has_alpha,
+                          gboolean             alpha_dither,
+                          gint                 offsetx,
+                          gint                 offsety)
+{
+  ColorFreq *colfreq;
+  gint       row, col, coledge;
+
+  if (alpha_dither)
     {
-      const guchar *data = iter->data[0];
+      /* if alpha-dithering,
+         we need to be deterministic w.r.t. offsets */
 
-      if (has_alpha)
+      col = roi->x + offsetx;
+      coledge = col + roi->width;
+      row = roi->y + offsety;
+
+      while (length--)
         {
-          while (iter->length--)
+          gboolean transparent = FALSE;
+
+          if (has_alpha &&
+              data[ALPHA] <
+              DM[col & DM_WIDTHMASK][row & DM_HEIGHTMASK])
+            transparent = TRUE;
+
+          if (! transparent)
             {
-              if (data[ALPHA_G] > 127)
-                histogram[*data]++;
+              colfreq = HIST_RGB (histogram,
+                                  data[RED],
+                                  data[GREEN],
+                                  data[BLUE]);
+              (*colfreq)++;
+            }
 
-              data += bpp;
+          col++;
+          if (col == coledge)
+            {
+              col = roi->x + offsetx;
+              row++;
             }
+
+          data += bpp;
         }
-      else
+    }
+  else
+    {
+      while (length--)
         {
-          while (iter->length--)
+          if ((has_alpha && ((data[ALPHA] > 127)))
+              || (!has_alpha))
             {
-              histogram[*data]++;
+              colfreq = HIST_RGB (histogram,
+                                  data[RED],
+                                  data[GREEN],
+                                  data[BLUE]);
+              (*colfreq)++;
+            }
 
-              data += bpp;
+          data += bpp;
+        }
+    }
+}
+
+
+typedef struct
+{
+  GeglBuffer     *buffer;
+  const Babl     *format;
+  cairo_region_t *region;
+  gboolean        alpha_dither;
+  gint            offsetx;
+  gint            offsety;
+  CFHistogram    *histograms;   /* [0] is the destination histogram */
+  gint            n_histograms;
+
+  GimpProgress   *progress;
+  gdouble         progress_start;
+  gdouble         progress_end;
+} HistogramRGBData;
+
+static void
+generate_histogram_rgb_func (gint              i,
+                             gint              n,
+                             HistogramRGBData *data)
+{
+  CFHistogram histogram;
+  gint        n_rects    = cairo_region_num_rectangles (data->region);
+  gint        bpp        = babl_format_get_bytes_per_pixel (data->format);
+  gboolean    has_alpha  = babl_format_has_alpha (data->format);
+  gboolean    progress   = (i == 0 && data->progress);
+  glong       band_size  = 0;
+  glong       total_size = 0;
+  gint        count      = 0;
+  gint        r;
+
+  if (i == 0)
+    {
+      histogram = data->histograms[0];
+    }
+  else
+    {
+      histogram = g_new0 (ColorFreq,
+                          HIST_R_ELEMS * HIST_G_ELEMS * HIST_B_ELEMS);
+
+      data->histograms[i] = histogram;
+    }
+
+  /*  the calling thread reports progress, extrapolating from its share */
+  if (progress)
+    band_size = convert_region_get_band_size (data->region, i, n);
+
+  for (r = 0; r < n_rects; r++)
+    {
+      GeglBufferIterator *iter;
+      GeglRectangle       band;
+
+      if (! convert_region_get_band (data->region, r, i, n, &band))
+        continue;
+
+      iter = gegl_buffer_iterator_new (data->buffer, &band, 0, data->format,
+                                       GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+
+      while (gegl_buffer_iterator_next (iter))
+        {
+          histogram_rgb_add_pixels (histogram,
+                                    iter->data[0], iter->length,
+                                    &iter->roi[0], bpp, has_alpha,
+                                    data->alpha_dither,
+                                    data->offsetx, data->offsety);
+
+          if (progress)
+            {
+              total_size += iter->length;
+
+              if (count++ % 16 == 0)
+                gimp_progress_set_value (data->progress,
+                                         data->progress_start +
+                                         (data->progress_end -
+                                          data->progress_start) *
+                                         total_size / band_size);
             }
         }
     }
 }
 
+static void
+generate_histogram_rgb_merge_func (gsize             offset,
+                                   gsize             size,
+                                   HistogramRGBData *data)
+{
+  ColorFreq *dest = data->histograms[0] + offset;
+  gint       i;
+
+  for (i = 1; i < data->n_histograms; i++)
+    {
+      const ColorFreq *src = data->histograms[i];
+      gsize            j;
+
+      if (! src)
+        continue;
+
+      src += offset;
+
+      for (j = 0; j < size; j++)
+        dest[j] += src[j];
+    }
+}
 
 static void
 generate_histogram_rgb (CFHistogram   histogram,
@@ -1186,10 +1516,9 @@ generate_histogram_rgb (CFHistogram   histogram,
                         gint          nth_layer,
                         gint          n_layers)
 {
-  GeglBufferIterator *iter;
+  GeglBuffer         *buffer;
   const Babl         *format;
-  GeglRectangle      *roi;
-  ColorFreq          *colfreq;
+  cairo_region_t     *region;
   gint                nfc_iter;
   gint                row, col, coledge;
   gint                offsetx, offsety;
@@ -1207,6 +1536,8 @@ generate_histogram_rgb (CFHistogram   histogram,
   bpp       = babl_format_get_bytes_per_pixel (format);
   has_alpha = babl_format_has_alpha (format);
 
+  buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+
   gimp_item_get_offset (GIMP_ITEM (layer), &offsetx, &offsety);
 
   layer_size = (gimp_item_get_width  (GIMP_ITEM (layer)) *
@@ -1214,81 +1545,36 @@ generate_histogram_rgb (CFHistogram   histogram,
 
   /*  g_printerr ("col_limit = %d, nfc = %d\n", col_limit, num_found_cols); */
 
-  iter = gegl_buffer_iterator_new (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
-                                   NULL, 0, format,
-                                   GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
-  roi = &iter->roi[0];
+  /*  the part of the layer which still needs to be counted  */
+  region =
+    cairo_region_create_rectangle ((cairo_rectangle_int_t *)
+                                   gegl_buffer_get_extent (buffer));
 
   if (progress)
     gimp_progress_set_value (progress, 0.0);
 
-  while (gegl_buffer_iterator_next (iter))
+  if (! needs_quantize)
     {
-      const guchar *data = iter->data[0];
-
-      total_size += iter->length;
+      /*  look for distinct colors one chunk at a time, and hand the
+       *  rest of the layer over to the parallel histogram below as soon
+       *  as there are more of them than the user asked for
+       */
+      GeglBufferIterator *iter;
+      GeglRectangle      *roi;
 
-      /* g_printerr (" [%d,%d - %d,%d]", srcPR.x, src_roi->y, offsetx, offsety); */
+      iter = gegl_buffer_iterator_new (buffer,
+                                       NULL, 0, format,
+                                       GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+      roi = &iter->roi[0];
 
-      if (needs_quantize)
+      while (gegl_buffer_iterator_next (iter))
         {
-          if (alpha_dither)
-            {
-              /* if alpha-dithering,
-                 we need to be deterministic w.r.t. offsets */
-
-              col = roi->x + offsetx;
-              coledge = col + roi->width;
-              row = roi->y + offsety;
+          const guchar *data = iter->data[0];
 
-              while (iter->length--)
-                {
-                  gboolean transparent = FALSE;
+          total_size += iter->length;
 
-                  if (has_alpha &&
-                      data[ALPHA] <
-                      DM[col & DM_WIDTHMASK][row & DM_HEIGHTMASK])
-                    transparent = TRUE;
+          /* g_printerr (" [%d,%d - %d,%d]", srcPR.x, src_roi->y, offsetx, offsety); */
 
-                  if (! transparent)
-                    {
-                      colfreq = HIST_RGB (histogram,
-                                          data[RED],
-                                          data[GREEN],
-                                          data[BLUE]);
-                      (*colfreq)++;
-                    }
-
-                  col++;
-                  if (col == coledge)
-                    {
-                      col = roi->x + offsetx;
-                      row++;
-                    }
-
-                  data += bpp;
-                }
-            }
-          else
-            {
-              while (iter->length--)
-                {
-                  if ((has_alpha && ((data[ALPHA] > 127)))
-                      || (!has_alpha))
-                    {
-                      colfreq = HIST_RGB (histogram,
-                                          data[RED],
-                                          data[GREEN],
-                                          data[BLUE]);
-                      (*colfreq)++;
-                    }
-
-                  data += bpp;
-                }
-            }
-        }
-      else
-        {
           /* if alpha-dithering, we need to be deterministic w.r.t. offsets */
           col = roi->x + offsetx;
           coledge = col + roi->width;
@@ -1315,6 +1601,8 @@ generate_histogram_rgb (CFHistogram   histogram,
 
 	      if (! transparent)
                 {
+                  ColorFreq *colfreq;
+
                   colfreq = HIST_RGB (histogram,
                                       data[RED],
                                       data[GREEN],
@@ -1371,19 +1659,73 @@ generate_histogram_rgb (CFHistogram   histogram,
 
               data += bpp;
             }
+
+          cairo_region_subtract_rectangle (region,
+                                           (cairo_rectangle_int_t *) roi);
+
+          if (progress && (count++ % 16 == 0))
+            gimp_progress_set_value (progress,
+                                     (nth_layer + ((gdouble) total_size)/
+                                      layer_size) / (gdouble) n_layers);
+
+          if (needs_quantize)
+            {
+              gegl_buffer_iterator_stop (iter);
+              break;
+            }
         }
+    }
 
-      if (progress && (count % 16 == 0))
-        gimp_progress_set_value (progress,
-                                 (nth_layer + ((gdouble) total_size)/
-                                  layer_size) / (gdouble) n_layers);
+  if (needs_quantize && ! cairo_region_is_empty (region))
+    {
+      HistogramRGBData data;
+      gint             i;
+
+      data.buffer         = buffer;
+      data.format         = format;
+      data.region         = region;
+      data.alpha_dither   = alpha_dither;
+      data.offsetx        = offsetx;
+      data.offsety        = offsety;
+      data.progress       = progress;
+      data.progress_start = (nth_layer + ((gdouble) total_size) /
+                             layer_size) / (gdouble) n_layers;
+      data.progress_end   = (nth_layer + 1) / (gdouble) n_layers;
+
+      /*  each thread counts into a private histogram, which are summed
+       *  up afterwards.  they are 8 MB each, so don't use too many.
+       */
+      data.n_histograms = convert_region_get_max_threads (region,
+                                                          HISTOGRAM_MAX_THREADS);
+      data.histograms   = g_new0 (CFHistogram, data.n_histograms);
+
+      data.histograms[0] = histogram;
+
+      gimp_parallel_distribute (data.n_histograms,
+                                (GimpParallelDistributeFunc)
+                                generate_histogram_rgb_func,
+                                &data);
+
+      gimp_parallel_distribute_range (HIST_R_ELEMS *
+                                      HIST_G_ELEMS *
+                                      HIST_B_ELEMS,
+                                      HISTOGRAM_MERGE_MIN_CELLS,
+                                      (GimpParallelDistributeRangeFunc)
+                                      generate_histogram_rgb_merge_func,
+                                      &data);
+
+      for (i = 1; i < data.n_histograms; i++)
+        g_free (data.histograms[i]);
+
+      g_free (data.histograms);
     }
 
+  cairo_region_destroy (region);
+
 /*  g_print ("O: col_limit = %d, nfc = %d\n", col_limit, num_found_cols);*/
 }
 
 
-
 static boxptr
 find_split_candidate (const boxptr  boxlist,
                       const int     numboxes,
@@ -2387,6 +2729,30 @@ select_colors_rgb (QuantizeObj *quantobj,
 #define BOX_G_SHIFT  (G_SHIFT + BOX_G_LOG)
 #define BOX_B_SHIFT  (B_SHIFT + BOX_B_LOG)
 
+#define N_UPDATE_BOXES ((HIST_R_ELEMS >> BOX_R_LOG) * \
+                        (HIST_G_ELEMS >> BOX_G_LOG) * \
+                        (HIST_B_ELEMS >> BOX_B_LOG))
+
+#define UPDATE_BOX_ID(R,G,B)                                          \
+  ((((R) >> BOX_R_LOG) * (HIST_G_ELEMS >> BOX_G_LOG) +                \
+    ((G) >> BOX_G_LOG)) * (HIST_B_ELEMS >> BOX_B_LOG) +               \
+   ((B) >> BOX_B_LOG))
+
+/* minimum number of update boxes each thread fills */
+#define INVERSE_CMAP_MIN_BOXES 64
+
+static inline void
+update_box_get_origin (guint  box,
+                       gint  *R,
+                       gint  *G,
+                       gint  *B)
+{
+  *B   = (box % (HIST_B_ELEMS >> BOX_B_LOG)) << BOX_B_LOG;
+  box /= HIST_B_ELEMS >> BOX_B_LOG;
+  *G   = (box % (HIST_G_ELEMS >> BOX_G_LOG)) << BOX_G_LOG;
+  *R   = (box / (HIST_G_ELEMS >> BOX_G_LOG)) << BOX_R_LOG;
+}
+
 
 /*
  * The next three routines implement inverse colormap filling.  They could
@@ -3088,131 +3454,324 @@ median_cut_pass2_fixed_dither_gray (QuantizeObj *quantobj,
     }
 }
 
-static void
-median_cut_pass2_no_dither_rgb (QuantizeObj *quantobj,
-                                GimpLayer   *layer,
-                                GeglBuffer  *new_buffer)
+typedef struct
 {
-  GeglBufferIterator *iter;
-  CFHistogram         histogram = quantobj->histogram;
-  ColorFreq          *cachep;
-  const Babl         *src_format;
-  const Babl         *dest_format;
-  GeglRectangle      *src_roi;
-  gint                src_bpp;
-  gint                dest_bpp;
-  gint                has_alpha;
-  gint                R, G, B;
-  gint                red_pix          = RED;
-  gint                green_pix        = GREEN;
-  gint                blue_pix         = BLUE;
-  gint                alpha_pix        = ALPHA;
-  gboolean            alpha_dither     = quantobj->want_alpha_dither;
-  gint                offsetx, offsety;
-  gulong             *index_used_count = quantobj->index_used_count;
-  glong               total_size       = 0;
-  glong               layer_size;
-  gint                count            = 0;
-  gint                nth_layer        = quantobj->nth_layer;
-  gint                n_layers         = quantobj->n_layers;
+  QuantizeObj    *quantobj;
+  GeglBuffer     *src_buffer;
+  const Babl     *src_format;
+  GeglBuffer     *dest_buffer;
+  const Babl     *dest_format;
+  cairo_region_t *region;
+  gint            red_pix;
+  gint            green_pix;
+  gint            blue_pix;
+  gint            alpha_pix;
+  gint            offsetx;
+  gint            offsety;
+  guint32       **missing;           /* per thread, bitmap of update boxes */
+  guint          *boxes;
+  gsize           n_boxes;
+  gulong         *index_used_counts; /* per thread, 256 counts */
+  gint            n_threads;
+} NoDitherRGBData;
+
+static inline gboolean
+no_dither_rgb_is_transparent (const NoDitherRGBData *data,
+                              const guchar          *src,
+                              gint                   x,
+                              gint                   y)
+{
+  if (data->quantobj->want_alpha_dither)
+    {
+      gint dither_x = (x + data->offsetx) & DM_WIDTHMASK;
+      gint dither_y = (y + data->offsety) & DM_HEIGHTMASK;
 
-  gimp_item_get_offset (GIMP_ITEM (layer), &offsetx, &offsety);
+      return src[data->alpha_pix] < DM[dither_x][dither_y];
+    }
 
-  src_format  = gimp_drawable_get_format (GIMP_DRAWABLE (layer));
-  dest_format = gegl_buffer_get_format (new_buffer);
+  return src[data->alpha_pix] <= 127;
+}
 
-  src_bpp  = babl_format_get_bytes_per_pixel (src_format);
-  dest_bpp = babl_format_get_bytes_per_pixel (dest_format);
+/*  find the update boxes of the inverse colormap which this thread's
+ *  pixels need, and which are not filled in yet
+ */
+static void
+no_dither_rgb_find_missing_func (gint             i,
+                                 gint             n,
+                                 NoDitherRGBData *data)
+{
+  CFHistogram  histogram = data->quantobj->histogram;
+  guint32     *missing;
+  gint         n_rects   = cairo_region_num_rectangles (data->region);
+  gint         src_bpp   = babl_format_get_bytes_per_pixel (data->src_format);
+  gboolean     has_alpha = babl_format_has_alpha (data->src_format);
+  gint         r;
 
-  has_alpha = babl_format_has_alpha (src_format);
+  missing = g_new0 (guint32, N_UPDATE_BOXES / 32);
 
-  /*  In the case of web/mono palettes, we actually force
-   *   grayscale drawables through the rgb pass2 functions
-   */
-  if (gimp_drawable_is_gray (GIMP_DRAWABLE (layer)))
+  data->missing[i] = missing;
+
+  for (r = 0; r < n_rects; r++)
     {
-      red_pix = green_pix = blue_pix = GRAY;
-      alpha_pix = ALPHA_G;
+      GeglBufferIterator *iter;
+      GeglRectangle       band;
+      GeglRectangle      *src_roi;
+
+      if (! convert_region_get_band (data->region, r, i, n, &band))
+        continue;
+
+      iter = gegl_buffer_iterator_new (data->src_buffer, &band, 0, NULL,
+                                       GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+      src_roi = &iter->roi[0];
+
+      while (gegl_buffer_iterator_next (iter))
+        {
+          const guchar *src = iter->data[0];
+          gint          row;
+
+          for (row = 0; row < src_roi->height; row++)
+            {
+              gint col;
+
+              for (col = 0; col < src_roi->width; col++, src += src_bpp)
+                {
+                  gint  R, G, B;
+                  guint box;
+
+                  if (has_alpha &&
+                      no_dither_rgb_is_transparent (data, src,
+                                                    src_roi->x + col,
+                                                    src_roi->y + row))
+                    continue;
+
+                  rgb_to_lin (src[data->red_pix],
+                              src[data->green_pix],
+                              src[data->blue_pix],
+                              &R, &G, &B);
+
+                  if (*HIST_LIN (histogram, R, G, B) != 0)
+                    continue;
+
+                  box = UPDATE_BOX_ID (R, G, B);
+
+                  missing[box / 32] |= 1u << (box % 32);
+                }
+            }
+        }
     }
+}
 
-  iter = gegl_buffer_iterator_new (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
-                                   NULL, 0, NULL,
-                                   GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
-  src_roi = &iter->roi[0];
+static void
+no_dither_rgb_fill_func (gsize            offset,
+                         gsize            size,
+                         NoDitherRGBData *data)
+{
+  gsize i;
 
-  gegl_buffer_iterator_add (iter, new_buffer,
-                            NULL, 0, NULL,
-                            GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
+  /*  update boxes are disjoint, so each one can be filled independently  */
+  for (i = offset; i < offset + size; i++)
+    {
+      gint R, G, B;
 
-  layer_size = (gimp_item_get_width  (GIMP_ITEM (layer)) *
-                gimp_item_get_height (GIMP_ITEM (layer)));
+      update_box_get_origin (data->boxes[i], &R, &G, &B);
 
-  while (gegl_buffer_iterator_next (iter))
+      fill_inverse_cmap_rgb (data->quantobj, data->quantobj->histogram,
+                             R, G, B);
+    }
+}
+
+static void
+no_dither_rgb_remap_func (gint             i,
+                          gint             n,
+                          NoDitherRGBData *data)
+{
+  QuantizeObj *quantobj         = data->quantobj;
+  CFHistogram  histogram        = quantobj->histogram;
+  gulong      *index_used_count = data->index_used_counts + i * 256;
+  gint         n_rects          = cairo_region_num_rectangles (data->region);
+  gint         src_bpp  = babl_format_get_bytes_per_pixel (data->src_format);
+  gint         dest_bpp = babl_format_get_bytes_per_pixel (data->dest_format);
+  gboolean     has_alpha        = babl_format_has_alpha (data->src_format);
+  gboolean     progress         = (i == 0 && quantobj->progress);
+  glong        band_size        = 0;
+  glong        total_size       = 0;
+  gint         count            = 0;
+  gint         r;
+
+  /*  the calling thread reports progress, extrapolating from its share */
+  if (progress)
+    band_size = convert_region_get_band_size (data->region, i, n);
+
+  for (r = 0; r < n_rects; r++)
     {
-      const guchar *src  = iter->data[0];
-      guchar       *dest = iter->data[1];
-      gint          row;
+      GeglBufferIterator *iter;
+      GeglRectangle       band;
+      GeglRectangle      *src_roi;
 
-      total_size += src_roi->height * src_roi->width;
+      if (! convert_region_get_band (data->region, r, i, n, &band))
+        continue;
 
-      for (row = 0; row < src_roi->height; row++)
+      iter = gegl_buffer_iterator_new (data->src_buffer, &band, 0, NULL,
+                                       GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+      src_roi = &iter->roi[0];
+
+      gegl_buffer_iterator_add (iter, data->dest_buffer, &band, 0, NULL,
+                                GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
+
+      while (gegl_buffer_iterator_next (iter))
         {
-          gint col;
+          const guchar *src  = iter->data[0];
+          guchar       *dest = iter->data[1];
+          gint          row;
 
-          for (col = 0; col < src_roi->width; col++)
+          for (row = 0; row < src_roi->height; row++)
             {
-              if (has_alpha)
+              gint col;
+
+              for (col = 0; col < src_roi->width; col++)
                 {
-                  gboolean transparent = FALSE;
+                  gint R, G, B;
 
-                  if (alpha_dither)
+                  if (has_alpha)
                     {
-                      gint dither_x = (col + offsetx + src_roi->x) & DM_WIDTHMASK;
-                      gint dither_y = (row + offsety + src_roi->y) & DM_HEIGHTMASK;
-                      if ((src[alpha_pix]) < DM[dither_x][dither_y])
-                        transparent = TRUE;
-                    }
-                  else
-                    {
-                      if (src[alpha_pix] <= 127)
-                        transparent = TRUE;
+                      if (no_dither_rgb_is_transparent (data, src,
+                                                        src_roi->x + col,
+                                                        src_roi->y + row))
+                        {
+                          dest[ALPHA_I] = 0;
+                          goto next_pixel;
+                        }
+                      else
+                        {
+                          dest[ALPHA_I] = 255;
+                        }
                     }
 
-                  if (transparent)
-                    {
-                      dest[ALPHA_I] = 0;
-                      goto next_pixel;
-                    }
-                  else
-                    {
-                      dest[ALPHA_I] = 255;
-                    }
-                }
+                  /* get pixel value and index into the cache, which
+                   * has already been filled for all colors of the layer
+                   */
+                  rgb_to_lin (src[data->red_pix],
+                              src[data->green_pix],
+                              src[data->blue_pix],
+                              &R, &G, &B);
 
-              /* get pixel value and index into the cache */
-              rgb_to_lin (src[red_pix], src[green_pix], src[blue_pix],
-                          &R, &G, &B);
-              cachep = HIST_LIN(histogram,R,G,B);
-              /* If we have not seen this color before, find nearest
-                 colormap entry and update the cache */
-              if (*cachep == 0)
-                fill_inverse_cmap_rgb (quantobj, histogram, R, G, B);
+                  /* Now emit the colormap index for this cell, barfbarf */
+                  index_used_count[dest[INDEXED] =
+                                   *HIST_LIN (histogram, R, G, B) - 1]++;
 
-              /* Now emit the colormap index for this cell, barfbarf */
-              index_used_count[dest[INDEXED] = *cachep - 1]++;
+                next_pixel:
 
-            next_pixel:
+                  src  += src_bpp;
+                  dest += dest_bpp;
+                }
+            }
 
-              src  += src_bpp;
-              dest += dest_bpp;
+          if (progress)
+            {
+              total_size += src_roi->width * src_roi->height;
+
+              if (count++ % 16 == 0)
+                gimp_progress_set_value (quantobj->progress,
+                                         (quantobj->nth_layer +
+                                          ((gdouble) total_size) /
+                                          band_size) /
+                                         (gdouble) quantobj->n_layers);
             }
         }
+    }
+}
 
-      if (quantobj->progress && (count % 16 == 0))
-         gimp_progress_set_value (quantobj->progress,
-                                  (nth_layer + ((gdouble) total_size)/
-                                   layer_size) / (gdouble) n_layers);
+static void
+median_cut_pass2_no_dither_rgb (QuantizeObj *quantobj,
+                                GimpLayer   *layer,
+                                GeglBuffer  *new_buffer)
+{
+  NoDitherRGBData data = { 0, };
+  gint            i, j;
+
+  data.quantobj    = quantobj;
+  data.src_buffer  = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+  data.src_format  = gimp_drawable_get_format (GIMP_DRAWABLE (layer));
+  data.dest_buffer = new_buffer;
+  data.dest_format = gegl_buffer_get_format (new_buffer);
+  data.region      =
+    cairo_region_create_rectangle ((cairo_rectangle_int_t *)
+                                   gegl_buffer_get_extent (data.src_buffer));
+  data.red_pix     = RED;
+  data.green_pix   = GREEN;
+  data.blue_pix    = BLUE;
+  data.alpha_pix   = ALPHA;
+
+  gimp_item_get_offset (GIMP_ITEM (layer), &data.offsetx, &data.offsety);
+
+  /*  In the case of web/mono palettes, we actually force
+   *   grayscale drawables through the rgb pass2 functions
+   */
+  if (gimp_drawable_is_gray (GIMP_DRAWABLE (layer)))
+    {
+      data.red_pix = data.green_pix = data.blue_pix = GRAY;
+      data.alpha_pix = ALPHA_G;
+    }
+
+  data.n_threads = convert_region_get_max_threads (data.region, G_MAXINT);
+
+  /*  The inverse colormap is shared by all threads, so instead of
+   *  filling it lazily while remapping, first collect the update boxes
+   *  the layer needs, fill them in parallel, and then remap the layer
+   *  against the complete cache.
+   */
+  data.missing = g_new0 (guint32 *, data.n_threads);
+
+  gimp_parallel_distribute (data.n_threads,
+                            (GimpParallelDistributeFunc)
+                            no_dither_rgb_find_missing_func,
+                            &data);
+
+  data.boxes = g_new (guint, N_UPDATE_BOXES);
+
+  for (i = 0; i < N_UPDATE_BOXES / 32; i++)
+    {
+      guint32 bits = 0;
+
+      for (j = 0; j < data.n_threads; j++)
+        {
+          if (data.missing[j])
+            bits |= data.missing[j][i];
+        }
+
+      for (j = 0; bits; j++, bits >>= 1)
+        {
+          if (bits & 1)
+            data.boxes[data.n_boxes++] = i * 32 + j;
+        }
     }
+
+  for (i = 0; i < data.n_threads; i++)
+    g_free (data.missing[i]);
+
+  g_free (data.missing);
+
+  gimp_parallel_distribute_range (data.n_boxes, INVERSE_CMAP_MIN_BOXES,
+                                  (GimpParallelDistributeRangeFunc)
+                                  no_dither_rgb_fill_func,
+                                  &data);
+
+  g_free (data.boxes);
+
+  /*  each thread counts the used indices privately  */
+  data.index_used_counts = g_new0 (gulong, data.n_threads * 256);
+
+  gimp_parallel_distribute (data.n_threads,
+                            (GimpParallelDistributeFunc)
+                            no_dither_rgb_remap_func,
+                            &data);
+
+  for (i = 0; i < data.n_threads; i++)
+    for (j = 0; j < 256; j++)
+      quantobj->index_used_count[j] += data.index_used_counts[i * 256 + j];
+
+  g_free (data.index_used_counts);
+  cairo_region_destroy (data.region);
 }
 
 static void
@@ -4287,6 +4846,166 @@ median_cut_pass2_fs_dither_rgb (QuantizeObj *quantobj,
 }
 
 
+static void
+fill_inverse_cmap_rgb_all_func (gsize        offset,
+                                gsize        size,
+                                QuantizeObj *quantobj)
+{
+  CFHistogram histogram = quantobj->histogram;
+  gsize       i;
+
+  for (i = offset; i < offset + size; i++)
+    {
+      gint R, G, B;
+
+      update_box_get_origin (i, &R, &G, &B);
+
+      if (*HIST_LIN (histogram, R, G, B) == 0)
+        fill_inverse_cmap_rgb (quantobj, histogram, R, G, B);
+    }
+}
+
+typedef struct
+{
+  QuantizeObj  *quantobj;
+  GimpLayer   **layers;
+  GeglBuffer  **new_buffers;
+  gint          n_layers;
+  gint          next_layer;
+  gint          n_done;
+  gulong       *index_used_counts;  /* per thread, 256 counts */
+} FSDitherRGBLayersData;
+
+static void
+fs_dither_rgb_layers_func (gint                   i,
+                           gint                   n,
+                           FSDitherRGBLayersData *data)
+{
+  QuantizeObj  layer_obj = *data->quantobj;
+  gint         index;
+
+  /*  only the calling thread may report progress  */
+  if (i != 0)
+    layer_obj.progress = NULL;
+
+  memset (layer_obj.index_used_count, 0, sizeof (layer_obj.index_used_count));
+
+  while ((index = g_atomic_int_add (&data->next_layer, 1)) < data->n_layers)
+    {
+      layer_obj.nth_layer = g_atomic_int_get (&data->n_done);
+
+      median_cut_pass2_fs_dither_rgb (&layer_obj,
+                                      data->layers[index],
+                                      data->new_buffers[index]);
+
+      g_atomic_int_inc (&data->n_done);
+    }
+
+  memcpy (data->index_used_counts + i * 256, layer_obj.index_used_count,
+          sizeof (layer_obj.index_used_count));
+}
+
+/*  Floyd-Steinberg diffusion visits the pixels of a layer in strict
+ *  serpentine order: each row starts where the previous one ended, so
+ *  every pixel depends on all pixels before it and a layer can't be
+ *  split without changing the result.  Instead, fill the whole inverse
+ *  colormap up front on all threads, which leaves the diffusion with
+ *  nothing but lookups and makes the cache read-only, and then dither
+ *  the layers concurrently.  The result is identical to converting the
+ *  layers one after the other.
+ *
+ *  Returns an array of new buffers, indexed like @layers, with NULL for
+ *  layers that are not to be quantized, or NULL if it's not worth it.
+ */
+static GeglBuffer **
+median_cut_pass2_fs_dither_rgb_layers (QuantizeObj *quantobj,
+                                       GimpImage   *image,
+                                       GList       *layers,
+                                       gboolean     text_layer_dither)
+{
+  FSDitherRGBLayersData  data = { 0, };
+  GeglBuffer           **new_buffers;
+  GList                 *list;
+  gint64                 n_pixels = 0;
+  gint                   n_threads;
+  gint                   i, j;
+
+  n_threads = gimp_parallel_get_n_threads ();
+
+  if (n_threads < 2)
+    return NULL;
+
+  for (list = layers; list; list = g_list_next (list))
+    {
+      GimpItem *item = list->data;
+
+      if (gimp_item_is_text_layer (item) && ! text_layer_dither)
+        continue;
+
+      n_pixels += (gint64) gimp_item_get_width  (item) *
+                           gimp_item_get_height (item);
+      data.n_layers++;
+    }
+
+  /*  filling the whole inverse colormap costs about as much as filling
+   *  a cell per pixel, don't bother for small images
+   */
+  if (n_pixels < N_UPDATE_BOXES)
+    return NULL;
+
+  new_buffers = g_new0 (GeglBuffer *, g_list_length (layers));
+
+  data.quantobj    = quantobj;
+  data.layers      = g_new (GimpLayer *, data.n_layers);
+  data.new_buffers = g_new (GeglBuffer *, data.n_layers);
+
+  for (list = layers, i = 0, j = 0; list; list = g_list_next (list), i++)
+    {
+      GimpLayer *layer = list->data;
+      gboolean   has_alpha;
+
+      if (gimp_item_is_text_layer (GIMP_ITEM (layer)) && ! text_layer_dither)
+        continue;
+
+      has_alpha = gimp_drawable_has_alpha (GIMP_DRAWABLE (layer));
+
+      new_buffers[i] =
+        gegl_buffer_new (GEGL_RECTANGLE (0, 0,
+                                         gimp_item_get_width  (GIMP_ITEM (layer)),
+                                         gimp_item_get_height (GIMP_ITEM (layer))),
+                         gimp_image_get_layer_format (image,
+                                                      has_alpha));
+
+      data.layers[j]      = layer;
+      data.new_buffers[j] = new_buffers[i];
+      j++;
+    }
+
+  gimp_parallel_distribute_range (N_UPDATE_BOXES, INVERSE_CMAP_MIN_BOXES,
+                                  (GimpParallelDistributeRangeFunc)
+                                  fill_inverse_cmap_rgb_all_func,
+                                  quantobj);
+
+  n_threads = MIN (n_threads, data.n_layers);
+
+  data.index_used_counts = g_new0 (gulong, n_threads * 256);
+
+  gimp_parallel_distribute (n_threads,
+                            (GimpParallelDistributeFunc)
+                            fs_dither_rgb_layers_func,
+                            &data);
+
+  for (i = 0; i < n_threads; i++)
+    for (j = 0; j < 256; j++)
+      quantobj->index_used_count[j] += data.index_used_counts[i * 256 + j];
+
+  g_free (data.index_used_counts);
+  g_free (data.layers);
+  g_free (data.new_buffers);
+
+  return new_buffers;
+}
+
 static void
 delete_median_cut (QuantizeObj *quantobj)
 {
@@ -21,7 +21,11 @@
 
 #include "core-types.h"
 
+#include "config/gimpgeglconfig.h"
+
 #include "gimp.h"
+#include "gimp-parallel.h"
+#include "gimpchannel.h"
 #include "gimpcontainer.h"
 #include "gimpguide.h"
 #include "gimpgrouplayer.h"
@@ -33,6 +37,7 @@
 #include "gimpimage-undo.h"
 #include "gimpimage-undo-push.h"
 #include "gimplayer.h"
+#include "gimplayermask.h"
 #include "gimpprogress.h"
 #include "gimpprojection.h"
 #include "gimpsamplepoint.h"
@@ -42,6 +47,41 @@
 #include "gimp-intl.h"
 
 
+typedef struct
+{
+  GimpDrawable *drawable;
+  gint          width;
+  gint          height;
+} PrescaleJob;
+
+typedef struct
+{
+  GArray                *jobs;
+  GimpInterpolationType  interpolation_type;
+  GimpProgress          *progress;
+  gint                   next_job;
+  gint                   n_done;
+} PrescaleData;
+
+
+static void   gimp_image_scale_add_job       (GArray                *jobs,
+                                              GimpDrawable          *drawable,
+                                              gint                   width,
+                                              gint                   height,
+                                              guint64               *memory);
+static GArray * gimp_image_scale_get_jobs    (GimpImage             *image,
+                                              GList                 *all_layers,
+                                              GList                 *all_channels,
+                                              gint                   new_width,
+                                              gint                   new_height);
+static void   gimp_image_scale_prescale      (GArray                *jobs,
+                                              GimpInterpolationType  interpolation_type,
+                                              GimpProgress          *progress);
+static void   gimp_image_scale_prescale_func (gint                   i,
+                                              gint                   n,
+                                              PrescaleData          *data);
+
+
 void
 gimp_image_scale (GimpImage             *image,
                   gint                   new_width,
@@ -54,6 +94,8 @@ gimp_image_scale (GimpImage             *image,
   GList        *all_channels;
   GList        *all_vectors;
   GList        *list;
+  GArray       *jobs;
+  guint         i;
   gint          old_width;
   gint          old_height;
   gint          offset_x;
@@ -80,6 +122,25 @@ gimp_image_scale (GimpImage             *image,
                     g_list_length (all_vectors)  +
                     1 /* selection */);
 
+  /*  scale the pixels of as many drawables as possible concurrently
+   *  first, the loops below then only swap in the new buffers
+   */
+  jobs = gimp_image_scale_get_jobs (image, all_layers, all_channels,
+                                    new_width, new_height);
+
+  if (jobs->len > 0)
+    {
+      progress_steps += jobs->len;
+
+      gimp_sub_progress_set_range (GIMP_SUB_PROGRESS (sub_progress),
+                                   0.0,
+                                   (gdouble) jobs->len / progress_steps);
+
+      gimp_image_scale_prescale (jobs, interpolation_type, sub_progress);
+
+      progress_current = jobs->len;
+    }
+
   g_object_freeze_notify (G_OBJECT (image));
 
   gimp_image_undo_group_start (image, GIMP_UNDO_GROUP_IMAGE_SCALE,
@@ -219,6 +280,17 @@ gimp_image_scale (GimpImage             *image,
 
   gimp_image_undo_group_end (image);
 
+  /*  drop what wasn't used, e.g. because a drawable got removed  */
+  for (i = 0; i < jobs->len; i++)
+    {
+      PrescaleJob *job = &g_array_index (jobs, PrescaleJob, i);
+
+      gimp_drawable_clear_prescaled (job->drawable);
+      g_object_unref (job->drawable);
+    }
+
+  g_array_free (jobs, TRUE);
+
   g_list_free (all_layers);
   g_list_free (all_channels);
   g_list_free (all_vectors);
@@ -367,3 +439,160 @@ gimp_image_scale_check (const GimpImage *image,
 
   return GIMP_IMAGE_SCALE_OK;
 }
+
+
+/*  private functions  */
+
+static void
+gimp_image_scale_add_job (GArray       *jobs,
+                          GimpDrawable *drawable,
+                          gint          width,
+                          gint          height,
+                          guint64      *memory)
+{
+  PrescaleJob job;
+  guint64     size;
+
+  if (width <= 0 || height <= 0)
+    return;
+
+  /*  don't waste CPU cycles scaling an empty channel, see
+   *  gimp_channel_scale()
+   */
+  if (GIMP_IS_CHANNEL (drawable) &&
+      GIMP_CHANNEL (drawable)->bounds_known &&
+      GIMP_CHANNEL (drawable)->empty)
+    return;
+
+  size = ((guint64) width * height *
+          babl_format_get_bytes_per_pixel (gimp_drawable_get_format (drawable)));
+
+  /*  all prescaled buffers are alive at the same time, keep them
+   *  within the tile cache and leave the rest to gimp_item_scale()
+   */
+  if (size > *memory)
+    return;
+
+  *memory -= size;
+
+  job.drawable = g_object_ref (drawable);
+  job.width    = width;
+  job.height   = height;
+
+  g_array_append_val (jobs, job);
+}
+
+static GArray *
+gimp_image_scale_get_jobs (GimpImage *image,
+                           GList     *all_layers,
+                           GList     *all_channels,
+                           gint       new_width,
+                           gint       new_height)
+{
+  GimpGeglConfig *config = GIMP_GEGL_CONFIG (image->gimp->config);
+  GArray         *jobs;
+  GList          *list;
+  guint64         memory;
+  gdouble         scale_w;
+  gdouble         scale_h;
+
+  jobs = g_array_new (FALSE, FALSE, sizeof (PrescaleJob));
+
+  /*  nothing to overlap with a single thread  */
+  if (gimp_parallel_get_n_threads () < 2)
+    return jobs;
+
+  memory  = config->tile_cache_size / 2;
+  scale_w = (gdouble) new_width  / gimp_image_get_width  (image);
+  scale_h = (gdouble) new_height / gimp_image_get_height (image);
+
+  /*  the sizes must match what gimp_image_scale() passes to
+   *  gimp_item_scale(), or the prescaled buffers are not used
+   */
+  for (list = all_channels; list; list = g_list_next (list))
+    gimp_image_scale_add_job (jobs, list->data, new_width, new_height,
+                              &memory);
+
+  gimp_image_scale_add_job (jobs, GIMP_DRAWABLE (gimp_image_get_mask (image)),
+                            new_width, new_height, &memory);
+
+  for (list = all_layers; list; list = g_list_next (list))
+    {
+      GimpItem  *item = list->data;
+      GimpLayer *layer = list->data;
+      gint       width;
+      gint       height;
+
+      if (gimp_viewable_get_children (GIMP_VIEWABLE (item)))
+        continue;
+
+      /*  see gimp_item_scale_by_factors()  */
+      width  = ROUND (scale_w * (gdouble) gimp_item_get_width  (item));
+      height = ROUND (scale_h * (gdouble) gimp_item_get_height (item));
+
+      gimp_image_scale_add_job (jobs, GIMP_DRAWABLE (item),
+                                width, height, &memory);
+
+      if (gimp_layer_get_mask (layer))
+        gimp_image_scale_add_job (jobs,
+                                  GIMP_DRAWABLE (gimp_layer_get_mask (layer)),
+                                  width, height, &memory);
+    }
+
+  return jobs;
+}
+
+static void
+gimp_image_scale_prescale (GArray                *jobs,
+                           GimpInterpolationType  interpolation_type,
+                           GimpProgress          *progress)
+{
+  PrescaleData data;
+  gboolean     progress_active;
+
+  data.jobs               = jobs;
+  data.interpolation_type = interpolation_type;
+  data.progress           = progress;
+  data.next_job           = 0;
+  data.n_done             = 0;
+
+  progress_active = gimp_progress_is_active (progress);
+
+  if (! progress_active)
+    gimp_progress_start (progress, C_("undo-type", "Scale"), FALSE);
+
+  gimp_parallel_distribute (jobs->len,
+                            (GimpParallelDistributeFunc)
+                            gimp_image_scale_prescale_func,
+                            &data);
+
+  if (! progress_active)
+    gimp_progress_end (progress);
+}
+
+static void
+gimp_image_scale_prescale_func (gint          i,
+                                gint          n,
+                                PrescaleData *data)
+{
+  gint j;
+
+  /*  every thread takes the next job until there are none left  */
+  while ((j = g_atomic_int_add (&data->next_job, 1)) < (gint) data->jobs->len)
+    {
+      PrescaleJob *job = &g_array_index (data->jobs, PrescaleJob, j);
+
+      gimp_drawable_prescale (job->drawable, job->width, job->height,
+                              data->interpolation_type);
+
+      g_atomic_int_inc (&data->n_done);
+
+      /*  only the calling thread may report progress, it reports
+       *  the jobs done by all threads
+       */
+      if (i == 0)
+        gimp_progress_set_value (data->progress,
+                                 (gdouble) g_atomic_int_get (&data->n_done) /
+                                 data->jobs->len);
+    }
+}
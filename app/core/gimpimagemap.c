@@ -33,14 +33,21 @@
 
 #include "config.h"
 
+#include <string.h>
+
+#include <cairo.h>
 #include <gegl.h>
 
 #include "libgimpbase/gimpbase.h"
+#include "libgimpmath/gimpmath.h"
 
 #include "core-types.h"
 
+#include "gegl/gimp-babl.h"
 #include "gegl/gimpapplicator.h"
 
+#include "operations/gimpoperationpointlut.h"
+
 #include "gimpchannel.h"
 #include "gimpdrawable-filter.h"
 #include "gimpimage.h"
@@ -49,6 +56,17 @@
 #include "gimpprogress.h"
 
 
+/*  just a bit less than the projection's chunk renderer  */
+#define GIMP_IMAGE_MAP_IDLE_PRIORITY (G_PRIORITY_HIGH_IDLE + 20 + 2)
+
+/*  chunk size for one iteration of the cache renderer  */
+#define GIMP_IMAGE_MAP_CHUNK_WIDTH  256
+#define GIMP_IMAGE_MAP_CHUNK_HEIGHT 128
+
+/*  how much time, in seconds, do we allow cache rendering to take  */
+#define GIMP_IMAGE_MAP_CHUNK_TIME 0.01
+
+
 enum
 {
   FLUSH,
@@ -72,7 +90,19 @@ struct _GimpImageMap
   GimpFilter         *filter;
   GeglNode           *translate;
   GeglNode           *crop;
+  GeglNode           *output;
+  GeglNode           *lut;
   GimpApplicator     *applicator;
+
+  gdouble             preview_scale;
+  GeglRectangle       preview_rect;
+
+  GeglBuffer         *cache;
+  GeglNode           *cache_node;
+  GeglNode           *cache_translate;
+  GeglRectangle       cache_area;
+  cairo_region_t     *cache_valid;
+  guint               cache_idle_id;
 };
 
 
@@ -83,6 +113,19 @@ static gboolean   gimp_image_map_add_filter      (GimpImageMap        *image_map
 static gboolean   gimp_image_map_remove_filter   (GimpImageMap        *image_map);
 static void       gimp_image_map_update_drawable (GimpImageMap        *image_map,
                                                   const GeglRectangle *area);
+static void       gimp_image_map_set_output      (GimpImageMap        *image_map,
+                                                  GeglNode            *output);
+static gboolean   gimp_image_map_compile_lut     (GimpImageMap        *image_map);
+
+static void       gimp_image_map_cache_update    (GimpImageMap        *image_map,
+                                                  const GeglRectangle *area);
+static void       gimp_image_map_cache_render    (GimpImageMap        *image_map,
+                                                  const GeglRectangle *rect);
+static gboolean   gimp_image_map_cache_render_next
+                                                 (GimpImageMap        *image_map,
+                                                  GeglRectangle       *rect);
+static gboolean   gimp_image_map_cache_idle      (gpointer             data);
+static void       gimp_image_map_cache_free      (GimpImageMap        *image_map);
 
 
 
@@ -133,6 +176,8 @@ gimp_image_map_finalize (GObject *object)
 {
   GimpImageMap *image_map = GIMP_IMAGE_MAP (object);
 
+  gimp_image_map_cache_free (image_map);
+
   if (image_map->undo_desc)
     {
       g_free (image_map->undo_desc);
@@ -206,6 +251,24 @@ gimp_image_map_set_region (GimpImageMap       *image_map,
   image_map->region = region;
 }
 
+void
+gimp_image_map_set_preview (GimpImageMap        *image_map,
+                            gdouble              scale,
+                            const GeglRectangle *rect)
+{
+  g_return_if_fail (GIMP_IS_IMAGE_MAP (image_map));
+
+  if (rect && scale > 0.0)
+    {
+      image_map->preview_scale = scale;
+      image_map->preview_rect  = *rect;
+    }
+  else
+    {
+      image_map->preview_scale = 0.0;
+    }
+}
+
 void
 gimp_image_map_apply (GimpImageMap        *image_map,
                       const GeglRectangle *area)
@@ -220,6 +283,7 @@ gimp_image_map_apply (GimpImageMap        *image_map,
   /*  Make sure the drawable is still valid  */
   if (! gimp_item_is_attached (GIMP_ITEM (image_map->drawable)))
     {
+      gimp_image_map_cache_free (image_map);
       gimp_image_map_remove_filter (image_map);
       return;
     }
@@ -231,6 +295,7 @@ gimp_image_map_apply (GimpImageMap        *image_map,
                                   &image_map->filter_area.width,
                                   &image_map->filter_area.height))
     {
+      gimp_image_map_cache_free (image_map);
       gimp_image_map_remove_filter (image_map);
       return;
     }
@@ -300,6 +365,19 @@ gimp_image_map_apply (GimpImageMap        *image_map,
                                NULL);
 
           filter_output = image_map->operation;
+
+          /*  point filters are previewed through lookup tables, see
+           *  gimp_image_map_compile_lut()
+           */
+          if (gimp_operation_point_lut_can_compile (image_map->operation))
+            {
+              image_map->lut = gegl_node_new_child (filter_node,
+                                                    "operation", "gimp:point-lut",
+                                                    NULL);
+
+              gegl_node_connect_to (image_map->crop, "output",
+                                    image_map->lut,  "input");
+            }
         }
       else if (gegl_node_has_pad (image_map->operation, "output"))
         {
@@ -334,6 +412,8 @@ gimp_image_map_apply (GimpImageMap        *image_map,
           filter_output = image_map->crop;
         }
 
+      image_map->output = filter_output;
+
       gegl_node_connect_to (filter_output, "output",
                             filter_node,   "aux");
 
@@ -357,6 +437,8 @@ gimp_image_map_apply (GimpImageMap        *image_map,
       gimp_applicator_set_apply_offset (image_map->applicator,
                                         image_map->filter_area.x,
                                         image_map->filter_area.y);
+
+      image_map->cache_area = image_map->filter_area;
     }
   else
     {
@@ -368,6 +450,8 @@ gimp_image_map_apply (GimpImageMap        *image_map,
                      "width",  width,
                      "height", height,
                      NULL);
+
+      image_map->cache_area = *GEGL_RECTANGLE (0, 0, width, height);
     }
 
   active_mask = gimp_drawable_get_active_mask (image_map->drawable);
@@ -403,6 +487,24 @@ gimp_image_map_apply (GimpImageMap        *image_map,
     }
 
   gimp_image_map_add_filter (image_map);
+
+  if (gimp_image_map_compile_lut (image_map))
+    {
+      gimp_image_map_cache_free (image_map);
+      gimp_image_map_set_output (image_map, image_map->lut);
+    }
+  else if (image_map->preview_scale > 0.0 &&
+           image_map->output != image_map->crop)
+    {
+      gimp_image_map_cache_update (image_map, &update_area);
+      gimp_image_map_set_output (image_map, image_map->cache_translate);
+    }
+  else
+    {
+      gimp_image_map_cache_free (image_map);
+      gimp_image_map_set_output (image_map, image_map->output);
+    }
+
   gimp_image_map_update_drawable (image_map, &update_area);
 }
 
@@ -413,6 +515,53 @@ gimp_image_map_commit (GimpImageMap *image_map,
   g_return_if_fail (GIMP_IS_IMAGE_MAP (image_map));
   g_return_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress));
 
+  if (image_map->filtering && image_map->cache)
+    {
+      GeglRectangle rect;
+      gboolean      progress_active = FALSE;
+      gint          n_pixels;
+      gint          n_done          = 0;
+
+      /*  reuse the full resolution pixels rendered so far, and render
+       *  the rest while the filter is still attached to the drawable
+       */
+      if (image_map->cache_idle_id)
+        {
+          g_source_remove (image_map->cache_idle_id);
+          image_map->cache_idle_id = 0;
+        }
+
+      n_pixels = image_map->cache_area.width * image_map->cache_area.height;
+
+      if (progress)
+        {
+          progress_active = gimp_progress_is_active (progress);
+
+          if (progress_active)
+            gimp_progress_set_text (progress, image_map->undo_desc);
+          else
+            gimp_progress_start (progress, image_map->undo_desc, FALSE);
+        }
+
+      image_map->preview_scale = 0.0;
+
+      while (gimp_image_map_cache_render_next (image_map, &rect))
+        {
+          n_done += rect.width * rect.height;
+
+          if (progress)
+            gimp_progress_set_value (progress, (gdouble) n_done / n_pixels);
+        }
+
+      if (progress && ! progress_active)
+        gimp_progress_end (progress);
+    }
+  else if (image_map->output)
+    {
+      /*  the committed pixels come from the exact operation  */
+      gimp_image_map_set_output (image_map, image_map->output);
+    }
+
   if (gimp_image_map_remove_filter (image_map))
     {
       gimp_drawable_merge_filter (image_map->drawable, image_map->filter,
@@ -421,6 +570,8 @@ gimp_image_map_commit (GimpImageMap *image_map,
 
       g_signal_emit (image_map, image_map_signals[FLUSH], 0);
     }
+
+  gimp_image_map_cache_free (image_map);
 }
 
 void
@@ -428,6 +579,8 @@ gimp_image_map_abort (GimpImageMap *image_map)
 {
   g_return_if_fail (GIMP_IS_IMAGE_MAP (image_map));
 
+  gimp_image_map_cache_free (image_map);
+
   if (gimp_image_map_remove_filter (image_map))
     {
       gimp_image_map_update_drawable (image_map, &image_map->filter_area);
@@ -484,3 +637,345 @@ gimp_image_map_update_drawable (GimpImageMap        *image_map,
 
   g_signal_emit (image_map, image_map_signals[FLUSH], 0);
 }
+
+static void
+gimp_image_map_set_output (GimpImageMap *image_map,
+                           GeglNode     *output)
+{
+  gegl_node_connect_to (output,                                   "output",
+                        gimp_filter_get_node (image_map->filter), "aux");
+}
+
+/*  point filters are previewed through lookup tables sampled from
+ *  the operation, the committed pixels come from the operation itself
+ */
+static gboolean
+gimp_image_map_compile_lut (GimpImageMap *image_map)
+{
+  GimpPrecision  precision;
+  GList         *nodes;
+  gint           curve_size;
+  gboolean       bounded;
+  gboolean       success;
+
+  if (! image_map->lut)
+    return FALSE;
+
+  precision = gimp_drawable_get_precision (image_map->drawable);
+
+  /*  8-bit gamma pixels hit the curve samples exactly  */
+  if (precision == GIMP_PRECISION_U8_GAMMA)
+    curve_size = 256;
+  else
+    curve_size = 4096;
+
+  switch (gimp_babl_component_type (precision))
+    {
+    case GIMP_COMPONENT_TYPE_HALF:
+    case GIMP_COMPONENT_TYPE_FLOAT:
+      bounded = FALSE;
+      break;
+
+    default:
+      bounded = TRUE;
+      break;
+    }
+
+  nodes = g_list_prepend (NULL, image_map->operation);
+
+  success = gimp_operation_point_lut_compile (image_map->lut, nodes,
+                                              curve_size, 33, bounded);
+
+  g_list_free (nodes);
+
+  return success;
+}
+
+/*  the cache holds the operation's output for cache_area, in the
+ *  drawable's format and coordinates, so it shares the tile grid of
+ *  the drawable's buffer.  After a change, the visible part of @area
+ *  is first rendered at the preview scale, then everything is
+ *  rendered at full resolution in an idle, visible part first.  Full
+ *  resolution pixels are tracked in cache_valid, in the operation's
+ *  coordinates, so commit only has to render what is missing.
+ */
+static void
+gimp_image_map_cache_update (GimpImageMap        *image_map,
+                             const GeglRectangle *area)
+{
+  const Babl            *format;
+  GeglRectangle          extent;
+  GeglRectangle          visible;
+  cairo_rectangle_int_t  rect;
+
+  format = gimp_drawable_get_format_with_alpha (image_map->drawable);
+  extent = *GEGL_RECTANGLE (0, 0,
+                            image_map->cache_area.width,
+                            image_map->cache_area.height);
+
+  if (! image_map->cache                                  ||
+      gegl_buffer_get_format (image_map->cache) != format ||
+      ! gegl_rectangle_equal (gegl_buffer_get_extent (image_map->cache),
+                              &image_map->cache_area))
+    {
+      GeglNode *filter_node = gimp_filter_get_node (image_map->filter);
+
+      if (image_map->cache)
+        g_object_unref (image_map->cache);
+
+      image_map->cache = gegl_buffer_new (&image_map->cache_area, format);
+
+      /*  show the original pixels until they are rendered.  With an
+       *  alpha channel, the buffers have the same format and tile
+       *  grid, so this only shares the drawable's tiles, the pixels
+       *  are copied when written.  Without, the drawable's alpha is
+       *  not affected and the empty cache replaces nothing.
+       */
+      if (format == gimp_drawable_get_format (image_map->drawable))
+        gegl_buffer_copy (gimp_drawable_get_buffer (image_map->drawable),
+                          &image_map->cache_area,
+                          image_map->cache,
+                          &image_map->cache_area);
+
+      if (! image_map->cache_node)
+        {
+          image_map->cache_node =
+            gegl_node_new_child (filter_node,
+                                 "operation", "gegl:buffer-source",
+                                 NULL);
+          image_map->cache_translate =
+            gegl_node_new_child (filter_node,
+                                 "operation", "gegl:translate",
+                                 NULL);
+
+          gegl_node_connect_to (image_map->cache_node,      "output",
+                                image_map->cache_translate, "input");
+        }
+
+      gegl_node_set (image_map->cache_node,
+                     "buffer", image_map->cache,
+                     NULL);
+      gegl_node_set (image_map->cache_translate,
+                     "x", (gdouble) -image_map->cache_area.x,
+                     "y", (gdouble) -image_map->cache_area.y,
+                     NULL);
+
+      if (image_map->cache_valid)
+        cairo_region_destroy (image_map->cache_valid);
+
+      image_map->cache_valid = cairo_region_create ();
+    }
+
+  rect.x      = area->x - image_map->cache_area.x;
+  rect.y      = area->y - image_map->cache_area.y;
+  rect.width  = area->width;
+  rect.height = area->height;
+
+  cairo_region_subtract_rectangle (image_map->cache_valid, &rect);
+
+  if (image_map->preview_scale < 1.0 &&
+      gimp_rectangle_intersect (image_map->preview_rect.x -
+                                image_map->cache_area.x,
+                                image_map->preview_rect.y -
+                                image_map->cache_area.y,
+                                image_map->preview_rect.width,
+                                image_map->preview_rect.height,
+                                rect.x, rect.y, rect.width, rect.height,
+                                &visible.x,     &visible.y,
+                                &visible.width, &visible.height) &&
+      gegl_rectangle_intersect (&visible, &visible, &extent))
+    {
+      gimp_image_map_cache_render (image_map, &visible);
+    }
+
+  if (! image_map->cache_idle_id)
+    image_map->cache_idle_id =
+      g_idle_add_full (GIMP_IMAGE_MAP_IDLE_PRIORITY,
+                       gimp_image_map_cache_idle, image_map,
+                       NULL);
+}
+
+/*  renders @rect at the preview scale and scales it back up into the
+ *  cache, without marking it valid
+ */
+static void
+gimp_image_map_cache_render (GimpImageMap        *image_map,
+                             const GeglRectangle *rect)
+{
+  const Babl    *format = gegl_buffer_get_format (image_map->cache);
+  gint           bpp    = babl_format_get_bytes_per_pixel (format);
+  gdouble        scale  = image_map->preview_scale;
+  GeglRectangle  scaled;
+  guchar        *src;
+  guchar        *row;
+  gint           x, y;
+
+  scaled.x      = floor (rect->x * scale);
+  scaled.y      = floor (rect->y * scale);
+  scaled.width  = MAX (1, ceil ((rect->x + rect->width)  * scale) - scaled.x);
+  scaled.height = MAX (1, ceil ((rect->y + rect->height) * scale) - scaled.y);
+
+  src = g_malloc (scaled.width * scaled.height * bpp);
+  row = g_malloc (rect->width * bpp);
+
+  /*  GEGL picks the mipmap level matching the scale  */
+  gegl_node_blit (image_map->output, scale, &scaled,
+                  format, src, GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  for (y = 0; y < rect->height; y++)
+    {
+      gint    src_y = CLAMP ((gint) ((rect->y + y) * scale) - scaled.y,
+                             0, scaled.height - 1);
+      guchar *s     = src + src_y * scaled.width * bpp;
+
+      for (x = 0; x < rect->width; x++)
+        {
+          gint src_x = CLAMP ((gint) ((rect->x + x) * scale) - scaled.x,
+                              0, scaled.width - 1);
+
+          memcpy (row + x * bpp, s + src_x * bpp, bpp);
+        }
+
+      gegl_buffer_set (image_map->cache,
+                       GEGL_RECTANGLE (image_map->cache_area.x + rect->x,
+                                       image_map->cache_area.y + rect->y + y,
+                                       rect->width, 1),
+                       0, format, row, GEGL_AUTO_ROWSTRIDE);
+    }
+
+  g_free (row);
+  g_free (src);
+}
+
+/*  renders the next chunk at full resolution, preferring the visible
+ *  part, returns FALSE when the cache is complete
+ */
+static gboolean
+gimp_image_map_cache_render_next (GimpImageMap  *image_map,
+                                  GeglRectangle *rect)
+{
+  cairo_region_t        *pending;
+  cairo_rectangle_int_t  extent = { 0, 0,
+                                    image_map->cache_area.width,
+                                    image_map->cache_area.height };
+  cairo_rectangle_int_t  chunk;
+  const Babl            *format;
+  guchar                *data;
+
+  pending = cairo_region_create_rectangle (&extent);
+  cairo_region_subtract (pending, image_map->cache_valid);
+
+  if (cairo_region_is_empty (pending))
+    {
+      cairo_region_destroy (pending);
+
+      return FALSE;
+    }
+
+  if (image_map->preview_scale > 0.0)
+    {
+      cairo_region_t        *visible;
+      cairo_rectangle_int_t  preview_rect;
+
+      preview_rect.x      = image_map->preview_rect.x - image_map->cache_area.x;
+      preview_rect.y      = image_map->preview_rect.y - image_map->cache_area.y;
+      preview_rect.width  = image_map->preview_rect.width;
+      preview_rect.height = image_map->preview_rect.height;
+
+      visible = cairo_region_copy (pending);
+      cairo_region_intersect_rectangle (visible, &preview_rect);
+
+      if (! cairo_region_is_empty (visible))
+        {
+          cairo_region_destroy (pending);
+          pending = visible;
+        }
+      else
+        {
+          cairo_region_destroy (visible);
+        }
+    }
+
+  cairo_region_get_rectangle (pending, 0, &chunk);
+  cairo_region_destroy (pending);
+
+  chunk.width  = MIN (chunk.width,  GIMP_IMAGE_MAP_CHUNK_WIDTH);
+  chunk.height = MIN (chunk.height, GIMP_IMAGE_MAP_CHUNK_HEIGHT);
+
+  *rect = *(GeglRectangle *) &chunk;
+
+  format = gegl_buffer_get_format (image_map->cache);
+  data   = g_malloc (rect->width * rect->height *
+                     babl_format_get_bytes_per_pixel (format));
+
+  gegl_node_blit (image_map->output, 1.0, rect,
+                  format, data, GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  gegl_buffer_set (image_map->cache,
+                   GEGL_RECTANGLE (image_map->cache_area.x + rect->x,
+                                   image_map->cache_area.y + rect->y,
+                                   rect->width, rect->height),
+                   0, format, data, GEGL_AUTO_ROWSTRIDE);
+
+  g_free (data);
+
+  cairo_region_union_rectangle (image_map->cache_valid, &chunk);
+
+  return TRUE;
+}
+
+static gboolean
+gimp_image_map_cache_idle (gpointer data)
+{
+  GimpImageMap *image_map = data;
+  GTimer       *timer     = g_timer_new ();
+  GeglRectangle rect;
+  gboolean      retval    = TRUE;
+
+  do
+    {
+      if (! gimp_image_map_cache_render_next (image_map, &rect))
+        {
+          image_map->cache_idle_id = 0;
+
+          retval = FALSE;
+
+          break;
+        }
+
+      gimp_drawable_update (image_map->drawable,
+                            image_map->cache_area.x + rect.x,
+                            image_map->cache_area.y + rect.y,
+                            rect.width,
+                            rect.height);
+    }
+  while (g_timer_elapsed (timer, NULL) < GIMP_IMAGE_MAP_CHUNK_TIME);
+
+  g_timer_destroy (timer);
+
+  g_signal_emit (image_map, image_map_signals[FLUSH], 0);
+
+  return retval;
+}
+
+static void
+gimp_image_map_cache_free (GimpImageMap *image_map)
+{
+  if (image_map->cache_idle_id)
+    {
+      g_source_remove (image_map->cache_idle_id);
+      image_map->cache_idle_id = 0;
+    }
+
+  if (image_map->cache)
+    {
+      g_object_unref (image_map->cache);
+      image_map->cache = NULL;
+    }
+
+  if (image_map->cache_valid)
+    {
+      cairo_region_destroy (image_map->cache_valid);
+      image_map->cache_valid = NULL;
+    }
+}
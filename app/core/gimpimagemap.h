@@ -54,22 +54,31 @@ struct _GimpImageMapClass
  *  The image map is no longer valid after a call to commit or abort.
  */
 
-GType          gimp_image_map_get_type   (void) G_GNUC_CONST;
+GType          gimp_image_map_get_type    (void) G_GNUC_CONST;
 
-GimpImageMap * gimp_image_map_new        (GimpDrawable        *drawable,
-                                          const gchar         *undo_desc,
-                                          GeglNode            *operation,
-                                          const gchar         *stock_id);
+GimpImageMap * gimp_image_map_new         (GimpDrawable        *drawable,
+                                           const gchar         *undo_desc,
+                                           GeglNode            *operation,
+                                           const gchar         *stock_id);
 
-void           gimp_image_map_set_region (GimpImageMap        *image_map,
-                                          GimpImageMapRegion   region);
+void           gimp_image_map_set_region  (GimpImageMap        *image_map,
+                                           GimpImageMapRegion   region);
 
-void           gimp_image_map_apply      (GimpImageMap        *image_map,
-                                          const GeglRectangle *area);
+/*  With a preview area set, gimp_image_map_apply() first renders the
+ *  visible @rect (in drawable coordinates) at the display's @scale,
+ *  then everything at full resolution in the background.  Commit
+ *  reuses the full resolution pixels rendered so far.
+ */
+void           gimp_image_map_set_preview (GimpImageMap        *image_map,
+                                           gdouble              scale,
+                                           const GeglRectangle *rect);
+
+void           gimp_image_map_apply       (GimpImageMap        *image_map,
+                                           const GeglRectangle *area);
 
-void           gimp_image_map_commit     (GimpImageMap        *image_map,
-                                          GimpProgress        *progress);
-void           gimp_image_map_abort      (GimpImageMap        *image_map);
+void           gimp_image_map_commit      (GimpImageMap        *image_map,
+                                           GimpProgress        *progress);
+void           gimp_image_map_abort       (GimpImageMap        *image_map);
 
 
 #endif /* __GIMP_IMAGE_MAP_H__ */
@@ -38,6 +38,7 @@
 #include "gimpcontext.h"
 #include "gimpcontainer.h"
 #include "gimperror.h"
+#include "gimpdrawable-convert.h"
 #include "gimpimage-undo-push.h"
 #include "gimpimage-undo.h"
 #include "gimpimage.h"
@@ -1011,28 +1012,8 @@ gimp_layer_convert_type (GimpDrawable      *drawable,
   GimpLayer  *layer = GIMP_LAYER (drawable);
   GeglBuffer *dest_buffer;
 
-  dest_buffer =
-    gegl_buffer_new (GEGL_RECTANGLE (0, 0,
-                                     gimp_item_get_width  (GIMP_ITEM (drawable)),
-                                     gimp_item_get_height (GIMP_ITEM (drawable))),
-                     new_format);
-
-  if (layer_dither_type == 0)
-    {
-      gegl_buffer_copy (gimp_drawable_get_buffer (drawable), NULL,
-                        dest_buffer, NULL);
-    }
-  else
-    {
-      gint bits;
-
-      bits = (babl_format_get_bytes_per_pixel (new_format) * 8 /
-              babl_format_get_n_components (new_format));
-
-      gimp_gegl_apply_color_reduction (gimp_drawable_get_buffer (drawable),
-                                       NULL, NULL,
-                                       dest_buffer, bits, layer_dither_type);
-    }
+  dest_buffer = gimp_drawable_convert_buffer (drawable, new_format,
+                                              layer_dither_type);
 
   gimp_drawable_set_buffer (drawable, push_undo, NULL, dest_buffer);
   g_object_unref (dest_buffer);
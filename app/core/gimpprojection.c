@@ -26,6 +26,8 @@
 #include "gegl/gimp-gegl-utils.h"
 #include "gegl/gimptilehandlerprojection.h"
 
+#include "pdb/gimppdb-scheduler.h"
+
 #include "gimp.h"
 #include "gimp-utils.h"
 #include "gimparea.h"
@@ -79,6 +81,8 @@ static gdouble     gimp_projection_get_opacity_at        (GimpPickable    *picka
                                                           gint             y);
 
 static void        gimp_projection_free_buffer           (GimpProjection  *proj);
+static void        gimp_projection_lock                  (GimpProjection  *proj);
+static void        gimp_projection_unlock                (GimpProjection  *proj);
 static void        gimp_projection_add_update_area       (GimpProjection  *proj,
                                                           gint             x,
                                                           gint             y,
@@ -379,12 +383,16 @@ gimp_projection_finish_draw (GimpProjection *proj)
 {
   g_return_if_fail (GIMP_IS_PROJECTION (proj));
 
+  gimp_projection_lock (proj);
+
   if (proj->chunk_render.running)
     {
       gimp_projection_chunk_render_stop (proj);
 
       while (gimp_projection_chunk_render_iteration (proj));
     }
+
+  gimp_projection_unlock (proj);
 }
 
 
@@ -409,6 +417,28 @@ gimp_projection_free_buffer (GimpProjection  *proj)
     }
 }
 
+/*  scheduled procedures update the image on another thread, and the
+ *  update areas with it, keep them out while the main thread uses
+ *  the update areas and the chunk renderer
+ */
+static void
+gimp_projection_lock (GimpProjection *proj)
+{
+  GimpImage *image = gimp_projectable_get_image (proj->projectable);
+
+  if (image && image->gimp->pdb)
+    gimp_pdb_lock_image (image->gimp->pdb, image);
+}
+
+static void
+gimp_projection_unlock (GimpProjection *proj)
+{
+  GimpImage *image = gimp_projectable_get_image (proj->projectable);
+
+  if (image && image->gimp->pdb)
+    gimp_pdb_unlock_image (image->gimp->pdb, image);
+}
+
 static void
 gimp_projection_add_update_area (GimpProjection *proj,
                                  gint            x,
@@ -442,6 +472,8 @@ static void
 gimp_projection_flush_whenever (GimpProjection *proj,
                                 gboolean        now)
 {
+  gimp_projection_lock (proj);
+
   /*  First the updates...  */
   if (proj->update_areas)
     {
@@ -482,6 +514,8 @@ gimp_projection_flush_whenever (GimpProjection *proj,
 
       gimp_projectable_invalidate_preview (proj->projectable);
     }
+
+  gimp_projection_unlock (proj);
 }
 
 static void
@@ -516,6 +550,8 @@ gimp_projection_chunk_render_callback (gpointer data)
   gint            chunks = 0;
   gboolean        retval = TRUE;
 
+  gimp_projection_lock (proj);
+
   do
     {
       if (! gimp_projection_chunk_render_iteration (proj))
@@ -535,6 +571,8 @@ gimp_projection_chunk_render_callback (gpointer data)
             chunks, g_timer_elapsed (timer, NULL));
   g_timer_destroy (timer);
 
+  gimp_projection_unlock (proj);
+
   return retval;
 }
 
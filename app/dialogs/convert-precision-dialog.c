@@ -29,6 +29,7 @@
 
 #include "core/gimp.h"
 #include "core/gimpcontext.h"
+#include "core/gimpdrawable-convert.h"
 #include "core/gimpimage.h"
 #include "core/gimpimage-convert-precision.h"
 #include "core/gimplist.h"
@@ -64,6 +65,8 @@ static void   convert_precision_dialog_response (GtkWidget        *widget,
                                                  ConvertDialog    *dialog);
 static void   convert_precision_dialog_free     (ConvertDialog    *dialog);
 
+static GtkWidget * convert_precision_dialog_dither_combo_new (GType dither_type);
+
 
 /*  defaults  */
 
@@ -183,7 +186,7 @@ convert_precision_dialog_new (GimpImage     *image,
   gtk_size_group_add_widget (size_group, label);
   gtk_widget_show (label);
 
-  combo = gimp_enum_combo_box_new (dither_type);
+  combo = convert_precision_dialog_dither_combo_new (dither_type);
   gtk_label_set_mnemonic_widget (GTK_LABEL (label), combo);
   gtk_box_pack_start (GTK_BOX (hbox), combo, TRUE, TRUE, 0);
   gtk_widget_show (combo);
@@ -205,7 +208,7 @@ convert_precision_dialog_new (GimpImage     *image,
   gtk_size_group_add_widget (size_group, label);
   gtk_widget_show (label);
 
-  combo = gimp_enum_combo_box_new (dither_type);
+  combo = convert_precision_dialog_dither_combo_new (dither_type);
   gtk_label_set_mnemonic_widget (GTK_LABEL (label), combo);
   gtk_box_pack_start (GTK_BOX (hbox), combo, TRUE, TRUE, 0);
   gtk_widget_show (combo);
@@ -231,7 +234,7 @@ convert_precision_dialog_new (GimpImage     *image,
   gtk_size_group_add_widget (size_group, label);
   gtk_widget_show (label);
 
-  combo = gimp_enum_combo_box_new (dither_type);
+  combo = convert_precision_dialog_dither_combo_new (dither_type);
   gtk_label_set_mnemonic_widget (GTK_LABEL (label), combo);
   gtk_box_pack_start (GTK_BOX (hbox), combo, TRUE, TRUE, 0);
   gtk_widget_show (combo);
@@ -286,3 +289,17 @@ convert_precision_dialog_free (ConvertDialog *dialog)
 {
   g_slice_free (ConvertDialog, dialog);
 }
+
+static GtkWidget *
+convert_precision_dialog_dither_combo_new (GType dither_type)
+{
+  GtkWidget *combo = gimp_enum_combo_box_new (dither_type);
+
+  gimp_int_combo_box_append (GIMP_INT_COMBO_BOX (combo),
+                             GIMP_INT_STORE_VALUE,
+                             GIMP_DRAWABLE_CONVERT_DITHER_BLUE_NOISE,
+                             GIMP_INT_STORE_LABEL, _("Blue noise"),
+                             -1);
+
+  return combo;
+}
@@ -42,6 +42,10 @@
 #include "gimpdisplayxfer.h"
 
 
+/*  the offset of v into its size-aligned cell, also for negative v  */
+#define ALIGN_OFFSET(v, size) ((((v) % (size)) + (size)) % (size))
+
+
 /*  public functions  */
 
 void
@@ -137,6 +141,7 @@ gimp_display_shell_draw_image (GimpDisplayShell *shell,
 {
   gint x1, y1, x2, y2;
   gint i, j;
+  gint dx, dy;
 
   g_return_if_fail (GIMP_IS_DISPLAY_SHELL (shell));
   g_return_if_fail (gimp_display_get_image (shell->display));
@@ -178,16 +183,20 @@ gimp_display_shell_draw_image (GimpDisplayShell *shell,
     }
 
   /*  display the image in RENDER_BUF_WIDTH x RENDER_BUF_HEIGHT
-   *  sized chunks
+   *  sized chunks, aligned to the render cache's tiles in zoomed
+   *  image coordinates
    */
-  for (i = y1; i < y2; i += GIMP_DISPLAY_RENDER_BUF_HEIGHT)
+  for (i = y1; i < y2; i += dy)
     {
-      for (j = x1; j < x2; j += GIMP_DISPLAY_RENDER_BUF_WIDTH)
-        {
-          gint dx, dy;
+      dy = GIMP_DISPLAY_RENDER_BUF_HEIGHT -
+           ALIGN_OFFSET (i + shell->offset_y, GIMP_DISPLAY_RENDER_BUF_HEIGHT);
+      dy = MIN (y2 - i, dy);
 
-          dx = MIN (x2 - j, GIMP_DISPLAY_RENDER_BUF_WIDTH);
-          dy = MIN (y2 - i, GIMP_DISPLAY_RENDER_BUF_HEIGHT);
+      for (j = x1; j < x2; j += dx)
+        {
+          dx = GIMP_DISPLAY_RENDER_BUF_WIDTH -
+               ALIGN_OFFSET (j + shell->offset_x, GIMP_DISPLAY_RENDER_BUF_WIDTH);
+          dx = MIN (x2 - j, dx);
 
           gimp_display_shell_render (shell, cr, j, i, dx, dy);
         }
@@ -20,6 +20,7 @@
 #include <gegl.h>
 #include <gtk/gtk.h>
 
+#include "libgimpcolor/gimpcolor.h"
 #include "libgimpconfig/gimpconfig.h"
 #include "libgimpwidgets/gimpwidgets.h"
 
@@ -27,15 +28,122 @@
 
 #include "config/gimpcoreconfig.h"
 
+#include "core/gimp-parallel.h"
+
 #include "gimpdisplayshell.h"
 #include "gimpdisplayshell-expose.h"
 #include "gimpdisplayshell-filter.h"
+#include "gimpdisplayshell-render.h"
+
+
+/*  the filter stack is sampled at every LUT_STEP-th value per channel,
+ *  255 must be a multiple of LUT_STEP
+ */
+#define LUT_STEP       5
+#define LUT_NODES      (255 / LUT_STEP + 1)
+
+/*  the LUT is only used if it reproduces the filter stack this well  */
+#define LUT_N_SAMPLES  4096
+#define LUT_MAX_ERROR  2
+
+/*  the minimal number of rows converted by one thread  */
+#define MIN_ROWS       16
+
+
+typedef struct
+{
+  const guint8 *lut;
+  guchar       *data;
+  gint          stride;
+  gint          width;
+} LutApplyData;
 
 
 /*  local function prototypes  */
 
-static void   gimp_display_shell_filter_changed (GimpColorDisplayStack *stack,
-                                                 GimpDisplayShell      *shell);
+static void     gimp_display_shell_filter_changed   (GimpColorDisplayStack *stack,
+                                                     GimpDisplayShell      *shell);
+
+static guint8 * gimp_display_shell_filter_lut_new   (GimpColorDisplayStack *stack);
+static void     gimp_display_shell_filter_lut_apply (gsize                  offset,
+                                                     gsize                  size,
+                                                     LutApplyData          *data);
+
+
+static inline void
+lut_lookup (const guint8 *lut,
+            guint         r,
+            guint         g,
+            guint         b,
+            guint        *out)
+{
+  const gint    dr = LUT_NODES * LUT_NODES * 3;
+  const gint    dg = LUT_NODES * 3;
+  const gint    db = 3;
+  gint          ir = r / LUT_STEP;
+  gint          ig = g / LUT_STEP;
+  gint          ib = b / LUT_STEP;
+  gint          fr = r % LUT_STEP;
+  gint          fg = g % LUT_STEP;
+  gint          fb = b % LUT_STEP;
+  const guint8 *c;
+  gint          o1, o2;
+  gint          w0, w1, w2, w3;
+  gint          i;
+
+  if (ir == LUT_NODES - 1) { ir--; fr = LUT_STEP; }
+  if (ig == LUT_NODES - 1) { ig--; fg = LUT_STEP; }
+  if (ib == LUT_NODES - 1) { ib--; fb = LUT_STEP; }
+
+  c = lut + ir * dr + ig * dg + ib * db;
+
+  /*  tetrahedral interpolation  */
+  if (fr >= fg)
+    {
+      if (fg >= fb)
+        {
+          o1 = dr;      o2 = dr + dg;
+          w0 = LUT_STEP - fr; w1 = fr - fg; w2 = fg - fb; w3 = fb;
+        }
+      else if (fr >= fb)
+        {
+          o1 = dr;      o2 = dr + db;
+          w0 = LUT_STEP - fr; w1 = fr - fb; w2 = fb - fg; w3 = fg;
+        }
+      else
+        {
+          o1 = db;      o2 = dr + db;
+          w0 = LUT_STEP - fb; w1 = fb - fr; w2 = fr - fg; w3 = fg;
+        }
+    }
+  else
+    {
+      if (fb >= fg)
+        {
+          o1 = db;      o2 = dg + db;
+          w0 = LUT_STEP - fb; w1 = fb - fg; w2 = fg - fr; w3 = fr;
+        }
+      else if (fb >= fr)
+        {
+          o1 = dg;      o2 = dg + db;
+          w0 = LUT_STEP - fg; w1 = fg - fb; w2 = fb - fr; w3 = fr;
+        }
+      else
+        {
+          o1 = dg;      o2 = dr + dg;
+          w0 = LUT_STEP - fg; w1 = fg - fr; w2 = fr - fb; w3 = fb;
+        }
+    }
+
+  for (i = 0; i < 3; i++)
+    {
+      out[i] = (w0 * c[i]                +
+                w1 * c[o1 + i]           +
+                w2 * c[o2 + i]           +
+                w3 * c[dr + dg + db + i] +
+                LUT_STEP / 2) / LUT_STEP;
+    }
+}
 
 
 /*  public functions  */
@@ -107,6 +215,60 @@ gimp_display_shell_filter_new (GimpDisplayShell *shell,
 }
 
 
+/**
+ * gimp_display_shell_filter_convert_surface:
+ * @shell:   a #GimpDisplayShell
+ * @surface: a #cairo_image_surface_t of type ARGB32
+ *
+ * Runs the shell's display filters on @surface. As long as the filter
+ * stack doesn't change, it is sampled into a 3D lookup table once,
+ * which is then applied to @surface on all threads. If the table
+ * doesn't reproduce the stack closely enough, e.g. for filters with
+ * discontinuities, the stack is run directly.
+ **/
+void
+gimp_display_shell_filter_convert_surface (GimpDisplayShell *shell,
+                                           cairo_surface_t  *surface)
+{
+  g_return_if_fail (GIMP_IS_DISPLAY_SHELL (shell));
+  g_return_if_fail (surface != NULL);
+
+  if (! shell->filter_stack || ! shell->filter_stack->filters)
+    return;
+
+  if (! shell->filter_lut_valid)
+    {
+      shell->filter_lut       = gimp_display_shell_filter_lut_new (shell->filter_stack);
+      shell->filter_lut_valid = TRUE;
+    }
+
+  if (shell->filter_lut &&
+      cairo_image_surface_get_format (surface) == CAIRO_FORMAT_ARGB32)
+    {
+      LutApplyData data;
+
+      cairo_surface_flush (surface);
+
+      data.lut    = shell->filter_lut;
+      data.data   = cairo_image_surface_get_data (surface);
+      data.stride = cairo_image_surface_get_stride (surface);
+      data.width  = cairo_image_surface_get_width (surface);
+
+      gimp_parallel_distribute_range (cairo_image_surface_get_height (surface),
+                                      MIN_ROWS,
+                                      (GimpParallelDistributeRangeFunc)
+                                      gimp_display_shell_filter_lut_apply,
+                                      &data);
+
+      cairo_surface_mark_dirty (surface);
+    }
+  else
+    {
+      gimp_color_display_stack_convert_surface (shell->filter_stack, surface);
+    }
+}
+
+
 /*  private functions  */
 
 static gboolean
@@ -114,6 +276,7 @@ gimp_display_shell_filter_changed_idle (gpointer data)
 {
   GimpDisplayShell *shell = data;
 
+  gimp_display_shell_render_invalidate_full (shell);
   gimp_display_shell_expose_full (shell);
   shell->filter_idle_id = 0;
 
@@ -124,6 +287,14 @@ static void
 gimp_display_shell_filter_changed (GimpColorDisplayStack *stack,
                                    GimpDisplayShell      *shell)
 {
+  if (shell->filter_lut)
+    {
+      g_free (shell->filter_lut);
+      shell->filter_lut = NULL;
+    }
+
+  shell->filter_lut_valid = FALSE;
+
   if (shell->filter_idle_id)
     g_source_remove (shell->filter_idle_id);
 
@@ -132,3 +303,153 @@ gimp_display_shell_filter_changed (GimpColorDisplayStack *stack,
                      gimp_display_shell_filter_changed_idle,
                      shell, NULL);
 }
+
+static guint8 *
+gimp_display_shell_filter_lut_new (GimpColorDisplayStack *stack)
+{
+  cairo_surface_t *surface;
+  guint8          *lut;
+  guint8          *samples;
+  guchar          *data;
+  gint             stride;
+  GRand           *rand;
+  gint             max_error = 0;
+  gint             r, g, b;
+  gint             i;
+
+  /*  run the stack on all lattice points, one red value per row  */
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                        LUT_NODES * LUT_NODES, LUT_NODES);
+
+  cairo_surface_flush (surface);
+
+  data   = cairo_image_surface_get_data (surface);
+  stride = cairo_image_surface_get_stride (surface);
+
+  for (r = 0; r < LUT_NODES; r++)
+    {
+      guchar *d = data + r * stride;
+
+      for (g = 0; g < LUT_NODES; g++)
+        for (b = 0; b < LUT_NODES; b++, d += 4)
+          GIMP_CAIRO_ARGB32_SET_PIXEL (d,
+                                       r * LUT_STEP, g * LUT_STEP, b * LUT_STEP,
+                                       255);
+    }
+
+  cairo_surface_mark_dirty (surface);
+
+  gimp_color_display_stack_convert_surface (stack, surface);
+
+  cairo_surface_flush (surface);
+
+  lut = g_new (guint8, LUT_NODES * LUT_NODES * LUT_NODES * 3);
+
+  for (r = 0; r < LUT_NODES; r++)
+    {
+      const guchar *s = data + r * stride;
+      guint8       *l = lut + r * LUT_NODES * LUT_NODES * 3;
+
+      for (i = 0; i < LUT_NODES * LUT_NODES; i++, s += 4, l += 3)
+        {
+          guint a;
+
+          GIMP_CAIRO_ARGB32_GET_PIXEL (s, l[0], l[1], l[2], a);
+        }
+    }
+
+  cairo_surface_destroy (surface);
+
+  /*  compare the LUT against the stack on random colors  */
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                        LUT_N_SAMPLES, 1);
+
+  cairo_surface_flush (surface);
+
+  data    = cairo_image_surface_get_data (surface);
+  samples = g_new (guint8, LUT_N_SAMPLES * 3);
+  rand    = g_rand_new_with_seed (LUT_N_SAMPLES);
+
+  for (i = 0; i < LUT_N_SAMPLES; i++)
+    {
+      samples[i * 3 + 0] = g_rand_int_range (rand, 0, 256);
+      samples[i * 3 + 1] = g_rand_int_range (rand, 0, 256);
+      samples[i * 3 + 2] = g_rand_int_range (rand, 0, 256);
+
+      GIMP_CAIRO_ARGB32_SET_PIXEL (data + i * 4,
+                                   samples[i * 3 + 0],
+                                   samples[i * 3 + 1],
+                                   samples[i * 3 + 2],
+                                   255);
+    }
+
+  g_rand_free (rand);
+
+  cairo_surface_mark_dirty (surface);
+
+  gimp_color_display_stack_convert_surface (stack, surface);
+
+  cairo_surface_flush (surface);
+
+  for (i = 0; i < LUT_N_SAMPLES && max_error <= LUT_MAX_ERROR; i++)
+    {
+      guint exact[3];
+      guint approx[3];
+      guint a;
+      gint  c;
+
+      GIMP_CAIRO_ARGB32_GET_PIXEL (data + i * 4,
+                                   exact[0], exact[1], exact[2], a);
+
+      lut_lookup (lut,
+                  samples[i * 3 + 0],
+                  samples[i * 3 + 1],
+                  samples[i * 3 + 2],
+                  approx);
+
+      for (c = 0; c < 3; c++)
+        max_error = MAX (max_error, ABS ((gint) exact[c] - (gint) approx[c]));
+    }
+
+  g_free (samples);
+  cairo_surface_destroy (surface);
+
+  if (max_error > LUT_MAX_ERROR)
+    {
+      g_free (lut);
+
+      return NULL;
+    }
+
+  return lut;
+}
+
+static void
+gimp_display_shell_filter_lut_apply (gsize         offset,
+                                     gsize         size,
+                                     LutApplyData *data)
+{
+  guchar *row = data->data + offset * data->stride;
+
+  for (; size; size--, row += data->stride)
+    {
+      guchar *d = row;
+      gint    x;
+
+      for (x = 0; x < data->width; x++, d += 4)
+        {
+          guint r, g, b, a;
+          guint rgb[3];
+
+          GIMP_CAIRO_ARGB32_GET_PIXEL (d, r, g, b, a);
+
+          /*  fully transparent pixels stay all zero  */
+          if (! a)
+            continue;
+
+          lut_lookup (data->lut, r, g, b, rgb);
+
+          GIMP_CAIRO_ARGB32_SET_PIXEL (d, rgb[0], rgb[1], rgb[2], a);
+        }
+    }
+}
@@ -25,5 +25,8 @@ void   gimp_display_shell_filter_set (GimpDisplayShell      *shell,
 GimpColorDisplayStack * gimp_display_shell_filter_new (GimpDisplayShell *shell,
                                                        GimpColorConfig  *config);
 
+void   gimp_display_shell_filter_convert_surface (GimpDisplayShell *shell,
+                                                  cairo_surface_t  *surface);
+
 
 #endif /* __GIMP_DISPLAY_SHELL_FILTER_H__ */
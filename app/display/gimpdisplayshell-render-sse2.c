@@ -0,0 +1,213 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpdisplayshell-render-sse2.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+
+#include "display-types.h"
+
+#include "gimpdisplayshell-render.h"
+
+#if COMPILE_SSE2_INTRINISICS
+/* SSE2 */
+#include <emmintrin.h>
+
+/*  premultiplies two RGBA pixels, given as 16 bit components, and
+ *  reorders them to the BGRA byte order of little endian ARGB32
+ */
+static inline __m128i
+render_premultiply_sse2 (__m128i v)
+{
+  const __m128i alpha_mask = _mm_set_epi16 (-1, 0, 0, 0, -1, 0, 0, 0);
+  const __m128i half       = _mm_set1_epi16 (0x80);
+  __m128i       a;
+  __m128i       t;
+
+  a = _mm_shufflelo_epi16 (v, _MM_SHUFFLE (3, 3, 3, 3));
+  a = _mm_shufflehi_epi16 (a, _MM_SHUFFLE (3, 3, 3, 3));
+
+  /*  INT_MULT(), the products fit into unsigned 16 bits  */
+  t = _mm_add_epi16 (_mm_mullo_epi16 (v, a), half);
+  t = _mm_srli_epi16 (_mm_add_epi16 (_mm_srli_epi16 (t, 8), t), 8);
+
+  t = _mm_or_si128 (_mm_andnot_si128 (alpha_mask, t),
+                    _mm_and_si128    (alpha_mask, v));
+
+  t = _mm_shufflelo_epi16 (t, _MM_SHUFFLE (3, 0, 1, 2));
+  t = _mm_shufflehi_epi16 (t, _MM_SHUFFLE (3, 0, 1, 2));
+
+  return t;
+}
+
+static inline void
+render_store_sse2 (guint32 *dest,
+                   __m128i  lo,
+                   __m128i  hi)
+{
+  _mm_storeu_si128 ((__m128i *) dest,
+                    _mm_packus_epi16 (render_premultiply_sse2 (lo),
+                                      render_premultiply_sse2 (hi)));
+}
+
+static inline __m128i
+render_float_to_int_sse2 (const gfloat *src,
+                          __m128        scale)
+{
+  const __m128 zero = _mm_setzero_ps ();
+  const __m128 one  = _mm_set1_ps (1.0f);
+  const __m128 half = _mm_set1_ps (0.5f);
+  __m128       v;
+
+  /*  _mm_max_ps() returns its second operand for NaN  */
+  v = _mm_min_ps (_mm_max_ps (_mm_loadu_ps (src), zero), one);
+
+  return _mm_cvttps_epi32 (_mm_add_ps (_mm_mul_ps (v, scale), half));
+}
+
+static inline void
+render_u8_gamma_4_sse2 (const guchar *src,
+                        guint32      *dest)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  __m128i       v    = _mm_loadu_si128 ((const __m128i *) src);
+
+  render_store_sse2 (dest,
+                     _mm_unpacklo_epi8 (v, zero),
+                     _mm_unpackhi_epi8 (v, zero));
+}
+
+static inline void
+render_float_gamma_4_sse2 (const gfloat *src,
+                           guint32      *dest)
+{
+  const __m128 scale = _mm_set1_ps (255.0f);
+  __m128i      p0, p1, p2, p3;
+
+  p0 = render_float_to_int_sse2 (src +  0, scale);
+  p1 = render_float_to_int_sse2 (src +  4, scale);
+  p2 = render_float_to_int_sse2 (src +  8, scale);
+  p3 = render_float_to_int_sse2 (src + 12, scale);
+
+  render_store_sse2 (dest,
+                     _mm_packs_epi32 (p0, p1),
+                     _mm_packs_epi32 (p2, p3));
+}
+
+static inline void
+render_float_linear_4_sse2 (const gfloat *src,
+                            guint32      *dest,
+                            const guint8 *gamma)
+{
+  /*  color goes through the u16 gamma table, alpha straight to u8  */
+  const __m128  scale = _mm_set_ps (255.0f, 65535.0f, 65535.0f, 65535.0f);
+  gint32        index[16];
+  guint16       comp[16];
+  gint          i;
+
+  for (i = 0; i < 4; i++)
+    _mm_storeu_si128 ((__m128i *) (index + 4 * i),
+                      render_float_to_int_sse2 (src + 4 * i, scale));
+
+  for (i = 0; i < 16; i += 4)
+    {
+      comp[i + 0] = gamma[index[i + 0]];
+      comp[i + 1] = gamma[index[i + 1]];
+      comp[i + 2] = gamma[index[i + 2]];
+      comp[i + 3] = index[i + 3];
+    }
+
+  render_store_sse2 (dest,
+                     _mm_loadu_si128 ((const __m128i *) (comp + 0)),
+                     _mm_loadu_si128 ((const __m128i *) (comp + 8)));
+}
+
+/*  the kernels only handle RGBA, n_components is always 4; they
+ *  convert four pixels at a time, the remaining ones are padded
+ */
+
+void
+gimp_display_shell_render_u8_gamma_sse2 (const guchar *src,
+                                         guint32      *dest,
+                                         gint          n_components,
+                                         gint          width)
+{
+  for (; width >= 4; width -= 4, src += 16, dest += 4)
+    render_u8_gamma_4_sse2 (src, dest);
+
+  if (width > 0)
+    {
+      guchar  src_tail[16] = { 0, };
+      guint32 dest_tail[4];
+
+      memcpy (src_tail, src, width * 4);
+      render_u8_gamma_4_sse2 (src_tail, dest_tail);
+      memcpy (dest, dest_tail, width * sizeof (guint32));
+    }
+}
+
+void
+gimp_display_shell_render_float_gamma_sse2 (const guchar *src,
+                                            guint32      *dest,
+                                            gint          n_components,
+                                            gint          width)
+{
+  const gfloat *s = (const gfloat *) src;
+
+  for (; width >= 4; width -= 4, s += 16, dest += 4)
+    render_float_gamma_4_sse2 (s, dest);
+
+  if (width > 0)
+    {
+      gfloat  src_tail[16] = { 0, };
+      guint32 dest_tail[4];
+
+      memcpy (src_tail, s, width * 4 * sizeof (gfloat));
+      render_float_gamma_4_sse2 (src_tail, dest_tail);
+      memcpy (dest, dest_tail, width * sizeof (guint32));
+    }
+}
+
+void
+gimp_display_shell_render_float_linear_sse2 (const guchar *src,
+                                             guint32      *dest,
+                                             gint          n_components,
+                                             gint          width)
+{
+  const gfloat *s     = (const gfloat *) src;
+  const guint8 *gamma = gimp_display_shell_render_get_gamma_u16 ();
+
+  for (; width >= 4; width -= 4, s += 16, dest += 4)
+    render_float_linear_4_sse2 (s, dest, gamma);
+
+  if (width > 0)
+    {
+      gfloat  src_tail[16] = { 0, };
+      guint32 dest_tail[4];
+
+      memcpy (src_tail, s, width * 4 * sizeof (gfloat));
+      render_float_linear_4_sse2 (src_tail, dest_tail, gamma);
+      memcpy (dest, dest_tail, width * sizeof (guint32));
+    }
+}
+
+#endif /* COMPILE_SSE2_INTRINISICS */
@@ -20,13 +20,18 @@
 #include <gegl.h>
 #include <gtk/gtk.h>
 
+#include "libgimpbase/gimpbase.h"
 #include "libgimpcolor/gimpcolor.h"
+#include "libgimpmath/gimpmath.h"
 #include "libgimpwidgets/gimpwidgets.h"
 
 #include "display-types.h"
 
 #include "config/gimpdisplayconfig.h"
 
+#include "core/gimp-parallel.h"
+
+#include "gegl/gimp-babl.h"
 #include "gegl/gimp-gegl-utils.h"
 
 #include "core/gimpdrawable.h"
@@ -37,6 +42,7 @@
 
 #include "gimpdisplay.h"
 #include "gimpdisplayshell.h"
+#include "gimpdisplayshell-expose.h"
 #include "gimpdisplayshell-transform.h"
 #include "gimpdisplayshell-filter.h"
 #include "gimpdisplayshell-render.h"
@@ -44,6 +50,138 @@
 #include "gimpdisplayxfer.h"
 
 
+/*  the size of the tiles the rendered projection is cached in, in
+ *  zoomed image coordinates; chunks passed to gimp_display_shell_render()
+ *  are aligned to this grid
+ */
+#define RENDER_TILE_WIDTH   GIMP_DISPLAY_RENDER_BUF_WIDTH
+#define RENDER_TILE_HEIGHT  GIMP_DISPLAY_RENDER_BUF_HEIGHT
+
+/*  the maximal number of cached tiles, 256 KB each, shared by all
+ *  zoom levels
+ */
+#define RENDER_CACHE_MAX_TILES  128
+
+/*  tiles that were never rendered at a zoom level below 100% are first
+ *  drawn from the projection's mipmap this many levels further down,
+ *  and refined from an idle
+ */
+#define RENDER_COARSE_FACTOR  4
+
+/*  how long a single refinement idle may run, in microseconds  */
+#define RENDER_IDLE_TIME  10000
+
+/*  the minimal number of rows converted by one thread  */
+#define RENDER_MIN_ROWS  16
+
+/*  the number of half pixels converted to float at a time  */
+#define RENDER_HALF_CHUNK  256
+
+#define INT_MULT(a,b,t)  ((t) = (a) * (b) + 0x80, ((((t) >> 8) + (t)) >> 8))
+
+
+typedef struct _GimpDisplayRenderTile GimpDisplayRenderTile;
+
+typedef struct
+{
+  GimpDisplayRenderKernel  kernel;
+  gint                     n_components;
+  const guchar            *src;
+  gint                     src_stride;
+
+  guchar                  *dest;
+  gint                     dest_stride;
+  gint                     width;
+
+  const guchar            *mask;
+  gint                     mask_stride;
+  guint                    mask_r;
+  guint                    mask_g;
+  guint                    mask_b;
+  guint                    mask_a;
+} GimpDisplayRenderData;
+
+struct _GimpDisplayRenderTile
+{
+  gdouble          scale_x;
+  gdouble          scale_y;
+  gint             x;        /*  position in zoomed image coordinates  */
+  gint             y;
+
+  cairo_surface_t *surface;
+  cairo_region_t  *valid;    /*  rendered area, relative to the tile   */
+  GList           *link;     /*  link in the shell's LRU queue         */
+};
+
+
+static void     gimp_display_shell_render_projection (GimpDisplayShell      *shell,
+                                                      guchar                *data,
+                                                      gint                   stride,
+                                                      gint                   x,
+                                                      gint                   y,
+                                                      gint                   w,
+                                                      gint                   h,
+                                                      gdouble                scale,
+                                                      gboolean               overlay_mask);
+static void     gimp_display_shell_render_rows       (gsize                  offset,
+                                                      gsize                  size,
+                                                      GimpDisplayRenderData *data);
+static GimpDisplayRenderKernel
+                gimp_display_shell_render_get_kernel (const Babl            *format,
+                                                      gint                  *n_components,
+                                                      gint                  *bpp);
+static void     gimp_display_shell_render_direct     (GimpDisplayShell      *shell,
+                                                      cairo_t               *cr,
+                                                      gint                   x,
+                                                      gint                   y,
+                                                      gint                   w,
+                                                      gint                   h,
+                                                      gdouble                window_scale);
+static void     gimp_display_shell_render_cached     (GimpDisplayShell      *shell,
+                                                      cairo_t               *cr,
+                                                      gint                   x,
+                                                      gint                   y,
+                                                      gint                   w,
+                                                      gint                   h);
+static void     gimp_display_shell_render_coarse     (GimpDisplayShell      *shell,
+                                                      cairo_t               *cr,
+                                                      gint                   x,
+                                                      gint                   y,
+                                                      gint                   w,
+                                                      gint                   h);
+static void     gimp_display_shell_render_tile_area  (GimpDisplayShell      *shell,
+                                                      GimpDisplayRenderTile *tile,
+                                                      const cairo_rectangle_int_t *rect);
+static void     gimp_display_shell_render_queue      (GimpDisplayShell      *shell,
+                                                      const cairo_rectangle_int_t *rect);
+static gboolean gimp_display_shell_render_idle       (GimpDisplayShell      *shell);
+
+static GimpDisplayRenderTile *
+                gimp_display_shell_render_get_tile   (GimpDisplayShell      *shell,
+                                                      gint                   x,
+                                                      gint                   y,
+                                                      gboolean               create);
+static guint    gimp_display_render_tile_hash        (gconstpointer          key);
+static gboolean gimp_display_render_tile_equal       (gconstpointer          a,
+                                                      gconstpointer          b);
+static void     gimp_display_render_tile_free        (GimpDisplayRenderTile *tile);
+
+
+/*  maps linear u16 and u8 to gamma corrected u8  */
+static guint8 render_gamma_u16[65536];
+static guint8 render_gamma_u8[256];
+
+
+static inline gint
+floor_div (gint a,
+           gint b)
+{
+  return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+
+/*  public functions  */
+
 void
 gimp_display_shell_render (GimpDisplayShell *shell,
                            cairo_t          *cr,
@@ -52,30 +190,12 @@ gimp_display_shell_render (GimpDisplayShell *shell,
                            gint              w,
                            gint              h)
 {
-  GimpImage       *image;
-  GimpProjection  *projection;
-  GeglBuffer      *buffer;
-  gdouble          window_scale = 1.0;
-  gint             viewport_offset_x;
-  gint             viewport_offset_y;
-  gint             viewport_width;
-  gint             viewport_height;
-  cairo_surface_t *xfer;
-  gint             src_x;
-  gint             src_y;
-  gint             mask_src_x = 0;
-  gint             mask_src_y = 0;
-  gint             stride;
-  guchar          *data;
+  gdouble window_scale = 1.0;
 
   g_return_if_fail (GIMP_IS_DISPLAY_SHELL (shell));
   g_return_if_fail (cr != NULL);
   g_return_if_fail (w > 0 && h > 0);
 
-  image      = gimp_display_get_image (shell->display);
-  projection = gimp_image_get_projection (image);
-  buffer     = gimp_pickable_get_buffer (GIMP_PICKABLE (projection));
-
 #ifdef GIMP_DISPLAY_RENDER_ENABLE_SCALING
   /* if we had this future API, things would look pretty on hires (retina) */
   window_scale = gdk_window_get_scale_factor (gtk_widget_get_window (gtk_widget_get_toplevel (GTK_WIDGET (shell))));
@@ -83,59 +203,190 @@ gimp_display_shell_render (GimpDisplayShell *shell,
 
   window_scale = MIN (window_scale, GIMP_DISPLAY_RENDER_MAX_SCALE);
 
-  gimp_display_shell_scroll_get_scaled_viewport (shell,
-                                                 &viewport_offset_x,
-                                                 &viewport_offset_y,
-                                                 &viewport_width,
-                                                 &viewport_height);
-  if (shell->rotate_transform)
+  /*  the cache holds plain unrotated pixels at window scale 1.0,
+   *  render everything else directly, the mask overlay is composited
+   *  while converting the projection
+   */
+  if (shell->rotate_transform || window_scale != 1.0 || shell->mask)
     {
-      xfer = cairo_surface_create_similar_image (cairo_get_target (cr),
-                                                 CAIRO_FORMAT_ARGB32,
-                                                 w * window_scale,
-                                                 h * window_scale);
-      cairo_surface_mark_dirty (xfer);
-      src_x = 0;
-      src_y = 0;
+      gimp_display_shell_render_direct (shell, cr, x, y, w, h, window_scale);
     }
   else
     {
-      xfer = gimp_display_xfer_get_surface (shell->xfer,
-                                            w * window_scale,
-                                            h * window_scale,
-                                            &src_x, &src_y);
+      gimp_display_shell_render_cached (shell, cr, x, y, w, h);
     }
+}
 
-  stride = cairo_image_surface_get_stride (xfer);
-  data = cairo_image_surface_get_data (xfer);
-  data += src_y * stride + src_x * 4;
+/**
+ * gimp_display_shell_render_invalidate_full:
+ * @shell: a #GimpDisplayShell
+ *
+ * Drops the whole render cache, of all zoom levels, and cancels
+ * pending refinement. Call this when the rendered pixels change in
+ * ways that are not reported as projection updates, e.g. when the
+ * display filters change.
+ **/
+void
+gimp_display_shell_render_invalidate_full (GimpDisplayShell *shell)
+{
+  g_return_if_fail (GIMP_IS_DISPLAY_SHELL (shell));
 
-  gegl_buffer_get (buffer,
-                   GEGL_RECTANGLE ((x + viewport_offset_x) * window_scale,
-                                   (y + viewport_offset_y) * window_scale,
-                                   w * window_scale,
-                                   h * window_scale),
-                   shell->scale_x * window_scale,
-                   babl_format ("cairo-ARGB32"),
-		   data, stride,
-                   GEGL_ABYSS_NONE);
-
-  /*  apply filters to the rendered projection  */
-  if (shell->filter_stack)
+  if (shell->render_idle_id)
+    {
+      g_source_remove (shell->render_idle_id);
+      shell->render_idle_id = 0;
+    }
+
+  if (shell->render_queue)
+    {
+      cairo_region_destroy (shell->render_queue);
+      shell->render_queue = NULL;
+    }
+
+  if (shell->render_cache)
+    {
+      g_hash_table_unref (shell->render_cache);
+      shell->render_cache = NULL;
+    }
+
+  if (shell->render_cache_lru)
+    {
+      g_queue_free (shell->render_cache_lru);
+      shell->render_cache_lru = NULL;
+    }
+}
+
+/**
+ * gimp_display_shell_render_invalidate_area:
+ * @shell: a #GimpDisplayShell
+ * @x:     x coordinate of the area, in image coordinates
+ * @y:     y coordinate of the area, in image coordinates
+ * @w:     width of the area
+ * @h:     height of the area
+ *
+ * Marks the given image area as outdated in the render cache, at
+ * all zoom levels.
+ **/
+void
+gimp_display_shell_render_invalidate_area (GimpDisplayShell *shell,
+                                           gint              x,
+                                           gint              y,
+                                           gint              w,
+                                           gint              h)
+{
+  GHashTableIter         iter;
+  GimpDisplayRenderTile *tile;
+
+  g_return_if_fail (GIMP_IS_DISPLAY_SHELL (shell));
+
+  if (! shell->render_cache || w <= 0 || h <= 0)
+    return;
+
+  g_hash_table_iter_init (&iter, shell->render_cache);
+
+  while (g_hash_table_iter_next (&iter, (gpointer *) &tile, NULL))
     {
-      cairo_surface_t *image =
-	cairo_image_surface_create_for_data (data, CAIRO_FORMAT_ARGB32,
-					     w * window_scale,
-					     h * window_scale,
-					     stride);
-      gimp_color_display_stack_convert_surface (shell->filter_stack, image);
-      cairo_surface_destroy (image);
+      cairo_rectangle_int_t rect;
+      gint                  x1, y1, x2, y2;
+
+      /*  include one pixel of spill for the scaling filter  */
+      x1 = floor (x       * tile->scale_x) - 1 - tile->x;
+      y1 = floor (y       * tile->scale_y) - 1 - tile->y;
+      x2 = ceil  ((x + w) * tile->scale_x) + 1 - tile->x;
+      y2 = ceil  ((y + h) * tile->scale_y) + 1 - tile->y;
+
+      x1 = MAX (x1, 0);
+      y1 = MAX (y1, 0);
+      x2 = MIN (x2, RENDER_TILE_WIDTH);
+      y2 = MIN (y2, RENDER_TILE_HEIGHT);
+
+      if (x2 > x1 && y2 > y1)
+        {
+          rect.x      = x1;
+          rect.y      = y1;
+          rect.width  = x2 - x1;
+          rect.height = y2 - y1;
+
+          cairo_region_subtract_rectangle (tile->valid, &rect);
+        }
     }
+}
+
+/*  for the SIMD kernels; only valid once the kernels are initialized  */
+const guint8 *
+gimp_display_shell_render_get_gamma_u16 (void)
+{
+  return render_gamma_u16;
+}
+
+
+/*  private functions  */
+
+static void
+gimp_display_shell_render_projection (GimpDisplayShell *shell,
+                                      guchar           *data,
+                                      gint              stride,
+                                      gint              x,
+                                      gint              y,
+                                      gint              w,
+                                      gint              h,
+                                      gdouble           scale,
+                                      gboolean          overlay_mask)
+{
+  GimpImage             *image      = gimp_display_get_image (shell->display);
+  GimpProjection        *projection = gimp_image_get_projection (image);
+  GeglBuffer            *buffer;
+  const Babl            *format;
+  GimpDisplayRenderData  render     = { 0, };
+  gint                   bpp        = 0;
+
+  buffer = gimp_pickable_get_buffer (GIMP_PICKABLE (projection));
+  format = gimp_pickable_get_format (GIMP_PICKABLE (projection));
 
-  if (shell->mask)
+  render.kernel      = gimp_display_shell_render_get_kernel (format,
+                                                             &render.n_components,
+                                                             &bpp);
+  render.dest        = data;
+  render.dest_stride = stride;
+  render.width       = w;
+
+  if (render.kernel)
+    {
+      /*  fetch the projection as it is and convert it ourselves,
+       *  instead of going through babl's generic conversions
+       */
+      gsize size = (gsize) w * h * bpp;
+
+      if (size > shell->render_buf_size)
+        {
+          g_free (shell->render_buf);
+
+          shell->render_buf      = g_malloc (size);
+          shell->render_buf_size = size;
+        }
+
+      render.src        = shell->render_buf;
+      render.src_stride = w * bpp;
+
+      gegl_buffer_get (buffer,
+                       GEGL_RECTANGLE (x, y, w, h),
+                       scale,
+                       format,
+                       shell->render_buf, render.src_stride,
+                       GEGL_ABYSS_NONE);
+    }
+  else
     {
-      gint mask_height;
+      gegl_buffer_get (buffer,
+                       GEGL_RECTANGLE (x, y, w, h),
+                       scale,
+                       babl_format ("cairo-ARGB32"),
+                       data, stride,
+                       GEGL_ABYSS_NONE);
+    }
 
+  if (overlay_mask && shell->mask)
+    {
       if (! shell->mask_surface)
         {
           shell->mask_surface =
@@ -146,39 +397,565 @@ gimp_display_shell_render (GimpDisplayShell *shell,
                                         GIMP_DISPLAY_RENDER_MAX_SCALE);
         }
 
-      cairo_surface_mark_dirty (shell->mask_surface);
-
-      stride = cairo_image_surface_get_stride (shell->mask_surface);
-      data = cairo_image_surface_get_data (shell->mask_surface);
-      data += mask_src_y * stride + mask_src_x * 4;
+      render.mask        = cairo_image_surface_get_data (shell->mask_surface);
+      render.mask_stride = cairo_image_surface_get_stride (shell->mask_surface);
+      render.mask_r      = ROUND (shell->mask_color.r * 255.0);
+      render.mask_g      = ROUND (shell->mask_color.g * 255.0);
+      render.mask_b      = ROUND (shell->mask_color.b * 255.0);
+      render.mask_a      = ROUND (shell->mask_color.a * 255.0);
 
       gegl_buffer_get (shell->mask,
-                       GEGL_RECTANGLE ((x + viewport_offset_x) * window_scale,
-                                       (y + viewport_offset_y) * window_scale,
-                                       w * window_scale,
-                                       h * window_scale),
-                       shell->scale_x * window_scale,
+                       GEGL_RECTANGLE (x, y, w, h),
+                       scale,
                        babl_format ("Y u8"),
-                       data, stride,
+                       (guchar *) render.mask, render.mask_stride,
                        GEGL_ABYSS_NONE);
+    }
+
+  /*  the mask overlay goes on top of the filtered projection, so it can
+   *  only share the conversion pass if there are no filters
+   */
+  if (shell->filter_stack)
+    {
+      const guchar *mask = render.mask;
+
+      render.mask = NULL;
+
+      if (render.kernel)
+        gimp_parallel_distribute_range (h, RENDER_MIN_ROWS,
+                                        (GimpParallelDistributeRangeFunc)
+                                        gimp_display_shell_render_rows,
+                                        &render);
+
+      /*  apply filters to the rendered projection  */
+      {
+        cairo_surface_t *image =
+          cairo_image_surface_create_for_data (data, CAIRO_FORMAT_ARGB32,
+                                               w, h, stride);
+        gimp_display_shell_filter_convert_surface (shell, image);
+        cairo_surface_destroy (image);
+      }
+
+      render.kernel = NULL;
+      render.mask   = mask;
+    }
+
+  if (render.kernel || render.mask)
+    gimp_parallel_distribute_range (h, RENDER_MIN_ROWS,
+                                    (GimpParallelDistributeRangeFunc)
+                                    gimp_display_shell_render_rows,
+                                    &render);
+}
+
+static void   render_kernel_u8_gamma     (const guchar *src,
+                                          guint32      *dest,
+                                          gint          n_components,
+                                          gint          width);
+static void   render_kernel_float_gamma  (const guchar *src,
+                                          guint32      *dest,
+                                          gint          n_components,
+                                          gint          width);
+static void   render_kernel_float_linear (const guchar *src,
+                                          guint32      *dest,
+                                          gint          n_components,
+                                          gint          width);
+
+/*  the kernels used for RGBA, which may be replaced by SIMD versions  */
+static GimpDisplayRenderKernel render_kernel_u8_gamma_rgba     = render_kernel_u8_gamma;
+static GimpDisplayRenderKernel render_kernel_float_gamma_rgba  = render_kernel_float_gamma;
+static GimpDisplayRenderKernel render_kernel_float_linear_rgba = render_kernel_float_linear;
+
+static void
+gimp_display_shell_render_init_kernels (void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized))
+    {
+      guint8 *gamma_u16 = render_gamma_u16;
+      gint    i;
+
+      /*  the sRGB TRC, which is what babl uses for the R'G'B' formats  */
+      for (i = 0; i < 65536; i++)
+        {
+          gdouble v = i / 65535.0;
+
+          if (v <= 0.0031308)
+            v = 12.92 * v;
+          else
+            v = 1.055 * pow (v, 1.0 / 2.4) - 0.055;
+
+          gamma_u16[i] = ROUND (v * 255.0);
+        }
+
+      for (i = 0; i < 256; i++)
+        render_gamma_u8[i] = gamma_u16[i * 257];
+
+#if COMPILE_SSE2_INTRINISICS
+      if (gimp_cpu_accel_get_support () & GIMP_CPU_ACCEL_X86_SSE2)
+        {
+          render_kernel_u8_gamma_rgba     = gimp_display_shell_render_u8_gamma_sse2;
+          render_kernel_float_gamma_rgba  = gimp_display_shell_render_float_gamma_sse2;
+          render_kernel_float_linear_rgba = gimp_display_shell_render_float_linear_sse2;
+        }
+#endif /* COMPILE_SSE2_INTRINISICS */
+
+      g_once_init_leave (&initialized, 1);
+    }
+}
+
+static inline guint32
+render_pack (guint r,
+             guint g,
+             guint b,
+             guint a)
+{
+  guint t;
+
+  if (a != 255)
+    {
+      r = INT_MULT (r, a, t);
+      g = INT_MULT (g, a, t);
+      b = INT_MULT (b, a, t);
+    }
+
+  return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+static inline guint
+render_float_to_u8 (gfloat v)
+{
+  return (guint) (CLAMP (v, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+static inline guint
+render_float_to_u16 (gfloat v)
+{
+  return (guint) (CLAMP (v, 0.0f, 1.0f) * 65535.0f + 0.5f);
+}
+
+static inline guint
+render_u16_to_u8 (guint v)
+{
+  v += 128;
+
+  return (v - (v >> 8)) >> 8;
+}
+
+static inline gfloat
+render_half_to_float (guint16 h)
+{
+  union
+  {
+    guint32 i;
+    gfloat  f;
+  } v;
+
+  guint32 sign     = (guint32) (h & 0x8000) << 16;
+  guint32 exponent = (h >> 10) & 0x1f;
+  guint32 mantissa = h & 0x3ff;
+
+  if (exponent == 0)
+    {
+      /*  zero and subnormals  */
+      v.f  = mantissa * (1.0f / 16777216.0f);
+      v.i |= sign;
+    }
+  else if (exponent == 0x1f)
+    {
+      /*  infinity and NaN  */
+      v.i = sign | 0x7f800000 | (mantissa << 13);
+    }
+  else
+    {
+      v.i = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+
+  return v.f;
+}
+
+/*  the kernels write premultiplied, gamma corrected ARGB32, the color
+ *  components are only read once for grayscale
+ */
+static void
+render_kernel_u8_gamma (const guchar *src,
+                        guint32      *dest,
+                        gint          n_components,
+                        gint          width)
+{
+  if (n_components == 4)
+    {
+      while (width--)
+        {
+          *dest++ = render_pack (src[0], src[1], src[2], src[3]);
+          src += 4;
+        }
+    }
+  else
+    {
+      while (width--)
+        {
+          *dest++ = render_pack (src[0], src[0], src[0], src[1]);
+          src += 2;
+        }
+    }
+}
+
+static void
+render_kernel_u8_linear (const guchar *src,
+                         guint32      *dest,
+                         gint          n_components,
+                         gint          width)
+{
+  const guint8 *gamma = render_gamma_u8;
+
+  if (n_components == 4)
+    {
+      while (width--)
+        {
+          *dest++ = render_pack (gamma[src[0]], gamma[src[1]], gamma[src[2]],
+                                 src[3]);
+          src += 4;
+        }
+    }
+  else
+    {
+      while (width--)
+        {
+          guint y = gamma[src[0]];
+
+          *dest++ = render_pack (y, y, y, src[1]);
+          src += 2;
+        }
+    }
+}
+
+static void
+render_kernel_u16_gamma (const guchar *src,
+                         guint32      *dest,
+                         gint          n_components,
+                         gint          width)
+{
+  const guint16 *s = (const guint16 *) src;
 
-      /* invert the mask so what is *not* the foreground object is masked */
-      mask_height = h * window_scale;
-      while (mask_height--)
+  if (n_components == 4)
+    {
+      while (width--)
         {
-          gint    mask_width = w * window_scale;
-          guchar *d          = data;
+          *dest++ = render_pack (render_u16_to_u8 (s[0]),
+                                 render_u16_to_u8 (s[1]),
+                                 render_u16_to_u8 (s[2]),
+                                 render_u16_to_u8 (s[3]));
+          s += 4;
+        }
+    }
+  else
+    {
+      while (width--)
+        {
+          guint y = render_u16_to_u8 (s[0]);
 
-          while (mask_width--)
+          *dest++ = render_pack (y, y, y, render_u16_to_u8 (s[1]));
+          s += 2;
+        }
+    }
+}
+
+static void
+render_kernel_u16_linear (const guchar *src,
+                          guint32      *dest,
+                          gint          n_components,
+                          gint          width)
+{
+  const guint16 *s     = (const guint16 *) src;
+  const guint8  *gamma = render_gamma_u16;
+
+  if (n_components == 4)
+    {
+      while (width--)
+        {
+          *dest++ = render_pack (gamma[s[0]], gamma[s[1]], gamma[s[2]],
+                                 render_u16_to_u8 (s[3]));
+          s += 4;
+        }
+    }
+  else
+    {
+      while (width--)
+        {
+          guint y = gamma[s[0]];
+
+          *dest++ = render_pack (y, y, y, render_u16_to_u8 (s[1]));
+          s += 2;
+        }
+    }
+}
+
+static void
+render_kernel_float_gamma (const guchar *src,
+                           guint32      *dest,
+                           gint          n_components,
+                           gint          width)
+{
+  const gfloat *s = (const gfloat *) src;
+
+  if (n_components == 4)
+    {
+      while (width--)
+        {
+          *dest++ = render_pack (render_float_to_u8 (s[0]),
+                                 render_float_to_u8 (s[1]),
+                                 render_float_to_u8 (s[2]),
+                                 render_float_to_u8 (s[3]));
+          s += 4;
+        }
+    }
+  else
+    {
+      while (width--)
+        {
+          guint y = render_float_to_u8 (s[0]);
+
+          *dest++ = render_pack (y, y, y, render_float_to_u8 (s[1]));
+          s += 2;
+        }
+    }
+}
+
+static void
+render_kernel_float_linear (const guchar *src,
+                            guint32      *dest,
+                            gint          n_components,
+                            gint          width)
+{
+  const gfloat *s     = (const gfloat *) src;
+  const guint8 *gamma = render_gamma_u16;
+
+  if (n_components == 4)
+    {
+      while (width--)
+        {
+          *dest++ = render_pack (gamma[render_float_to_u16 (s[0])],
+                                 gamma[render_float_to_u16 (s[1])],
+                                 gamma[render_float_to_u16 (s[2])],
+                                 render_float_to_u8 (s[3]));
+          s += 4;
+        }
+    }
+  else
+    {
+      while (width--)
+        {
+          guint y = gamma[render_float_to_u16 (s[0])];
+
+          *dest++ = render_pack (y, y, y, render_float_to_u8 (s[1]));
+          s += 2;
+        }
+    }
+}
+
+/*  half is widened to float in chunks and handed to the float kernels  */
+static inline void
+render_kernel_half (const guchar            *src,
+                    guint32                 *dest,
+                    gint                     n_components,
+                    gint                     width,
+                    GimpDisplayRenderKernel  float_kernel)
+{
+  const guint16 *s = (const guint16 *) src;
+  gfloat         buf[RENDER_HALF_CHUNK * 4];
+
+  while (width > 0)
+    {
+      gint n = MIN (width, RENDER_HALF_CHUNK);
+      gint i;
+
+      for (i = 0; i < n * n_components; i++)
+        buf[i] = render_half_to_float (s[i]);
+
+      float_kernel ((const guchar *) buf, dest, n_components, n);
+
+      s     += n * n_components;
+      dest  += n;
+      width -= n;
+    }
+}
+
+static void
+render_kernel_half_gamma (const guchar *src,
+                          guint32      *dest,
+                          gint          n_components,
+                          gint          width)
+{
+  render_kernel_half (src, dest, n_components, width,
+                      n_components == 4 ?
+                      render_kernel_float_gamma_rgba :
+                      render_kernel_float_gamma);
+}
+
+static void
+render_kernel_half_linear (const guchar *src,
+                           guint32      *dest,
+                           gint          n_components,
+                           gint          width)
+{
+  render_kernel_half (src, dest, n_components, width,
+                      n_components == 4 ?
+                      render_kernel_float_linear_rgba :
+                      render_kernel_float_linear);
+}
+
+static GimpDisplayRenderKernel
+gimp_display_shell_render_get_kernel (const Babl *format,
+                                      gint       *n_components,
+                                      gint       *bpp)
+{
+  GimpDisplayRenderKernel kernel = NULL;
+  gboolean                linear;
+
+  *n_components = babl_format_get_n_components (format);
+  *bpp          = babl_format_get_bytes_per_pixel (format);
+
+  /*  only RGBA and YA, anything else goes through babl  */
+  if (! babl_format_has_alpha (format) ||
+      (*n_components != 4 && *n_components != 2))
+    return NULL;
+
+  gimp_display_shell_render_init_kernels ();
+
+  linear = gimp_babl_format_get_linear (format);
+
+  switch (gimp_babl_format_get_component_type (format))
+    {
+    case GIMP_COMPONENT_TYPE_U8:
+      if (linear)
+        kernel = render_kernel_u8_linear;
+      else if (*n_components == 4)
+        kernel = render_kernel_u8_gamma_rgba;
+      else
+        kernel = render_kernel_u8_gamma;
+      break;
+
+    case GIMP_COMPONENT_TYPE_U16:
+      kernel = linear ? render_kernel_u16_linear : render_kernel_u16_gamma;
+      break;
+
+    case GIMP_COMPONENT_TYPE_HALF:
+      kernel = linear ? render_kernel_half_linear : render_kernel_half_gamma;
+      break;
+
+    case GIMP_COMPONENT_TYPE_FLOAT:
+      if (*n_components == 4)
+        kernel = linear ? render_kernel_float_linear_rgba :
+                          render_kernel_float_gamma_rgba;
+      else
+        kernel = linear ? render_kernel_float_linear :
+                          render_kernel_float_gamma;
+      break;
+
+    default:
+      /*  u32 is rare enough to leave it to babl  */
+      return NULL;
+    }
+
+  return kernel;
+}
+
+static void
+gimp_display_shell_render_rows (gsize                  offset,
+                                gsize                  size,
+                                GimpDisplayRenderData *data)
+{
+  for (; size; size--, offset++)
+    {
+      guint32 *dest = (guint32 *) (data->dest + offset * data->dest_stride);
+
+      if (data->kernel)
+        data->kernel (data->src + offset * data->src_stride,
+                      dest, data->n_components, data->width);
+
+      if (data->mask)
+        {
+          /*  composite the mask color over everything that is *not*
+           *  the foreground object, inverting the mask on the fly
+           */
+          const guchar *m = data->mask + offset * data->mask_stride;
+          gint          x;
+
+          for (x = 0; x < data->width; x++)
             {
-              guchar inv = 255 - *d;
+              guint32 p = dest[x];
+              guint   k, ik, t;
 
-              *d++ = inv;
-            }
+              k  = INT_MULT (255 - m[x], data->mask_a, t);
+              ik = 255 - k;
 
-          data += stride;
+              if (! k)
+                continue;
+
+              dest[x] =
+                ((k + INT_MULT ((p >> 24) & 0xff, ik, t)) << 24)                    |
+                ((INT_MULT (data->mask_r, k, t) + INT_MULT ((p >> 16) & 0xff, ik, t)) << 16) |
+                ((INT_MULT (data->mask_g, k, t) + INT_MULT ((p >>  8) & 0xff, ik, t)) <<  8) |
+                ((INT_MULT (data->mask_b, k, t) + INT_MULT ( p        & 0xff, ik, t)));
+            }
         }
     }
+}
+
+static void
+gimp_display_shell_render_direct (GimpDisplayShell *shell,
+                                  cairo_t          *cr,
+                                  gint              x,
+                                  gint              y,
+                                  gint              w,
+                                  gint              h,
+                                  gdouble           window_scale)
+{
+  gint             viewport_offset_x;
+  gint             viewport_offset_y;
+  gint             viewport_width;
+  gint             viewport_height;
+  cairo_surface_t *xfer;
+  gint             src_x;
+  gint             src_y;
+  gint             stride;
+  guchar          *data;
+
+  gimp_display_shell_scroll_get_scaled_viewport (shell,
+                                                 &viewport_offset_x,
+                                                 &viewport_offset_y,
+                                                 &viewport_width,
+                                                 &viewport_height);
+  if (shell->rotate_transform)
+    {
+      xfer = cairo_surface_create_similar_image (cairo_get_target (cr),
+                                                 CAIRO_FORMAT_ARGB32,
+                                                 w * window_scale,
+                                                 h * window_scale);
+      cairo_surface_mark_dirty (xfer);
+      src_x = 0;
+      src_y = 0;
+    }
+  else
+    {
+      xfer = gimp_display_xfer_get_surface (shell->xfer,
+                                            w * window_scale,
+                                            h * window_scale,
+                                            &src_x, &src_y);
+    }
+
+  stride = cairo_image_surface_get_stride (xfer);
+  data = cairo_image_surface_get_data (xfer);
+  data += src_y * stride + src_x * 4;
+
+  gimp_display_shell_render_projection (shell, data, stride,
+                                        (x + viewport_offset_x) * window_scale,
+                                        (y + viewport_offset_y) * window_scale,
+                                        w * window_scale,
+                                        h * window_scale,
+                                        shell->scale_x * window_scale,
+                                        TRUE);
 
   /*  put it to the screen  */
   cairo_save (cr);
@@ -207,13 +984,380 @@ gimp_display_shell_render (GimpDisplayShell *shell,
   cairo_clip (cr);
   cairo_paint (cr);
 
-  if (shell->mask)
+  cairo_restore (cr);
+}
+
+static void
+gimp_display_shell_render_cached (GimpDisplayShell *shell,
+                                  cairo_t          *cr,
+                                  gint              x,
+                                  gint              y,
+                                  gint              w,
+                                  gint              h)
+{
+  gint zx1 = x + shell->offset_x;
+  gint zy1 = y + shell->offset_y;
+  gint zx2 = zx1 + w;
+  gint zy2 = zy1 + h;
+  gint tx, ty;
+
+  /*  walk all cache tiles touched by the area, which are usually just
+   *  one, because gimp_display_shell_draw_image() aligns its chunks
+   */
+  for (ty = floor_div (zy1, RENDER_TILE_HEIGHT) * RENDER_TILE_HEIGHT;
+       ty < zy2;
+       ty += RENDER_TILE_HEIGHT)
     {
-      gimp_cairo_set_source_rgba (cr, &shell->mask_color);
-      cairo_mask_surface (cr, shell->mask_surface,
-                          (x - mask_src_x) * window_scale,
-                          (y - mask_src_y) * window_scale);
+      for (tx = floor_div (zx1, RENDER_TILE_WIDTH) * RENDER_TILE_WIDTH;
+           tx < zx2;
+           tx += RENDER_TILE_WIDTH)
+        {
+          GimpDisplayRenderTile *tile;
+          cairo_rectangle_int_t  rect;
+          cairo_region_overlap_t overlap = CAIRO_REGION_OVERLAP_OUT;
+
+          rect.x      = MAX (zx1, tx);
+          rect.y      = MAX (zy1, ty);
+          rect.width  = MIN (zx2, tx + RENDER_TILE_WIDTH)  - rect.x;
+          rect.height = MIN (zy2, ty + RENDER_TILE_HEIGHT) - rect.y;
+
+          tile = gimp_display_shell_render_get_tile (shell, tx, ty, FALSE);
+
+          if (tile)
+            {
+              cairo_rectangle_int_t local = rect;
+
+              local.x -= tile->x;
+              local.y -= tile->y;
+
+              overlap = cairo_region_contains_rectangle (tile->valid, &local);
+            }
+
+          if (overlap != CAIRO_REGION_OVERLAP_IN &&
+              shell->scale_x < 1.0                &&
+              (! tile || cairo_region_is_empty (tile->valid)))
+            {
+              /*  nothing of this tile was rendered at this zoom level
+               *  yet, quickly draw it from a coarser mipmap level and
+               *  let the idle render the real thing
+               */
+              gimp_display_shell_render_coarse (shell, cr,
+                                                rect.x - shell->offset_x,
+                                                rect.y - shell->offset_y,
+                                                rect.width,
+                                                rect.height);
+
+              gimp_display_shell_render_queue (shell, &rect);
+
+              continue;
+            }
+
+          if (! tile)
+            tile = gimp_display_shell_render_get_tile (shell, tx, ty, TRUE);
+
+          if (overlap != CAIRO_REGION_OVERLAP_IN)
+            gimp_display_shell_render_tile_area (shell, tile, &rect);
+
+          cairo_save (cr);
+
+          cairo_rectangle (cr,
+                           rect.x - shell->offset_x,
+                           rect.y - shell->offset_y,
+                           rect.width,
+                           rect.height);
+          cairo_clip (cr);
+
+          cairo_set_source_surface (cr, tile->surface,
+                                    tile->x - shell->offset_x,
+                                    tile->y - shell->offset_y);
+          cairo_paint (cr);
+
+          cairo_restore (cr);
+        }
     }
+}
+
+static void
+gimp_display_shell_render_coarse (GimpDisplayShell *shell,
+                                  cairo_t          *cr,
+                                  gint              x,
+                                  gint              y,
+                                  gint              w,
+                                  gint              h)
+{
+  cairo_surface_t *coarse;
+  gint             zx = x + shell->offset_x;
+  gint             zy = y + shell->offset_y;
+  gint             cx1, cy1, cx2, cy2;
+
+  cx1 = floor_div (zx,     RENDER_COARSE_FACTOR);
+  cy1 = floor_div (zy,     RENDER_COARSE_FACTOR);
+  cx2 = floor_div (zx + w + RENDER_COARSE_FACTOR - 1, RENDER_COARSE_FACTOR);
+  cy2 = floor_div (zy + h + RENDER_COARSE_FACTOR - 1, RENDER_COARSE_FACTOR);
+
+  coarse = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                       cx2 - cx1, cy2 - cy1);
+
+  cairo_surface_flush (coarse);
+
+  gimp_display_shell_render_projection (shell,
+                                        cairo_image_surface_get_data (coarse),
+                                        cairo_image_surface_get_stride (coarse),
+                                        cx1, cy1, cx2 - cx1, cy2 - cy1,
+                                        shell->scale_x / RENDER_COARSE_FACTOR,
+                                        FALSE);
+
+  cairo_surface_mark_dirty (coarse);
+
+  cairo_save (cr);
+
+  cairo_rectangle (cr, x, y, w, h);
+  cairo_clip (cr);
+
+  cairo_translate (cr,
+                   cx1 * RENDER_COARSE_FACTOR - shell->offset_x,
+                   cy1 * RENDER_COARSE_FACTOR - shell->offset_y);
+  cairo_scale (cr, RENDER_COARSE_FACTOR, RENDER_COARSE_FACTOR);
+
+  cairo_set_source_surface (cr, coarse, 0, 0);
+  cairo_pattern_set_extend (cairo_get_source (cr), CAIRO_EXTEND_PAD);
+  cairo_paint (cr);
 
   cairo_restore (cr);
+
+  cairo_surface_destroy (coarse);
+}
+
+static void
+gimp_display_shell_render_tile_area (GimpDisplayShell            *shell,
+                                     GimpDisplayRenderTile       *tile,
+                                     const cairo_rectangle_int_t *rect)
+{
+  cairo_rectangle_int_t  local = *rect;
+  cairo_region_t        *missing;
+  gint                   stride;
+  guchar                *data;
+  gint                   n_rects;
+  gint                   i;
+
+  local.x -= tile->x;
+  local.y -= tile->y;
+
+  /*  only render what is not valid yet  */
+  missing = cairo_region_create_rectangle (&local);
+  cairo_region_subtract (missing, tile->valid);
+
+  cairo_surface_flush (tile->surface);
+
+  stride = cairo_image_surface_get_stride (tile->surface);
+  data   = cairo_image_surface_get_data (tile->surface);
+
+  n_rects = cairo_region_num_rectangles (missing);
+
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t r;
+
+      cairo_region_get_rectangle (missing, i, &r);
+
+      gimp_display_shell_render_projection (shell,
+                                            data + r.y * stride + r.x * 4,
+                                            stride,
+                                            tile->x + r.x,
+                                            tile->y + r.y,
+                                            r.width,
+                                            r.height,
+                                            tile->scale_x,
+                                            FALSE);
+
+      cairo_surface_mark_dirty_rectangle (tile->surface,
+                                          r.x, r.y, r.width, r.height);
+    }
+
+  cairo_region_union (tile->valid, missing);
+  cairo_region_destroy (missing);
+}
+
+static void
+gimp_display_shell_render_queue (GimpDisplayShell            *shell,
+                                 const cairo_rectangle_int_t *rect)
+{
+  if (shell->render_queue &&
+      (shell->render_queue_scale_x != shell->scale_x ||
+       shell->render_queue_scale_y != shell->scale_y))
+    {
+      cairo_region_destroy (shell->render_queue);
+      shell->render_queue = NULL;
+    }
+
+  if (! shell->render_queue)
+    {
+      shell->render_queue         = cairo_region_create ();
+      shell->render_queue_scale_x = shell->scale_x;
+      shell->render_queue_scale_y = shell->scale_y;
+    }
+
+  cairo_region_union_rectangle (shell->render_queue, rect);
+
+  if (! shell->render_idle_id)
+    {
+      shell->render_idle_id =
+        g_idle_add_full (G_PRIORITY_LOW,
+                         (GSourceFunc) gimp_display_shell_render_idle,
+                         shell, NULL);
+    }
+}
+
+static gboolean
+gimp_display_shell_render_idle (GimpDisplayShell *shell)
+{
+  gint64 end_time = g_get_monotonic_time () + RENDER_IDLE_TIME;
+
+  /*  the queue is in zoomed coordinates and useless after zooming  */
+  if (shell->render_queue_scale_x != shell->scale_x ||
+      shell->render_queue_scale_y != shell->scale_y)
+    {
+      cairo_region_destroy (shell->render_queue);
+      shell->render_queue = NULL;
+    }
+
+  while (shell->render_queue &&
+         ! cairo_region_is_empty (shell->render_queue))
+    {
+      GimpDisplayRenderTile *tile;
+      cairo_rectangle_int_t  rect;
+      gint                   tx, ty;
+
+      cairo_region_get_rectangle (shell->render_queue, 0, &rect);
+
+      tx = floor_div (rect.x, RENDER_TILE_WIDTH)  * RENDER_TILE_WIDTH;
+      ty = floor_div (rect.y, RENDER_TILE_HEIGHT) * RENDER_TILE_HEIGHT;
+
+      rect.width  = MIN (rect.x + rect.width,  tx + RENDER_TILE_WIDTH)  - rect.x;
+      rect.height = MIN (rect.y + rect.height, ty + RENDER_TILE_HEIGHT) - rect.y;
+
+      tile = gimp_display_shell_render_get_tile (shell, tx, ty, TRUE);
+
+      gimp_display_shell_render_tile_area (shell, tile, &rect);
+
+      cairo_region_subtract_rectangle (shell->render_queue, &rect);
+
+      /*  the expose paints straight from the cache now  */
+      gimp_display_shell_expose_area (shell,
+                                      rect.x - shell->offset_x,
+                                      rect.y - shell->offset_y,
+                                      rect.width,
+                                      rect.height);
+
+      if (g_get_monotonic_time () >= end_time)
+        return TRUE;
+    }
+
+  if (shell->render_queue)
+    {
+      cairo_region_destroy (shell->render_queue);
+      shell->render_queue = NULL;
+    }
+
+  shell->render_idle_id = 0;
+
+  return FALSE;
+}
+
+static GimpDisplayRenderTile *
+gimp_display_shell_render_get_tile (GimpDisplayShell *shell,
+                                    gint              x,
+                                    gint              y,
+                                    gboolean          create)
+{
+  GimpDisplayRenderTile  key  = { 0, };
+  GimpDisplayRenderTile *tile = NULL;
+
+  key.scale_x = shell->scale_x;
+  key.scale_y = shell->scale_y;
+  key.x       = x;
+  key.y       = y;
+
+  if (shell->render_cache)
+    tile = g_hash_table_lookup (shell->render_cache, &key);
+
+  if (tile)
+    {
+      /*  move to the front of the LRU queue  */
+      g_queue_unlink (shell->render_cache_lru, tile->link);
+      g_queue_push_head_link (shell->render_cache_lru, tile->link);
+
+      return tile;
+    }
+
+  if (! create)
+    return NULL;
+
+  if (! shell->render_cache)
+    {
+      shell->render_cache =
+        g_hash_table_new_full (gimp_display_render_tile_hash,
+                               gimp_display_render_tile_equal,
+                               (GDestroyNotify) gimp_display_render_tile_free,
+                               NULL);
+      shell->render_cache_lru = g_queue_new ();
+    }
+
+  /*  evict the least recently used tiles, of any zoom level  */
+  while (g_queue_get_length (shell->render_cache_lru) >=
+         RENDER_CACHE_MAX_TILES)
+    {
+      GimpDisplayRenderTile *old = g_queue_pop_tail (shell->render_cache_lru);
+
+      old->link = NULL;
+      g_hash_table_remove (shell->render_cache, old);
+    }
+
+  tile = g_slice_new0 (GimpDisplayRenderTile);
+
+  *tile = key;
+
+  tile->surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                              RENDER_TILE_WIDTH,
+                                              RENDER_TILE_HEIGHT);
+  tile->valid   = cairo_region_create ();
+
+  g_queue_push_head (shell->render_cache_lru, tile);
+  tile->link = g_queue_peek_head_link (shell->render_cache_lru);
+
+  g_hash_table_insert (shell->render_cache, tile, tile);
+
+  return tile;
+}
+
+static guint
+gimp_display_render_tile_hash (gconstpointer key)
+{
+  const GimpDisplayRenderTile *tile = key;
+
+  return (g_double_hash (&tile->scale_x) ^
+          (guint) tile->x * 7919u            ^
+          (guint) tile->y * 104729u);
+}
+
+static gboolean
+gimp_display_render_tile_equal (gconstpointer a,
+                                gconstpointer b)
+{
+  const GimpDisplayRenderTile *tile_a = a;
+  const GimpDisplayRenderTile *tile_b = b;
+
+  return (tile_a->scale_x == tile_b->scale_x &&
+          tile_a->scale_y == tile_b->scale_y &&
+          tile_a->x       == tile_b->x       &&
+          tile_a->y       == tile_b->y);
+}
+
+static void
+gimp_display_render_tile_free (GimpDisplayRenderTile *tile)
+{
+  cairo_surface_destroy (tile->surface);
+  cairo_region_destroy (tile->valid);
+
+  g_slice_free (GimpDisplayRenderTile, tile);
 }
@@ -25,4 +25,37 @@ void  gimp_display_shell_render (GimpDisplayShell *shell,
                                  gint              w,
                                  gint              h);
 
+void  gimp_display_shell_render_invalidate_full (GimpDisplayShell *shell);
+void  gimp_display_shell_render_invalidate_area (GimpDisplayShell *shell,
+                                                 gint              x,
+                                                 gint              y,
+                                                 gint              w,
+                                                 gint              h);
+
+
+/*  the conversion kernels, private to gimpdisplayshell-render*.c; they
+ *  write @width pixels of premultiplied, gamma corrected ARGB32
+ */
+
+typedef void (* GimpDisplayRenderKernel) (const guchar *src,
+                                          guint32      *dest,
+                                          gint          n_components,
+                                          gint          width);
+
+/*  maps linear u16 to gamma corrected u8  */
+const guint8 * gimp_display_shell_render_get_gamma_u16     (void);
+
+void  gimp_display_shell_render_u8_gamma_sse2     (const guchar *src,
+                                                   guint32      *dest,
+                                                   gint          n_components,
+                                                   gint          width);
+void  gimp_display_shell_render_float_gamma_sse2  (const guchar *src,
+                                                   guint32      *dest,
+                                                   gint          n_components,
+                                                   gint          width);
+void  gimp_display_shell_render_float_linear_sse2 (const guchar *src,
+                                                   guint32      *dest,
+                                                   gint          n_components,
+                                                   gint          width);
+
 #endif  /*  __GIMP_DISPLAY_SHELL_RENDER_H__  */
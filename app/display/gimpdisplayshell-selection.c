@@ -20,6 +20,8 @@
 #include <gegl.h>
 #include <gtk/gtk.h>
 
+#include "libgimpmath/gimpmath.h"
+
 #include "display-types.h"
 
 #include "config/gimpdisplayconfig.h"
@@ -39,22 +41,44 @@
 #include "gimpdisplayshell-transform.h"
 
 
-struct _Selection
-{
-  GimpDisplayShell *shell;            /*  shell that owns the selection     */
-
-  GimpSegment      *segs_in;          /*  gdk segments of area boundary     */
-  gint              n_segs_in;        /*  number of segments in segs_in     */
+/*  margin around the window covered by the rendered marching ants, so
+ *  that scrolling by less than this doesn't require a re-render
+ */
+#define MASK_MARGIN 128
 
-  GimpSegment      *segs_out;         /*  gdk segments of area boundary     */
-  gint              n_segs_out;       /*  number of segments in segs_out    */
 
-  guint             index;            /*  index of current stipple pattern  */
-  gint              paused;           /*  count of pause requests           */
-  gboolean          shell_visible;    /*  visility of the display shell     */
-  gboolean          show_selection;   /*  is the selection visible?         */
-  guint             timeout;          /*  timer for successive draws        */
-  cairo_pattern_t  *segs_in_mask;     /*  cache for rendered segments       */
+struct _Selection
+{
+  GimpDisplayShell   *shell;          /*  shell that owns the selection     */
+
+  const GimpBoundSeg *bound_segs_in;  /*  boundary the indices were built   */
+  const GimpBoundSeg *bound_segs_out; /*  from, owned by the mask           */
+  gint                n_bound_segs_in;
+  gint                n_bound_segs_out;
+  GimpBoundIndex     *index_in;       /*  spatial index of bound_segs_in    */
+  GimpBoundIndex     *index_out;      /*  spatial index of bound_segs_out   */
+  gint               *visible;        /*  scratch space for index queries   */
+
+  GimpSegment        *segs_in;        /*  gdk segments of area boundary     */
+  gint                n_segs_in;      /*  number of segments in segs_in     */
+
+  GimpSegment        *segs_out;       /*  gdk segments of area boundary     */
+  gint                n_segs_out;     /*  number of segments in segs_out    */
+
+  guint               index;          /*  index of current stipple pattern  */
+  gint                paused;         /*  count of pause requests           */
+  gboolean            shell_visible;  /*  visility of the display shell     */
+  gboolean            show_selection; /*  is the selection visible?         */
+  guint               timeout;        /*  timer for successive draws        */
+  cairo_pattern_t    *segs_in_mask;   /*  cache for rendered segments       */
+
+  gdouble             mask_scale_x;   /*  zoom level the mask was rendered  */
+  gdouble             mask_scale_y;   /*  at                                */
+  gdouble             mask_rotate_angle;
+  gint                mask_offset_x;  /*  scroll offset the mask was        */
+  gint                mask_offset_y;  /*  rendered at                       */
+  gint                mask_width;     /*  window size the mask was          */
+  gint                mask_height;    /*  rendered for                      */
 };
 
 
@@ -67,13 +91,16 @@ static void      selection_draw           (Selection          *selection);
 static void      selection_undraw         (Selection          *selection);
 
 static void      selection_render_mask    (Selection          *selection);
+static gboolean  selection_mask_valid     (Selection          *selection);
 
-static void      selection_zoom_segs      (Selection          *selection,
+static gint      selection_zoom_segs      (Selection          *selection,
                                            const GimpBoundSeg *src_segs,
-                                           GimpSegment        *dest_segs,
-                                           gint                n_segs);
+                                           GimpBoundIndex     *index,
+                                           gint                margin,
+                                           GimpSegment        *dest_segs);
 static void      selection_generate_segs  (Selection          *selection);
 static void      selection_free_segs      (Selection          *selection);
+static void      selection_free_index     (Selection          *selection);
 
 static gboolean  selection_start_timeout  (Selection          *selection);
 static gboolean  selection_timeout        (Selection          *selection);
@@ -132,6 +159,7 @@ gimp_display_shell_selection_free (GimpDisplayShell *shell)
                                         selection);
 
   selection_free_segs (selection);
+  selection_free_index (selection);
 
   g_slice_free (Selection, selection);
 
@@ -144,6 +172,10 @@ gimp_display_shell_selection_undraw (GimpDisplayShell *shell)
   g_return_if_fail (GIMP_IS_DISPLAY_SHELL (shell));
   g_return_if_fail (shell->selection != NULL);
 
+  /*  the boundary is about to change, forget everything derived from it  */
+  selection_free_segs (shell->selection);
+  selection_free_index (shell->selection);
+
   if (gimp_display_get_image (shell->display))
     {
       selection_undraw (shell->selection);
@@ -151,7 +183,6 @@ gimp_display_shell_selection_undraw (GimpDisplayShell *shell)
   else
     {
       selection_stop (shell->selection);
-      selection_free_segs (shell->selection);
     }
 }
 
@@ -248,13 +279,23 @@ selection_stop (Selection *selection)
 static void
 selection_draw (Selection *selection)
 {
-  if (selection->segs_in)
+  if (selection->segs_in_mask)
     {
-      cairo_t *cr;
+      GimpDisplayShell *shell = selection->shell;
+      cairo_matrix_t    matrix;
+      cairo_t          *cr;
 
-      cr = gdk_cairo_create (gtk_widget_get_window (selection->shell->canvas));
+      /*  the mask may have been rendered at a different scroll offset  */
+      cairo_matrix_init_translate (&matrix,
+                                   MASK_MARGIN +
+                                   shell->offset_x - selection->mask_offset_x,
+                                   MASK_MARGIN +
+                                   shell->offset_y - selection->mask_offset_y);
+      cairo_pattern_set_matrix (selection->segs_in_mask, &matrix);
 
-      gimp_display_shell_draw_selection_in (selection->shell, cr,
+      cr = gdk_cairo_create (gtk_widget_get_window (shell->canvas));
+
+      gimp_display_shell_draw_selection_in (shell, cr,
                                             selection->segs_in_mask,
                                             selection->index % 8);
 
@@ -284,21 +325,26 @@ selection_undraw (Selection *selection)
 static void
 selection_render_mask (Selection *selection)
 {
-  GdkWindow       *window;
-  cairo_surface_t *surface;
-  cairo_t         *cr;
+  GimpDisplayShell *shell = selection->shell;
+  GdkWindow        *window;
+  cairo_surface_t  *surface;
+  cairo_t          *cr;
 
-  window = gtk_widget_get_window (selection->shell->canvas);
+  window = gtk_widget_get_window (shell->canvas);
   surface = gdk_window_create_similar_surface (window, CAIRO_CONTENT_ALPHA,
-                                               gdk_window_get_width  (window),
-                                               gdk_window_get_height (window));
+                                               gdk_window_get_width  (window) +
+                                               2 * MASK_MARGIN,
+                                               gdk_window_get_height (window) +
+                                               2 * MASK_MARGIN);
   cr = cairo_create (surface);
 
   cairo_set_line_cap (cr, CAIRO_LINE_CAP_SQUARE);
   cairo_set_line_width (cr, 1.0);
 
-  if (selection->shell->rotate_transform)
-    cairo_transform (cr, selection->shell->rotate_transform);
+  cairo_translate (cr, MASK_MARGIN, MASK_MARGIN);
+
+  if (shell->rotate_transform)
+    cairo_transform (cr, shell->rotate_transform);
 
   gimp_cairo_add_segments (cr,
                            selection->segs_in,
@@ -307,52 +353,110 @@ selection_render_mask (Selection *selection)
 
   selection->segs_in_mask = cairo_pattern_create_for_surface (surface);
 
+  selection->mask_scale_x      = shell->scale_x;
+  selection->mask_scale_y      = shell->scale_y;
+  selection->mask_rotate_angle = shell->rotate_angle;
+  selection->mask_offset_x     = shell->offset_x;
+  selection->mask_offset_y     = shell->offset_y;
+  selection->mask_width        = shell->disp_width;
+  selection->mask_height       = shell->disp_height;
+
   cairo_destroy (cr);
   cairo_surface_destroy (surface);
 }
 
-static void
+static gboolean
+selection_mask_valid (Selection *selection)
+{
+  GimpDisplayShell *shell = selection->shell;
+
+  /*  scrolling shifts the whole display, rotation included, so the
+   *  rendered mask stays usable as long as the window doesn't leave
+   *  its margin
+   */
+  return (selection->segs_in_mask                              &&
+          selection->mask_scale_x      == shell->scale_x       &&
+          selection->mask_scale_y      == shell->scale_y       &&
+          selection->mask_rotate_angle == shell->rotate_angle  &&
+          selection->mask_width        == shell->disp_width    &&
+          selection->mask_height       == shell->disp_height   &&
+          ABS (shell->offset_x - selection->mask_offset_x) <= MASK_MARGIN &&
+          ABS (shell->offset_y - selection->mask_offset_y) <= MASK_MARGIN);
+}
+
+static gint
 selection_zoom_segs (Selection          *selection,
                      const GimpBoundSeg *src_segs,
-                     GimpSegment        *dest_segs,
-                     gint                n_segs)
+                     GimpBoundIndex     *index,
+                     gint                margin,
+                     GimpSegment        *dest_segs)
 {
-  const gint xclamp = selection->shell->disp_width + 1;
-  const gint yclamp = selection->shell->disp_height + 1;
-  gint       i;
+  GimpDisplayShell *shell = selection->shell;
+  GeglRectangle     rect;
+  gdouble           x1, y1, x2, y2;
+  gint              xmin, ymin;
+  gint              xmax, ymax;
+  gint              n_segs;
+  gint              i;
+
+  /*  find the part of the window, plus margin, in unrotated display
+   *  coordinates, and only look at the segments within it
+   */
+  gimp_display_shell_unrotate_bounds (shell,
+                                      -margin, -margin,
+                                      shell->disp_width  + margin,
+                                      shell->disp_height + margin,
+                                      &x1, &y1, &x2, &y2);
+
+  xmin = floor (x1) - 1;
+  ymin = floor (y1) - 1;
+  xmax = ceil (x2) + 1;
+  ymax = ceil (y2) + 1;
 
-  gimp_display_shell_zoom_segments (selection->shell,
-                                    src_segs, dest_segs, n_segs,
-                                    0.0, 0.0);
+  rect.x      = floor ((xmin + shell->offset_x) / shell->scale_x) - 1;
+  rect.y      = floor ((ymin + shell->offset_y) / shell->scale_y) - 1;
+  rect.width  = ceil ((xmax + shell->offset_x) / shell->scale_x) + 1 - rect.x;
+  rect.height = ceil ((ymax + shell->offset_y) / shell->scale_y) + 1 - rect.y;
+
+  n_segs = gimp_boundary_index_query (index, &rect, selection->visible);
 
   for (i = 0; i < n_segs; i++)
     {
-      dest_segs[i].x1 = CLAMP (dest_segs[i].x1, -1, xclamp);
-      dest_segs[i].y1 = CLAMP (dest_segs[i].y1, -1, yclamp);
+      const GimpBoundSeg *src_seg  = &src_segs[selection->visible[i]];
+      GimpSegment        *dest_seg = &dest_segs[i];
+
+      gimp_display_shell_zoom_segments (shell,
+                                        src_seg, dest_seg, 1,
+                                        0.0, 0.0);
 
-      dest_segs[i].x2 = CLAMP (dest_segs[i].x2, -1, xclamp);
-      dest_segs[i].y2 = CLAMP (dest_segs[i].y2, -1, yclamp);
+      dest_seg->x1 = CLAMP (dest_seg->x1, xmin, xmax);
+      dest_seg->y1 = CLAMP (dest_seg->y1, ymin, ymax);
+
+      dest_seg->x2 = CLAMP (dest_seg->x2, xmin, xmax);
+      dest_seg->y2 = CLAMP (dest_seg->y2, ymin, ymax);
 
       /*  If this segment is a closing segment && the segments lie inside
        *  the region, OR if this is an opening segment and the segments
        *  lie outside the region...
        *  we need to transform it by one display pixel
        */
-      if (! src_segs[i].open)
+      if (! src_seg->open)
         {
           /*  If it is vertical  */
-          if (dest_segs[i].x1 == dest_segs[i].x2)
+          if (dest_seg->x1 == dest_seg->x2)
             {
-              dest_segs[i].x1 -= 1;
-              dest_segs[i].x2 -= 1;
+              dest_seg->x1 -= 1;
+              dest_seg->x2 -= 1;
             }
           else
             {
-              dest_segs[i].y1 -= 1;
-              dest_segs[i].y2 -= 1;
+              dest_seg->y1 -= 1;
+              dest_seg->y2 -= 1;
             }
         }
     }
+
+  return n_segs;
 }
 
 static void
@@ -361,38 +465,65 @@ selection_generate_segs (Selection *selection)
   GimpImage          *image = gimp_display_get_image (selection->shell->display);
   const GimpBoundSeg *segs_in;
   const GimpBoundSeg *segs_out;
+  gint                n_segs_in;
+  gint                n_segs_out;
 
   /*  Ask the image for the boundary of its selected region...
-   *  Then transform that information into a new buffer of GimpSegments
+   *  Then transform the visible part of it into GimpSegments
    */
   gimp_channel_boundary (gimp_image_get_mask (image),
                          &segs_in, &segs_out,
-                         &selection->n_segs_in, &selection->n_segs_out,
+                         &n_segs_in, &n_segs_out,
                          0, 0, 0, 0);
 
-  if (selection->n_segs_in)
+  if (segs_in         != selection->bound_segs_in    ||
+      segs_out        != selection->bound_segs_out   ||
+      n_segs_in       != selection->n_bound_segs_in  ||
+      n_segs_out      != selection->n_bound_segs_out ||
+      ! selection->index_in)
     {
-      selection->segs_in = g_new (GimpSegment, selection->n_segs_in);
-      selection_zoom_segs (selection, segs_in,
-                           selection->segs_in, selection->n_segs_in);
+      selection_free_segs (selection);
+      selection_free_index (selection);
 
-      selection_render_mask (selection);
-    }
-  else
-    {
-      selection->segs_in = NULL;
+      selection->bound_segs_in    = segs_in;
+      selection->bound_segs_out   = segs_out;
+      selection->n_bound_segs_in  = n_segs_in;
+      selection->n_bound_segs_out = n_segs_out;
+
+      selection->index_in  = gimp_boundary_index_new (segs_in,  n_segs_in);
+      selection->index_out = gimp_boundary_index_new (segs_out, n_segs_out);
+
+      selection->visible = g_new (gint, MAX (n_segs_in, n_segs_out));
+
+      selection->segs_in  = g_new (GimpSegment, n_segs_in);
+      selection->segs_out = g_new (GimpSegment, n_segs_out);
     }
 
-  /*  Possible secondary boundary representation  */
-  if (selection->n_segs_out)
+  if (n_segs_in && ! selection_mask_valid (selection))
     {
-      selection->segs_out = g_new (GimpSegment, selection->n_segs_out);
-      selection_zoom_segs (selection, segs_out,
-                           selection->segs_out, selection->n_segs_out);
+      if (selection->segs_in_mask)
+        {
+          cairo_pattern_destroy (selection->segs_in_mask);
+          selection->segs_in_mask = NULL;
+        }
+
+      selection->n_segs_in = selection_zoom_segs (selection, segs_in,
+                                                  selection->index_in,
+                                                  MASK_MARGIN,
+                                                  selection->segs_in);
+
+      selection_render_mask (selection);
     }
-  else
+
+  /*  Possible secondary boundary representation, this is drawn only
+   *  once per (re)start, so there is no need to look past the window
+   */
+  if (n_segs_out)
     {
-      selection->segs_out = NULL;
+      selection->n_segs_out = selection_zoom_segs (selection, segs_out,
+                                                   selection->index_out,
+                                                   0,
+                                                   selection->segs_out);
     }
 }
 
@@ -420,14 +551,45 @@ selection_free_segs (Selection *selection)
     }
 }
 
+static void
+selection_free_index (Selection *selection)
+{
+  if (selection->index_in)
+    {
+      gimp_boundary_index_free (selection->index_in);
+      selection->index_in = NULL;
+    }
+
+  if (selection->index_out)
+    {
+      gimp_boundary_index_free (selection->index_out);
+      selection->index_out = NULL;
+    }
+
+  if (selection->visible)
+    {
+      g_free (selection->visible);
+      selection->visible = NULL;
+    }
+
+  selection->bound_segs_in    = NULL;
+  selection->bound_segs_out   = NULL;
+  selection->n_bound_segs_in  = 0;
+  selection->n_bound_segs_out = 0;
+}
+
 static gboolean
 selection_start_timeout (Selection *selection)
 {
-  selection_free_segs (selection);
   selection->timeout = 0;
 
   if (! gimp_display_get_image (selection->shell->display))
-    return FALSE;
+    {
+      selection_free_segs (selection);
+      selection_free_index (selection);
+
+      return FALSE;
+    }
 
   selection_generate_segs (selection);
 
@@ -440,7 +602,7 @@ selection_start_timeout (Selection *selection)
 
       selection_draw (selection);
 
-      if (selection->segs_out)
+      if (selection->n_segs_out)
         {
           cairo_t *cr;
 
@@ -456,7 +618,7 @@ selection_start_timeout (Selection *selection)
           cairo_destroy (cr);
         }
 
-      if (selection->segs_in && selection->shell_visible)
+      if (selection->segs_in_mask && selection->shell_visible)
         selection->timeout = g_timeout_add_full (G_PRIORITY_DEFAULT_IDLE,
                                                  config->marching_ants_speed,
                                                  (GSourceFunc) selection_timeout,
@@ -785,12 +785,21 @@ gimp_display_shell_dispose (GObject *object)
       shell->filter_idle_id = 0;
     }
 
+  gimp_display_shell_render_invalidate_full (shell);
+
   if (shell->mask_surface)
     {
       cairo_surface_destroy (shell->mask_surface);
       shell->mask_surface = NULL;
     }
 
+  if (shell->render_buf)
+    {
+      g_free (shell->render_buf);
+      shell->render_buf      = NULL;
+      shell->render_buf_size = 0;
+    }
+
   if (shell->checkerboard)
     {
       cairo_pattern_destroy (shell->checkerboard);
@@ -1296,6 +1305,7 @@ gimp_display_shell_reconnect (GimpDisplayShell *shell)
 
   gimp_display_shell_scaled (shell);
 
+  gimp_display_shell_render_invalidate_full (shell);
   gimp_display_shell_expose_full (shell);
 }
 
@@ -1335,6 +1345,7 @@ gimp_display_shell_empty (GimpDisplayShell *shell)
   shell->rotate_angle = 0.0;
   gimp_display_shell_rotate_update_transform (shell);
 
+  gimp_display_shell_render_invalidate_full (shell);
   gimp_display_shell_expose_full (shell);
 
   user_context = gimp_get_user_context (shell->display->gimp);
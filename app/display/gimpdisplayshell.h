@@ -110,8 +110,17 @@ struct _GimpDisplayShell
 
   GimpDisplayXfer   *xfer;             /*  managers image buffer transfers    */
   cairo_surface_t   *mask_surface;     /*  buffer for rendering the mask      */
+  guchar            *render_buf;       /*  unconverted projection pixels      */
+  gsize              render_buf_size;
   cairo_pattern_t   *checkerboard;     /*  checkerboard pattern               */
 
+  GHashTable        *render_cache;     /*  rendered projection tiles          */
+  GQueue            *render_cache_lru; /*  the same tiles, most recent first  */
+  cairo_region_t    *render_queue;     /*  area queued for refinement         */
+  gdouble            render_queue_scale_x;
+  gdouble            render_queue_scale_y;
+  guint              render_idle_id;   /*  refinement idle ID                 */
+
   GimpCanvasItem    *canvas_item;      /*  items drawn on the canvas          */
   GimpCanvasItem    *unrotated_item;   /*  unrotated items for e.g. cursor    */
   GimpCanvasItem    *passe_partout;    /*  item for the highlight             */
@@ -151,6 +160,8 @@ struct _GimpDisplayShell
 
   GimpColorDisplayStack *filter_stack;   /* color display conversion stuff    */
   guint                  filter_idle_id;
+  guint8                *filter_lut;     /* sampled filter stack, or NULL     */
+  gboolean               filter_lut_valid;
   GtkWidget             *filters_dialog; /* color display filter dialog       */
 
   gint               paused_count;
@@ -23,9 +23,13 @@
 #include "config.h"
 
 #include <gegl.h>
+#include <gegl-plugin.h>
+
+#include "libgimpmath/gimpmath.h"
 
 #include "gimp-gegl-types.h"
 
+#include "core/gimp-parallel.h"
 #include "core/gimp-utils.h"
 #include "core/gimpprogress.h"
 
@@ -34,6 +38,58 @@
 #include "gegl/gimp-gegl-utils.h"
 
 
+/*  the size of the work units the destination is split into, rounded
+ *  up to whole tiles
+ */
+#define APPLY_UNIT_WIDTH  256
+#define APPLY_UNIT_HEIGHT 256
+
+
+typedef struct
+{
+  GeglNode      *operation;
+  GeglBuffer    *src_buffer;
+  GeglBuffer    *dest_buffer;
+  GeglNode      *dest_node;
+
+  GeglRectangle  rect;
+  gint           unit_width;
+  gint           unit_height;
+  gint           n_units_x;
+  gint           n_units;
+
+  GimpProgress  *progress;
+  gboolean       cancelable;
+
+  gint           next_unit;
+  gint           n_done;
+  gint           cancelled;
+} ApplyOperationData;
+
+
+static gboolean   gimp_gegl_apply_operation_real      (GeglBuffer          *src_buffer,
+                                                       GimpProgress        *progress,
+                                                       const gchar         *undo_desc,
+                                                       GeglNode            *operation,
+                                                       GeglBuffer          *dest_buffer,
+                                                       const GeglRectangle *dest_rect,
+                                                       gboolean             cancelable);
+static void       gimp_gegl_apply_operation_func      (gint                 i,
+                                                       gint                 n,
+                                                       ApplyOperationData  *data);
+static gboolean   gimp_gegl_apply_operation_next_unit (ApplyOperationData  *data,
+                                                       GeglNode            *dest_node);
+static gboolean   gimp_gegl_apply_operation_can_clone (GeglNode            *operation,
+                                                       const GeglRectangle *rect);
+static GeglNode * gimp_gegl_apply_operation_clone     (GeglNode            *operation);
+static GeglBuffer * gimp_gegl_apply_operation_copy    (GeglBuffer          *buffer,
+                                                       const GeglRectangle *rect);
+static void       gimp_gegl_apply_operation_cancel    (GimpProgress        *progress,
+                                                       ApplyOperationData  *data);
+
+
+/*  public functions  */
+
 void
 gimp_gegl_apply_operation (GeglBuffer          *src_buffer,
                            GimpProgress        *progress,
@@ -42,97 +98,49 @@ gimp_gegl_apply_operation (GeglBuffer          *src_buffer,
                            GeglBuffer          *dest_buffer,
                            const GeglRectangle *dest_rect)
 {
-  GeglNode      *gegl;
-  GeglNode      *dest_node;
-  GeglRectangle  rect = { 0, };
-  gdouble        value;
-  gboolean       progress_active = FALSE;
-
   g_return_if_fail (src_buffer == NULL || GEGL_IS_BUFFER (src_buffer));
   g_return_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress));
   g_return_if_fail (GEGL_IS_NODE (operation));
   g_return_if_fail (GEGL_IS_BUFFER (dest_buffer));
 
-  if (dest_rect)
-    {
-      rect = *dest_rect;
-    }
-  else
-    {
-      rect = *GEGL_RECTANGLE (0, 0, gegl_buffer_get_width  (dest_buffer),
-                                    gegl_buffer_get_height (dest_buffer));
-    }
-
-  gegl = gegl_node_new ();
-
-  if (! gegl_node_get_parent (operation))
-    gegl_node_add_child (gegl, operation);
-
-  if (src_buffer)
-    {
-      GeglNode *src_node;
-
-      /* dup() because reading and writing the same buffer doesn't
-       * work with area ops when using a processor. See bug #701875.
-       */
-      if (progress && (src_buffer == dest_buffer))
-        src_buffer = gegl_buffer_dup (src_buffer);
-      else
-        g_object_ref (src_buffer);
-
-      src_node = gegl_node_new_child (gegl,
-                                      "operation", "gegl:buffer-source",
-                                      "buffer",    src_buffer,
-                                      NULL);
-
-      g_object_unref (src_buffer);
-
-      gegl_node_connect_to (src_node,  "output",
-                            operation, "input");
-    }
-
-  dest_node = gegl_node_new_child (gegl,
-                                   "operation", "gegl:write-buffer",
-                                   "buffer",    dest_buffer,
-                                   NULL);
-
-
-  gegl_node_connect_to (operation, "output",
-                        dest_node, "input");
-
-  if (progress)
-    {
-      GeglProcessor *processor;
-
-      processor = gegl_node_new_processor (dest_node, &rect);
-
-      progress_active = gimp_progress_is_active (progress);
-
-      if (progress_active)
-        {
-          if (undo_desc)
-            gimp_progress_set_text (progress, undo_desc);
-        }
-      else
-        {
-          gimp_progress_start (progress, undo_desc, FALSE);
-        }
-
-      while (gegl_processor_work (processor, &value))
-        gimp_progress_set_value (progress, value);
-
-      g_object_unref (processor);
-    }
-  else
-    {
-      gegl_node_blit (dest_node, 1.0, &rect,
-                      NULL, NULL, 0, GEGL_BLIT_DEFAULT);
-    }
-
-  g_object_unref (gegl);
+  gimp_gegl_apply_operation_real (src_buffer, progress, undo_desc,
+                                  operation, dest_buffer, dest_rect,
+                                  FALSE);
+}
 
-  if (progress && ! progress_active)
-    gimp_progress_end (progress);
+/**
+ * gimp_gegl_apply_cancelable_operation:
+ * @src_buffer:  the input buffer, or %NULL
+ * @progress:    a #GimpProgress, or %NULL
+ * @undo_desc:   the progress text, or %NULL
+ * @operation:   the #GeglNode to apply
+ * @dest_buffer: the output buffer
+ * @dest_rect:   the area of @dest_buffer to render, or %NULL for all of it
+ *
+ * Like gimp_gegl_apply_operation(), but can be canceled through
+ * @progress.
+ *
+ * Return value: %FALSE if the operation was canceled, @dest_buffer is
+ *               then left unchanged.
+ **/
+gboolean
+gimp_gegl_apply_cancelable_operation (GeglBuffer          *src_buffer,
+                                      GimpProgress        *progress,
+                                      const gchar         *undo_desc,
+                                      GeglNode            *operation,
+                                      GeglBuffer          *dest_buffer,
+                                      const GeglRectangle *dest_rect)
+{
+  g_return_val_if_fail (src_buffer == NULL || GEGL_IS_BUFFER (src_buffer),
+                        FALSE);
+  g_return_val_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress),
+                        FALSE);
+  g_return_val_if_fail (GEGL_IS_NODE (operation), FALSE);
+  g_return_val_if_fail (GEGL_IS_BUFFER (dest_buffer), FALSE);
+
+  return gimp_gegl_apply_operation_real (src_buffer, progress, undo_desc,
+                                         operation, dest_buffer, dest_rect,
+                                         TRUE);
 }
 
 void
@@ -400,3 +408,373 @@ gimp_gegl_apply_transform (GeglBuffer            *src_buffer,
                              node, dest_buffer, NULL);
   g_object_unref (node);
 }
+
+
+/*  private functions  */
+
+/*  the destination is rendered in tile aligned units.  Units are
+ *  handed out to the threads of gimp_parallel_distribute(), each of
+ *  which renders through its own copy of the operation, because GEGL
+ *  graphs can't be processed from several threads at once.  Thread 0
+ *  is the calling thread, it keeps the progress updated and, when
+ *  cancelable, dispatches pending events between its units.
+ */
+static gboolean
+gimp_gegl_apply_operation_real (GeglBuffer          *src_buffer,
+                                GimpProgress        *progress,
+                                const gchar         *undo_desc,
+                                GeglNode            *operation,
+                                GeglBuffer          *dest_buffer,
+                                const GeglRectangle *dest_rect,
+                                gboolean             cancelable)
+{
+  ApplyOperationData  data            = { 0, };
+  GeglNode           *gegl;
+  GeglNode           *src_node        = NULL;
+  GeglBuffer         *backup          = NULL;
+  gboolean            progress_active = FALSE;
+  gulong              cancel_id       = 0;
+  gint                tile_width;
+  gint                tile_height;
+  gint                n_units_y;
+
+  if (dest_rect)
+    {
+      data.rect = *dest_rect;
+    }
+  else
+    {
+      data.rect = *GEGL_RECTANGLE (0, 0, gegl_buffer_get_width  (dest_buffer),
+                                         gegl_buffer_get_height (dest_buffer));
+    }
+
+  if (data.rect.width <= 0 || data.rect.height <= 0)
+    return TRUE;
+
+  gegl = gegl_node_new ();
+
+  if (! gegl_node_get_parent (operation))
+    gegl_node_add_child (gegl, operation);
+
+  if (src_buffer)
+    {
+      src_node = gegl_node_new_child (gegl,
+                                      "operation", "gegl:buffer-source",
+                                      "buffer",    src_buffer,
+                                      NULL);
+
+      gegl_node_connect_to (src_node,  "output",
+                            operation, "input");
+    }
+
+  data.dest_node = gegl_node_new_child (gegl,
+                                        "operation", "gegl:write-buffer",
+                                        "buffer",    dest_buffer,
+                                        NULL);
+
+  gegl_node_connect_to (operation,      "output",
+                        data.dest_node, "input");
+
+  /*  reading and writing the same buffer doesn't work for area ops
+   *  processed in pieces (see bug #701875), so read from a copy of
+   *  just the area the operation needs
+   */
+  if (src_buffer && src_buffer == dest_buffer)
+    {
+      GeglOperation *op = gegl_node_get_gegl_operation (operation);
+      GeglRectangle  required;
+
+      gegl_node_get_bounding_box (operation);
+
+      if (op && ! gegl_node_get_children (operation))
+        required = gegl_operation_get_required_for_output (op, "input",
+                                                           &data.rect);
+      else
+        required = *gegl_buffer_get_extent (src_buffer);
+
+      src_buffer = gimp_gegl_apply_operation_copy (src_buffer, &required);
+
+      gegl_node_set (src_node,
+                     "buffer", src_buffer,
+                     NULL);
+
+      g_object_unref (src_buffer);
+    }
+
+  if (cancelable)
+    backup = gimp_gegl_apply_operation_copy (dest_buffer, &data.rect);
+
+  g_object_get (dest_buffer,
+                "tile-width",  &tile_width,
+                "tile-height", &tile_height,
+                NULL);
+
+  data.operation   = operation;
+  data.src_buffer  = src_buffer;
+  data.dest_buffer = dest_buffer;
+  data.progress    = progress;
+  data.cancelable  = cancelable;
+
+  data.unit_width  = (APPLY_UNIT_WIDTH  + tile_width  - 1) / tile_width  * tile_width;
+  data.unit_height = (APPLY_UNIT_HEIGHT + tile_height - 1) / tile_height * tile_height;
+
+  data.n_units_x = ((data.rect.x + data.rect.width  - 1) / data.unit_width -
+                    data.rect.x / data.unit_width + 1);
+  n_units_y      = ((data.rect.y + data.rect.height - 1) / data.unit_height -
+                    data.rect.y / data.unit_height + 1);
+  data.n_units   = data.n_units_x * n_units_y;
+
+  if (progress)
+    {
+      progress_active = gimp_progress_is_active (progress);
+
+      if (progress_active)
+        {
+          if (undo_desc)
+            gimp_progress_set_text (progress, undo_desc);
+        }
+      else
+        {
+          gimp_progress_start (progress, undo_desc, cancelable);
+        }
+
+      if (cancelable)
+        cancel_id = g_signal_connect (progress, "cancel",
+                                      G_CALLBACK (gimp_gegl_apply_operation_cancel),
+                                      &data);
+    }
+
+  /*  the first unit is always rendered here, it prepares the graph and
+   *  creates the babl fishes before other threads get to it
+   */
+  if (gimp_gegl_apply_operation_next_unit (&data, data.dest_node) &&
+      data.n_units > 1)
+    {
+      gint max_threads = 1;
+
+      if (gimp_gegl_apply_operation_can_clone (operation, &data.rect))
+        max_threads = data.n_units - 1;
+
+      gimp_parallel_distribute (max_threads,
+                                (GimpParallelDistributeFunc)
+                                gimp_gegl_apply_operation_func,
+                                &data);
+    }
+
+  if (cancel_id)
+    g_signal_handler_disconnect (progress, cancel_id);
+
+  if (data.cancelled && backup)
+    gegl_buffer_copy (backup, &data.rect, dest_buffer, &data.rect);
+
+  if (backup)
+    g_object_unref (backup);
+
+  g_object_unref (gegl);
+
+  if (progress && ! progress_active)
+    gimp_progress_end (progress);
+
+  return ! data.cancelled;
+}
+
+static void
+gimp_gegl_apply_operation_func (gint                i,
+                                gint                n,
+                                ApplyOperationData *data)
+{
+  GeglNode *gegl      = NULL;
+  GeglNode *dest_node = data->dest_node;
+
+  if (i > 0)
+    {
+      GeglNode *operation;
+
+      gegl = gegl_node_new ();
+
+      operation = gimp_gegl_apply_operation_clone (data->operation);
+      gegl_node_add_child (gegl, operation);
+      g_object_unref (operation);
+
+      if (data->src_buffer)
+        {
+          GeglNode *src_node;
+
+          src_node = gegl_node_new_child (gegl,
+                                          "operation", "gegl:buffer-source",
+                                          "buffer",    data->src_buffer,
+                                          NULL);
+
+          gegl_node_connect_to (src_node,  "output",
+                                operation, "input");
+        }
+
+      dest_node = gegl_node_new_child (gegl,
+                                       "operation", "gegl:write-buffer",
+                                       "buffer",    data->dest_buffer,
+                                       NULL);
+
+      gegl_node_connect_to (operation, "output",
+                            dest_node, "input");
+    }
+
+  while (gimp_gegl_apply_operation_next_unit (data, dest_node));
+
+  if (gegl)
+    g_object_unref (gegl);
+}
+
+/*  renders the next unit through @dest_node, returns FALSE when there
+ *  are no units left or the operation was canceled
+ */
+static gboolean
+gimp_gegl_apply_operation_next_unit (ApplyOperationData *data,
+                                     GeglNode           *dest_node)
+{
+  GeglRectangle unit;
+  gint          index;
+  gint          n_done;
+
+  if (g_atomic_int_get (&data->cancelled))
+    return FALSE;
+
+  index = g_atomic_int_add (&data->next_unit, 1);
+
+  if (index >= data->n_units)
+    return FALSE;
+
+  unit.x      = (data->rect.x / data->unit_width  + index % data->n_units_x) *
+                data->unit_width;
+  unit.y      = (data->rect.y / data->unit_height + index / data->n_units_x) *
+                data->unit_height;
+  unit.width  = data->unit_width;
+  unit.height = data->unit_height;
+
+  gegl_rectangle_intersect (&unit, &unit, &data->rect);
+
+  gegl_node_blit (dest_node, 1.0, &unit,
+                  NULL, NULL, 0, GEGL_BLIT_DEFAULT);
+
+  n_done = g_atomic_int_add (&data->n_done, 1) + 1;
+
+  /*  only the calling thread talks to the progress, and runs the
+   *  main loop so the progress' "cancel" signal can get through
+   */
+  if (data->progress && dest_node == data->dest_node)
+    {
+      gimp_progress_set_value (data->progress,
+                               (gdouble) n_done / data->n_units);
+
+      if (data->cancelable)
+        {
+          while (g_main_context_pending (NULL))
+            g_main_context_iteration (NULL, TRUE);
+        }
+    }
+
+  return TRUE;
+}
+
+/*  the operation can be rendered from several threads if it is a
+ *  single operation whose output only depends on a neighborhood of the
+ *  pixels, so it can be copied along its properties
+ */
+static gboolean
+gimp_gegl_apply_operation_can_clone (GeglNode            *operation,
+                                     const GeglRectangle *rect)
+{
+  GeglOperation *op = gegl_node_get_gegl_operation (operation);
+  GeglRectangle  cached;
+
+  if (gimp_parallel_get_n_threads () < 2)
+    return FALSE;
+
+  if (! op                                     ||
+      ! gegl_node_get_operation (operation)    ||
+      gegl_node_get_children (operation)       ||
+      (gegl_node_has_pad (operation, "aux") &&
+       gegl_node_get_producer (operation, "aux", NULL)))
+    return FALSE;
+
+  cached = gegl_operation_get_cached_region (op, rect);
+
+  return gegl_rectangle_equal (&cached, rect);
+}
+
+static GeglNode *
+gimp_gegl_apply_operation_clone (GeglNode *operation)
+{
+  const gchar  *name = gegl_node_get_operation (operation);
+  GeglNode     *clone;
+  GParamSpec  **pspecs;
+  guint         n_pspecs;
+  guint         i;
+
+  clone = gegl_node_new ();
+
+  gegl_node_set (clone,
+                 "operation", name,
+                 NULL);
+
+  pspecs = gegl_operation_list_properties (name, &n_pspecs);
+
+  for (i = 0; i < n_pspecs; i++)
+    {
+      GValue value = G_VALUE_INIT;
+
+      g_value_init (&value, pspecs[i]->value_type);
+
+      gegl_node_get_property (operation, pspecs[i]->name, &value);
+      gegl_node_set_property (clone,     pspecs[i]->name, &value);
+
+      g_value_unset (&value);
+    }
+
+  g_free (pspecs);
+
+  return clone;
+}
+
+/*  copies @rect of @buffer, grown to whole tiles so gegl_buffer_copy()
+ *  shares the tiles copy-on-write instead of copying pixels
+ */
+static GeglBuffer *
+gimp_gegl_apply_operation_copy (GeglBuffer          *buffer,
+                                const GeglRectangle *rect)
+{
+  GeglBuffer    *copy;
+  GeglRectangle  area;
+  gint           tile_width;
+  gint           tile_height;
+
+  g_object_get (buffer,
+                "tile-width",  &tile_width,
+                "tile-height", &tile_height,
+                NULL);
+
+  copy = gegl_buffer_new (gegl_buffer_get_extent (buffer),
+                          gegl_buffer_get_format (buffer));
+
+  if (! gegl_rectangle_intersect (&area, rect, gegl_buffer_get_extent (buffer)))
+    return copy;
+
+  area.width  += area.x - (gint) floor ((gdouble) area.x / tile_width) * tile_width;
+  area.height += area.y - (gint) floor ((gdouble) area.y / tile_height) * tile_height;
+  area.x       = (gint) floor ((gdouble) area.x / tile_width)  * tile_width;
+  area.y       = (gint) floor ((gdouble) area.y / tile_height) * tile_height;
+  area.width   = (area.width  + tile_width  - 1) / tile_width  * tile_width;
+  area.height  = (area.height + tile_height - 1) / tile_height * tile_height;
+
+  gegl_rectangle_intersect (&area, &area, gegl_buffer_get_extent (buffer));
+
+  gegl_buffer_copy (buffer, &area, copy, &area);
+
+  return copy;
+}
+
+static void
+gimp_gegl_apply_operation_cancel (GimpProgress       *progress,
+                                  ApplyOperationData *data)
+{
+  g_atomic_int_set (&data->cancelled, TRUE);
+}
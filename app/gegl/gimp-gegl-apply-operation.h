@@ -26,12 +26,18 @@
 
 /*  generic function, also used by the specific ones below  */
 
-void   gimp_gegl_apply_operation       (GeglBuffer            *src_buffer,
-                                        GimpProgress          *progress,
-                                        const gchar           *undo_desc,
-                                        GeglNode              *operation,
-                                        GeglBuffer            *dest_buffer,
-                                        const GeglRectangle   *dest_rect);
+void     gimp_gegl_apply_operation            (GeglBuffer          *src_buffer,
+                                               GimpProgress        *progress,
+                                               const gchar         *undo_desc,
+                                               GeglNode            *operation,
+                                               GeglBuffer          *dest_buffer,
+                                               const GeglRectangle *dest_rect);
+gboolean gimp_gegl_apply_cancelable_operation (GeglBuffer          *src_buffer,
+                                               GimpProgress        *progress,
+                                               const gchar         *undo_desc,
+                                               GeglNode            *operation,
+                                               GeglBuffer          *dest_buffer,
+                                               const GeglRectangle *dest_rect);
 
 
 /*  apply specific operations  */
@@ -49,6 +49,7 @@
 #include "gimpoperationlevels.h"
 #include "gimpoperationposterize.h"
 #include "gimpoperationthreshold.h"
+#include "gimpoperationpointlut.h"
 
 #include "gimpoperationpointlayermode.h"
 #include "gimpoperationnormalmode.h"
@@ -104,6 +105,7 @@ gimp_operations_init (void)
   g_type_class_ref (GIMP_TYPE_OPERATION_LEVELS);
   g_type_class_ref (GIMP_TYPE_OPERATION_POSTERIZE);
   g_type_class_ref (GIMP_TYPE_OPERATION_THRESHOLD);
+  g_type_class_ref (GIMP_TYPE_OPERATION_POINT_LUT);
 
   g_type_class_ref (GIMP_TYPE_OPERATION_POINT_LAYER_MODE);
   g_type_class_ref (GIMP_TYPE_OPERATION_NORMAL_MODE);
@@ -65,6 +65,9 @@ gimp_operation_hue_saturation_class_init (GimpOperationHueSaturationClass *klass
 
   point_class->process = gimp_operation_hue_saturation_process;
 
+  GIMP_OPERATION_POINT_FILTER_CLASS (klass)->map_type =
+    GIMP_POINT_FILTER_MAP_RGB;
+
   g_object_class_install_property (object_class,
                                    GIMP_OPERATION_POINT_FILTER_PROP_CONFIG,
                                    g_param_spec_object ("config",
@@ -41,6 +41,20 @@ enum
 #define GIMP_OPERATION_POINT_FILTER_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj),  GIMP_TYPE_OPERATION_POINT_FILTER, GimpOperationPointFilterClass))
 
 
+/*  how a point filter maps pixels, tells gimp:point-lut whether and how
+ *  the filter can be sampled into lookup tables. The tables are
+ *  interpolated, so step functions (threshold, posterize, equalize)
+ *  must stay at GIMP_POINT_FILTER_MAP_NONE, or their edges would be
+ *  blurred.
+ */
+typedef enum
+{
+  GIMP_POINT_FILTER_MAP_NONE,        /*  can't be sampled                  */
+  GIMP_POINT_FILTER_MAP_PER_CHANNEL, /*  each channel maps on its own      */
+  GIMP_POINT_FILTER_MAP_RGB          /*  RGB maps jointly, alpha on its own */
+} GimpPointFilterMapType;
+
+
 typedef struct _GimpOperationPointFilterClass GimpOperationPointFilterClass;
 
 struct _GimpOperationPointFilter
@@ -53,6 +67,8 @@ struct _GimpOperationPointFilter
 struct _GimpOperationPointFilterClass
 {
   GeglOperationPointFilterClass  parent_class;
+
+  GimpPointFilterMapType         map_type;
 };
 
 
@@ -0,0 +1,148 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpoperationpointlut-sse2.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl-plugin.h>
+
+#include "operations-types.h"
+
+#include "gimpoperationpointlut.h"
+
+#if COMPILE_SSE2_INTRINISICS
+/* SSE2 */
+#include <emmintrin.h>
+
+void
+gimp_operation_point_lut_curves_sse2 (const GimpOperationPointLut *lut,
+                                      const gfloat                *src,
+                                      gfloat                      *dest,
+                                      glong                        samples)
+{
+  const gfloat  *curves = lut->curves;
+  const __v4sf   zero   = _mm_setzero_ps ();
+  const __v4sf   one    = _mm_set1_ps (1.0f);
+  const __v4sf   scale  = _mm_set1_ps (lut->curve_size - 1);
+
+  while (samples--)
+    {
+      __v4sf  pos;
+      __m128i index;
+      gint    i[4];
+      __v4sf  a, b;
+
+      pos   = _mm_min_ps (_mm_max_ps (_mm_loadu_ps (src), zero), one);
+      pos   = _mm_mul_ps (pos, scale);
+      index = _mm_cvttps_epi32 (pos);
+      pos   = _mm_sub_ps (pos, _mm_cvtepi32_ps (index));
+
+      /*  the table index of each channel's sample  */
+      index = _mm_add_epi32 (_mm_slli_epi32 (index, 2),
+                             _mm_set_epi32 (3, 2, 1, 0));
+
+      _mm_storeu_si128 ((__m128i *) i, index);
+
+      a = _mm_set_ps (curves[i[3]],     curves[i[2]],
+                      curves[i[1]],     curves[i[0]]);
+      b = _mm_set_ps (curves[i[3] + 4], curves[i[2] + 4],
+                      curves[i[1] + 4], curves[i[0] + 4]);
+
+      _mm_storeu_ps (dest, _mm_add_ps (a, _mm_mul_ps (pos, _mm_sub_ps (b, a))));
+
+      src  += 4;
+      dest += 4;
+    }
+}
+
+void
+gimp_operation_point_lut_cube_sse2 (const GimpOperationPointLut *lut,
+                                    const gfloat                *src,
+                                    gfloat                      *dest,
+                                    glong                        samples)
+{
+  const gfloat  *cube    = lut->cube;
+  const gfloat  *curves  = lut->curves;
+  gint           size    = lut->cube_size;
+  gint           stride1 = 4;
+  gint           stride2 = size * stride1;
+  gint           stride3 = size * stride2;
+  const __v4sf   zero    = _mm_setzero_ps ();
+  const __v4sf   one     = _mm_set1_ps (1.0f);
+  const __v4sf   scale   = _mm_set_ps (lut->curve_size - 1,
+                                       size - 1, size - 1, size - 1);
+
+  while (samples--)
+    {
+      const gfloat *c;
+      __v4sf        pos;
+      gfloat        p[4];
+      gint          i[4];
+      __v4sf        c00, c01, c10, c11;
+      __v4sf        c0, c1;
+      __v4sf        f;
+      gfloat        alpha;
+
+      pos = _mm_min_ps (_mm_max_ps (_mm_loadu_ps (src), zero), one);
+      pos = _mm_mul_ps (pos, scale);
+
+      _mm_storeu_si128 ((__m128i *) i, _mm_cvttps_epi32 (pos));
+      _mm_storeu_ps (p, pos);
+
+      i[0] = MIN (i[0], size - 2);
+      i[1] = MIN (i[1], size - 2);
+      i[2] = MIN (i[2], size - 2);
+
+      /*  alpha, from its curve  */
+      alpha = curves[i[3] * 4 + ALPHA];
+      alpha = alpha + (p[3] - i[3]) * (curves[i[3] * 4 + 4 + ALPHA] - alpha);
+
+      c = cube + i[0] * stride3 + i[1] * stride2 + i[2] * stride1;
+
+      /*  blue  */
+      f   = _mm_set1_ps (p[2] - i[2]);
+
+      c00 = _mm_loadu_ps (c);
+      c01 = _mm_loadu_ps (c + stride2);
+      c10 = _mm_loadu_ps (c + stride3);
+      c11 = _mm_loadu_ps (c + stride3 + stride2);
+
+      c00 = _mm_add_ps (c00, _mm_mul_ps (f, _mm_sub_ps (_mm_loadu_ps (c + stride1), c00)));
+      c01 = _mm_add_ps (c01, _mm_mul_ps (f, _mm_sub_ps (_mm_loadu_ps (c + stride2 + stride1), c01)));
+      c10 = _mm_add_ps (c10, _mm_mul_ps (f, _mm_sub_ps (_mm_loadu_ps (c + stride3 + stride1), c10)));
+      c11 = _mm_add_ps (c11, _mm_mul_ps (f, _mm_sub_ps (_mm_loadu_ps (c + stride3 + stride2 + stride1), c11)));
+
+      /*  green  */
+      f   = _mm_set1_ps (p[1] - i[1]);
+
+      c0  = _mm_add_ps (c00, _mm_mul_ps (f, _mm_sub_ps (c01, c00)));
+      c1  = _mm_add_ps (c10, _mm_mul_ps (f, _mm_sub_ps (c11, c10)));
+
+      /*  red  */
+      f   = _mm_set1_ps (p[0] - i[0]);
+
+      _mm_storeu_ps (dest, _mm_add_ps (c0, _mm_mul_ps (f, _mm_sub_ps (c1, c0))));
+
+      dest[ALPHA] = alpha;
+
+      src  += 4;
+      dest += 4;
+    }
+}
+
+#endif /* COMPILE_SSE2_INTRINISICS */
@@ -0,0 +1,515 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpoperationpointlut.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*  gimp:point-lut replaces a chain of GimpOperationPointFilters with
+ *  lookup tables sampled from the chain.  If every filter in the chain
+ *  maps its channels independently, the chain becomes four 1D curves;
+ *  otherwise RGB goes through a 3D table with trilinear interpolation
+ *  and alpha through its curve.  Pixels outside [0..1] (only possible
+ *  with unbounded input) are passed through the original filters.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gegl-plugin.h>
+
+#include <libgimpbase/gimpbase.h>
+
+#include "operations-types.h"
+
+#include "gimpoperationpointfilter.h"
+#include "gimpoperationpointlut.h"
+
+
+static void     gimp_operation_point_lut_finalize (GObject             *object);
+
+static void     gimp_operation_point_lut_prepare  (GeglOperation       *operation);
+static gboolean gimp_operation_point_lut_process  (GeglOperation       *operation,
+                                                   void                *in_buf,
+                                                   void                *out_buf,
+                                                   glong                samples,
+                                                   const GeglRectangle *roi,
+                                                   gint                 level);
+
+static gboolean gimp_operation_point_lut_run      (GList               *filters,
+                                                   gfloat              *buf,
+                                                   gfloat              *temp,
+                                                   glong                samples);
+static void     gimp_operation_point_lut_clear    (GimpOperationPointLut *lut);
+
+
+G_DEFINE_TYPE (GimpOperationPointLut, gimp_operation_point_lut,
+               GEGL_TYPE_OPERATION_POINT_FILTER)
+
+#define parent_class gimp_operation_point_lut_parent_class
+
+
+static GimpPointLutFunc gimp_operation_point_lut_curves = NULL;
+static GimpPointLutFunc gimp_operation_point_lut_cube   = NULL;
+
+
+static void
+gimp_operation_point_lut_class_init (GimpOperationPointLutClass *klass)
+{
+  GObjectClass                  *object_class    = G_OBJECT_CLASS (klass);
+  GeglOperationClass            *operation_class = GEGL_OPERATION_CLASS (klass);
+  GeglOperationPointFilterClass *point_class     = GEGL_OPERATION_POINT_FILTER_CLASS (klass);
+
+  object_class->finalize   = gimp_operation_point_lut_finalize;
+
+  operation_class->prepare = gimp_operation_point_lut_prepare;
+
+  gegl_operation_class_set_keys (operation_class,
+                                 "name",        "gimp:point-lut",
+                                 "categories",  "color",
+                                 "description", "Point filters compiled to lookup tables",
+                                 NULL);
+
+  point_class->process = gimp_operation_point_lut_process;
+
+  gimp_operation_point_lut_curves = gimp_operation_point_lut_curves_core;
+  gimp_operation_point_lut_cube   = gimp_operation_point_lut_cube_core;
+
+#if COMPILE_SSE2_INTRINISICS
+  if (gimp_cpu_accel_get_support () & GIMP_CPU_ACCEL_X86_SSE2)
+    {
+      gimp_operation_point_lut_curves = gimp_operation_point_lut_curves_sse2;
+      gimp_operation_point_lut_cube   = gimp_operation_point_lut_cube_sse2;
+    }
+#endif /* COMPILE_SSE2_INTRINISICS */
+}
+
+static void
+gimp_operation_point_lut_init (GimpOperationPointLut *self)
+{
+}
+
+static void
+gimp_operation_point_lut_finalize (GObject *object)
+{
+  GimpOperationPointLut *lut = GIMP_OPERATION_POINT_LUT (object);
+
+  gimp_operation_point_lut_clear (lut);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gimp_operation_point_lut_prepare (GeglOperation *operation)
+{
+  const Babl *format = babl_format ("R'G'B'A float");
+
+  gegl_operation_set_format (operation, "input",  format);
+  gegl_operation_set_format (operation, "output", format);
+}
+
+static inline void
+gimp_operation_point_lut_lookup (const GimpOperationPointLut *lut,
+                                 const gfloat                *src,
+                                 gfloat                      *dest,
+                                 glong                        samples)
+{
+  if (lut->cube)
+    gimp_operation_point_lut_cube (lut, src, dest, samples);
+  else
+    gimp_operation_point_lut_curves (lut, src, dest, samples);
+}
+
+static inline gboolean
+gimp_operation_point_lut_in_range (const gfloat *pixel)
+{
+  return (pixel[0] >= 0.0f && pixel[0] <= 1.0f &&
+          pixel[1] >= 0.0f && pixel[1] <= 1.0f &&
+          pixel[2] >= 0.0f && pixel[2] <= 1.0f &&
+          pixel[3] >= 0.0f && pixel[3] <= 1.0f);
+}
+
+static gboolean
+gimp_operation_point_lut_process (GeglOperation       *operation,
+                                  void                *in_buf,
+                                  void                *out_buf,
+                                  glong                samples,
+                                  const GeglRectangle *roi,
+                                  gint                 level)
+{
+  GimpOperationPointLut *lut  = GIMP_OPERATION_POINT_LUT (operation);
+  const gfloat          *src  = in_buf;
+  gfloat                *dest = out_buf;
+  glong                  i;
+
+  if (! lut->curves)
+    {
+      if (src != dest)
+        memcpy (dest, src, samples * 4 * sizeof (gfloat));
+
+      return TRUE;
+    }
+
+  if (lut->bounded)
+    {
+      gimp_operation_point_lut_lookup (lut, src, dest, samples);
+
+      return TRUE;
+    }
+
+  /*  the tables only cover [0..1], run the filters on anything else  */
+  i = 0;
+
+  while (i < samples)
+    {
+      glong start = i;
+
+      while (i < samples && gimp_operation_point_lut_in_range (src + i * 4))
+        i++;
+
+      if (i > start)
+        gimp_operation_point_lut_lookup (lut,
+                                         src + start * 4, dest + start * 4,
+                                         i - start);
+
+      while (i < samples && ! gimp_operation_point_lut_in_range (src + i * 4))
+        {
+          gfloat temp[4];
+
+          memmove (dest + i * 4, src + i * 4, 4 * sizeof (gfloat));
+
+          gimp_operation_point_lut_run (lut->filters, dest + i * 4, temp, 1);
+
+          i++;
+        }
+    }
+
+  return TRUE;
+}
+
+/*  public functions  */
+
+/**
+ * gimp_operation_point_lut_can_compile:
+ * @node: a #GeglNode
+ *
+ * Returns: %TRUE if @node is a point filter which can be sampled into
+ *          lookup tables by gimp_operation_point_lut_compile().
+ **/
+gboolean
+gimp_operation_point_lut_can_compile (GeglNode *node)
+{
+  GeglOperation *operation;
+
+  g_return_val_if_fail (GEGL_IS_NODE (node), FALSE);
+
+  operation = gegl_node_get_gegl_operation (node);
+
+  return (GIMP_IS_OPERATION_POINT_FILTER (operation) &&
+          GIMP_OPERATION_POINT_FILTER_GET_CLASS (operation)->map_type !=
+          GIMP_POINT_FILTER_MAP_NONE);
+}
+
+/**
+ * gimp_operation_point_lut_compile:
+ * @lut_node:   a gimp:point-lut node
+ * @nodes:      the point filter nodes to fold, in processing order
+ * @curve_size: the number of samples of the 1D curves
+ * @cube_size:  the number of samples per axis of the 3D table
+ * @bounded:    whether input is known to lie within [0..1]
+ *
+ * Samples the chain of point filters in @nodes into the lookup tables
+ * of @lut_node.  The filters are sampled with their current settings,
+ * so this has to be called again whenever they change.
+ *
+ * Returns: %TRUE on success, %FALSE if the chain can't be compiled.
+ *          @lut_node then passes its input through unchanged.
+ **/
+gboolean
+gimp_operation_point_lut_compile (GeglNode *lut_node,
+                                  GList    *nodes,
+                                  gint      curve_size,
+                                  gint      cube_size,
+                                  gboolean  bounded)
+{
+  GimpOperationPointLut *lut;
+  GList                 *filters     = NULL;
+  GList                 *list;
+  gboolean               per_channel = TRUE;
+  gfloat                *temp        = NULL;
+  gint                   n_samples;
+  gint                   i;
+
+  g_return_val_if_fail (GEGL_IS_NODE (lut_node), FALSE);
+  g_return_val_if_fail (curve_size >= 2, FALSE);
+  g_return_val_if_fail (cube_size >= 2, FALSE);
+
+  lut = GIMP_OPERATION_POINT_LUT (gegl_node_get_gegl_operation (lut_node));
+
+  gimp_operation_point_lut_clear (lut);
+
+  for (list = nodes; list; list = g_list_next (list))
+    {
+      GeglOperation *operation;
+
+      if (! gimp_operation_point_lut_can_compile (list->data))
+        goto fail;
+
+      operation = gegl_node_get_gegl_operation (list->data);
+
+      if (GIMP_OPERATION_POINT_FILTER_GET_CLASS (operation)->map_type !=
+          GIMP_POINT_FILTER_MAP_PER_CHANNEL)
+        per_channel = FALSE;
+
+      filters = g_list_prepend (filters, g_object_ref (operation));
+    }
+
+  filters = g_list_reverse (filters);
+
+  /*  the curves, sampled on the gray ramp, provide alpha for both
+   *  kinds of tables and RGB for per-channel chains
+   */
+  lut->curves = g_new (gfloat, (curve_size + 1) * 4);
+
+  for (i = 0; i < curve_size; i++)
+    {
+      gfloat value = (gfloat) i / (curve_size - 1);
+
+      lut->curves[i * 4 + 0] = value;
+      lut->curves[i * 4 + 1] = value;
+      lut->curves[i * 4 + 2] = value;
+      lut->curves[i * 4 + 3] = value;
+    }
+
+  n_samples = curve_size;
+
+  if (! per_channel)
+    n_samples = MAX (n_samples, cube_size * cube_size * cube_size);
+
+  temp = g_new (gfloat, n_samples * 4);
+
+  if (! gimp_operation_point_lut_run (filters, lut->curves, temp, curve_size))
+    goto fail;
+
+  /*  pad for the interpolation at 1.0  */
+  memcpy (lut->curves + curve_size * 4,
+          lut->curves + (curve_size - 1) * 4, 4 * sizeof (gfloat));
+
+  if (! per_channel)
+    {
+      gfloat *sample;
+      gint    r, g, b;
+
+      lut->cube = g_new (gfloat, cube_size * cube_size * cube_size * 4);
+
+      sample = lut->cube;
+
+      for (r = 0; r < cube_size; r++)
+        for (g = 0; g < cube_size; g++)
+          for (b = 0; b < cube_size; b++)
+            {
+              sample[0] = (gfloat) r / (cube_size - 1);
+              sample[1] = (gfloat) g / (cube_size - 1);
+              sample[2] = (gfloat) b / (cube_size - 1);
+              sample[3] = 1.0f;
+
+              sample += 4;
+            }
+
+      if (! gimp_operation_point_lut_run (filters, lut->cube, temp,
+                                          cube_size * cube_size * cube_size))
+        goto fail;
+    }
+
+  g_free (temp);
+
+  lut->filters    = filters;
+  lut->bounded    = bounded;
+  lut->curve_size = curve_size;
+  lut->cube_size  = cube_size;
+
+  gegl_operation_invalidate (GEGL_OPERATION (lut), NULL, TRUE);
+
+  return TRUE;
+
+ fail:
+  g_free (temp);
+  g_list_free_full (filters, g_object_unref);
+
+  gimp_operation_point_lut_clear (lut);
+
+  gegl_operation_invalidate (GEGL_OPERATION (lut), NULL, TRUE);
+
+  return FALSE;
+}
+
+
+/*  lookup kernels  */
+
+static inline gfloat
+gimp_operation_point_lut_map (const gfloat *curves,
+                              gint          size,
+                              gint          channel,
+                              gfloat        value)
+{
+  gfloat pos;
+  gint   index;
+
+  pos   = CLAMP (value, 0.0f, 1.0f) * (size - 1);
+  index = (gint) pos;
+  pos  -= index;
+
+  curves += index * 4 + channel;
+
+  return curves[0] + pos * (curves[4] - curves[0]);
+}
+
+void
+gimp_operation_point_lut_curves_core (const GimpOperationPointLut *lut,
+                                      const gfloat                *src,
+                                      gfloat                      *dest,
+                                      glong                        samples)
+{
+  const gfloat *curves = lut->curves;
+  gint          size   = lut->curve_size;
+
+  while (samples--)
+    {
+      dest[RED]   = gimp_operation_point_lut_map (curves, size, RED,   src[RED]);
+      dest[GREEN] = gimp_operation_point_lut_map (curves, size, GREEN, src[GREEN]);
+      dest[BLUE]  = gimp_operation_point_lut_map (curves, size, BLUE,  src[BLUE]);
+      dest[ALPHA] = gimp_operation_point_lut_map (curves, size, ALPHA, src[ALPHA]);
+
+      src  += 4;
+      dest += 4;
+    }
+}
+
+void
+gimp_operation_point_lut_cube_core (const GimpOperationPointLut *lut,
+                                    const gfloat                *src,
+                                    gfloat                      *dest,
+                                    glong                        samples)
+{
+  const gfloat *cube    = lut->cube;
+  gint          size    = lut->cube_size;
+  gint          stride1 = 4;
+  gint          stride2 = size * stride1;
+  gint          stride3 = size * stride2;
+
+  while (samples--)
+    {
+      const gfloat *c;
+      gfloat        pos[3];
+      gint          index[3];
+      gfloat        alpha;
+      gint          i;
+
+      for (i = 0; i < 3; i++)
+        {
+          pos[i]   = CLAMP (src[i], 0.0f, 1.0f) * (size - 1);
+          index[i] = MIN ((gint) pos[i], size - 2);
+          pos[i]  -= index[i];
+        }
+
+      alpha = gimp_operation_point_lut_map (lut->curves, lut->curve_size,
+                                            ALPHA, src[ALPHA]);
+
+      c = cube + index[0] * stride3 + index[1] * stride2 + index[2] * stride1;
+
+      for (i = 0; i < 3; i++)
+        {
+          gfloat c00, c01, c10, c11;
+
+          c00 = c[i]                     + pos[2] * (c[stride1 + i] - c[i]);
+          c01 = c[stride2 + i]           + pos[2] * (c[stride2 + stride1 + i] -
+                                                     c[stride2 + i]);
+          c10 = c[stride3 + i]           + pos[2] * (c[stride3 + stride1 + i] -
+                                                     c[stride3 + i]);
+          c11 = c[stride3 + stride2 + i] + pos[2] * (c[stride3 + stride2 + stride1 + i] -
+                                                     c[stride3 + stride2 + i]);
+
+          c00 += pos[1] * (c01 - c00);
+          c10 += pos[1] * (c11 - c10);
+
+          dest[i] = c00 + pos[0] * (c10 - c00);
+        }
+
+      dest[ALPHA] = alpha;
+
+      src  += 4;
+      dest += 4;
+    }
+}
+
+
+/*  private functions  */
+
+/*  runs @samples RGBA pixels in @buf through @filters, in place  */
+static gboolean
+gimp_operation_point_lut_run (GList  *filters,
+                              gfloat *buf,
+                              gfloat *temp,
+                              glong   samples)
+{
+  GeglRectangle  roi = { 0, 0, samples, 1 };
+  gfloat        *src = buf;
+  gfloat        *dest = temp;
+  GList         *list;
+
+  for (list = filters; list; list = g_list_next (list))
+    {
+      GeglOperation                 *operation = list->data;
+      GeglOperationPointFilterClass *klass;
+      gfloat                        *tmp;
+
+      klass = GEGL_OPERATION_POINT_FILTER_GET_CLASS (operation);
+
+      if (! klass->process (operation, src, dest, samples, &roi, 0))
+        return FALSE;
+
+      tmp  = src;
+      src  = dest;
+      dest = tmp;
+    }
+
+  if (src != buf)
+    memcpy (buf, src, samples * 4 * sizeof (gfloat));
+
+  return TRUE;
+}
+
+static void
+gimp_operation_point_lut_clear (GimpOperationPointLut *lut)
+{
+  if (lut->filters)
+    {
+      g_list_free_full (lut->filters, g_object_unref);
+      lut->filters = NULL;
+    }
+
+  if (lut->curves)
+    {
+      g_free (lut->curves);
+      lut->curves = NULL;
+    }
+
+  if (lut->cube)
+    {
+      g_free (lut->cube);
+      lut->cube = NULL;
+    }
+}
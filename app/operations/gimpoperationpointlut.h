@@ -0,0 +1,95 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpoperationpointlut.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_OPERATION_POINT_LUT_H__
+#define __GIMP_OPERATION_POINT_LUT_H__
+
+
+#include <gegl-plugin.h>
+#include <operation/gegl-operation-point-filter.h>
+
+
+#define GIMP_TYPE_OPERATION_POINT_LUT            (gimp_operation_point_lut_get_type ())
+#define GIMP_OPERATION_POINT_LUT(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), GIMP_TYPE_OPERATION_POINT_LUT, GimpOperationPointLut))
+#define GIMP_OPERATION_POINT_LUT_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass),  GIMP_TYPE_OPERATION_POINT_LUT, GimpOperationPointLutClass))
+#define GIMP_IS_OPERATION_POINT_LUT(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GIMP_TYPE_OPERATION_POINT_LUT))
+#define GIMP_IS_OPERATION_POINT_LUT_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass),  GIMP_TYPE_OPERATION_POINT_LUT))
+#define GIMP_OPERATION_POINT_LUT_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj),  GIMP_TYPE_OPERATION_POINT_LUT, GimpOperationPointLutClass))
+
+
+typedef struct _GimpOperationPointLut      GimpOperationPointLut;
+typedef struct _GimpOperationPointLutClass GimpOperationPointLutClass;
+
+struct _GimpOperationPointLut
+{
+  GeglOperationPointFilter  parent_instance;
+
+  GList                    *filters;     /*  the compiled GeglOperations  */
+  gboolean                  bounded;
+
+  gint                      curve_size;
+  gfloat                   *curves;      /*  curve_size + 1 RGBA samples  */
+
+  gint                      cube_size;
+  gfloat                   *cube;        /*  cube_size^3 RGBx samples     */
+};
+
+struct _GimpOperationPointLutClass
+{
+  GeglOperationPointFilterClass  parent_class;
+};
+
+
+GType      gimp_operation_point_lut_get_type      (void) G_GNUC_CONST;
+
+gboolean   gimp_operation_point_lut_can_compile   (GeglNode        *node);
+gboolean   gimp_operation_point_lut_compile       (GeglNode        *lut_node,
+                                                   GList           *nodes,
+                                                   gint             curve_size,
+                                                   gint             cube_size,
+                                                   gboolean         bounded);
+
+
+/*  lookup kernels  */
+
+typedef void (* GimpPointLutFunc) (const GimpOperationPointLut *lut,
+                                   const gfloat                *src,
+                                   gfloat                      *dest,
+                                   glong                        samples);
+
+void       gimp_operation_point_lut_curves_core   (const GimpOperationPointLut *lut,
+                                                   const gfloat                *src,
+                                                   gfloat                      *dest,
+                                                   glong                        samples);
+void       gimp_operation_point_lut_cube_core     (const GimpOperationPointLut *lut,
+                                                   const gfloat                *src,
+                                                   gfloat                      *dest,
+                                                   glong                        samples);
+
+void       gimp_operation_point_lut_curves_sse2   (const GimpOperationPointLut *lut,
+                                                   const gfloat                *src,
+                                                   gfloat                      *dest,
+                                                   glong                        samples);
+void       gimp_operation_point_lut_cube_sse2     (const GimpOperationPointLut *lut,
+                                                   const gfloat                *src,
+                                                   gfloat                      *dest,
+                                                   glong                        samples);
+
+
+#endif /* __GIMP_OPERATION_POINT_LUT_H__ */
@@ -72,6 +72,17 @@ struct _PDBQuery
   gboolean  querying_compat;
 };
 
+typedef struct _PDBSignatures PDBSignatures;
+
+struct _PDBSignatures
+{
+  GimpPDB    *pdb;
+
+  GPtrArray  *names;
+  GByteArray *signatures;
+  gboolean    querying_compat;
+};
+
 typedef struct _PDBStrings PDBStrings;
 
 struct _PDBStrings
@@ -88,16 +99,19 @@ struct _PDBStrings
 
 /*  local function prototypes  */
 
-static void   gimp_pdb_query_entry  (gpointer       key,
-                                     gpointer       value,
-                                     gpointer       user_data);
-static void   gimp_pdb_print_entry  (gpointer       key,
-                                     gpointer       value,
-                                     gpointer       user_data);
-static void   gimp_pdb_get_strings  (PDBStrings    *strings,
-                                     GimpProcedure *procedure,
-                                     gboolean       compat);
-static void   gimp_pdb_free_strings (PDBStrings    *strings);
+static void   gimp_pdb_query_entry     (gpointer       key,
+                                        gpointer       value,
+                                        gpointer       user_data);
+static void   gimp_pdb_print_entry     (gpointer       key,
+                                        gpointer       value,
+                                        gpointer       user_data);
+static void   gimp_pdb_signature_entry (gpointer       key,
+                                        gpointer       value,
+                                        gpointer       user_data);
+static void   gimp_pdb_get_strings     (PDBStrings    *strings,
+                                        GimpProcedure *procedure,
+                                        gboolean       compat);
+static void   gimp_pdb_free_strings    (PDBStrings    *strings);
 
 
 /*  public functions  */
@@ -301,6 +315,46 @@ gimp_pdb_proc_info (GimpPDB          *pdb,
   return FALSE;
 }
 
+/*  the signatures of all procedures are returned in one go, for
+ *  language bindings which need to know every procedure at startup.
+ *  For each procedure in @procs, @signatures contains its procedure
+ *  type, its number of arguments and return values, followed by the
+ *  GimpPDBArgType of each argument and return value, one byte each.
+ */
+void
+gimp_pdb_proc_signatures (GimpPDB   *pdb,
+                          gint      *num_procs,
+                          gchar   ***procs,
+                          gint      *num_bytes,
+                          guint8   **signatures)
+{
+  PDBSignatures pdb_signatures;
+
+  g_return_if_fail (GIMP_IS_PDB (pdb));
+  g_return_if_fail (num_procs != NULL);
+  g_return_if_fail (procs != NULL);
+  g_return_if_fail (num_bytes != NULL);
+  g_return_if_fail (signatures != NULL);
+
+  pdb_signatures.pdb             = pdb;
+  pdb_signatures.names           = g_ptr_array_new ();
+  pdb_signatures.signatures      = g_byte_array_new ();
+  pdb_signatures.querying_compat = FALSE;
+
+  g_hash_table_foreach (pdb->procedures,
+                        gimp_pdb_signature_entry, &pdb_signatures);
+
+  pdb_signatures.querying_compat = TRUE;
+
+  g_hash_table_foreach (pdb->compat_proc_names,
+                        gimp_pdb_signature_entry, &pdb_signatures);
+
+  *num_procs  = pdb_signatures.names->len;
+  *procs      = (gchar **) g_ptr_array_free (pdb_signatures.names, FALSE);
+  *num_bytes  = pdb_signatures.signatures->len;
+  *signatures = g_byte_array_free (pdb_signatures.signatures, FALSE);
+}
+
 
 /*  private functions  */
 
@@ -314,6 +368,61 @@ match_string (GRegex      *regex,
   return g_regex_match (regex, string, 0, NULL);
 }
 
+static void
+gimp_pdb_signature_entry (gpointer key,
+                          gpointer value,
+                          gpointer user_data)
+{
+  PDBSignatures *pdb_signatures = user_data;
+  GList         *list;
+  GimpProcedure *procedure;
+  guint8         header[3];
+  gint           i;
+
+  if (pdb_signatures->querying_compat)
+    list = g_hash_table_lookup (pdb_signatures->pdb->procedures, value);
+  else
+    list = value;
+
+  if (! list)
+    return;
+
+  procedure = list->data;
+
+  /*  counts are stored in one byte, nothing comes close to that  */
+  if (procedure->num_args   > G_MAXUINT8 ||
+      procedure->num_values > G_MAXUINT8)
+    return;
+
+  header[0] = procedure->proc_type;
+  header[1] = procedure->num_args;
+  header[2] = procedure->num_values;
+
+  g_byte_array_append (pdb_signatures->signatures, header, sizeof (header));
+
+  for (i = 0; i < procedure->num_args; i++)
+    {
+      GParamSpec *pspec = procedure->args[i];
+      guint8      type;
+
+      type = gimp_pdb_compat_arg_type_from_gtype (G_PARAM_SPEC_VALUE_TYPE (pspec));
+
+      g_byte_array_append (pdb_signatures->signatures, &type, 1);
+    }
+
+  for (i = 0; i < procedure->num_values; i++)
+    {
+      GParamSpec *pspec = procedure->values[i];
+      guint8      type;
+
+      type = gimp_pdb_compat_arg_type_from_gtype (G_PARAM_SPEC_VALUE_TYPE (pspec));
+
+      g_byte_array_append (pdb_signatures->signatures, &type, 1);
+    }
+
+  g_ptr_array_add (pdb_signatures->names, g_strdup (key));
+}
+
 static void
 gimp_pdb_query_entry (gpointer key,
                       gpointer value,
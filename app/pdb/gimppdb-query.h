@@ -43,6 +43,11 @@ gboolean   gimp_pdb_proc_info (GimpPDB          *pdb,
                                gint             *num_args,
                                gint             *num_values,
                                GError          **error);
+void       gimp_pdb_proc_signatures (GimpPDB    *pdb,
+                                     gint       *num_procs,
+                                     gchar    ***procs,
+                                     gint       *num_bytes,
+                                     guint8    **signatures);
 
 
 #endif /* __GIMP_PDB_QUERY_H__ */
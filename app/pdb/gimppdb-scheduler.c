@@ -0,0 +1,582 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995-2003 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "pdb-types.h"
+
+#include "core/gimp.h"
+#include "core/gimp-parallel.h"
+#include "core/gimpcontext.h"
+#include "core/gimpimage.h"
+#include "core/gimpitem.h"
+#include "core/gimpparamspecs.h"
+
+#include "gimppdb.h"
+#include "gimppdb-scheduler.h"
+#include "gimpprocedure.h"
+
+
+/*  Procedures which only touch the pixels of the drawable they are
+ *  passed can run on a thread of their own while the main thread goes
+ *  on serving other plug-ins, as long as nothing else uses the image
+ *  at the same time.
+ *
+ *  Each scheduled procedure holds its image until it is done, other
+ *  procedures on the same image wait in line. Everything else which
+ *  runs an internal procedure on the main thread takes gimp_pdb_lock()
+ *  and waits for all scheduled procedures first, and main thread code
+ *  which touches a single image outside of the PDB takes
+ *  gimp_pdb_lock_image().
+ *
+ *  The image's signals are emitted on the procedure's thread as well,
+ *  so main thread code which uses state their handlers keep, like the
+ *  projection's update areas and the drawable histogram cache, also
+ *  takes gimp_pdb_lock_image().
+ *
+ *  This is only done without a user interface, the GUI keeps using
+ *  images from idle handlers all the time.
+ */
+static const gchar * const scheduled_procedures[] =
+{
+  "gimp-brightness-contrast",
+  "gimp-color-balance",
+  "gimp-colorize",
+  "gimp-curves-explicit",
+  "gimp-curves-spline",
+  "gimp-desaturate",
+  "gimp-desaturate-full",
+  "gimp-drawable-offset",
+  "gimp-equalize",
+  "gimp-hue-saturation",
+  "gimp-invert",
+  "gimp-levels",
+  "gimp-levels-auto",
+  "gimp-levels-stretch",
+  "gimp-posterize",
+  "gimp-threshold",
+
+  "plug-in-alienmap2",
+  "plug-in-antialias",
+  "plug-in-colors-channel-mixer",
+  "plug-in-colortoalpha",
+  "plug-in-cubism",
+  "plug-in-make-seamless",
+  "plug-in-mblur",
+  "plug-in-mblur-inward",
+  "plug-in-pixelize",
+  "plug-in-pixelize2",
+  "plug-in-polar-coords",
+  "plug-in-randomize-hurl",
+  "plug-in-randomize-pick",
+  "plug-in-randomize-slur",
+  "plug-in-red-eye-removal",
+  "plug-in-semiflatten",
+  "plug-in-shift",
+  "plug-in-spread",
+  "plug-in-threshold-alpha",
+  "plug-in-vinvert",
+  "plug-in-waves",
+  "plug-in-whirl-pinch"
+};
+
+
+struct _GimpPDBScheduler
+{
+  GMutex       mutex;
+  GCond        cond;
+
+  GThreadPool *pool;
+  GHashTable  *procedures;
+
+  gint         lock_count;      /*  gimp_pdb_lock() nesting               */
+  GHashTable  *locked_images;   /*  image -> gimp_pdb_lock_image() count  */
+  GHashTable  *running_images;  /*  images a started job holds            */
+  gint         n_running;
+  GQueue       pending;         /*  jobs waiting for their image          */
+};
+
+typedef struct
+{
+  GimpPDB                 *pdb;
+  GimpProcedure           *procedure;
+  GimpContext             *context;
+  GimpImage               *image;
+  GimpValueArray          *args;
+
+  GimpPDBScheduleCallback  callback;
+  gpointer                 user_data;
+
+  GimpValueArray          *return_vals;
+  GError                  *error;
+} GimpPDBJob;
+
+
+static GimpImage * gimp_pdb_scheduler_get_image  (GimpPDB          *pdb,
+                                                  GimpProcedure    *procedure,
+                                                  GimpValueArray   *args);
+static void        gimp_pdb_scheduler_start_jobs (GimpPDBScheduler *scheduler);
+static void        gimp_pdb_scheduler_run_job    (GimpPDBJob       *job,
+                                                  GimpPDBScheduler *scheduler);
+
+static void        gimp_pdb_job_execute          (GimpPDBJob       *job);
+static gboolean    gimp_pdb_job_done             (GimpPDBJob       *job);
+static void        gimp_pdb_job_free             (GimpPDBJob       *job);
+
+
+/*  set in threads which are executing a scheduled procedure, anything
+ *  it runs is covered by the lock of its image
+ */
+static GPrivate gimp_pdb_scheduler_job = G_PRIVATE_INIT (NULL);
+
+
+/*  public functions  */
+
+GimpPDBScheduler *
+gimp_pdb_scheduler_new (void)
+{
+  GimpPDBScheduler *scheduler = g_slice_new0 (GimpPDBScheduler);
+  gint              i;
+
+  g_mutex_init (&scheduler->mutex);
+  g_cond_init (&scheduler->cond);
+
+  scheduler->procedures     = g_hash_table_new (g_str_hash, g_str_equal);
+  scheduler->locked_images  = g_hash_table_new (g_direct_hash, NULL);
+  scheduler->running_images = g_hash_table_new (g_direct_hash, NULL);
+
+  for (i = 0; i < G_N_ELEMENTS (scheduled_procedures); i++)
+    g_hash_table_add (scheduler->procedures,
+                      (gpointer) scheduled_procedures[i]);
+
+  g_queue_init (&scheduler->pending);
+
+  return scheduler;
+}
+
+void
+gimp_pdb_scheduler_free (GimpPDBScheduler *scheduler)
+{
+  g_return_if_fail (scheduler != NULL);
+
+  /*  jobs keep the PDB alive, there can't be any left  */
+  g_warn_if_fail (scheduler->n_running == 0);
+  g_warn_if_fail (g_queue_is_empty (&scheduler->pending));
+
+  if (scheduler->pool)
+    g_thread_pool_free (scheduler->pool, FALSE, TRUE);
+
+  g_hash_table_unref (scheduler->procedures);
+  g_hash_table_unref (scheduler->locked_images);
+  g_hash_table_unref (scheduler->running_images);
+
+  g_cond_clear (&scheduler->cond);
+  g_mutex_clear (&scheduler->mutex);
+
+  g_slice_free (GimpPDBScheduler, scheduler);
+}
+
+/**
+ * gimp_pdb_schedule_procedure:
+ * @pdb:       a #GimpPDB
+ * @procedure: the procedure to run
+ * @context:   the context to run it in
+ * @progress:  the progress the caller would run it with
+ * @args:      the arguments
+ * @callback:  called from the main loop with the return values
+ * @user_data: data to pass to @callback
+ *
+ * Runs @procedure on a thread of its own if it only touches a single
+ * image, and nothing else is using that image. If another scheduled
+ * procedure holds the image, @procedure waits for it.
+ *
+ * Return value: %TRUE if @procedure was scheduled and @callback will
+ *               be called, %FALSE if the caller has to run it the
+ *               usual way.
+ **/
+gboolean
+gimp_pdb_schedule_procedure (GimpPDB                 *pdb,
+                             GimpProcedure           *procedure,
+                             GimpContext             *context,
+                             GimpProgress            *progress,
+                             GimpValueArray          *args,
+                             GimpPDBScheduleCallback  callback,
+                             gpointer                 user_data)
+{
+  GimpPDBScheduler *scheduler;
+  GimpPDBJob       *job;
+  GimpImage        *image;
+  gint              n_threads;
+
+  g_return_val_if_fail (GIMP_IS_PDB (pdb), FALSE);
+  g_return_val_if_fail (GIMP_IS_PROCEDURE (procedure), FALSE);
+  g_return_val_if_fail (GIMP_IS_CONTEXT (context), FALSE);
+  g_return_val_if_fail (args != NULL, FALSE);
+  g_return_val_if_fail (callback != NULL, FALSE);
+
+  scheduler = pdb->scheduler;
+  n_threads = gimp_parallel_get_n_threads ();
+
+  /*  progress objects call back into plug-ins and displays  */
+  if (! pdb->gimp->no_interface                  ||
+      n_threads < 2                              ||
+      progress                                   ||
+      procedure->proc_type != GIMP_INTERNAL      ||
+      ! g_hash_table_contains (scheduler->procedures,
+                               gimp_object_get_name (procedure)))
+    {
+      return FALSE;
+    }
+
+  image = gimp_pdb_scheduler_get_image (pdb, procedure, args);
+
+  if (! image)
+    return FALSE;
+
+  g_mutex_lock (&scheduler->mutex);
+
+  /*  the main thread is in the middle of using the image, and may be
+   *  waiting for the caller
+   */
+  if (scheduler->lock_count > 0 ||
+      g_hash_table_contains (scheduler->locked_images, image))
+    {
+      g_mutex_unlock (&scheduler->mutex);
+
+      return FALSE;
+    }
+
+  if (! scheduler->pool)
+    scheduler->pool = g_thread_pool_new ((GFunc) gimp_pdb_scheduler_run_job,
+                                         scheduler, n_threads, FALSE, NULL);
+  else
+    g_thread_pool_set_max_threads (scheduler->pool, n_threads, NULL);
+
+  job = g_slice_new0 (GimpPDBJob);
+
+  job->pdb       = g_object_ref (pdb);
+  job->procedure = g_object_ref (procedure);
+  job->context   = g_object_ref (context);
+  job->image     = g_object_ref (image);
+  job->args      = gimp_value_array_ref (args);
+  job->callback  = callback;
+  job->user_data = user_data;
+
+  g_queue_push_tail (&scheduler->pending, job);
+
+  gimp_pdb_scheduler_start_jobs (scheduler);
+
+  g_mutex_unlock (&scheduler->mutex);
+
+  return TRUE;
+}
+
+/**
+ * gimp_pdb_lock:
+ * @pdb: a #GimpPDB
+ *
+ * Waits for all scheduled procedures to finish, and keeps new ones
+ * from starting until gimp_pdb_unlock(). Procedures which could not
+ * start yet are run right here. Calls can be nested, and must only
+ * be made from the main thread.
+ **/
+void
+gimp_pdb_lock (GimpPDB *pdb)
+{
+  GimpPDBScheduler *scheduler;
+
+  g_return_if_fail (GIMP_IS_PDB (pdb));
+
+  if (g_private_get (&gimp_pdb_scheduler_job))
+    return;
+
+  scheduler = pdb->scheduler;
+
+  g_mutex_lock (&scheduler->mutex);
+
+  if (scheduler->lock_count++ == 0)
+    {
+      GimpPDBJob *job;
+
+      while (scheduler->n_running > 0)
+        g_cond_wait (&scheduler->cond, &scheduler->mutex);
+
+      /*  their callers may be what we are about to wait for  */
+      while ((job = g_queue_pop_head (&scheduler->pending)))
+        {
+          g_mutex_unlock (&scheduler->mutex);
+
+          gimp_pdb_job_execute (job);
+
+          g_idle_add_full (G_PRIORITY_DEFAULT,
+                           (GSourceFunc) gimp_pdb_job_done, job,
+                           NULL);
+
+          g_mutex_lock (&scheduler->mutex);
+        }
+    }
+
+  g_mutex_unlock (&scheduler->mutex);
+}
+
+void
+gimp_pdb_unlock (GimpPDB *pdb)
+{
+  GimpPDBScheduler *scheduler;
+
+  g_return_if_fail (GIMP_IS_PDB (pdb));
+
+  if (g_private_get (&gimp_pdb_scheduler_job))
+    return;
+
+  scheduler = pdb->scheduler;
+
+  g_mutex_lock (&scheduler->mutex);
+
+  g_warn_if_fail (scheduler->lock_count > 0);
+
+  if (--scheduler->lock_count == 0)
+    gimp_pdb_scheduler_start_jobs (scheduler);
+
+  g_mutex_unlock (&scheduler->mutex);
+}
+
+/**
+ * gimp_pdb_lock_image:
+ * @pdb:   a #GimpPDB
+ * @image: a #GimpImage
+ *
+ * Like gimp_pdb_lock(), but only waits for procedures scheduled on
+ * @image. Must not be held across anything which runs a main loop.
+ **/
+void
+gimp_pdb_lock_image (GimpPDB   *pdb,
+                     GimpImage *image)
+{
+  GimpPDBScheduler *scheduler;
+  gint              count;
+
+  g_return_if_fail (GIMP_IS_PDB (pdb));
+  g_return_if_fail (GIMP_IS_IMAGE (image));
+
+  if (g_private_get (&gimp_pdb_scheduler_job))
+    return;
+
+  scheduler = pdb->scheduler;
+
+  g_mutex_lock (&scheduler->mutex);
+
+  count = GPOINTER_TO_INT (g_hash_table_lookup (scheduler->locked_images,
+                                                image));
+  g_hash_table_insert (scheduler->locked_images,
+                       image, GINT_TO_POINTER (count + 1));
+
+  while (g_hash_table_contains (scheduler->running_images, image))
+    g_cond_wait (&scheduler->cond, &scheduler->mutex);
+
+  g_mutex_unlock (&scheduler->mutex);
+}
+
+void
+gimp_pdb_unlock_image (GimpPDB   *pdb,
+                       GimpImage *image)
+{
+  GimpPDBScheduler *scheduler;
+  gint              count;
+
+  g_return_if_fail (GIMP_IS_PDB (pdb));
+  g_return_if_fail (GIMP_IS_IMAGE (image));
+
+  if (g_private_get (&gimp_pdb_scheduler_job))
+    return;
+
+  scheduler = pdb->scheduler;
+
+  g_mutex_lock (&scheduler->mutex);
+
+  count = GPOINTER_TO_INT (g_hash_table_lookup (scheduler->locked_images,
+                                                image));
+
+  g_warn_if_fail (count > 0);
+
+  if (count > 1)
+    {
+      g_hash_table_insert (scheduler->locked_images,
+                           image, GINT_TO_POINTER (count - 1));
+    }
+  else
+    {
+      g_hash_table_remove (scheduler->locked_images, image);
+
+      gimp_pdb_scheduler_start_jobs (scheduler);
+    }
+
+  g_mutex_unlock (&scheduler->mutex);
+}
+
+
+/*  private functions  */
+
+/*  returns the one image all image and item arguments belong to  */
+static GimpImage *
+gimp_pdb_scheduler_get_image (GimpPDB        *pdb,
+                              GimpProcedure  *procedure,
+                              GimpValueArray *args)
+{
+  GimpImage *image = NULL;
+  gint       n_args;
+  gint       i;
+
+  n_args = MIN (procedure->num_args, gimp_value_array_length (args));
+
+  for (i = 0; i < n_args; i++)
+    {
+      GParamSpec *pspec = procedure->args[i];
+      GValue     *value = gimp_value_array_index (args, i);
+      GimpImage  *arg_image;
+
+      if (! G_VALUE_HOLDS (value, G_PARAM_SPEC_VALUE_TYPE (pspec)))
+        return NULL;
+
+      if (GIMP_IS_PARAM_SPEC_IMAGE_ID (pspec))
+        {
+          arg_image = gimp_value_get_image (value, pdb->gimp);
+        }
+      else if (GIMP_IS_PARAM_SPEC_ITEM_ID (pspec))
+        {
+          GimpItem *item = gimp_value_get_item (value, pdb->gimp);
+
+          if (! item || ! gimp_item_is_attached (item))
+            return NULL;
+
+          arg_image = gimp_item_get_image (item);
+        }
+      else
+        {
+          continue;
+        }
+
+      if (! arg_image || (image && arg_image != image))
+        return NULL;
+
+      image = arg_image;
+    }
+
+  return image;
+}
+
+/*  called with the mutex held, starts pending jobs in order, a job
+ *  only starts when no job before it holds the same image
+ */
+static void
+gimp_pdb_scheduler_start_jobs (GimpPDBScheduler *scheduler)
+{
+  GList *list;
+  GList *next;
+
+  if (scheduler->lock_count > 0)
+    return;
+
+  for (list = scheduler->pending.head; list; list = next)
+    {
+      GimpPDBJob *job = list->data;
+
+      next = g_list_next (list);
+
+      if (g_hash_table_contains (scheduler->running_images, job->image) ||
+          g_hash_table_contains (scheduler->locked_images,  job->image))
+        continue;
+
+      g_queue_delete_link (&scheduler->pending, list);
+
+      g_hash_table_add (scheduler->running_images, job->image);
+      scheduler->n_running++;
+
+      g_thread_pool_push (scheduler->pool, job, NULL);
+    }
+}
+
+static void
+gimp_pdb_scheduler_run_job (GimpPDBJob       *job,
+                            GimpPDBScheduler *scheduler)
+{
+  g_private_set (&gimp_pdb_scheduler_job, job);
+
+  gimp_pdb_job_execute (job);
+
+  g_private_set (&gimp_pdb_scheduler_job, NULL);
+
+  g_mutex_lock (&scheduler->mutex);
+
+  g_hash_table_remove (scheduler->running_images, job->image);
+  scheduler->n_running--;
+
+  gimp_pdb_scheduler_start_jobs (scheduler);
+
+  g_cond_broadcast (&scheduler->cond);
+
+  g_mutex_unlock (&scheduler->mutex);
+
+  /*  the return values are handed back on the main thread, which
+   *  is also where the job drops its references
+   */
+  g_idle_add_full (G_PRIORITY_DEFAULT,
+                   (GSourceFunc) gimp_pdb_job_done, job,
+                   NULL);
+}
+
+static void
+gimp_pdb_job_execute (GimpPDBJob *job)
+{
+  job->return_vals = gimp_procedure_execute (job->procedure,
+                                             job->pdb->gimp,
+                                             job->context,
+                                             NULL,
+                                             job->args,
+                                             &job->error);
+}
+
+static gboolean
+gimp_pdb_job_done (GimpPDBJob *job)
+{
+  job->callback (job->pdb, job->return_vals, job->error, job->user_data);
+
+  gimp_pdb_job_free (job);
+
+  return FALSE;
+}
+
+static void
+gimp_pdb_job_free (GimpPDBJob *job)
+{
+  if (job->return_vals)
+    gimp_value_array_unref (job->return_vals);
+
+  g_clear_error (&job->error);
+
+  gimp_value_array_unref (job->args);
+  g_object_unref (job->image);
+  g_object_unref (job->context);
+  g_object_unref (job->procedure);
+  g_object_unref (job->pdb);
+
+  g_slice_free (GimpPDBJob, job);
+}
@@ -0,0 +1,48 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995-2003 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_PDB_SCHEDULER_H__
+#define __GIMP_PDB_SCHEDULER_H__
+
+
+typedef void (* GimpPDBScheduleCallback) (GimpPDB        *pdb,
+                                          GimpValueArray *return_vals,
+                                          const GError   *error,
+                                          gpointer        user_data);
+
+
+GimpPDBScheduler * gimp_pdb_scheduler_new      (void);
+void               gimp_pdb_scheduler_free     (GimpPDBScheduler        *scheduler);
+
+gboolean           gimp_pdb_schedule_procedure (GimpPDB                 *pdb,
+                                                GimpProcedure           *procedure,
+                                                GimpContext             *context,
+                                                GimpProgress            *progress,
+                                                GimpValueArray          *args,
+                                                GimpPDBScheduleCallback  callback,
+                                                gpointer                 user_data);
+
+void               gimp_pdb_lock               (GimpPDB                 *pdb);
+void               gimp_pdb_unlock             (GimpPDB                 *pdb);
+
+void               gimp_pdb_lock_image         (GimpPDB                 *pdb,
+                                                GimpImage               *image);
+void               gimp_pdb_unlock_image       (GimpPDB                 *pdb,
+                                                GimpImage               *image);
+
+
+#endif  /*  __GIMP_PDB_SCHEDULER_H__  */
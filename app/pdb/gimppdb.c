@@ -35,6 +35,7 @@
 #include "core/gimpprogress.h"
 
 #include "gimppdb.h"
+#include "gimppdb-scheduler.h"
 #include "gimppdberror.h"
 #include "gimpprocedure.h"
 
@@ -109,6 +110,7 @@ gimp_pdb_init (GimpPDB *pdb)
 {
   pdb->procedures        = g_hash_table_new (g_str_hash, g_str_equal);
   pdb->compat_proc_names = g_hash_table_new (g_str_hash, g_str_equal);
+  pdb->scheduler         = gimp_pdb_scheduler_new ();
 }
 
 static void
@@ -129,6 +131,12 @@ gimp_pdb_finalize (GObject *object)
       pdb->compat_proc_names = NULL;
     }
 
+  if (pdb->scheduler)
+    {
+      gimp_pdb_scheduler_free (pdb->scheduler);
+      pdb->scheduler = NULL;
+    }
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -34,12 +34,14 @@ typedef struct _GimpPDBClass GimpPDBClass;
 
 struct _GimpPDB
 {
-  GimpObject  parent_instance;
+  GimpObject        parent_instance;
 
-  Gimp       *gimp;
+  Gimp             *gimp;
 
-  GHashTable *procedures;
-  GHashTable *compat_proc_names;
+  GHashTable       *procedures;
+  GHashTable       *compat_proc_names;
+
+  GimpPDBScheduler *scheduler;
 };
 
 struct _GimpPDBClass
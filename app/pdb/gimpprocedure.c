@@ -35,6 +35,8 @@
 
 #include "vectors/gimpvectors.h"
 
+#include "gimppdb.h"
+#include "gimppdb-scheduler.h"
 #include "gimppdbcontext.h"
 #include "gimppdberror.h"
 #include "gimpprocedure.h"
@@ -328,6 +330,12 @@ gimp_procedure_execute (GimpProcedure   *procedure,
   else
     context = gimp_pdb_context_new (gimp, context, TRUE);
 
+  /*  internal procedures must not run while procedures scheduled
+   *  on other threads use the images
+   */
+  if (procedure->proc_type == GIMP_INTERNAL)
+    gimp_pdb_lock (gimp->pdb);
+
   /*  call the procedure  */
   return_vals = GIMP_PROCEDURE_GET_CLASS (procedure)->execute (procedure,
                                                                gimp,
@@ -336,6 +344,9 @@ gimp_procedure_execute (GimpProcedure   *procedure,
                                                                args,
                                                                error);
 
+  if (procedure->proc_type == GIMP_INTERNAL)
+    gimp_pdb_unlock (gimp->pdb);
+
   g_object_unref (context);
 
   if (return_vals)
@@ -28,7 +28,7 @@
 #include "internal-procs.h"
 
 
-/* 696 procedures registered total */
+/* 698 procedures registered total */
 
 void
 internal_procs_init (GimpPDB *pdb)
@@ -23,6 +23,7 @@
 
 
 typedef struct _GimpPDB                GimpPDB;
+typedef struct _GimpPDBScheduler       GimpPDBScheduler;
 typedef struct _GimpProcedure          GimpProcedure;
 typedef struct _GimpPlugInProcedure    GimpPlugInProcedure;
 typedef struct _GimpTemporaryProcedure GimpTemporaryProcedure;
@@ -400,6 +400,30 @@ plugin_precision_enabled_invoker (GimpProcedure         *procedure,
   return return_vals;
 }
 
+static GimpValueArray *
+plugin_set_persistent_invoker (GimpProcedure         *procedure,
+                               Gimp                  *gimp,
+                               GimpContext           *context,
+                               GimpProgress          *progress,
+                               const GimpValueArray  *args,
+                               GError               **error)
+{
+  gboolean success = TRUE;
+  GimpPlugIn *plug_in = gimp->plug_in_manager->current_plug_in;
+
+  if (plug_in && plug_in->call_mode == GIMP_PLUG_IN_CALL_QUERY)
+    {
+      gimp_plug_in_def_set_persistent (plug_in->plug_in_def, TRUE);
+    }
+  else
+    {
+      success = FALSE;
+    }
+
+  return gimp_procedure_get_return_values (procedure, success,
+                                           error ? *error : NULL);
+}
+
 void
 register_plug_in_procs (GimpPDB *pdb)
 {
@@ -748,4 +772,21 @@ register_plug_in_procs (GimpPDB *pdb)
                                                          GIMP_PARAM_READWRITE));
   gimp_pdb_register_procedure (pdb, procedure);
   g_object_unref (procedure);
+
+  /*
+   * gimp-plugin-set-persistent
+   */
+  procedure = gimp_procedure_new (plugin_set_persistent_invoker);
+  gimp_object_set_static_name (GIMP_OBJECT (procedure),
+                               "gimp-plugin-set-persistent");
+  gimp_procedure_set_static_strings (procedure,
+                                     "gimp-plugin-set-persistent",
+                                     "Declares that this plug-in can run its procedures repeatedly.",
+                                     "Declares that this plug-in's procedures can be run several times in the same plug-in process. GIMP may then keep the plug-in running after a procedure returns, and send it the next call of one of its procedures instead of starting a new process, which saves the plug-in's startup time on repeated calls. A persistent plug-in must not rely on its global state being reset between runs. Idle plug-ins are asked to quit after a while. This procedure can only be called in the query function of a plug-in.",
+                                     "GIMP Development Team <gimp-developer-list@gnome.org>",
+                                     "GIMP Development Team",
+                                     "2026",
+                                     NULL);
+  gimp_pdb_register_procedure (pdb, procedure);
+  g_object_unref (procedure);
 }
@@ -366,6 +366,34 @@ procedural_db_proc_val_invoker (GimpProcedure         *procedure,
   return return_vals;
 }
 
+static GimpValueArray *
+procedural_db_proc_signatures_invoker (GimpProcedure         *procedure,
+                                       Gimp                  *gimp,
+                                       GimpContext           *context,
+                                       GimpProgress          *progress,
+                                       const GimpValueArray  *args,
+                                       GError               **error)
+{
+  GimpValueArray *return_vals;
+  gint32 num_procs = 0;
+  gchar **procedure_names = NULL;
+  gint32 num_bytes = 0;
+  guint8 *signatures = NULL;
+
+  gimp_pdb_proc_signatures (gimp->pdb,
+                            &num_procs, &procedure_names,
+                            &num_bytes, &signatures);
+
+  return_vals = gimp_procedure_get_return_values (procedure, TRUE, NULL);
+
+  g_value_set_int (gimp_value_array_index (return_vals, 1), num_procs);
+  gimp_value_take_stringarray (gimp_value_array_index (return_vals, 2), procedure_names, num_procs);
+  g_value_set_int (gimp_value_array_index (return_vals, 3), num_bytes);
+  gimp_value_take_int8array (gimp_value_array_index (return_vals, 4), signatures, num_bytes);
+
+  return return_vals;
+}
+
 static GimpValueArray *
 procedural_db_get_data_invoker (GimpProcedure         *procedure,
                                 Gimp                  *gimp,
@@ -820,6 +848,45 @@ register_procedural_db_procs (GimpPDB *pdb)
   gimp_pdb_register_procedure (pdb, procedure);
   g_object_unref (procedure);
 
+  /*
+   * gimp-procedural-db-proc-signatures
+   */
+  procedure = gimp_procedure_new (procedural_db_proc_signatures_invoker);
+  gimp_object_set_static_name (GIMP_OBJECT (procedure),
+                               "gimp-procedural-db-proc-signatures");
+  gimp_procedure_set_static_strings (procedure,
+                                     "gimp-procedural-db-proc-signatures",
+                                     "Returns the signatures of all procedures in the procedural database.",
+                                     "This procedure returns the names and argument types of all procedures in the procedural database in one call, for language bindings which need to know every procedure when they start up. For each procedure in 'procedure-names', 'signatures' contains one byte each for its procedure type, its number of arguments and its number of return values, followed by the type of each argument and each return value, one byte each.",
+                                     "GIMP Development Team <gimp-developer-list@gnome.org>",
+                                     "GIMP Development Team",
+                                     "2026",
+                                     NULL);
+  gimp_procedure_add_return_value (procedure,
+                                   gimp_param_spec_int32 ("num-procs",
+                                                          "num procs",
+                                                          "The number of procedures",
+                                                          0, G_MAXINT32, 0,
+                                                          GIMP_PARAM_READWRITE));
+  gimp_procedure_add_return_value (procedure,
+                                   gimp_param_spec_string_array ("procedure-names",
+                                                                 "procedure names",
+                                                                 "The procedure names",
+                                                                 GIMP_PARAM_READWRITE));
+  gimp_procedure_add_return_value (procedure,
+                                   gimp_param_spec_int32 ("num-bytes",
+                                                          "num bytes",
+                                                          "The length of the signatures array",
+                                                          0, G_MAXINT32, 0,
+                                                          GIMP_PARAM_READWRITE));
+  gimp_procedure_add_return_value (procedure,
+                                   gimp_param_spec_int8_array ("signatures",
+                                                               "signatures",
+                                                               "The procedure signatures",
+                                                               GIMP_PARAM_READWRITE));
+  gimp_pdb_register_procedure (pdb, procedure);
+  g_object_unref (procedure);
+
   /*
    * gimp-procedural-db-get-data
    */
@@ -33,6 +33,7 @@
 #include "core/gimpimage.h"
 #include "core/gimplayer.h"
 #include "core/gimpparamspecs.h"
+#include "text/gimp-fonts.h"
 #include "text/gimptext-compat.h"
 
 #include "gimppdb.h"
@@ -127,6 +128,8 @@ text_get_extents_fontname_invoker (GimpProcedure         *procedure,
     {
       gchar *real_fontname = g_strdup_printf ("%s %d", fontname, (gint) size);
 
+      gimp_fonts_load_pending (gimp);
+
       success = text_get_extents (real_fontname, text,
                                   &width, &height,
                                   &ascent, &descent);
@@ -234,6 +237,8 @@ text_get_extents_invoker (GimpProcedure         *procedure,
     {
       gchar *real_fontname = g_strdup_printf ("%s %d", family, (gint) size);
 
+      gimp_fonts_load_pending (gimp);
+
       success = text_get_extents (real_fontname, text,
                                   &width, &height,
                                   &ascent, &descent);
@@ -31,6 +31,8 @@
 #include "core/gimpimage-undo.h"
 #include "core/gimpundostack.h"
 
+#include "pdb/gimppdb-scheduler.h"
+
 #include "gimpplugin.h"
 #include "gimpplugin-cleanup.h"
 #include "gimppluginmanager.h"
@@ -197,6 +199,8 @@ gimp_plug_in_cleanup (GimpPlugIn          *plug_in,
   g_return_if_fail (GIMP_IS_PLUG_IN (plug_in));
   g_return_if_fail (proc_frame != NULL);
 
+  gimp_pdb_lock (plug_in->manager->gimp->pdb);
+
   for (list = proc_frame->image_cleanups; list; list = g_list_next (list))
     {
       GimpPlugInCleanupImage *cleanup = list->data;
@@ -228,6 +232,8 @@ gimp_plug_in_cleanup (GimpPlugIn          *plug_in,
 
   g_list_free (proc_frame->item_cleanups);
   proc_frame->item_cleanups = NULL;
+
+  gimp_pdb_unlock (plug_in->manager->gimp->pdb);
 }
 
 
@@ -36,15 +36,18 @@
 #include "core/gimp.h"
 #include "core/gimpdrawable.h"
 #include "core/gimpdrawable-shadow.h"
+#include "core/gimpimage.h"
 
 #include "pdb/gimp-pdb-compat.h"
 #include "pdb/gimppdb.h"
+#include "pdb/gimppdb-scheduler.h"
 #include "pdb/gimppdberror.h"
 
 #include "gimpplugin.h"
 #include "gimpplugin-cleanup.h"
 #include "gimpplugin-message.h"
 #include "gimppluginmanager.h"
+#include "gimppluginmanager-persistent.h"
 #include "gimpplugindef.h"
 #include "gimppluginshm.h"
 #include "gimptemporaryprocedure.h"
@@ -53,6 +56,15 @@
 #include "gimp-intl.h"
 
 
+typedef struct
+{
+  GimpPlugIn *plug_in;
+  gchar      *name;
+  gchar      *canonical;
+  guint32     request_id;
+} ScheduledProcRun;
+
+
 /*  local function prototypes  */
 
 static void gimp_plug_in_handle_quit             (GimpPlugIn      *plug_in);
@@ -64,6 +76,16 @@ static void gimp_plug_in_handle_tile_get         (GimpPlugIn      *plug_in,
                                                   GPTileReq       *request);
 static void gimp_plug_in_handle_proc_run         (GimpPlugIn      *plug_in,
                                                   GPProcRun       *proc_run);
+static void gimp_plug_in_proc_run_scheduled      (GimpPDB         *pdb,
+                                                  GimpValueArray  *return_vals,
+                                                  const GError    *error,
+                                                  ScheduledProcRun *run);
+static void gimp_plug_in_proc_run_return         (GimpPlugIn      *plug_in,
+                                                  const gchar     *name,
+                                                  const gchar     *canonical,
+                                                  guint32          request_id,
+                                                  GimpValueArray  *return_vals,
+                                                  const GError    *error);
 static void gimp_plug_in_handle_proc_return      (GimpPlugIn      *plug_in,
                                                   GPProcReturn    *proc_return);
 static void gimp_plug_in_handle_temp_proc_return (GimpPlugIn      *plug_in,
@@ -191,6 +213,7 @@ gimp_plug_in_handle_tile_put (GimpPlugIn *plug_in,
   GPTileData      *tile_info;
   GimpWireMessage  msg;
   GimpDrawable    *drawable;
+  GimpImage       *image;
   GeglBuffer      *buffer;
   const Babl      *format;
   GeglRectangle    tile_rect;
@@ -257,6 +280,11 @@ gimp_plug_in_handle_tile_put (GimpPlugIn *plug_in,
       return;
     }
 
+  /*  procedures scheduled on other threads may be using the image  */
+  image = gimp_item_get_image (GIMP_ITEM (drawable));
+
+  gimp_pdb_lock_image (plug_in->manager->gimp->pdb, image);
+
   if (tile_info->shadow)
     {
 
@@ -279,6 +307,7 @@ gimp_plug_in_handle_tile_put (GimpPlugIn *plug_in,
                         gimp_object_get_name (plug_in),
                         gimp_filename_to_utf8 (plug_in->prog),
                         tile_info->drawable_ID);
+          gimp_pdb_unlock_image (plug_in->manager->gimp->pdb, image);
           gimp_plug_in_close (plug_in, TRUE);
           return;
         }
@@ -290,6 +319,7 @@ gimp_plug_in_handle_tile_put (GimpPlugIn *plug_in,
                         gimp_object_get_name (plug_in),
                         gimp_filename_to_utf8 (plug_in->prog),
                         tile_info->drawable_ID);
+          gimp_pdb_unlock_image (plug_in->manager->gimp->pdb, image);
           gimp_plug_in_close (plug_in, TRUE);
           return;
         }
@@ -308,6 +338,7 @@ gimp_plug_in_handle_tile_put (GimpPlugIn *plug_in,
                     "requested invalid tile (killing)",
                     gimp_object_get_name (plug_in),
                     gimp_filename_to_utf8 (plug_in->prog));
+      gimp_pdb_unlock_image (plug_in->manager->gimp->pdb, image);
       gimp_plug_in_close (plug_in, TRUE);
       return;
     }
@@ -332,6 +363,8 @@ gimp_plug_in_handle_tile_put (GimpPlugIn *plug_in,
                        GEGL_AUTO_ROWSTRIDE);
     }
 
+  gimp_pdb_unlock_image (plug_in->manager->gimp->pdb, image);
+
   gimp_wire_destroy (&msg);
 
   if (! gp_tile_ack_write (plug_in->my_write, plug_in))
@@ -350,6 +383,7 @@ gimp_plug_in_handle_tile_get (GimpPlugIn *plug_in,
   GPTileData       tile_data;
   GimpWireMessage  msg;
   GimpDrawable    *drawable;
+  GimpImage       *image;
   GeglBuffer      *buffer;
   const Babl      *format;
   GeglRectangle    tile_rect;
@@ -382,6 +416,10 @@ gimp_plug_in_handle_tile_get (GimpPlugIn *plug_in,
       return;
     }
 
+  image = gimp_item_get_image (GIMP_ITEM (drawable));
+
+  gimp_pdb_lock_image (plug_in->manager->gimp->pdb, image);
+
   if (request->shadow)
     {
       buffer = gimp_drawable_get_shadow_buffer (drawable);
@@ -404,6 +442,7 @@ gimp_plug_in_handle_tile_get (GimpPlugIn *plug_in,
                     "requested invalid tile (killing)",
                     gimp_object_get_name (plug_in),
                     gimp_filename_to_utf8 (plug_in->prog));
+      gimp_pdb_unlock_image (plug_in->manager->gimp->pdb, image);
       gimp_plug_in_close (plug_in, TRUE);
       return;
     }
@@ -441,6 +480,8 @@ gimp_plug_in_handle_tile_get (GimpPlugIn *plug_in,
                        GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
     }
 
+  gimp_pdb_unlock_image (plug_in->manager->gimp->pdb, image);
+
   if (! gp_tile_data_write (plug_in->my_write, &tile_data, plug_in))
     {
       gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
@@ -511,6 +552,7 @@ gimp_plug_in_handle_proc_run (GimpPlugIn *plug_in,
   gchar               *canonical;
   const gchar         *proc_name   = NULL;
   GimpProcedure       *procedure;
+  GimpContext         *context;
   GimpValueArray      *args        = NULL;
   GimpValueArray      *return_vals = NULL;
   GError              *error       = NULL;
@@ -581,15 +623,48 @@ gimp_plug_in_handle_proc_run (GimpPlugIn *plug_in,
                                  proc_run->params, proc_run->nparams,
                                  FALSE, FALSE);
 
+  context = (proc_frame->context_stack ?
+             proc_frame->context_stack->data : proc_frame->main_context);
+
+  /*  Procedures which only touch one image can run on another thread
+   *  while other plug-ins are served. The plug-in waits for the
+   *  return values anyway, stop reading from it until they are sent
+   *  so its calls still run in order.
+   */
+  if (procedure && plug_in->input_id)
+    {
+      ScheduledProcRun *run = g_slice_new (ScheduledProcRun);
+
+      run->plug_in    = g_object_ref (plug_in);
+      run->name       = g_strdup (proc_run->name);
+      run->canonical  = canonical;
+      run->request_id = proc_run->request_id;
+
+      if (gimp_pdb_schedule_procedure (plug_in->manager->gimp->pdb,
+                                       procedure, context,
+                                       proc_frame->progress, args,
+                                       (GimpPDBScheduleCallback)
+                                       gimp_plug_in_proc_run_scheduled,
+                                       run))
+        {
+          gimp_plug_in_block_input (plug_in);
+          gimp_value_array_unref (args);
+
+          return;
+        }
+
+      g_object_unref (run->plug_in);
+      g_free (run->name);
+      g_slice_free (ScheduledProcRun, run);
+    }
+
   /*  Execute the procedure even if gimp_pdb_lookup_procedure()
    *  returned NULL, gimp_pdb_execute_procedure_by_name_args() will
    *  return appropriate error return_vals.
    */
   gimp_plug_in_manager_plug_in_push (plug_in->manager, plug_in);
   return_vals = gimp_pdb_execute_procedure_by_name_args (plug_in->manager->gimp->pdb,
-                                                         proc_frame->context_stack ?
-                                                         proc_frame->context_stack->data :
-                                                         proc_frame->main_context,
+                                                         context,
                                                          proc_frame->progress,
                                                          &error,
                                                          proc_name,
@@ -598,31 +673,93 @@ gimp_plug_in_handle_proc_run (GimpPlugIn *plug_in,
 
   gimp_value_array_unref (args);
 
+  gimp_plug_in_proc_run_return (plug_in, proc_run->name, canonical,
+                                proc_run->request_id, return_vals, error);
+
+  g_clear_error (&error);
+  g_free (canonical);
+
+  gimp_value_array_unref (return_vals);
+}
+
+static void
+gimp_plug_in_proc_run_scheduled (GimpPDB          *pdb,
+                                 GimpValueArray   *return_vals,
+                                 const GError     *error,
+                                 ScheduledProcRun *run)
+{
+  GimpPlugIn *plug_in = run->plug_in;
+
+  if (plug_in->open)
+    {
+      gimp_plug_in_proc_run_return (plug_in, run->name, run->canonical,
+                                    run->request_id, return_vals, error);
+
+      gimp_plug_in_unblock_input (plug_in);
+    }
+
+  g_object_unref (plug_in);
+  g_free (run->name);
+  g_free (run->canonical);
+  g_slice_free (ScheduledProcRun, run);
+}
+
+static void
+gimp_plug_in_proc_run_return (GimpPlugIn     *plug_in,
+                              const gchar    *name,
+                              const gchar    *canonical,
+                              guint32         request_id,
+                              GimpValueArray *return_vals,
+                              const GError   *error)
+{
   if (error)
     {
+      GimpPlugInProcFrame *proc_frame = gimp_plug_in_get_proc_frame (plug_in);
+
       gimp_plug_in_handle_proc_error (plug_in, proc_frame,
                                       canonical, error);
-      g_error_free (error);
     }
 
-  g_free (canonical);
-
   /*  Don't bother to send the return value if executing the procedure
    *  closed the plug-in (e.g. if the procedure is gimp-quit)
    */
   if (plug_in->open)
     {
       GPProcReturn proc_return;
+      gboolean     success;
 
       /*  Return the name we got called with, *not* proc_name or canonical,
        *  since proc_name may have been remapped by gimp->procedural_compat_ht
        *  and canonical may be different too.
+       *
+       *  The request_id lets the plug-in match the return values to
+       *  the call, a plug-in can have several calls in progress.
+       */
+      proc_return.name       = (gchar *) name;
+      proc_return.request_id = request_id;
+      proc_return.nparams    = gimp_value_array_length (return_vals);
+      proc_return.params     = plug_in_args_to_params (return_vals, FALSE);
+
+      /*  The plug-in doesn't wait for the return values of asynchronous
+       *  calls, it may be busy with other things, queue them instead of
+       *  blocking until it reads them.
        */
-      proc_return.name    = proc_run->name;
-      proc_return.nparams = gimp_value_array_length (return_vals);
-      proc_return.params  = plug_in_args_to_params (return_vals, FALSE);
+      if (request_id != 0)
+        {
+          GByteArray *queue = gimp_plug_in_get_return_queue (plug_in);
+
+          success = gp_proc_return_append (queue, &proc_return);
 
-      if (! gp_proc_return_write (plug_in->my_write, &proc_return, plug_in))
+          if (success)
+            gimp_plug_in_send_return_queue (plug_in);
+        }
+      else
+        {
+          success = gp_proc_return_write (plug_in->my_write, &proc_return,
+                                          plug_in);
+        }
+
+      if (! success)
         {
           gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
                         "%s: ERROR", G_STRFUNC);
@@ -631,8 +768,6 @@ gimp_plug_in_handle_proc_run (GimpPlugIn *plug_in,
 
       g_free (proc_return.params);
     }
-
-  gimp_value_array_unref (return_vals);
 }
 
 static void
@@ -665,7 +800,14 @@ gimp_plug_in_handle_proc_return (GimpPlugIn   *plug_in,
                                                    proc_frame->return_vals);
     }
 
-  gimp_plug_in_close (plug_in, FALSE);
+  /*  a persistent plug-in keeps running, it goes idle once the
+   *  return values are handled, for a synchronous call that happens
+   *  in gimp_plug_in_manager_call_run()
+   */
+  if (! plug_in->persistent)
+    gimp_plug_in_close (plug_in, FALSE);
+  else if (! proc_frame->main_loop)
+    gimp_plug_in_manager_persistent_add (plug_in->manager, plug_in);
 }
 
 static void
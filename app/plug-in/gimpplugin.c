@@ -102,6 +102,10 @@ static gboolean   gimp_plug_in_write         (GIOChannel   *channel,
                                               gpointer      data);
 static gboolean   gimp_plug_in_flush         (GIOChannel   *channel,
                                               gpointer      data);
+static gboolean   gimp_plug_in_write_chars   (GIOChannel   *channel,
+                                              const gchar  *buf,
+                                              gsize         count,
+                                              gsize        *bytes_written);
 
 static gboolean   gimp_plug_in_recv_message  (GIOChannel   *channel,
                                               GIOCondition  cond,
@@ -113,6 +117,12 @@ static void       gimp_plug_in_prep_for_exec (gpointer      data);
 #define           gimp_plug_in_prep_for_exec  NULL
 #endif
 
+static void       gimp_plug_in_watch_input   (GimpPlugIn   *plug_in);
+static gboolean   gimp_plug_in_send_returns  (GIOChannel   *channel,
+                                              GIOCondition  cond,
+                                              GimpPlugIn   *plug_in);
+static void       gimp_plug_in_clear_returns (GimpPlugIn   *plug_in);
+
 
 G_DEFINE_TYPE (GimpPlugIn, gimp_plug_in, GIMP_TYPE_OBJECT)
 
@@ -151,7 +161,10 @@ gimp_plug_in_init (GimpPlugIn *plug_in)
   plug_in->his_write          = NULL;
 
   plug_in->input_id           = 0;
+  plug_in->output_id          = 0;
+  plug_in->idle_id            = 0;
   plug_in->write_buffer_index = 0;
+  plug_in->return_queue       = NULL;
 
   plug_in->temp_procedures    = NULL;
 
@@ -376,21 +389,7 @@ gimp_plug_in_open (GimpPlugIn         *plug_in,
   plug_in->his_write = NULL;
 
   if (! synchronous)
-    {
-      GSource *source;
-
-      source = g_io_create_watch (plug_in->my_read,
-                                  G_IO_IN  | G_IO_PRI | G_IO_ERR | G_IO_HUP);
-
-      g_source_set_callback (source,
-                             (GSourceFunc) gimp_plug_in_recv_message, plug_in,
-                             NULL);
-
-      g_source_set_can_recurse (source, TRUE);
-
-      plug_in->input_id = g_source_attach (source, NULL);
-      g_source_unref (source);
-    }
+    gimp_plug_in_watch_input (plug_in);
 
   plug_in->open      = TRUE;
   plug_in->call_mode = call_mode;
@@ -420,6 +419,9 @@ gimp_plug_in_close (GimpPlugIn *plug_in,
 
   plug_in->open = FALSE;
 
+  /*  nobody is going to read them any more  */
+  gimp_plug_in_clear_returns (plug_in);
+
   if (plug_in->pid)
     {
 #ifndef G_OS_WIN32
@@ -502,6 +504,8 @@ gimp_plug_in_close (GimpPlugIn *plug_in,
       plug_in->input_id = 0;
     }
 
+  plug_in->input_blocked = FALSE;
+
   /* Close the pipes. */
   if (plug_in->my_read != NULL)
     {
@@ -688,50 +692,80 @@ gimp_plug_in_flush (GIOChannel *channel,
                     gpointer    data)
 {
   GimpPlugIn *plug_in = data;
+  gsize       count;
+  gsize       bytes;
 
-  if (plug_in->write_buffer_index > 0)
+  /*  queued return values go first, the plug-in would otherwise read
+   *  a message in the middle of a partly sent one
+   */
+  if (plug_in->return_queue && plug_in->return_queue->len > 0)
     {
-      GIOStatus  status;
-      GError    *error = NULL;
-      gint       count;
-      gsize      bytes;
-
-      count = 0;
-      while (count != plug_in->write_buffer_index)
+      for (count = 0; count < plug_in->return_queue->len; count += bytes)
         {
-          do
-            {
-              bytes = 0;
-              status = g_io_channel_write_chars (channel,
-                                                 &plug_in->write_buffer[count],
-                                                 (plug_in->write_buffer_index - count),
-                                                 &bytes,
-                                                 &error);
-            }
-          while (status == G_IO_STATUS_AGAIN);
+          if (! gimp_plug_in_write_chars (channel,
+                                          (const gchar *)
+                                          plug_in->return_queue->data + count,
+                                          plug_in->return_queue->len - count,
+                                          &bytes))
+            return FALSE;
+        }
 
-          if (status != G_IO_STATUS_NORMAL)
-            {
-              if (error)
-                {
-                  g_warning ("%s: plug_in_flush(): error: %s",
-                             gimp_filename_to_utf8 (g_get_prgname ()),
-                             error->message);
-                  g_error_free (error);
-                }
-              else
-                {
-                  g_warning ("%s: plug_in_flush(): error",
-                             gimp_filename_to_utf8 (g_get_prgname ()));
-                }
-
-              return FALSE;
-            }
+      g_byte_array_set_size (plug_in->return_queue, 0);
+    }
+
+  for (count = 0; count < plug_in->write_buffer_index; count += bytes)
+    {
+      if (! gimp_plug_in_write_chars (channel,
+                                      &plug_in->write_buffer[count],
+                                      plug_in->write_buffer_index - count,
+                                      &bytes))
+        return FALSE;
+    }
+
+  plug_in->write_buffer_index = 0;
+
+  return TRUE;
+}
+
+static gboolean
+gimp_plug_in_write_chars (GIOChannel  *channel,
+                          const gchar *buf,
+                          gsize        count,
+                          gsize       *bytes_written)
+{
+  GIOStatus  status;
+  GError    *error = NULL;
 
-          count += bytes;
+  do
+    {
+      *bytes_written = 0;
+      status = g_io_channel_write_chars (channel,
+                                         buf, count, bytes_written,
+                                         &error);
+    }
+  while (status == G_IO_STATUS_AGAIN &&
+         ! (g_io_channel_get_flags (channel) & G_IO_FLAG_NONBLOCK));
+
+  /*  a non-blocking channel is full, try again later  */
+  if (status == G_IO_STATUS_AGAIN)
+    return TRUE;
+
+  if (status != G_IO_STATUS_NORMAL)
+    {
+      if (error)
+        {
+          g_warning ("%s: plug_in_flush(): error: %s",
+                     gimp_filename_to_utf8 (g_get_prgname ()),
+                     error->message);
+          g_error_free (error);
+        }
+      else
+        {
+          g_warning ("%s: plug_in_flush(): error",
+                     gimp_filename_to_utf8 (g_get_prgname ()));
         }
 
-      plug_in->write_buffer_index = 0;
+      return FALSE;
     }
 
   return TRUE;
@@ -753,6 +787,93 @@ gimp_plug_in_prep_for_exec (gpointer data)
 
 #endif
 
+static void
+gimp_plug_in_watch_input (GimpPlugIn *plug_in)
+{
+  GSource *source;
+
+  source = g_io_create_watch (plug_in->my_read,
+                              G_IO_IN  | G_IO_PRI | G_IO_ERR | G_IO_HUP);
+
+  g_source_set_callback (source,
+                         (GSourceFunc) gimp_plug_in_recv_message, plug_in,
+                         NULL);
+
+  g_source_set_can_recurse (source, TRUE);
+
+  plug_in->input_id = g_source_attach (source, NULL);
+  g_source_unref (source);
+}
+
+static gboolean
+gimp_plug_in_send_returns (GIOChannel   *channel,
+                           GIOCondition  cond,
+                           GimpPlugIn   *plug_in)
+{
+  GIOFlags flags;
+  gsize    bytes = 0;
+  gboolean success;
+
+  /*  errors and hangups are handled by the input watch  */
+  if (cond & (G_IO_ERR | G_IO_HUP))
+    {
+      plug_in->output_id = 0;
+
+      return FALSE;
+    }
+
+  /*  send what fits into the pipe, a busy plug-in must not block
+   *  the core
+   */
+  flags = g_io_channel_get_flags (channel);
+  g_io_channel_set_flags (channel, flags | G_IO_FLAG_NONBLOCK, NULL);
+
+  success = gimp_plug_in_write_chars (channel,
+                                      (const gchar *) plug_in->return_queue->data,
+                                      plug_in->return_queue->len,
+                                      &bytes);
+
+  g_io_channel_set_flags (channel, flags, NULL);
+
+  if (! success)
+    {
+      plug_in->output_id = 0;
+
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "%s: ERROR", G_STRFUNC);
+      gimp_plug_in_close (plug_in, TRUE);
+
+      return FALSE;
+    }
+
+  g_byte_array_remove_range (plug_in->return_queue, 0, bytes);
+
+  if (plug_in->return_queue->len == 0)
+    {
+      plug_in->output_id = 0;
+
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+gimp_plug_in_clear_returns (GimpPlugIn *plug_in)
+{
+  if (plug_in->output_id)
+    {
+      g_source_remove (plug_in->output_id);
+      plug_in->output_id = 0;
+    }
+
+  if (plug_in->return_queue)
+    {
+      g_byte_array_free (plug_in->return_queue, TRUE);
+      plug_in->return_queue = NULL;
+    }
+}
+
 GimpPlugInProcFrame *
 gimp_plug_in_get_proc_frame (GimpPlugIn *plug_in)
 {
@@ -1047,3 +1168,70 @@ gimp_plug_in_precision_enabled (GimpPlugIn *plug_in)
 
   return plug_in->precision;
 }
+
+/*  stops reading messages from the plug-in, used while the core works
+ *  on a procedure call the plug-in waits for somewhere else
+ */
+void
+gimp_plug_in_block_input (GimpPlugIn *plug_in)
+{
+  g_return_if_fail (GIMP_IS_PLUG_IN (plug_in));
+  g_return_if_fail (plug_in->input_id != 0);
+
+  g_source_remove (plug_in->input_id);
+  plug_in->input_id = 0;
+
+  plug_in->input_blocked = TRUE;
+}
+
+void
+gimp_plug_in_unblock_input (GimpPlugIn *plug_in)
+{
+  g_return_if_fail (GIMP_IS_PLUG_IN (plug_in));
+
+  if (! plug_in->input_blocked)
+    return;
+
+  plug_in->input_blocked = FALSE;
+
+  if (plug_in->open)
+    gimp_plug_in_watch_input (plug_in);
+}
+
+/*  the return values of asynchronous calls are appended to the return
+ *  queue and sent once the plug-in reads from its pipe, so the core
+ *  doesn't wait for a plug-in that is busy doing something else
+ */
+GByteArray *
+gimp_plug_in_get_return_queue (GimpPlugIn *plug_in)
+{
+  g_return_val_if_fail (GIMP_IS_PLUG_IN (plug_in), NULL);
+
+  if (! plug_in->return_queue)
+    plug_in->return_queue = g_byte_array_new ();
+
+  return plug_in->return_queue;
+}
+
+void
+gimp_plug_in_send_return_queue (GimpPlugIn *plug_in)
+{
+  GSource *source;
+
+  g_return_if_fail (GIMP_IS_PLUG_IN (plug_in));
+  g_return_if_fail (plug_in->open);
+
+  if (plug_in->output_id ||
+      ! plug_in->return_queue || plug_in->return_queue->len == 0)
+    return;
+
+  source = g_io_create_watch (plug_in->my_write,
+                              G_IO_OUT | G_IO_ERR | G_IO_HUP);
+
+  g_source_set_callback (source,
+                         (GSourceFunc) gimp_plug_in_send_returns, plug_in,
+                         NULL);
+
+  plug_in->output_id = g_source_attach (source, NULL);
+  g_source_unref (source);
+}
@@ -48,6 +48,8 @@ struct _GimpPlugIn
   guint                open : 1;        /*  Is the plug-in open?              */
   guint                hup : 1;         /*  Did we receive a G_IO_HUP         */
   guint                precision : 1;   /*  True drawable precision enabled   */
+  guint                persistent : 1;  /*  Keeps running between runs        */
+  guint                input_blocked : 1; /*  Waits for a scheduled call    */
   GPid                 pid;             /*  Plug-in's process id              */
 
   GIOChannel          *my_read;         /*  App's read and write channels     */
@@ -56,9 +58,12 @@ struct _GimpPlugIn
   GIOChannel          *his_write;
 
   guint                input_id;        /*  Id of input proc                  */
+  guint                output_id;       /*  Id of the return queue's writer   */
+  guint                idle_id;         /*  Id of the persistent idle timeout */
 
   gchar                write_buffer[WRITE_BUFFER_SIZE]; /* Buffer for writing */
   gint                 write_buffer_index;              /* Buffer index       */
+  GByteArray          *return_queue;    /*  Unsent returns of async calls     */
 
   GSList              *temp_procedures; /*  Temporary procedures              */
 
@@ -123,5 +128,11 @@ GimpPDBErrorHandler
 void          gimp_plug_in_enable_precision  (GimpPlugIn             *plug_in);
 gboolean      gimp_plug_in_precision_enabled (GimpPlugIn             *plug_in);
 
+void          gimp_plug_in_block_input       (GimpPlugIn             *plug_in);
+void          gimp_plug_in_unblock_input     (GimpPlugIn             *plug_in);
+
+GByteArray  * gimp_plug_in_get_return_queue  (GimpPlugIn             *plug_in);
+void          gimp_plug_in_send_return_queue (GimpPlugIn             *plug_in);
+
 
 #endif /* __GIMP_PLUG_IN_H__ */
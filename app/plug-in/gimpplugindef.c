@@ -123,7 +123,8 @@ gimp_plug_in_def_add_procedure (GimpPlugInDef       *plug_in_def,
   if (overridden)
     gimp_plug_in_def_remove_procedure (plug_in_def, overridden);
 
-  proc->mtime = plug_in_def->mtime;
+  proc->mtime      = plug_in_def->mtime;
+  proc->persistent = plug_in_def->persistent;
 
   gimp_plug_in_procedure_set_locale_domain (proc,
                                             plug_in_def->locale_domain_name);
@@ -232,3 +233,21 @@ gimp_plug_in_def_set_has_init (GimpPlugInDef *plug_in_def,
 
   plug_in_def->has_init = has_init ? TRUE : FALSE;
 }
+
+void
+gimp_plug_in_def_set_persistent (GimpPlugInDef *plug_in_def,
+                                 gboolean       persistent)
+{
+  GSList *list;
+
+  g_return_if_fail (GIMP_IS_PLUG_IN_DEF (plug_in_def));
+
+  plug_in_def->persistent = persistent ? TRUE : FALSE;
+
+  for (list = plug_in_def->procedures; list; list = g_slist_next (list))
+    {
+      GimpPlugInProcedure *proc = list->data;
+
+      proc->persistent = plug_in_def->persistent;
+    }
+}
@@ -46,6 +46,7 @@ struct _GimpPlugInDef
   gint64      mtime;
   gboolean    needs_query;  /* Does the plug-in need to be queried ?     */
   gboolean    has_init;     /* Does the plug-in need to be initialized ? */
+  gboolean    persistent;   /* Can the plug-in run procedures repeatedly ? */
 };
 
 struct _GimpPlugInDefClass
@@ -77,6 +78,8 @@ void   gimp_plug_in_def_set_needs_query   (GimpPlugInDef       *plug_in_def,
                                            gboolean             needs_query);
 void   gimp_plug_in_def_set_has_init      (GimpPlugInDef       *plug_in_def,
                                            gboolean             has_init);
+void   gimp_plug_in_def_set_persistent    (GimpPlugInDef       *plug_in_def,
+                                           gboolean             persistent);
 
 
 #endif /* __GIMP_PLUG_IN_DEF_H__ */
@@ -41,6 +41,7 @@
 #include "gimppluginmanager.h"
 #define __YES_I_NEED_GIMP_PLUG_IN_MANAGER_CALL__
 #include "gimppluginmanager-call.h"
+#include "gimppluginmanager-persistent.h"
 #include "gimppluginshm.h"
 #include "gimptemporaryprocedure.h"
 #include "plug-in-params.h"
@@ -48,86 +49,122 @@
 #include "gimp-intl.h"
 
 
+typedef struct
+{
+  GMainContext *main_context;
+  gint          n_open;
+} CallConcurrentData;
+
+typedef struct
+{
+  CallConcurrentData *data;
+  GimpPlugIn         *plug_in;
+} CallConcurrentPlugIn;
+
+
+static gboolean   gimp_plug_in_manager_call_concurrent_recv
+                                              (GIOChannel           *channel,
+                                               GIOCondition          cond,
+                                               CallConcurrentPlugIn *call);
+static void       gimp_plug_in_manager_call_concurrent_done
+                                              (CallConcurrentPlugIn *call);
+
+
 /*  public functions  */
 
 void
-gimp_plug_in_manager_call_query (GimpPlugInManager *manager,
-                                 GimpContext       *context,
-                                 GimpPlugInDef     *plug_in_def)
+gimp_plug_in_manager_call_concurrent (GimpPlugInManager  *manager,
+                                      GimpContext        *context,
+                                      GimpPlugInCallMode  call_mode,
+                                      GSList             *plug_in_defs,
+                                      gint                max_open,
+                                      GimpInitStatusFunc  status_callback)
 {
-  GimpPlugIn *plug_in;
+  CallConcurrentData  data;
+  GSList             *list;
+  gint                n_plug_ins;
+  gint                nth;
 
   g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
   g_return_if_fail (GIMP_IS_PDB_CONTEXT (context));
-  g_return_if_fail (GIMP_IS_PLUG_IN_DEF (plug_in_def));
+  g_return_if_fail (call_mode == GIMP_PLUG_IN_CALL_QUERY ||
+                    call_mode == GIMP_PLUG_IN_CALL_INIT);
+  g_return_if_fail (status_callback != NULL);
 
-  plug_in = gimp_plug_in_new (manager, context, NULL,
-                              NULL, plug_in_def->prog);
+  data.main_context = g_main_context_new ();
+  data.n_open       = 0;
 
-  if (plug_in)
-    {
-      plug_in->plug_in_def = plug_in_def;
+  n_plug_ins = g_slist_length (plug_in_defs);
+  max_open   = MAX (max_open, 1);
 
-      if (gimp_plug_in_open (plug_in, GIMP_PLUG_IN_CALL_QUERY, TRUE))
+  for (list = plug_in_defs, nth = 0; list || data.n_open > 0; )
+    {
+      /*  keep up to max_open plug-ins running, their messages are
+       *  handled here one at a time, so each of them only ever
+       *  touches its own plug-in def, in the order it sent them
+       */
+      while (list && data.n_open < max_open)
         {
-          while (plug_in->open)
-            {
-              GimpWireMessage msg;
-
-              if (! gimp_wire_read_msg (plug_in->my_read, &msg, plug_in))
-                {
-                  gimp_plug_in_close (plug_in, TRUE);
-                }
-              else
-                {
-                  gimp_plug_in_handle_message (plug_in, &msg);
-                  gimp_wire_destroy (&msg);
-                }
-            }
-        }
+          GimpPlugInDef *plug_in_def = list->data;
+          GimpPlugIn    *plug_in;
+          gchar         *basename;
 
-      g_object_unref (plug_in);
-    }
-}
+          list = g_slist_next (list);
 
-void
-gimp_plug_in_manager_call_init (GimpPlugInManager *manager,
-                                GimpContext       *context,
-                                GimpPlugInDef     *plug_in_def)
-{
-  GimpPlugIn *plug_in;
+          basename = g_filename_display_basename (plug_in_def->prog);
+          status_callback (NULL, basename,
+                           (gdouble) nth++ / (gdouble) n_plug_ins);
+          g_free (basename);
 
-  g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
-  g_return_if_fail (GIMP_IS_PDB_CONTEXT (context));
-  g_return_if_fail (GIMP_IS_PLUG_IN_DEF (plug_in_def));
+          if (manager->gimp->be_verbose)
+            g_print (call_mode == GIMP_PLUG_IN_CALL_QUERY ?
+                     "Querying plug-in: '%s'\n" :
+                     "Initializing plug-in: '%s'\n",
+                     gimp_filename_to_utf8 (plug_in_def->prog));
 
-  plug_in = gimp_plug_in_new (manager, context, NULL,
-                              NULL, plug_in_def->prog);
+          plug_in = gimp_plug_in_new (manager, context, NULL,
+                                      NULL, plug_in_def->prog);
 
-  if (plug_in)
-    {
-      plug_in->plug_in_def = plug_in_def;
+          if (! plug_in)
+            continue;
 
-      if (gimp_plug_in_open (plug_in, GIMP_PLUG_IN_CALL_INIT, TRUE))
-        {
-          while (plug_in->open)
+          plug_in->plug_in_def = plug_in_def;
+
+          if (gimp_plug_in_open (plug_in, call_mode, TRUE))
             {
-              GimpWireMessage msg;
-
-              if (! gimp_wire_read_msg (plug_in->my_read, &msg, plug_in))
-                {
-                  gimp_plug_in_close (plug_in, TRUE);
-                }
-              else
-                {
-                  gimp_plug_in_handle_message (plug_in, &msg);
-                  gimp_wire_destroy (&msg);
-                }
+              CallConcurrentPlugIn *call = g_slice_new (CallConcurrentPlugIn);
+              GSource              *source;
+
+              call->data    = &data;
+              call->plug_in = plug_in;
+
+              source = g_io_create_watch (plug_in->my_read,
+                                          G_IO_IN  | G_IO_PRI |
+                                          G_IO_ERR | G_IO_HUP);
+
+              g_source_set_callback (source,
+                                     (GSourceFunc)
+                                     gimp_plug_in_manager_call_concurrent_recv,
+                                     call,
+                                     (GDestroyNotify)
+                                     gimp_plug_in_manager_call_concurrent_done);
+
+              g_source_attach (source, data.main_context);
+              g_source_unref (source);
+
+              data.n_open++;
+            }
+          else
+            {
+              g_object_unref (plug_in);
             }
         }
 
-      g_object_unref (plug_in);
+      if (data.n_open > 0)
+        g_main_context_iteration (data.main_context, TRUE);
     }
+
+  g_main_context_unref (data.main_context);
 }
 
 GimpValueArray *
@@ -140,7 +177,8 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
                                GimpObject          *display)
 {
   GimpValueArray *return_vals = NULL;
-  GimpPlugIn     *plug_in;
+  GimpPlugIn     *plug_in     = NULL;
+  gboolean        persistent;
 
   g_return_val_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager), NULL);
   g_return_val_if_fail (GIMP_IS_PDB_CONTEXT (context), NULL);
@@ -149,7 +187,18 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
   g_return_val_if_fail (args != NULL, NULL);
   g_return_val_if_fail (display == NULL || GIMP_IS_OBJECT (display), NULL);
 
-  plug_in = gimp_plug_in_new (manager, context, progress, procedure, NULL);
+  /*  extensions stay running anyway, only plain plug-in procedures
+   *  can be sent to an idle persistent plug-in
+   */
+  persistent = (procedure->persistent &&
+                GIMP_PROCEDURE (procedure)->proc_type == GIMP_PLUGIN);
+
+  if (persistent)
+    plug_in = gimp_plug_in_manager_persistent_take (manager, context,
+                                                    progress, procedure);
+
+  if (! plug_in)
+    plug_in = gimp_plug_in_new (manager, context, progress, procedure, NULL);
 
   if (plug_in)
     {
@@ -161,7 +210,8 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
       gint               display_ID;
       gint               monitor;
 
-      if (! gimp_plug_in_open (plug_in, GIMP_PLUG_IN_CALL_RUN, FALSE))
+      if (! plug_in->open &&
+          ! gimp_plug_in_open (plug_in, GIMP_PLUG_IN_CALL_RUN, FALSE))
         {
           const gchar *name  = gimp_object_get_name (plug_in);
           GError      *error = g_error_new (GIMP_PLUG_IN_ERROR,
@@ -178,6 +228,8 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
           return return_vals;
         }
 
+      plug_in->persistent = persistent;
+
       display_ID = display ? gimp_get_display_ID (manager->gimp, display) : -1;
 
       config.version          = GIMP_PROTOCOL_VERSION;
@@ -190,7 +242,7 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
       config.show_help_button = (gui_config->use_help &&
                                  gui_config->show_help_button);
       config.use_cpu_accel    = manager->gimp->use_cpu_accel;
-      config.gimp_reserved_5  = 0;
+      config.persistent       = persistent;
       config.gimp_reserved_6  = 0;
       config.gimp_reserved_7  = 0;
       config.gimp_reserved_8  = 0;
@@ -205,9 +257,10 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
       config.monitor_number   = monitor;
       config.timestamp        = gimp_get_user_time (manager->gimp);
 
-      proc_run.name    = GIMP_PROCEDURE (procedure)->original_name;
-      proc_run.nparams = gimp_value_array_length (args);
-      proc_run.params  = plug_in_args_to_params (args, FALSE);
+      proc_run.name       = GIMP_PROCEDURE (procedure)->original_name;
+      proc_run.request_id = 0;
+      proc_run.nparams    = gimp_value_array_length (args);
+      proc_run.params     = plug_in_args_to_params (args, FALSE);
 
       if (! gp_config_write (plug_in->my_write, &config, plug_in)     ||
           ! gp_proc_run_write (plug_in->my_write, &proc_run, plug_in) ||
@@ -249,6 +302,29 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
 
           g_main_loop_unref (plug_in->ext_main_loop);
           plug_in->ext_main_loop = NULL;
+
+          /* Extensions keep running after their acknowledgement, so
+           * a synchronous call returns right here instead of waiting
+           * for return values that may never come
+           */
+          if (synchronous)
+            {
+              GError *error = NULL;
+
+              if (! plug_in->open)
+                error = g_error_new (GIMP_PLUG_IN_ERROR,
+                                     GIMP_PLUG_IN_EXECUTION_FAILED,
+                                     _("Failed to run plug-in \"%s\""),
+                                     gimp_object_get_name (plug_in));
+
+              return_vals = gimp_procedure_get_return_values (GIMP_PROCEDURE (procedure),
+                                                              error == NULL,
+                                                              error);
+              if (error)
+                g_error_free (error);
+
+              synchronous = FALSE;
+            }
         }
 
       /* If this plug-in is requested to run synchronously,
@@ -270,6 +346,9 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
           proc_frame->main_loop = NULL;
 
           return_vals = gimp_plug_in_proc_frame_get_return_values (proc_frame);
+
+          if (plug_in->persistent)
+            gimp_plug_in_manager_persistent_add (manager, plug_in);
         }
 
       g_object_unref (plug_in);
@@ -304,9 +383,10 @@ gimp_plug_in_manager_call_run_temp (GimpPlugInManager      *manager,
       proc_frame = gimp_plug_in_proc_frame_push (plug_in, context, progress,
                                                  procedure);
 
-      proc_run.name    = GIMP_PROCEDURE (procedure)->original_name;
-      proc_run.nparams = gimp_value_array_length (args);
-      proc_run.params  = plug_in_args_to_params (args, FALSE);
+      proc_run.name       = GIMP_PROCEDURE (procedure)->original_name;
+      proc_run.request_id = 0;
+      proc_run.nparams    = gimp_value_array_length (args);
+      proc_run.params     = plug_in_args_to_params (args, FALSE);
 
       if (! gp_temp_proc_run_write (plug_in->my_write, &proc_run, plug_in) ||
           ! gimp_wire_flush (plug_in->my_write, plug_in))
@@ -346,3 +426,48 @@ gimp_plug_in_manager_call_run_temp (GimpPlugInManager      *manager,
 
   return return_vals;
 }
+
+
+/*  private functions  */
+
+static gboolean
+gimp_plug_in_manager_call_concurrent_recv (GIOChannel           *channel,
+                                           GIOCondition          cond,
+                                           CallConcurrentPlugIn *call)
+{
+  GimpPlugIn *plug_in = call->plug_in;
+
+  if (! plug_in->open)
+    return FALSE;
+
+  if (cond & (G_IO_IN | G_IO_PRI))
+    {
+      GimpWireMessage msg;
+
+      if (! gimp_wire_read_msg (plug_in->my_read, &msg, plug_in))
+        {
+          gimp_plug_in_close (plug_in, TRUE);
+        }
+      else
+        {
+          gimp_plug_in_handle_message (plug_in, &msg);
+          gimp_wire_destroy (&msg);
+        }
+    }
+  else if (cond & (G_IO_ERR | G_IO_HUP))
+    {
+      gimp_plug_in_close (plug_in, TRUE);
+    }
+
+  return plug_in->open;
+}
+
+static void
+gimp_plug_in_manager_call_concurrent_done (CallConcurrentPlugIn *call)
+{
+  call->data->n_open--;
+
+  g_object_unref (call->plug_in);
+
+  g_slice_free (CallConcurrentPlugIn, call);
+}
@@ -0,0 +1,208 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimppluginmanager-persistent.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*  Plug-ins which called gimp_plugin_set_persistent() in their query
+ *  function keep running after a procedure returned.  They are kept
+ *  here, idle, until the next call of one of their procedures, or
+ *  until they were idle for PERSISTENT_IDLE_TIMEOUT seconds.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gegl.h>
+
+#include "libgimpbase/gimpbase.h"
+#include "libgimpbase/gimpprotocol.h"
+
+#include "plug-in-types.h"
+
+#include "core/gimp.h"
+#include "core/gimpprogress.h"
+
+#include "pdb/gimppdbcontext.h"
+
+#include "gimpplugin.h"
+#include "gimppluginmanager.h"
+#include "gimppluginmanager-persistent.h"
+#include "gimppluginprocedure.h"
+
+
+#define PERSISTENT_IDLE_TIMEOUT 60  /*  seconds  */
+#define PERSISTENT_MAX_IDLE     8
+
+
+static gboolean   gimp_plug_in_manager_persistent_timeout (GimpPlugIn *plug_in);
+static void       gimp_plug_in_manager_persistent_quit    (GimpPlugIn *plug_in);
+
+
+/*  public functions  */
+
+GimpPlugIn *
+gimp_plug_in_manager_persistent_take (GimpPlugInManager   *manager,
+                                      GimpContext         *context,
+                                      GimpProgress        *progress,
+                                      GimpPlugInProcedure *procedure)
+{
+  const gchar *prog;
+  GSList      *list;
+
+  g_return_val_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager), NULL);
+  g_return_val_if_fail (GIMP_IS_PDB_CONTEXT (context), NULL);
+  g_return_val_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress), NULL);
+  g_return_val_if_fail (GIMP_IS_PLUG_IN_PROCEDURE (procedure), NULL);
+
+  prog = gimp_plug_in_procedure_get_progname (procedure);
+
+  for (list = manager->persistent_plug_ins; list; list = g_slist_next (list))
+    {
+      GimpPlugIn *plug_in = list->data;
+
+      /*  plug-ins which died while idle are dropped by the timeout  */
+      if (plug_in->open && ! strcmp (plug_in->prog, prog))
+        {
+          manager->persistent_plug_ins =
+            g_slist_delete_link (manager->persistent_plug_ins, list);
+
+          g_source_remove (plug_in->idle_id);
+          plug_in->idle_id = 0;
+
+          gimp_plug_in_proc_frame_init (&plug_in->main_proc_frame,
+                                        context, progress, procedure);
+
+          if (manager->gimp->be_verbose)
+            g_print ("Reusing persistent plug-in: '%s'\n",
+                     gimp_filename_to_utf8 (plug_in->prog));
+
+          /*  the pool's reference is passed on to the caller  */
+          return plug_in;
+        }
+    }
+
+  return NULL;
+}
+
+void
+gimp_plug_in_manager_persistent_add (GimpPlugInManager *manager,
+                                     GimpPlugIn        *plug_in)
+{
+  g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
+  g_return_if_fail (GIMP_IS_PLUG_IN (plug_in));
+  g_return_if_fail (plug_in->persistent);
+
+  if (! plug_in->open)
+    return;
+
+  /*  a plug-in which still serves temporary procedures, or talks to
+   *  us in any other way, is not idle and can't be reused
+   */
+  if (plug_in->temp_procedures || plug_in->temp_proc_frames)
+    {
+      gimp_plug_in_manager_persistent_quit (plug_in);
+      return;
+    }
+
+  /*  finish the run like closing the plug-in would, end its
+   *  progress, undo groups and shadow buffers
+   */
+  gimp_plug_in_proc_frame_dispose (&plug_in->main_proc_frame, plug_in);
+
+  if (g_slist_length (manager->persistent_plug_ins) >= PERSISTENT_MAX_IDLE)
+    {
+      GSList     *last   = g_slist_last (manager->persistent_plug_ins);
+      GimpPlugIn *oldest = last->data;
+
+      manager->persistent_plug_ins =
+        g_slist_delete_link (manager->persistent_plug_ins, last);
+
+      g_source_remove (oldest->idle_id);
+      oldest->idle_id = 0;
+
+      gimp_plug_in_manager_persistent_quit (oldest);
+      g_object_unref (oldest);
+    }
+
+  plug_in->idle_id =
+    g_timeout_add_seconds (PERSISTENT_IDLE_TIMEOUT,
+                           (GSourceFunc) gimp_plug_in_manager_persistent_timeout,
+                           plug_in);
+
+  manager->persistent_plug_ins = g_slist_prepend (manager->persistent_plug_ins,
+                                                  g_object_ref (plug_in));
+}
+
+void
+gimp_plug_in_manager_persistent_clear (GimpPlugInManager *manager)
+{
+  g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
+
+  while (manager->persistent_plug_ins)
+    {
+      GimpPlugIn *plug_in = manager->persistent_plug_ins->data;
+
+      manager->persistent_plug_ins =
+        g_slist_delete_link (manager->persistent_plug_ins,
+                             manager->persistent_plug_ins);
+
+      g_source_remove (plug_in->idle_id);
+      plug_in->idle_id = 0;
+
+      gimp_plug_in_manager_persistent_quit (plug_in);
+      g_object_unref (plug_in);
+    }
+}
+
+
+/*  private functions  */
+
+static gboolean
+gimp_plug_in_manager_persistent_timeout (GimpPlugIn *plug_in)
+{
+  GimpPlugInManager *manager = plug_in->manager;
+
+  plug_in->idle_id = 0;
+
+  manager->persistent_plug_ins = g_slist_remove (manager->persistent_plug_ins,
+                                                 plug_in);
+
+  gimp_plug_in_manager_persistent_quit (plug_in);
+  g_object_unref (plug_in);
+
+  return FALSE;
+}
+
+static void
+gimp_plug_in_manager_persistent_quit (GimpPlugIn *plug_in)
+{
+  if (! plug_in->open)
+    return;
+
+  if (plug_in->manager->gimp->be_verbose)
+    g_print ("Quitting persistent plug-in: '%s'\n",
+             gimp_filename_to_utf8 (plug_in->prog));
+
+  /*  the plug-in waits for its next message, ask it to quit and
+   *  let gimp_plug_in_close() wait for it like after any other run
+   */
+  if (gp_quit_write (plug_in->my_write, plug_in))
+    gimp_plug_in_close (plug_in, FALSE);
+  else
+    gimp_plug_in_close (plug_in, TRUE);
+}
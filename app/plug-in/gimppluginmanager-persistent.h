@@ -0,0 +1,33 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimppluginmanager-persistent.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_PLUG_IN_MANAGER_PERSISTENT_H__
+#define __GIMP_PLUG_IN_MANAGER_PERSISTENT_H__
+
+
+GimpPlugIn * gimp_plug_in_manager_persistent_take  (GimpPlugInManager   *manager,
+                                                    GimpContext         *context,
+                                                    GimpProgress        *progress,
+                                                    GimpPlugInProcedure *procedure);
+void         gimp_plug_in_manager_persistent_add   (GimpPlugInManager   *manager,
+                                                    GimpPlugIn          *plug_in);
+void         gimp_plug_in_manager_persistent_clear (GimpPlugInManager   *manager);
+
+
+#endif /* __GIMP_PLUG_IN_MANAGER_PERSISTENT_H__ */
@@ -22,6 +22,7 @@
 #include <string.h>
 
 #include <gegl.h>
+#include <glib/gstdio.h>
 
 #include "libgimpbase/gimpbase.h"
 #include "libgimpconfig/gimpconfig.h"
@@ -45,6 +46,7 @@
 #include "gimppluginmanager-restore.h"
 #include "gimppluginprocedure.h"
 #include "plug-in-rc.h"
+#include "plug-in-rc-binary.h"
 
 #include "gimp-intl.h"
 
@@ -55,12 +57,19 @@ static gchar * gimp_plug_in_manager_get_pluginrc      (GimpPlugInManager      *m
 static void    gimp_plug_in_manager_read_pluginrc     (GimpPlugInManager      *manager,
                                                        const gchar            *pluginrc,
                                                        GimpInitStatusFunc      status_callback);
+static GSList * gimp_plug_in_manager_read_pluginrc_binary
+                                                      (GimpPlugInManager      *manager,
+                                                       const gchar            *pluginrc);
+static gboolean gimp_plug_in_manager_rc_filter        (const gchar            *prog,
+                                                       gint64                  mtime,
+                                                       GimpPlugInManager      *manager);
 static void    gimp_plug_in_manager_query_new         (GimpPlugInManager      *manager,
                                                        GimpContext            *context,
                                                        GimpInitStatusFunc      status_callback);
 static void    gimp_plug_in_manager_init_plug_ins     (GimpPlugInManager      *manager,
                                                        GimpContext            *context,
                                                        GimpInitStatusFunc      status_callback);
+static gint    gimp_plug_in_manager_get_max_open      (GimpPlugInManager      *manager);
 static void    gimp_plug_in_manager_run_extensions    (GimpPlugInManager      *manager,
                                                        GimpContext            *context,
                                                        GimpInitStatusFunc      status_callback);
@@ -135,6 +144,25 @@ gimp_plug_in_manager_restore (GimpPlugInManager  *manager,
 				NULL, GIMP_MESSAGE_ERROR, error->message);
           g_clear_error (&error);
         }
+      else
+        {
+          gchar *filename = plug_in_rc_binary_get_filename (pluginrc);
+
+          if (gimp->be_verbose)
+            g_print ("Writing '%s'\n", gimp_filename_to_utf8 (filename));
+
+          /*  only a cache, don't bother the user if it fails  */
+          if (! plug_in_rc_binary_write (manager->plug_in_defs, filename,
+                                         &error))
+            {
+              if (gimp->be_verbose)
+                g_print ("%s\n", error->message);
+
+              g_clear_error (&error);
+            }
+
+          g_free (filename);
+        }
 
       manager->write_pluginrc = FALSE;
     }
@@ -287,7 +315,10 @@ gimp_plug_in_manager_read_pluginrc (GimpPlugInManager  *manager,
   if (manager->gimp->be_verbose)
     g_print ("Parsing '%s'\n", gimp_filename_to_utf8 (pluginrc));
 
-  rc_defs = plug_in_rc_parse (manager->gimp, pluginrc, &error);
+  rc_defs = gimp_plug_in_manager_read_pluginrc_binary (manager, pluginrc);
+
+  if (! rc_defs)
+    rc_defs = plug_in_rc_parse (manager->gimp, pluginrc, &error);
 
   if (rc_defs)
     {
@@ -308,51 +339,103 @@ gimp_plug_in_manager_read_pluginrc (GimpPlugInManager  *manager,
     }
 }
 
+/* read the binary copy of pluginrc, if it is at least as new as the
+ * text file, which stays the authoritative one: it can be removed or
+ * edited by hand
+ */
+static GSList *
+gimp_plug_in_manager_read_pluginrc_binary (GimpPlugInManager *manager,
+                                           const gchar       *pluginrc)
+{
+  GSList    *rc_defs = NULL;
+  gchar     *filename;
+  GStatBuf   text_stat;
+  GStatBuf   binary_stat;
+
+  filename = plug_in_rc_binary_get_filename (pluginrc);
+
+  if (g_stat (pluginrc, &text_stat)    == 0 &&
+      g_stat (filename, &binary_stat)  == 0 &&
+      binary_stat.st_mtime >= text_stat.st_mtime)
+    {
+      GError *error = NULL;
+
+      if (manager->gimp->be_verbose)
+        g_print ("Parsing '%s'\n", gimp_filename_to_utf8 (filename));
+
+      rc_defs = plug_in_rc_binary_parse (manager->gimp, filename,
+                                         (PlugInRcFilterFunc)
+                                         gimp_plug_in_manager_rc_filter,
+                                         manager,
+                                         &error);
+
+      if (error)
+        {
+          if (manager->gimp->be_verbose)
+            g_print ("%s\n", error->message);
+
+          g_clear_error (&error);
+        }
+    }
+
+  g_free (filename);
+
+  return rc_defs;
+}
+
+/* only plug-ins which are on disk and unchanged use their procedures
+ * from pluginrc, see gimp_plug_in_manager_add_from_rc()
+ */
+static gboolean
+gimp_plug_in_manager_rc_filter (const gchar       *prog,
+                                gint64             mtime,
+                                GimpPlugInManager *manager)
+{
+  GSList *list;
+
+  for (list = manager->plug_in_defs; list; list = list->next)
+    {
+      GimpPlugInDef *ondisk_plug_in_def = list->data;
+
+      if (ondisk_plug_in_def->mtime == mtime &&
+          ! g_ascii_strcasecmp (ondisk_plug_in_def->prog, prog))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
 /* query any plug-ins that changed since we last wrote out pluginrc */
 static void
 gimp_plug_in_manager_query_new (GimpPlugInManager  *manager,
                                 GimpContext        *context,
                                 GimpInitStatusFunc  status_callback)
 {
+  GSList *query = NULL;
   GSList *list;
-  gint    n_plugins;
 
   status_callback (_("Querying new Plug-ins"), "", 0.0);
 
-  for (list = manager->plug_in_defs, n_plugins = 0; list; list = list->next)
+  for (list = manager->plug_in_defs; list; list = list->next)
     {
       GimpPlugInDef *plug_in_def = list->data;
 
       if (plug_in_def->needs_query)
-        n_plugins++;
+        query = g_slist_prepend (query, plug_in_def);
     }
 
-  if (n_plugins)
+  if (query)
     {
-      gint nth;
-
       manager->write_pluginrc = TRUE;
 
-      for (list = manager->plug_in_defs, nth = 0; list; list = list->next)
-        {
-          GimpPlugInDef *plug_in_def = list->data;
-
-          if (plug_in_def->needs_query)
-            {
-              gchar *basename;
-
-              basename = g_filename_display_basename (plug_in_def->prog);
-              status_callback (NULL, basename,
-                               (gdouble) nth++ / (gdouble) n_plugins);
-              g_free (basename);
+      query = g_slist_reverse (query);
 
-              if (manager->gimp->be_verbose)
-                g_print ("Querying plug-in: '%s'\n",
-                         gimp_filename_to_utf8 (plug_in_def->prog));
+      gimp_plug_in_manager_call_concurrent (manager, context,
+                                            GIMP_PLUG_IN_CALL_QUERY, query,
+                                            gimp_plug_in_manager_get_max_open (manager),
+                                            status_callback);
 
-              gimp_plug_in_manager_call_query (manager, context, plug_in_def);
-            }
-        }
+      g_slist_free (query);
     }
 
   status_callback (NULL, "", 1.0);
@@ -364,48 +447,45 @@ gimp_plug_in_manager_init_plug_ins (GimpPlugInManager  *manager,
                                     GimpContext        *context,
                                     GimpInitStatusFunc  status_callback)
 {
+  GSList *init = NULL;
   GSList *list;
-  gint    n_plugins;
 
   status_callback (_("Initializing Plug-ins"), "", 0.0);
 
-  for (list = manager->plug_in_defs, n_plugins = 0; list; list = list->next)
+  for (list = manager->plug_in_defs; list; list = list->next)
     {
       GimpPlugInDef *plug_in_def = list->data;
 
       if (plug_in_def->has_init)
-        n_plugins++;
+        init = g_slist_prepend (init, plug_in_def);
     }
 
-  if (n_plugins)
+  if (init)
     {
-      gint nth;
-
-      for (list = manager->plug_in_defs, nth = 0; list; list = list->next)
-        {
-          GimpPlugInDef *plug_in_def = list->data;
-
-          if (plug_in_def->has_init)
-            {
-              gchar *basename;
-
-              basename = g_filename_display_basename (plug_in_def->prog);
-              status_callback (NULL, basename,
-                               (gdouble) nth++ / (gdouble) n_plugins);
-              g_free (basename);
+      init = g_slist_reverse (init);
 
-              if (manager->gimp->be_verbose)
-                g_print ("Initializing plug-in: '%s'\n",
-                         gimp_filename_to_utf8 (plug_in_def->prog));
+      gimp_plug_in_manager_call_concurrent (manager, context,
+                                            GIMP_PLUG_IN_CALL_INIT, init,
+                                            gimp_plug_in_manager_get_max_open (manager),
+                                            status_callback);
 
-              gimp_plug_in_manager_call_init (manager, context, plug_in_def);
-            }
-        }
+      g_slist_free (init);
     }
 
   status_callback (NULL, "", 1.0);
 }
 
+/* the number of plug-ins to query or initialize at the same time,
+ * they spend most of that time starting up, so don't be shy
+ */
+static gint
+gimp_plug_in_manager_get_max_open (GimpPlugInManager *manager)
+{
+  GimpGeglConfig *config = GIMP_GEGL_CONFIG (manager->gimp->config);
+
+  return MAX (2 * (gint) config->num_processors, 1);
+}
+
 /* run automatically started extensions */
 static void
 gimp_plug_in_manager_run_extensions (GimpPlugInManager  *manager,
@@ -47,6 +47,7 @@
 #include "gimppluginmanager-history.h"
 #include "gimppluginmanager-locale-domain.h"
 #include "gimppluginmanager-menu-branch.h"
+#include "gimppluginmanager-persistent.h"
 #include "gimppluginshm.h"
 #include "gimptemporaryprocedure.h"
 
@@ -137,26 +138,27 @@ gimp_plug_in_manager_class_init (GimpPlugInManagerClass *klass)
 static void
 gimp_plug_in_manager_init (GimpPlugInManager *manager)
 {
-  manager->gimp               = NULL;
-
-  manager->plug_in_defs       = NULL;
-  manager->write_pluginrc     = FALSE;
-
-  manager->plug_in_procedures = NULL;
-  manager->load_procs         = NULL;
-  manager->save_procs         = NULL;
-  manager->export_procs       = NULL;
-
-  manager->current_plug_in    = NULL;
-  manager->open_plug_ins      = NULL;
-  manager->plug_in_stack      = NULL;
-  manager->history            = NULL;
-
-  manager->shm                = NULL;
-  manager->interpreter_db     = gimp_interpreter_db_new ();
-  manager->environ_table      = gimp_environ_table_new ();
-  manager->debug              = NULL;
-  manager->data_list          = NULL;
+  manager->gimp                = NULL;
+
+  manager->plug_in_defs        = NULL;
+  manager->write_pluginrc      = FALSE;
+
+  manager->plug_in_procedures  = NULL;
+  manager->load_procs          = NULL;
+  manager->save_procs          = NULL;
+  manager->export_procs        = NULL;
+
+  manager->current_plug_in     = NULL;
+  manager->open_plug_ins       = NULL;
+  manager->persistent_plug_ins = NULL;
+  manager->plug_in_stack       = NULL;
+  manager->history             = NULL;
+
+  manager->shm                 = NULL;
+  manager->interpreter_db      = gimp_interpreter_db_new ();
+  manager->environ_table       = gimp_environ_table_new ();
+  manager->debug               = NULL;
+  manager->data_list           = NULL;
 }
 
 static void
@@ -322,6 +324,8 @@ gimp_plug_in_manager_exit (GimpPlugInManager *manager)
 {
   g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
 
+  gimp_plug_in_manager_persistent_clear (manager);
+
   while (manager->open_plug_ins)
     gimp_plug_in_close (manager->open_plug_ins->data, TRUE);
 
@@ -54,6 +54,7 @@ struct _GimpPlugInManager
 
   GimpPlugIn        *current_plug_in;
   GSList            *open_plug_ins;
+  GSList            *persistent_plug_ins;
   GSList            *plug_in_stack;
   GSList            *history;
 
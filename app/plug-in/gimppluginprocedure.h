@@ -54,6 +54,7 @@ struct _GimpPlugInProcedure
   GimpPlugInImageType  image_types_val;
   gint64               mtime;
   gboolean             installed_during_init;
+  gboolean             persistent;
 
   /*  file proc specific members  */
   gboolean             file_proc;
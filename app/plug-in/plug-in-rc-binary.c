@@ -0,0 +1,770 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * plug-in-rc-binary.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*  The binary pluginrc holds the same data as the text pluginrc, in a
+ *  form which can be mapped and read without any tokenizing:
+ *
+ *    header:   magic, file version, protocol version, byte order mark,
+ *              number of plug-in defs, payload size, payload checksum
+ *    payload:  a table of (offset, size) for each plug-in def, followed
+ *              by the def records
+ *
+ *  Integers are stored in host byte order, strings as a 32 bit length
+ *  (G_MAXUINT32 for NULL) followed by the bytes and a terminating NUL.
+ *  The file is only a cache, whenever anything about it doesn't match
+ *  it is ignored and the text pluginrc is read instead.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib-object.h>
+
+#include "libgimpbase/gimpbase.h"
+#include "libgimpbase/gimpprotocol.h"
+#include "libgimpconfig/gimpconfig.h"
+
+#include "plug-in-types.h"
+
+#include "core/gimp.h"
+
+#include "pdb/gimp-pdb-compat.h"
+
+#include "gimpplugindef.h"
+#include "gimppluginprocedure.h"
+#include "plug-in-rc-binary.h"
+
+#include "gimp-intl.h"
+
+
+#define PLUG_IN_RC_BINARY_MAGIC        "GIMPPRC"
+#define PLUG_IN_RC_BINARY_FILE_VERSION 2
+#define PLUG_IN_RC_BINARY_BYTE_ORDER   0x01020304
+#define PLUG_IN_RC_BINARY_NULL_STRING  G_MAXUINT32
+
+
+typedef struct
+{
+  gchar   magic[8];
+  guint32 file_version;
+  guint32 protocol_version;
+  guint32 byte_order;
+  guint32 n_plug_in_defs;
+  guint32 payload_size;
+  guint32 checksum;
+} PlugInRcHeader;
+
+typedef struct
+{
+  const guchar *data;
+  gsize         size;
+  gsize         pos;
+  gboolean      error;
+} PlugInRcReader;
+
+
+static GimpPlugInDef * plug_in_rc_binary_read_def  (PlugInRcReader      *reader,
+                                                    Gimp                *gimp,
+                                                    PlugInRcFilterFunc   filter,
+                                                    gpointer             filter_data);
+static GimpPlugInProcedure *
+                       plug_in_rc_binary_read_proc (PlugInRcReader      *reader,
+                                                    Gimp                *gimp,
+                                                    const gchar         *prog);
+
+static guint32         reader_uint32               (PlugInRcReader      *reader);
+static gint64          reader_int64                (PlugInRcReader      *reader);
+static const guchar  * reader_data                 (PlugInRcReader      *reader,
+                                                    gsize                size);
+static gchar         * reader_string               (PlugInRcReader      *reader);
+
+static void            writer_uint32               (GByteArray          *array,
+                                                    guint32              value);
+static void            writer_int64                (GByteArray          *array,
+                                                    gint64               value);
+static void            writer_string               (GByteArray          *array,
+                                                    const gchar         *string);
+static void            writer_data                 (GByteArray          *array,
+                                                    const guint8        *data,
+                                                    gsize                size);
+static void            writer_def                  (GByteArray          *array,
+                                                    GimpPlugInDef       *plug_in_def);
+static void            writer_proc                 (GByteArray          *array,
+                                                    GimpPlugInProcedure *proc);
+
+static guint32         plug_in_rc_binary_checksum  (const guchar        *data,
+                                                    gsize                size);
+
+
+/*  public functions  */
+
+gchar *
+plug_in_rc_binary_get_filename (const gchar *filename)
+{
+  g_return_val_if_fail (filename != NULL, NULL);
+
+  return g_strconcat (filename, ".bin", NULL);
+}
+
+GSList *
+plug_in_rc_binary_parse (Gimp                *gimp,
+                         const gchar         *filename,
+                         PlugInRcFilterFunc   filter,
+                         gpointer             filter_data,
+                         GError             **error)
+{
+  GMappedFile    *file;
+  PlugInRcHeader  header;
+  PlugInRcReader  reader;
+  const guchar   *payload;
+  GSList         *plug_in_defs = NULL;
+  GError         *my_error     = NULL;
+  guint32         i;
+
+  g_return_val_if_fail (GIMP_IS_GIMP (gimp), NULL);
+  g_return_val_if_fail (filename != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  file = g_mapped_file_new (filename, FALSE, &my_error);
+
+  if (! file)
+    {
+      g_set_error (error, GIMP_CONFIG_ERROR,
+                   my_error->code == G_FILE_ERROR_NOENT ?
+                   GIMP_CONFIG_ERROR_OPEN_ENOENT : GIMP_CONFIG_ERROR_OPEN,
+                   _("Could not open '%s' for reading: %s"),
+                   gimp_filename_to_utf8 (filename), my_error->message);
+      g_clear_error (&my_error);
+
+      return NULL;
+    }
+
+  if (g_mapped_file_get_length (file) < sizeof (PlugInRcHeader))
+    goto corrupt;
+
+  memcpy (&header, g_mapped_file_get_contents (file), sizeof (header));
+
+  if (memcmp (header.magic, PLUG_IN_RC_BINARY_MAGIC,
+              sizeof (PLUG_IN_RC_BINARY_MAGIC)) ||
+      header.byte_order != PLUG_IN_RC_BINARY_BYTE_ORDER)
+    goto corrupt;
+
+  if (header.protocol_version != GIMP_PROTOCOL_VERSION)
+    {
+      g_set_error (error,
+                   GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_VERSION,
+                   _("Skipping '%s': wrong GIMP protocol version."),
+                   gimp_filename_to_utf8 (filename));
+      g_mapped_file_unref (file);
+
+      return NULL;
+    }
+
+  if (header.file_version != PLUG_IN_RC_BINARY_FILE_VERSION)
+    {
+      g_set_error (error,
+                   GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_VERSION,
+                   _("Skipping '%s': wrong pluginrc file format version."),
+                   gimp_filename_to_utf8 (filename));
+      g_mapped_file_unref (file);
+
+      return NULL;
+    }
+
+  if (g_mapped_file_get_length (file) - sizeof (PlugInRcHeader) !=
+      header.payload_size)
+    goto corrupt;
+
+  payload = ((const guchar *) g_mapped_file_get_contents (file) +
+             sizeof (PlugInRcHeader));
+
+  if (plug_in_rc_binary_checksum (payload, header.payload_size) !=
+      header.checksum)
+    goto corrupt;
+
+  for (i = 0; i < header.n_plug_in_defs; i++)
+    {
+      GimpPlugInDef *plug_in_def;
+      guint32        offset;
+      guint32        size;
+
+      reader.data  = payload;
+      reader.size  = header.payload_size;
+      reader.pos   = i * 2 * sizeof (guint32);
+      reader.error = FALSE;
+
+      offset = reader_uint32 (&reader);
+      size   = reader_uint32 (&reader);
+
+      if (reader.error ||
+          offset > header.payload_size ||
+          size   > header.payload_size - offset)
+        goto corrupt;
+
+      reader.data = payload + offset;
+      reader.size = size;
+      reader.pos  = 0;
+
+      plug_in_def = plug_in_rc_binary_read_def (&reader, gimp,
+                                                filter, filter_data);
+
+      if (! plug_in_def)
+        goto corrupt;
+
+      plug_in_defs = g_slist_prepend (plug_in_defs, plug_in_def);
+    }
+
+  g_mapped_file_unref (file);
+
+  return g_slist_reverse (plug_in_defs);
+
+ corrupt:
+  g_set_error (error,
+               GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_PARSE,
+               _("Skipping '%s': file is corrupt."),
+               gimp_filename_to_utf8 (filename));
+
+  g_slist_free_full (plug_in_defs, (GDestroyNotify) g_object_unref);
+  g_mapped_file_unref (file);
+
+  return NULL;
+}
+
+gboolean
+plug_in_rc_binary_write (GSList       *plug_in_defs,
+                         const gchar  *filename,
+                         GError      **error)
+{
+  PlugInRcHeader  header = { { 0, }, };
+  GByteArray     *array;
+  GSList         *list;
+  gsize           table;
+  gboolean        success;
+  guint32         n     = 0;
+
+  g_return_val_if_fail (filename != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  for (list = plug_in_defs; list; list = g_slist_next (list))
+    {
+      GimpPlugInDef *plug_in_def = list->data;
+
+      if (plug_in_def->procedures)
+        n++;
+    }
+
+  array = g_byte_array_new ();
+
+  g_byte_array_set_size (array, sizeof (PlugInRcHeader) +
+                                n * 2 * sizeof (guint32));
+
+  table = sizeof (PlugInRcHeader);
+
+  for (list = plug_in_defs; list; list = g_slist_next (list))
+    {
+      GimpPlugInDef *plug_in_def = list->data;
+      guint32        entry[2];
+
+      if (! plug_in_def->procedures)
+        continue;
+
+      entry[0] = array->len - sizeof (PlugInRcHeader);
+
+      writer_def (array, plug_in_def);
+
+      entry[1] = array->len - sizeof (PlugInRcHeader) - entry[0];
+
+      memcpy (array->data + table, entry, sizeof (entry));
+      table += sizeof (entry);
+    }
+
+  memcpy (header.magic, PLUG_IN_RC_BINARY_MAGIC,
+          sizeof (PLUG_IN_RC_BINARY_MAGIC));
+  header.file_version     = PLUG_IN_RC_BINARY_FILE_VERSION;
+  header.protocol_version = GIMP_PROTOCOL_VERSION;
+  header.byte_order       = PLUG_IN_RC_BINARY_BYTE_ORDER;
+  header.n_plug_in_defs   = n;
+  header.payload_size     = array->len - sizeof (PlugInRcHeader);
+  header.checksum         =
+    plug_in_rc_binary_checksum (array->data + sizeof (PlugInRcHeader),
+                                header.payload_size);
+
+  memcpy (array->data, &header, sizeof (header));
+
+  success = g_file_set_contents (filename,
+                                 (const gchar *) array->data, array->len,
+                                 error);
+
+  g_byte_array_free (array, TRUE);
+
+  return success;
+}
+
+
+/*  private functions  */
+
+static GimpPlugInDef *
+plug_in_rc_binary_read_def (PlugInRcReader     *reader,
+                            Gimp               *gimp,
+                            PlugInRcFilterFunc  filter,
+                            gpointer            filter_data)
+{
+  GimpPlugInDef *plug_in_def;
+  gchar         *prog;
+  gchar         *domain_name;
+  gchar         *domain_path;
+  gint64         mtime;
+  guint32        n_procs;
+  guint32        i;
+
+  prog  = reader_string (reader);
+  mtime = reader_int64 (reader);
+
+  if (reader->error || ! prog)
+    {
+      g_free (prog);
+      return NULL;
+    }
+
+  plug_in_def = gimp_plug_in_def_new (prog);
+  plug_in_def->mtime = mtime;
+
+  /*  nobody is going to use this plug-in's procedures, the plug-in
+   *  changed or is gone, so don't even look at them
+   */
+  if (filter && ! filter (prog, mtime, filter_data))
+    {
+      g_free (prog);
+      return plug_in_def;
+    }
+
+  n_procs = reader_uint32 (reader);
+
+  for (i = 0; i < n_procs && ! reader->error; i++)
+    {
+      GimpPlugInProcedure *proc;
+
+      proc = plug_in_rc_binary_read_proc (reader, gimp, prog);
+
+      if (proc)
+        {
+          gimp_plug_in_def_add_procedure (plug_in_def, proc);
+          g_object_unref (proc);
+        }
+    }
+
+  g_free (prog);
+
+  domain_name = reader_string (reader);
+  domain_path = reader_string (reader);
+
+  if (domain_name)
+    gimp_plug_in_def_set_locale_domain (plug_in_def, domain_name, domain_path);
+
+  g_free (domain_name);
+  g_free (domain_path);
+
+  domain_name = reader_string (reader);
+  domain_path = reader_string (reader);
+
+  if (domain_name)
+    gimp_plug_in_def_set_help_domain (plug_in_def, domain_name, domain_path);
+
+  g_free (domain_name);
+  g_free (domain_path);
+
+  if (reader_uint32 (reader))
+    gimp_plug_in_def_set_has_init (plug_in_def, TRUE);
+
+  if (reader_uint32 (reader))
+    gimp_plug_in_def_set_persistent (plug_in_def, TRUE);
+
+  if (reader->error)
+    {
+      g_object_unref (plug_in_def);
+      return NULL;
+    }
+
+  return plug_in_def;
+}
+
+static GimpPlugInProcedure *
+plug_in_rc_binary_read_proc (PlugInRcReader *reader,
+                             Gimp           *gimp,
+                             const gchar    *prog)
+{
+  GimpProcedure       *procedure;
+  GimpPlugInProcedure *proc;
+  gchar               *name;
+  gchar               *str;
+  gint                 proc_type;
+  guint32              n_menu_paths;
+  guint32              n_args;
+  guint32              n_return_vals;
+  guint32              i;
+
+  name      = reader_string (reader);
+  proc_type = reader_uint32 (reader);
+
+  if (reader->error || ! name)
+    {
+      g_free (name);
+      return NULL;
+    }
+
+  procedure = gimp_plug_in_procedure_new (proc_type, prog);
+  proc      = GIMP_PLUG_IN_PROCEDURE (procedure);
+
+  gimp_object_take_name (GIMP_OBJECT (procedure),
+                         gimp_canonicalize_identifier (name));
+
+  procedure->original_name = name;
+
+  procedure->blurb     = reader_string (reader);
+  procedure->help      = reader_string (reader);
+  procedure->author    = reader_string (reader);
+  procedure->copyright = reader_string (reader);
+  procedure->date      = reader_string (reader);
+  proc->menu_label     = reader_string (reader);
+
+  n_menu_paths = reader_uint32 (reader);
+
+  for (i = 0; i < n_menu_paths && ! reader->error; i++)
+    proc->menu_paths = g_list_append (proc->menu_paths,
+                                      reader_string (reader));
+
+  proc->icon_type        = reader_uint32 (reader);
+  proc->icon_data_length = reader_uint32 (reader);
+
+  switch (proc->icon_type)
+    {
+    case GIMP_ICON_TYPE_STOCK_ID:
+    case GIMP_ICON_TYPE_IMAGE_FILE:
+      proc->icon_data_length = -1;
+      proc->icon_data        = (guint8 *) reader_string (reader);
+      break;
+
+    case GIMP_ICON_TYPE_INLINE_PIXBUF:
+      {
+        const guchar *data;
+
+        data = reader_data (reader, MAX (proc->icon_data_length, 0));
+
+        if (data)
+          proc->icon_data = g_memdup (data, proc->icon_data_length);
+      }
+      break;
+
+    default:
+      reader->error = TRUE;
+      break;
+    }
+
+  if (reader_uint32 (reader))
+    {
+      proc->file_proc  = TRUE;
+      proc->extensions = reader_string (reader);
+      proc->prefixes   = reader_string (reader);
+      proc->magics     = reader_string (reader);
+
+      str = reader_string (reader);
+      if (str)
+        gimp_plug_in_procedure_set_mime_type (proc, str);
+      g_free (str);
+
+      if (reader_uint32 (reader))
+        gimp_plug_in_procedure_set_handles_uri (proc);
+
+      str = reader_string (reader);
+      if (str)
+        gimp_plug_in_procedure_set_thumb_loader (proc, str);
+      g_free (str);
+    }
+
+  str = reader_string (reader);
+  gimp_plug_in_procedure_set_image_types (proc, str);
+  g_free (str);
+
+  n_args        = reader_uint32 (reader);
+  n_return_vals = reader_uint32 (reader);
+
+  for (i = 0; i < n_args + n_return_vals && ! reader->error; i++)
+    {
+      GParamSpec *pspec;
+      gint        arg_type;
+      gchar      *arg_name;
+      gchar      *arg_desc;
+
+      arg_type = reader_uint32 (reader);
+      arg_name = reader_string (reader);
+      arg_desc = reader_string (reader);
+
+      if (! reader->error)
+        {
+          pspec = gimp_pdb_compat_param_spec (gimp, arg_type,
+                                              arg_name, arg_desc);
+
+          if (i < n_args)
+            gimp_procedure_add_argument (procedure, pspec);
+          else
+            gimp_procedure_add_return_value (procedure, pspec);
+        }
+
+      g_free (arg_name);
+      g_free (arg_desc);
+    }
+
+  if (reader->error)
+    {
+      g_object_unref (procedure);
+      return NULL;
+    }
+
+  return proc;
+}
+
+static guint32
+reader_uint32 (PlugInRcReader *reader)
+{
+  const guchar *data = reader_data (reader, sizeof (guint32));
+  guint32       value;
+
+  if (! data)
+    return 0;
+
+  memcpy (&value, data, sizeof (value));
+
+  return value;
+}
+
+static gint64
+reader_int64 (PlugInRcReader *reader)
+{
+  const guchar *data = reader_data (reader, sizeof (gint64));
+  gint64        value;
+
+  if (! data)
+    return 0;
+
+  memcpy (&value, data, sizeof (value));
+
+  return value;
+}
+
+static const guchar *
+reader_data (PlugInRcReader *reader,
+             gsize           size)
+{
+  const guchar *data;
+
+  if (reader->error || size > reader->size - reader->pos)
+    {
+      reader->error = TRUE;
+      return NULL;
+    }
+
+  data = reader->data + reader->pos;
+
+  reader->pos += size;
+
+  return data;
+}
+
+static gchar *
+reader_string (PlugInRcReader *reader)
+{
+  const guchar *data;
+  guint32       length;
+
+  length = reader_uint32 (reader);
+
+  if (reader->error || length == PLUG_IN_RC_BINARY_NULL_STRING)
+    return NULL;
+
+  data = reader_data (reader, (gsize) length + 1);
+
+  if (! data || data[length] != '\0')
+    {
+      reader->error = TRUE;
+      return NULL;
+    }
+
+  return g_strndup ((const gchar *) data, length);
+}
+
+static void
+writer_uint32 (GByteArray *array,
+               guint32     value)
+{
+  g_byte_array_append (array, (const guint8 *) &value, sizeof (value));
+}
+
+static void
+writer_int64 (GByteArray *array,
+              gint64      value)
+{
+  g_byte_array_append (array, (const guint8 *) &value, sizeof (value));
+}
+
+static void
+writer_string (GByteArray  *array,
+               const gchar *string)
+{
+  if (string)
+    {
+      gsize length = strlen (string);
+
+      writer_uint32 (array, length);
+      g_byte_array_append (array, (const guint8 *) string, length + 1);
+    }
+  else
+    {
+      writer_uint32 (array, PLUG_IN_RC_BINARY_NULL_STRING);
+    }
+}
+
+static void
+writer_data (GByteArray   *array,
+             const guint8 *data,
+             gsize         size)
+{
+  g_byte_array_append (array, data, size);
+}
+
+static void
+writer_def (GByteArray    *array,
+            GimpPlugInDef *plug_in_def)
+{
+  GSList *list;
+  guint32 n_procs = 0;
+
+  writer_string (array, plug_in_def->prog);
+  writer_int64  (array, plug_in_def->mtime);
+
+  for (list = plug_in_def->procedures; list; list = g_slist_next (list))
+    {
+      GimpPlugInProcedure *proc = list->data;
+
+      if (! proc->installed_during_init)
+        n_procs++;
+    }
+
+  writer_uint32 (array, n_procs);
+
+  for (list = plug_in_def->procedures; list; list = g_slist_next (list))
+    {
+      GimpPlugInProcedure *proc = list->data;
+
+      if (! proc->installed_during_init)
+        writer_proc (array, proc);
+    }
+
+  writer_string (array, plug_in_def->locale_domain_name);
+  writer_string (array, plug_in_def->locale_domain_path);
+  writer_string (array, plug_in_def->help_domain_name);
+  writer_string (array, plug_in_def->help_domain_uri);
+  writer_uint32 (array, plug_in_def->has_init);
+  writer_uint32 (array, plug_in_def->persistent);
+}
+
+static void
+writer_proc (GByteArray          *array,
+             GimpPlugInProcedure *proc)
+{
+  GimpProcedure *procedure = GIMP_PROCEDURE (proc);
+  GList         *list;
+  gint           i;
+
+  writer_string (array, procedure->original_name);
+  writer_uint32 (array, procedure->proc_type);
+  writer_string (array, procedure->blurb);
+  writer_string (array, procedure->help);
+  writer_string (array, procedure->author);
+  writer_string (array, procedure->copyright);
+  writer_string (array, procedure->date);
+  writer_string (array, proc->menu_label);
+
+  writer_uint32 (array, g_list_length (proc->menu_paths));
+  for (list = proc->menu_paths; list; list = g_list_next (list))
+    writer_string (array, list->data);
+
+  writer_uint32 (array, proc->icon_type);
+  writer_uint32 (array, proc->icon_data_length);
+
+  switch (proc->icon_type)
+    {
+    case GIMP_ICON_TYPE_STOCK_ID:
+    case GIMP_ICON_TYPE_IMAGE_FILE:
+      writer_string (array, (const gchar *) proc->icon_data);
+      break;
+
+    case GIMP_ICON_TYPE_INLINE_PIXBUF:
+      writer_data (array, proc->icon_data, proc->icon_data_length);
+      break;
+    }
+
+  writer_uint32 (array, proc->file_proc);
+
+  if (proc->file_proc)
+    {
+      writer_string (array, proc->extensions);
+      writer_string (array, proc->prefixes);
+      writer_string (array, proc->magics);
+      writer_string (array, proc->mime_type);
+      writer_uint32 (array, proc->handles_uri);
+      writer_string (array, proc->thumb_loader);
+    }
+
+  writer_string (array, proc->image_types);
+
+  writer_uint32 (array, procedure->num_args);
+  writer_uint32 (array, procedure->num_values);
+
+  for (i = 0; i < procedure->num_args + procedure->num_values; i++)
+    {
+      GParamSpec *pspec = (i < procedure->num_args ?
+                           procedure->args[i] :
+                           procedure->values[i - procedure->num_args]);
+
+      writer_uint32 (array,
+                     gimp_pdb_compat_arg_type_from_gtype (G_PARAM_SPEC_VALUE_TYPE (pspec)));
+      writer_string (array, g_param_spec_get_name (pspec));
+      writer_string (array, g_param_spec_get_blurb (pspec));
+    }
+}
+
+/*  32 bit FNV-1a, cheap enough to run on every start and good enough
+ *  to notice a truncated or otherwise damaged file
+ */
+static guint32
+plug_in_rc_binary_checksum (const guchar *data,
+                            gsize         size)
+{
+  guint32 hash = 2166136261u;
+  gsize   i;
+
+  for (i = 0; i < size; i++)
+    {
+      hash ^= data[i];
+      hash *= 16777619u;
+    }
+
+  return hash;
+}
@@ -0,0 +1,45 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * plug-in-rc-binary.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __PLUG_IN_RC_BINARY_H__
+#define __PLUG_IN_RC_BINARY_H__
+
+
+/*  Decides whether the procedures of the plug-in @prog, last modified
+ *  at @mtime, are read at all.  Plug-ins it rejects are returned
+ *  without any procedures.
+ */
+typedef gboolean (* PlugInRcFilterFunc) (const gchar *prog,
+                                         gint64       mtime,
+                                         gpointer     user_data);
+
+
+gchar    * plug_in_rc_binary_get_filename (const gchar         *filename);
+
+GSList   * plug_in_rc_binary_parse        (Gimp                *gimp,
+                                           const gchar         *filename,
+                                           PlugInRcFilterFunc   filter,
+                                           gpointer             filter_data,
+                                           GError             **error);
+gboolean   plug_in_rc_binary_write        (GSList              *plug_in_defs,
+                                           const gchar         *filename,
+                                           GError             **error);
+
+
+#endif /* __PLUG_IN_RC_BINARY_H__ */
@@ -0,0 +1,484 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 2009 Martin Nordholts
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+
+#include "widgets/widgets-types.h"
+
+#include "widgets/gimpuimanager.h"
+
+#include "core/gimp.h"
+#include "core/gimpcontext.h"
+#include "core/gimpimage.h"
+#include "core/gimpimage-colormap.h"
+#include "core/gimpimage-convert-type.h"
+#include "core/gimpimage-duplicate.h"
+#include "core/gimplayer.h"
+
+#include "operations/gimplevelsconfig.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+#define GIMP_TEST_IMAGE_SIZE  100
+#define GIMP_TEST_DITHER_SIZE 600
+
+#define ADD_IMAGE_TEST(function) \
+  g_test_add ("/gimp-core/" #function, \
+              GimpTestFixture, \
+              gimp, \
+              gimp_test_image_setup, \
+              function, \
+              gimp_test_image_teardown);
+
+#define ADD_TEST(function) \
+  g_test_add ("/gimp-core/" #function, \
+              GimpTestFixture, \
+              gimp, \
+              NULL, \
+              function, \
+              NULL);
+
+
+typedef struct
+{
+  GimpImage *image;
+} GimpTestFixture;
+
+
+static void gimp_test_image_setup    (GimpTestFixture *fixture,
+                                      gconstpointer    data);
+static void gimp_test_image_teardown (GimpTestFixture *fixture,
+                                      gconstpointer    data);
+
+
+/**
+ * gimp_test_image_setup:
+ * @fixture:
+ * @data:
+ *
+ * Test fixture setup for a single image.
+ **/
+static void
+gimp_test_image_setup (GimpTestFixture *fixture,
+                       gconstpointer    data)
+{
+  Gimp *gimp = GIMP (data);
+
+  fixture->image = gimp_image_new (gimp,
+                                   GIMP_TEST_IMAGE_SIZE,
+                                   GIMP_TEST_IMAGE_SIZE,
+                                   GIMP_RGB,
+                                   GIMP_PRECISION_FLOAT_LINEAR);
+}
+
+/**
+ * gimp_test_image_teardown:
+ * @fixture:
+ * @data:
+ *
+ * Test fixture teardown for a single image.
+ **/
+static void
+gimp_test_image_teardown (GimpTestFixture *fixture,
+                          gconstpointer    data)
+{
+  g_object_unref (fixture->image);
+}
+
+/**
+ * rotate_non_overlapping:
+ * @fixture:
+ * @data:
+ *
+ * Super basic test that makes sure we can add a layer
+ * and call gimp_item_rotate with center at (0, -10)
+ * without triggering a failed assertion .
+ **/
+static void
+rotate_non_overlapping (GimpTestFixture *fixture,
+                        gconstpointer    data)
+{
+  Gimp        *gimp    = GIMP (data);
+  GimpImage   *image   = fixture->image;
+  GimpLayer   *layer;
+  GimpContext *context = gimp_context_new (gimp, "Test", NULL /*template*/);
+  gboolean     result;
+
+  g_assert_cmpint (gimp_image_get_n_layers (image), ==, 0);
+
+  layer = gimp_layer_new (image,
+                          GIMP_TEST_IMAGE_SIZE,
+                          GIMP_TEST_IMAGE_SIZE,
+                          babl_format ("R'G'B'A u8"),
+                          "Test Layer",
+                          1.0,
+                          GIMP_NORMAL_MODE);
+
+  g_assert_cmpint (GIMP_IS_LAYER (layer), ==, TRUE);
+
+  result = gimp_image_add_layer (image,
+                                 layer,
+                                 GIMP_IMAGE_ACTIVE_PARENT,
+                                 0,
+                                 FALSE);
+
+  gimp_item_rotate (GIMP_ITEM (layer), context, GIMP_ROTATE_90, 0., -10., TRUE);
+
+  g_assert_cmpint (result, ==, TRUE);
+  g_assert_cmpint (gimp_image_get_n_layers (image), ==, 1);
+  g_object_unref (context);
+}
+
+/**
+ * add_layer:
+ * @fixture:
+ * @data:
+ *
+ * Super basic test that makes sure we can add a layer.
+ **/
+static void
+add_layer (GimpTestFixture *fixture,
+           gconstpointer    data)
+{
+  GimpImage *image = fixture->image;
+  GimpLayer *layer;
+  gboolean   result;
+
+  g_assert_cmpint (gimp_image_get_n_layers (image), ==, 0);
+
+  layer = gimp_layer_new (image,
+                          GIMP_TEST_IMAGE_SIZE,
+                          GIMP_TEST_IMAGE_SIZE,
+                          babl_format ("R'G'B'A u8"),
+                          "Test Layer",
+                          1.0,
+                          GIMP_NORMAL_MODE);
+
+  g_assert_cmpint (GIMP_IS_LAYER (layer), ==, TRUE);
+
+  result = gimp_image_add_layer (image,
+                                 layer,
+                                 GIMP_IMAGE_ACTIVE_PARENT,
+                                 0,
+                                 FALSE);
+
+  g_assert_cmpint (result, ==, TRUE);
+  g_assert_cmpint (gimp_image_get_n_layers (image), ==, 1);
+}
+
+/**
+ * remove_layer:
+ * @fixture:
+ * @data:
+ *
+ * Super basic test that makes sure we can remove a layer.
+ **/
+static void
+remove_layer (GimpTestFixture *fixture,
+              gconstpointer    data)
+{
+  GimpImage *image = fixture->image;
+  GimpLayer *layer;
+  gboolean   result;
+
+  g_assert_cmpint (gimp_image_get_n_layers (image), ==, 0);
+
+  layer = gimp_layer_new (image,
+                          GIMP_TEST_IMAGE_SIZE,
+                          GIMP_TEST_IMAGE_SIZE,
+                          babl_format ("R'G'B'A u8"),
+                          "Test Layer",
+                          1.0,
+                          GIMP_NORMAL_MODE);
+
+  g_assert_cmpint (GIMP_IS_LAYER (layer), ==, TRUE);
+
+  result = gimp_image_add_layer (image,
+                                 layer,
+                                 GIMP_IMAGE_ACTIVE_PARENT,
+                                 0,
+                                 FALSE);
+
+  g_assert_cmpint (result, ==, TRUE);
+  g_assert_cmpint (gimp_image_get_n_layers (image), ==, 1);
+
+  gimp_image_remove_layer (image,
+                           layer,
+                           FALSE,
+                           NULL);
+
+  g_assert_cmpint (gimp_image_get_n_layers (image), ==, 0);
+}
+
+/**
+ * white_graypoint_in_red_levels:
+ * @fixture:
+ * @data:
+ *
+ * Makes sure the levels algorithm can handle when the graypoint is
+ * white. It's easy to get a divide by zero problem when trying to
+ * calculate what gamma will give a white graypoint.
+ **/
+static void
+white_graypoint_in_red_levels (GimpTestFixture *fixture,
+                               gconstpointer    data)
+{
+  GimpRGB              black   = { 0, 0, 0, 0 };
+  GimpRGB              gray    = { 1, 1, 1, 1 };
+  GimpRGB              white   = { 1, 1, 1, 1 };
+  GimpHistogramChannel channel = GIMP_HISTOGRAM_RED;
+  GimpLevelsConfig    *config;
+
+  config = g_object_new (GIMP_TYPE_LEVELS_CONFIG, NULL);
+
+  gimp_levels_config_adjust_by_colors (config,
+                                       channel,
+                                       &black,
+                                       &gray,
+                                       &white);
+
+  /* Make sure we didn't end up with an invalid gamma value */
+  g_object_set (config,
+                "gamma", config->gamma[channel],
+                NULL);
+}
+
+/**
+ * gimp_test_dither_image_new:
+ * @gimp:
+ *
+ * Creates an RGB image with a few layers of reproducible noise, large
+ * enough for indexed conversion to take its multi-threaded paths.
+ **/
+static GimpImage *
+gimp_test_dither_image_new (Gimp *gimp)
+{
+  GimpImage *image;
+  GRand     *rand;
+  gint       i;
+
+  image = gimp_image_new (gimp,
+                          GIMP_TEST_DITHER_SIZE,
+                          GIMP_TEST_DITHER_SIZE,
+                          GIMP_RGB,
+                          GIMP_PRECISION_U8_GAMMA);
+
+  rand = g_rand_new_with_seed (4711);
+
+  for (i = 0; i < 3; i++)
+    {
+      const Babl *format;
+      GimpLayer  *layer;
+      guchar     *pixels;
+      gsize       size;
+      gsize       j;
+
+      format = babl_format (i == 0 ? "R'G'B' u8" : "R'G'B'A u8");
+
+      layer = gimp_layer_new (image,
+                              GIMP_TEST_DITHER_SIZE,
+                              GIMP_TEST_DITHER_SIZE,
+                              format,
+                              "Test Layer",
+                              1.0,
+                              GIMP_NORMAL_MODE);
+
+      size = (GIMP_TEST_DITHER_SIZE * GIMP_TEST_DITHER_SIZE *
+              babl_format_get_bytes_per_pixel (format));
+
+      pixels = g_malloc (size);
+
+      for (j = 0; j < size; j++)
+        pixels[j] = g_rand_int_range (rand, 0, 256);
+
+      gegl_buffer_set (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
+                       NULL, 0, format, pixels, GEGL_AUTO_ROWSTRIDE);
+
+      g_free (pixels);
+
+      gimp_image_add_layer (image, layer, GIMP_IMAGE_ACTIVE_PARENT, 0, FALSE);
+    }
+
+  g_rand_free (rand);
+
+  return image;
+}
+
+/**
+ * gimp_test_convert_indexed_parallel:
+ * @gimp:
+ * @dither:
+ *
+ * Converts the same image to indexed once on a single thread and once
+ * on several threads, and makes sure the results are identical.
+ **/
+static void
+gimp_test_convert_indexed_parallel (Gimp                  *gimp,
+                                    GimpConvertDitherType  dither)
+{
+  GimpImage *serial;
+  GimpImage *parallel;
+  GList     *serial_layers;
+  GList     *parallel_layers;
+  GList     *list1;
+  GList     *list2;
+  gint       num_processors;
+  gboolean   result;
+
+  g_object_get (gimp->config, "num-processors", &num_processors, NULL);
+
+  serial   = gimp_test_dither_image_new (gimp);
+  parallel = gimp_image_duplicate (serial);
+
+  g_object_set (gimp->config, "num-processors", 1, NULL);
+
+  result = gimp_image_convert_type (serial, GIMP_INDEXED,
+                                    256, dither, TRUE, FALSE, TRUE,
+                                    GIMP_MAKE_PALETTE, NULL, NULL, NULL);
+  g_assert_cmpint (result, ==, TRUE);
+
+  g_object_set (gimp->config, "num-processors", 4, NULL);
+
+  result = gimp_image_convert_type (parallel, GIMP_INDEXED,
+                                    256, dither, TRUE, FALSE, TRUE,
+                                    GIMP_MAKE_PALETTE, NULL, NULL, NULL);
+  g_assert_cmpint (result, ==, TRUE);
+
+  g_object_set (gimp->config, "num-processors", num_processors, NULL);
+
+  g_assert_cmpint (gimp_image_get_colormap_size (serial), ==,
+                   gimp_image_get_colormap_size (parallel));
+  g_assert_cmpint (memcmp (gimp_image_get_colormap (serial),
+                           gimp_image_get_colormap (parallel),
+                           gimp_image_get_colormap_size (serial) * 3), ==, 0);
+
+  serial_layers   = gimp_image_get_layer_list (serial);
+  parallel_layers = gimp_image_get_layer_list (parallel);
+
+  g_assert_cmpint (g_list_length (serial_layers), ==,
+                   g_list_length (parallel_layers));
+
+  for (list1 = serial_layers, list2 = parallel_layers;
+       list1 && list2;
+       list1 = g_list_next (list1), list2 = g_list_next (list2))
+    {
+      GimpDrawable *drawable1 = list1->data;
+      GimpDrawable *drawable2 = list2->data;
+      const Babl   *format    = gimp_drawable_get_format (drawable1);
+      gsize         size;
+      guchar       *pixels1;
+      guchar       *pixels2;
+
+      g_assert (format == gimp_drawable_get_format (drawable2));
+
+      size = (GIMP_TEST_DITHER_SIZE * GIMP_TEST_DITHER_SIZE *
+              babl_format_get_bytes_per_pixel (format));
+
+      pixels1 = g_malloc (size);
+      pixels2 = g_malloc (size);
+
+      gegl_buffer_get (gimp_drawable_get_buffer (drawable1), NULL, 1.0,
+                       format, pixels1,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+      gegl_buffer_get (gimp_drawable_get_buffer (drawable2), NULL, 1.0,
+                       format, pixels2,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      g_assert_cmpint (memcmp (pixels1, pixels2, size), ==, 0);
+
+      g_free (pixels1);
+      g_free (pixels2);
+    }
+
+  g_list_free (serial_layers);
+  g_list_free (parallel_layers);
+
+  g_object_unref (serial);
+  g_object_unref (parallel);
+}
+
+/**
+ * convert_indexed_fs_dither_parallel:
+ * @fixture:
+ * @data:
+ *
+ * Makes sure multi-threaded Floyd-Steinberg dithering gives exactly
+ * the same result as the serial code.
+ **/
+static void
+convert_indexed_fs_dither_parallel (GimpTestFixture *fixture,
+                                    gconstpointer    data)
+{
+  gimp_test_convert_indexed_parallel (GIMP (data), GIMP_FS_DITHER);
+}
+
+/**
+ * convert_indexed_fs_lowbleed_dither_parallel:
+ * @fixture:
+ * @data:
+ *
+ * Same as convert_indexed_fs_dither_parallel(), for the low-bleed
+ * variant of Floyd-Steinberg dithering.
+ **/
+static void
+convert_indexed_fs_lowbleed_dither_parallel (GimpTestFixture *fixture,
+                                             gconstpointer    data)
+{
+  gimp_test_convert_indexed_parallel (GIMP (data), GIMP_FSLOWBLEED_DITHER);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  Gimp *gimp;
+  int   result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  /* We share the same application instance across all tests */
+  gimp = gimp_init_for_testing ();
+
+  /* Add tests */
+  ADD_IMAGE_TEST (add_layer);
+  ADD_IMAGE_TEST (remove_layer);
+  ADD_IMAGE_TEST (rotate_non_overlapping);
+  ADD_TEST (white_graypoint_in_red_levels);
+  ADD_TEST (convert_indexed_fs_dither_parallel);
+  ADD_TEST (convert_indexed_fs_lowbleed_dither_parallel);
+
+  /* Run the tests */
+  result = g_test_run ();
+
+  /* Don't write files to the source dir */
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  /* Exit so we don't break script-fu plug-in wire */
+  gimp_exit (gimp, TRUE);
+
+  return result;
+}
@@ -37,7 +37,8 @@
 #include "gimpfontlist.h"
 
 
-#define CONF_FNAME "fonts.conf"
+#define CONF_FNAME         "fonts.conf"
+#define FONTS_PENDING_KEY  "gimp-fonts-pending"
 
 
 static gboolean gimp_fonts_load_fonts_conf (FcConfig    *config,
@@ -64,13 +65,20 @@ gimp_fonts_load (Gimp *gimp)
   FcConfig *config;
   gchar    *fonts_conf;
   gchar    *path;
+  GTimer   *timer = NULL;
 
   g_return_if_fail (GIMP_IS_FONT_LIST (gimp->fonts));
 
+  g_object_set_data (G_OBJECT (gimp->fonts), FONTS_PENDING_KEY, NULL);
+
   gimp_set_busy (gimp);
 
   if (gimp->be_verbose)
-    g_print ("Loading fonts\n");
+    {
+      g_print ("Loading fonts\n");
+
+      timer = g_timer_new ();
+    }
 
   gimp_container_freeze (GIMP_CONTAINER (gimp->fonts));
 
@@ -106,6 +114,40 @@ gimp_fonts_load (Gimp *gimp)
  cleanup:
   gimp_container_thaw (GIMP_CONTAINER (gimp->fonts));
   gimp_unset_busy (gimp);
+
+  if (timer)
+    {
+      g_print ("  %d fonts in %.3f seconds\n",
+               gimp_container_get_n_children (GIMP_CONTAINER (gimp->fonts)),
+               g_timer_elapsed (timer, NULL));
+
+      g_timer_destroy (timer);
+    }
+}
+
+/*  Defers setting up fontconfig and filling the font list until
+ *  fonts are first needed, see gimp_fonts_load_pending().
+ */
+void
+gimp_fonts_load_lazy (Gimp *gimp)
+{
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+  g_return_if_fail (GIMP_IS_FONT_LIST (gimp->fonts));
+
+  g_object_set_data (G_OBJECT (gimp->fonts), FONTS_PENDING_KEY,
+                     GINT_TO_POINTER (TRUE));
+}
+
+void
+gimp_fonts_load_pending (Gimp *gimp)
+{
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  if (gimp->fonts &&
+      g_object_get_data (G_OBJECT (gimp->fonts), FONTS_PENDING_KEY))
+    {
+      gimp_fonts_load (gimp);
+    }
 }
 
 void
@@ -32,6 +32,7 @@
 #include "vectors/gimpvectors.h"
 #include "vectors/gimpanchor.h"
 
+#include "gimp-fonts.h"
 #include "gimptext.h"
 #include "gimptext-vectors.h"
 #include "gimptextlayout.h"
@@ -80,6 +81,8 @@ gimp_text_vectors_new (GimpImage *image,
 
       gimp_image_get_resolution (image, &xres, &yres);
 
+      gimp_fonts_load_pending (image->gimp);
+
       layout = gimp_text_layout_new (text, xres, yres);
       gimp_text_layout_render (layout, cr, text->base_dir, TRUE);
       g_object_unref (layout);
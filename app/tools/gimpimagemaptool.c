@@ -56,6 +56,7 @@
 
 #include "display/gimpdisplay.h"
 #include "display/gimpdisplayshell.h"
+#include "display/gimpdisplayshell-transform.h"
 #include "display/gimptoolgui.h"
 
 #include "gimpcoloroptions.h"
@@ -765,6 +766,27 @@ gimp_image_map_tool_preview (GimpImageMapTool *image_map_tool)
 
   if (image_map_tool->image_map && options->preview)
     {
+      if (tool->display)
+        {
+          GimpDisplayShell *shell = gimp_display_get_shell (tool->display);
+          GeglRectangle     rect;
+          gint              off_x, off_y;
+
+          /*  render what is visible at the display's scale first  */
+          gimp_display_shell_untransform_viewport (shell,
+                                                   &rect.x, &rect.y,
+                                                   &rect.width, &rect.height);
+          gimp_item_get_offset (GIMP_ITEM (image_map_tool->drawable),
+                                &off_x, &off_y);
+
+          rect.x -= off_x;
+          rect.y -= off_y;
+
+          gimp_image_map_set_preview (image_map_tool->image_map,
+                                      MIN (shell->scale_x, shell->scale_y),
+                                      &rect);
+        }
+
       gimp_tool_control_push_preserve (tool->control, TRUE);
 
       gimp_image_map_tool_map (image_map_tool);
@@ -138,6 +138,29 @@ typedef enum
 
 #define WRITE_BUFFER_SIZE  1024
 
+/* Limits the asynchronous calls in flight.  The core reads a call
+ * completely before it writes the return values, so the calls whose
+ * return values didn't arrive yet bound what the core has left unread
+ * in its pipe.  As long as they fit into a pipe, writing another call
+ * can't block while the core blocks flushing queued return values to
+ * us before a message of its own.
+ */
+#define MAX_ASYNC_CALLS    16
+#define MAX_ASYNC_BYTES    16384
+
+typedef struct
+{
+  guint32                   request_id;
+  gchar                    *name;
+  gsize                     size;
+  GimpRunProcedureCallback  callback;
+  gpointer                  user_data;
+  gboolean                  done;
+  gboolean                  finishing;
+  gint                      n_return_vals;
+  GimpParam                *return_vals;
+} GimpAsyncCall;
+
 void gimp_read_expect_msg   (GimpWireMessage *msg,
                              gint             type);
 
@@ -173,6 +196,13 @@ static gboolean   gimp_extension_read          (GIOChannel      *channel,
 static void       gimp_set_pdb_error           (const GimpParam *return_vals,
                                                 gint             n_return_vals);
 
+static void       gimp_async_call_return       (GPProcReturn    *proc_return);
+static void       gimp_async_calls_dispatch    (void);
+static void       gimp_async_calls_finish_all  (void);
+static void       gimp_async_calls_wait        (gsize            size);
+static void       gimp_async_calls_drain       (void);
+static void       gimp_async_calls_read        (void);
+
 
 static GIOChannel *_readchannel  = NULL;
 GIOChannel *_writechannel = NULL;
@@ -197,6 +227,7 @@ static gchar         *_wm_class          = NULL;
 static gchar         *_display_name      = NULL;
 static gint           _monitor_number    = 0;
 static guint32        _timestamp         = 0;
+static gboolean       _persistent        = FALSE;
 static const gchar   *progname           = NULL;
 
 static gchar          write_buffer[WRITE_BUFFER_SIZE];
@@ -206,6 +237,11 @@ static GimpStackTraceMode stack_trace_mode = GIMP_STACK_TRACE_NEVER;
 
 static GHashTable    *temp_proc_ht       = NULL;
 
+static GHashTable    *async_calls        = NULL;
+static guint32        async_call_id      = 0;
+static gint           n_async_running    = 0;
+static gsize          async_bytes        = 0;
+
 static guint          gimp_debug_flags   = 0;
 
 static const GDebugKey gimp_debug_keys[] =
@@ -958,10 +994,20 @@ gimp_read_expect_msg (GimpWireMessage *msg,
       if (! gimp_wire_read_msg (_readchannel, msg, NULL))
         gimp_quit ();
 
-      if (msg->type == type)
-        return; /* up to the caller to call wire_destroy() */
-
-      if (msg->type == GP_TEMP_PROC_RUN || msg->type == GP_QUIT)
+      if (msg->type == GP_PROC_RETURN &&
+          ((GPProcReturn *) msg->data)->request_id != 0)
+        {
+          /*  keep the return values of an asynchronous call, the
+           *  callback is run later, not in the middle of whatever
+           *  we are waiting for here
+           */
+          gimp_async_call_return (msg->data);
+        }
+      else if (msg->type == type)
+        {
+          return; /* up to the caller to call wire_destroy() */
+        }
+      else if (msg->type == GP_TEMP_PROC_RUN || msg->type == GP_QUIT)
         {
           gimp_process_message (msg);
         }
@@ -1005,9 +1051,13 @@ gimp_run_procedure2 (const gchar     *name,
   g_return_val_if_fail (name != NULL, NULL);
   g_return_val_if_fail (n_return_vals != NULL, NULL);
 
-  proc_run.name    = (gchar *) name;
-  proc_run.nparams = n_params;
-  proc_run.params  = (GPParam *) params;
+  proc_run.name       = (gchar *) name;
+  proc_run.request_id = 0;
+  proc_run.nparams    = n_params;
+  proc_run.params     = (GPParam *) params;
+
+  if (n_async_running > 0)
+    gimp_async_calls_wait (gp_proc_run_get_size (&proc_run));
 
   if (! gp_proc_run_write (_writechannel, &proc_run, NULL))
     gimp_quit ();
@@ -1029,6 +1079,152 @@ gimp_run_procedure2 (const gchar     *name,
   return return_vals;
 }
 
+/**
+ * gimp_run_procedure_async:
+ * @name:      the name of the procedure to run
+ * @n_params:  the number of parameters the procedure takes.
+ * @params:    the procedure's parameters array.
+ * @callback:  function to call with the return values, or %NULL
+ * @user_data: data to pass to @callback
+ *
+ * Starts running a GIMP procedure like gimp_run_procedure2(), but
+ * returns without waiting for the procedure's return values, so the
+ * plug-in can go on working while the core executes the procedure.
+ * Several calls can be in progress at the same time, as long as their
+ * parameters are small; otherwise this waits for earlier calls to
+ * return first.  Return values are picked up whenever libgimp talks
+ * to the core, until then the core keeps them queued.
+ *
+ * If @callback is given, it is called with the return values once
+ * they arrived, from gimp_run_procedure_finish(),
+ * gimp_extension_process() or a later gimp_run_procedure_async().
+ * Otherwise the return values are kept until they are collected
+ * with gimp_run_procedure_finish().
+ *
+ * All calls are finished before the plug-in's run procedure returns
+ * to the core, unless collected their return values are dropped.
+ *
+ * Return value: the request ID to pass to gimp_run_procedure_finish().
+ *
+ * Since: 2.10
+ **/
+guint32
+gimp_run_procedure_async (const gchar              *name,
+                          gint                      n_params,
+                          const GimpParam          *params,
+                          GimpRunProcedureCallback  callback,
+                          gpointer                  user_data)
+{
+  GPProcRun      proc_run;
+  GimpAsyncCall *call;
+  gsize          size;
+
+  g_return_val_if_fail (name != NULL, 0);
+
+  if (! async_calls)
+    async_calls = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  proc_run.name       = (gchar *) name;
+  proc_run.request_id = 0;
+  proc_run.nparams    = n_params;
+  proc_run.params     = (GPParam *) params;
+
+  /*  the request_id doesn't change the size  */
+  size = gp_proc_run_get_size (&proc_run);
+
+  /*  pick up what already arrived, so the core's queue of return
+   *  values doesn't grow, and run the callbacks before waiting for a
+   *  free slot, they may start calls of their own
+   */
+  gimp_async_calls_drain ();
+  gimp_async_calls_dispatch ();
+  gimp_async_calls_wait (size);
+
+  /*  0 is for calls waiting for their return values  */
+  if (++async_call_id == 0)
+    async_call_id = 1;
+
+  call = g_slice_new0 (GimpAsyncCall);
+
+  call->request_id = async_call_id;
+  call->name       = g_strdup (name);
+  call->size       = size;
+  call->callback   = callback;
+  call->user_data  = user_data;
+
+  g_hash_table_insert (async_calls, GUINT_TO_POINTER (async_call_id), call);
+  n_async_running++;
+  async_bytes += size;
+
+  proc_run.request_id = async_call_id;
+
+  if (! gp_proc_run_write (_writechannel, &proc_run, NULL))
+    gimp_quit ();
+
+  return async_call_id;
+}
+
+/**
+ * gimp_run_procedure_finish:
+ * @request_id:    the ID returned by gimp_run_procedure_async()
+ * @n_return_vals: return location for the number of return values
+ *
+ * Waits until the procedure started with gimp_run_procedure_async()
+ * returned.  If the call has a callback, the callback is called and
+ * %NULL is returned, otherwise the return values are returned like
+ * by gimp_run_procedure2().
+ *
+ * Return value: the procedure's return values, or %NULL.
+ *
+ * Since: 2.10
+ **/
+GimpParam *
+gimp_run_procedure_finish (guint32  request_id,
+                           gint    *n_return_vals)
+{
+  GimpAsyncCall *call = NULL;
+  GimpParam     *return_vals;
+
+  g_return_val_if_fail (n_return_vals != NULL, NULL);
+
+  *n_return_vals = 0;
+
+  if (async_calls)
+    call = g_hash_table_lookup (async_calls, GUINT_TO_POINTER (request_id));
+
+  g_return_val_if_fail (call != NULL, NULL);
+
+  /*  don't let gimp_async_calls_dispatch() run the callback  */
+  call->finishing = TRUE;
+
+  while (! call->done)
+    gimp_single_message ();
+
+  g_hash_table_remove (async_calls, GUINT_TO_POINTER (request_id));
+
+  gimp_set_pdb_error (call->return_vals, call->n_return_vals);
+
+  if (call->callback)
+    {
+      call->callback (call->name,
+                      call->n_return_vals, call->return_vals,
+                      call->user_data);
+
+      gimp_destroy_params (call->return_vals, call->n_return_vals);
+      return_vals = NULL;
+    }
+  else
+    {
+      *n_return_vals = call->n_return_vals;
+      return_vals    = call->return_vals;
+    }
+
+  g_free (call->name);
+  g_slice_free (GimpAsyncCall, call);
+
+  return return_vals;
+}
+
 /**
  * gimp_destroy_params:
  * @params:   the #GimpParam array to destroy
@@ -1884,6 +2080,13 @@ gimp_loop (void)
         case GP_PROC_RUN:
           gimp_proc_run (msg.data);
           gimp_wire_destroy (&msg);
+
+          /*  a persistent plug-in waits for the next GP_CONFIG and
+           *  GP_PROC_RUN, until the core sends GP_QUIT
+           */
+          if (_persistent)
+            continue;
+
           gimp_close ();
           return;
 
@@ -1944,17 +2147,23 @@ gimp_config (GPConfig *config)
   _show_help_button = config->show_help_button ? TRUE : FALSE;
   _min_colors       = config->min_colors;
   _gdisp_ID         = config->gdisp_ID;
-  _wm_class         = g_strdup (config->wm_class);
-  _display_name     = g_strdup (config->display_name);
   _monitor_number   = config->monitor_number;
   _timestamp        = config->timestamp;
+  _persistent       = config->persistent       ? TRUE : FALSE;
+
+  /*  a persistent plug-in gets a new config for each run  */
+  g_free (_wm_class);
+  _wm_class         = g_strdup (config->wm_class);
+
+  g_free (_display_name);
+  _display_name     = g_strdup (config->display_name);
 
   if (config->app_name)
     g_set_application_name (config->app_name);
 
   gimp_cpu_accel_set_use (config->use_cpu_accel);
 
-  if (_shm_ID != -1)
+  if (_shm_ID != -1 && ! _shm_addr)
     {
 #if defined(USE_SYSV_SHM)
 
@@ -2053,9 +2262,13 @@ gimp_proc_run (GPProcRun *proc_run)
                                  (GimpParam *) proc_run->params,
                                  &n_return_vals, &return_vals);
 
-      proc_return.name    = proc_run->name;
-      proc_return.nparams = n_return_vals;
-      proc_return.params  = (GPParam *) return_vals;
+      /*  the core doesn't expect any return values after ours  */
+      gimp_async_calls_finish_all ();
+
+      proc_return.name       = proc_run->name;
+      proc_return.request_id = 0;
+      proc_return.nparams    = n_return_vals;
+      proc_return.params     = (GPParam *) return_vals;
 
       if (! gp_proc_return_write (_writechannel, &proc_return, NULL))
         gimp_quit ();
@@ -2086,9 +2299,10 @@ gimp_temp_proc_run (GPProcRun *proc_run)
                     (GimpParam *) proc_run->params,
                     &n_return_vals, &return_vals);
 
-      proc_return.name    = proc_run->name;
-      proc_return.nparams = n_return_vals;
-      proc_return.params  = (GPParam *) return_vals;
+      proc_return.name       = proc_run->name;
+      proc_return.request_id = 0;
+      proc_return.nparams    = n_return_vals;
+      proc_return.params     = (GPParam *) return_vals;
 
       if (! gp_temp_proc_return_write (_writechannel, &proc_return, NULL))
         gimp_quit ();
@@ -2115,7 +2329,15 @@ gimp_process_message (GimpWireMessage *msg)
       g_warning ("unexpected proc run message received (should not happen)");
       break;
     case GP_PROC_RETURN:
-      g_warning ("unexpected proc return message received (should not happen)");
+      if (((GPProcReturn *) msg->data)->request_id != 0)
+        {
+          gimp_async_call_return (msg->data);
+          gimp_async_calls_dispatch ();
+        }
+      else
+        {
+          g_warning ("unexpected proc return message received (should not happen)");
+        }
       break;
     case GP_TEMP_PROC_RUN:
       gimp_temp_proc_run (msg->data);
@@ -2184,3 +2406,152 @@ gimp_set_pdb_error (const GimpParam *return_vals,
       break;
     }
 }
+
+static void
+gimp_async_call_return (GPProcReturn *proc_return)
+{
+  GimpAsyncCall *call = NULL;
+
+  if (async_calls)
+    call = g_hash_table_lookup (async_calls,
+                                GUINT_TO_POINTER (proc_return->request_id));
+
+  if (! call || call->done)
+    {
+      g_warning ("unexpected proc return message received (should not happen)");
+      return;
+    }
+
+  call->done          = TRUE;
+  call->n_return_vals = proc_return->nparams;
+  call->return_vals   = (GimpParam *) proc_return->params;
+
+  proc_return->nparams = 0;
+  proc_return->params  = NULL;
+
+  n_async_running--;
+  async_bytes -= call->size;
+}
+
+static gboolean
+gimp_async_call_is_dispatchable (gpointer       key,
+                                 GimpAsyncCall *call,
+                                 gpointer       data)
+{
+  return call->done && call->callback && ! call->finishing;
+}
+
+static void
+gimp_async_calls_dispatch (void)
+{
+  GimpAsyncCall *call;
+
+  if (! async_calls)
+    return;
+
+  /*  callbacks may start or finish other calls, so look the next
+   *  one up each time
+   */
+  while ((call = g_hash_table_find (async_calls,
+                                    (GHRFunc) gimp_async_call_is_dispatchable,
+                                    NULL)))
+    {
+      gint n_return_vals;
+
+      gimp_run_procedure_finish (call->request_id, &n_return_vals);
+    }
+}
+
+static void
+gimp_async_calls_finish_all (void)
+{
+  GHashTableIter iter;
+  gpointer       request_id;
+
+  if (! async_calls)
+    return;
+
+  while (g_hash_table_size (async_calls) > 0)
+    {
+      GimpParam *return_vals;
+      gint       n_return_vals;
+
+      g_hash_table_iter_init (&iter, async_calls);
+      g_hash_table_iter_next (&iter, &request_id, NULL);
+
+      return_vals = gimp_run_procedure_finish (GPOINTER_TO_UINT (request_id),
+                                               &n_return_vals);
+
+      if (return_vals)
+        gimp_destroy_params (return_vals, n_return_vals);
+    }
+}
+
+/*  waits until a call of @size bytes can be written without exceeding
+ *  the limits.  A call bigger than MAX_ASYNC_BYTES is only written
+ *  when no calls are in flight, the core then writes nothing we don't
+ *  wait for
+ */
+static void
+gimp_async_calls_wait (gsize size)
+{
+  while (n_async_running > 0 &&
+         (n_async_running >= MAX_ASYNC_CALLS ||
+          async_bytes + size > MAX_ASYNC_BYTES))
+    {
+      gimp_async_calls_read ();
+    }
+}
+
+/*  reads the messages that are already waiting, without blocking  */
+static void
+gimp_async_calls_drain (void)
+{
+  while (n_async_running > 0)
+    {
+#ifndef G_OS_WIN32
+      fd_set         readfds;
+      struct timeval tv = { 0, 0 };
+
+      FD_ZERO (&readfds);
+      FD_SET (g_io_channel_unix_get_fd (_readchannel), &readfds);
+
+      if (select (FD_SETSIZE, &readfds, NULL, NULL, &tv) <= 0)
+        return;
+#else
+      GPollFD pollfd;
+
+      g_io_channel_win32_make_pollfd (_readchannel, G_IO_IN, &pollfd);
+
+      if (g_io_channel_win32_poll (&pollfd, 1, 0) != 1)
+        return;
+#endif
+
+      gimp_async_calls_read ();
+    }
+}
+
+/*  reads one message like gimp_single_message(), but only keeps the
+ *  return values of asynchronous calls, their callbacks are not run
+ *  from the middle of another call
+ */
+static void
+gimp_async_calls_read (void)
+{
+  GimpWireMessage msg;
+
+  if (! gimp_wire_read_msg (_readchannel, &msg, NULL))
+    gimp_quit ();
+
+  if (msg.type == GP_PROC_RETURN &&
+      ((GPProcReturn *) msg.data)->request_id != 0)
+    {
+      gimp_async_call_return (msg.data);
+    }
+  else
+    {
+      gimp_process_message (&msg);
+    }
+
+  gimp_wire_destroy (&msg);
+}
@@ -86,6 +86,11 @@ typedef void (* GimpRunProc)   (const gchar      *name,
                                 gint             *n_return_vals,
                                 GimpParam       **return_vals);
 
+typedef void (* GimpRunProcedureCallback) (const gchar     *name,
+                                           gint             n_return_vals,
+                                           const GimpParam *return_vals,
+                                           gpointer         user_data);
+
 
 /**
  * GimpPlugInInfo:
@@ -297,6 +302,18 @@ GimpParam    * gimp_run_procedure2      (const gchar     *name,
                                          gint             n_params,
                                          const GimpParam *params);
 
+/* Start running a procedure in the procedure database without
+ *  waiting for its return values, which are passed to the callback
+ *  or collected with 'gimp_run_procedure_finish'.
+ */
+guint32        gimp_run_procedure_async  (const gchar              *name,
+                                          gint                      n_params,
+                                          const GimpParam          *params,
+                                          GimpRunProcedureCallback  callback,
+                                          gpointer                  user_data);
+GimpParam    * gimp_run_procedure_finish (guint32                   request_id,
+                                          gint                     *n_return_vals);
+
 /* Destroy the an array of parameters. This is useful for
  *  destroying the return values returned by a call to
  *  'gimp_run_procedure'.
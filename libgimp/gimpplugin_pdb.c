@@ -355,3 +355,39 @@ gimp_plugin_precision_enabled (void)
 
   return enabled;
 }
+
+/**
+ * gimp_plugin_set_persistent:
+ *
+ * Declares that this plug-in can run its procedures repeatedly.
+ *
+ * Declares that this plug-in's procedures can be run several times in
+ * the same plug-in process. GIMP may then keep the plug-in running
+ * after a procedure returns, and send it the next call of one of its
+ * procedures instead of starting a new process, which saves the
+ * plug-in's startup time on repeated calls. A persistent plug-in must
+ * not rely on its global state being reset between runs. Idle plug-ins
+ * are asked to quit after a while. This procedure can only be called
+ * in the query function of a plug-in.
+ *
+ * Returns: TRUE on success.
+ *
+ * Since: GIMP 2.10
+ **/
+gboolean
+gimp_plugin_set_persistent (void)
+{
+  GimpParam *return_vals;
+  gint nreturn_vals;
+  gboolean success = TRUE;
+
+  return_vals = gimp_run_procedure ("gimp-plugin-set-persistent",
+                                    &nreturn_vals,
+                                    GIMP_PDB_END);
+
+  success = return_vals[0].data.d_status == GIMP_PDB_SUCCESS;
+
+  gimp_destroy_params (return_vals, nreturn_vals);
+
+  return success;
+}
@@ -48,6 +48,7 @@ gboolean                 gimp_plugin_set_pdb_error_handler (GimpPDBErrorHandler
 GimpPDBErrorHandler      gimp_plugin_get_pdb_error_handler (void);
 gboolean                 gimp_plugin_enable_precision      (void);
 gboolean                 gimp_plugin_precision_enabled     (void);
+gboolean                 gimp_plugin_set_persistent        (void);
 
 
 G_END_DECLS
@@ -381,6 +381,68 @@ gimp_procedural_db_proc_val (const gchar     *procedure_name,
   return success;
 }
 
+/**
+ * gimp_procedural_db_proc_signatures:
+ * @num_procs: The number of procedures.
+ * @procedure_names: The procedure names.
+ * @num_bytes: The length of the signatures array.
+ * @signatures: The procedure signatures.
+ *
+ * Returns the signatures of all procedures in the procedural database.
+ *
+ * This procedure returns the names and argument types of all
+ * procedures in the procedural database in one call, for language
+ * bindings which need to know every procedure when they start up. For
+ * each procedure in 'procedure-names', 'signatures' contains one byte
+ * each for its procedure type, its number of arguments and its number
+ * of return values, followed by the type of each argument and each
+ * return value, one byte each.
+ *
+ * Returns: TRUE on success.
+ *
+ * Since: GIMP 2.10
+ **/
+gboolean
+gimp_procedural_db_proc_signatures (gint     *num_procs,
+                                    gchar  ***procedure_names,
+                                    gint     *num_bytes,
+                                    guint8  **signatures)
+{
+  GimpParam *return_vals;
+  gint nreturn_vals;
+  gboolean success = TRUE;
+  gint i;
+
+  return_vals = gimp_run_procedure ("gimp-procedural-db-proc-signatures",
+                                    &nreturn_vals,
+                                    GIMP_PDB_END);
+
+  *num_procs = 0;
+  *procedure_names = NULL;
+  *num_bytes = 0;
+  *signatures = NULL;
+
+  success = return_vals[0].data.d_status == GIMP_PDB_SUCCESS;
+
+  if (success)
+    {
+      *num_procs = return_vals[1].data.d_int32;
+      *procedure_names = g_new (gchar *, *num_procs + 1);
+      for (i = 0; i < *num_procs; i++)
+        (*procedure_names)[i] = g_strdup (return_vals[2].data.d_stringarray[i]);
+      (*procedure_names)[i] = NULL;
+      *num_bytes = return_vals[3].data.d_int32;
+      *signatures = g_new (guint8, *num_bytes);
+      memcpy (*signatures,
+              return_vals[4].data.d_int8array,
+              *num_bytes * sizeof (guint8));
+    }
+
+  gimp_destroy_params (return_vals, nreturn_vals);
+
+  return success;
+}
+
 /**
  * _gimp_procedural_db_get_data:
  * @identifier: The identifier associated with data.
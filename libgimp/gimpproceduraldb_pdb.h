@@ -32,44 +32,48 @@ G_BEGIN_DECLS
 /* For information look into the C source or the html documentation */
 
 
-gchar*                   gimp_procedural_db_temp_name     (void);
-gboolean                 gimp_procedural_db_dump          (const gchar       *filename);
-gboolean                 gimp_procedural_db_query         (const gchar       *name,
-                                                           const gchar       *blurb,
-                                                           const gchar       *help,
-                                                           const gchar       *author,
-                                                           const gchar       *copyright,
-                                                           const gchar       *date,
-                                                           const gchar       *proc_type,
-                                                           gint              *num_matches,
-                                                           gchar           ***procedure_names);
-gboolean                 gimp_procedural_db_proc_exists   (const gchar       *procedure_name);
-G_GNUC_INTERNAL gboolean _gimp_procedural_db_proc_info    (const gchar       *procedure_name,
-                                                           gchar            **blurb,
-                                                           gchar            **help,
-                                                           gchar            **author,
-                                                           gchar            **copyright,
-                                                           gchar            **date,
-                                                           GimpPDBProcType   *proc_type,
-                                                           gint              *num_args,
-                                                           gint              *num_values);
-gboolean                 gimp_procedural_db_proc_arg      (const gchar       *procedure_name,
-                                                           gint               arg_num,
-                                                           GimpPDBArgType    *arg_type,
-                                                           gchar            **arg_name,
-                                                           gchar            **arg_desc);
-gboolean                 gimp_procedural_db_proc_val      (const gchar       *procedure_name,
-                                                           gint               val_num,
-                                                           GimpPDBArgType    *val_type,
-                                                           gchar            **val_name,
-                                                           gchar            **val_desc);
-G_GNUC_INTERNAL gboolean _gimp_procedural_db_get_data     (const gchar       *identifier,
-                                                           gint              *bytes,
-                                                           guint8           **data);
-gint                     gimp_procedural_db_get_data_size (const gchar       *identifier);
-G_GNUC_INTERNAL gboolean _gimp_procedural_db_set_data     (const gchar       *identifier,
-                                                           gint               bytes,
-                                                           const guint8      *data);
+gchar*                   gimp_procedural_db_temp_name       (void);
+gboolean                 gimp_procedural_db_dump            (const gchar       *filename);
+gboolean                 gimp_procedural_db_query           (const gchar       *name,
+                                                             const gchar       *blurb,
+                                                             const gchar       *help,
+                                                             const gchar       *author,
+                                                             const gchar       *copyright,
+                                                             const gchar       *date,
+                                                             const gchar       *proc_type,
+                                                             gint              *num_matches,
+                                                             gchar           ***procedure_names);
+gboolean                 gimp_procedural_db_proc_exists     (const gchar       *procedure_name);
+G_GNUC_INTERNAL gboolean _gimp_procedural_db_proc_info      (const gchar       *procedure_name,
+                                                             gchar            **blurb,
+                                                             gchar            **help,
+                                                             gchar            **author,
+                                                             gchar            **copyright,
+                                                             gchar            **date,
+                                                             GimpPDBProcType   *proc_type,
+                                                             gint              *num_args,
+                                                             gint              *num_values);
+gboolean                 gimp_procedural_db_proc_arg        (const gchar       *procedure_name,
+                                                             gint               arg_num,
+                                                             GimpPDBArgType    *arg_type,
+                                                             gchar            **arg_name,
+                                                             gchar            **arg_desc);
+gboolean                 gimp_procedural_db_proc_val        (const gchar       *procedure_name,
+                                                             gint               val_num,
+                                                             GimpPDBArgType    *val_type,
+                                                             gchar            **val_name,
+                                                             gchar            **val_desc);
+gboolean                 gimp_procedural_db_proc_signatures (gint              *num_procs,
+                                                             gchar           ***procedure_names,
+                                                             gint              *num_bytes,
+                                                             guint8           **signatures);
+G_GNUC_INTERNAL gboolean _gimp_procedural_db_get_data       (const gchar       *identifier,
+                                                             gint              *bytes,
+                                                             guint8           **data);
+gint                     gimp_procedural_db_get_data_size   (const gchar       *identifier);
+G_GNUC_INTERNAL gboolean _gimp_procedural_db_set_data       (const gchar       *identifier,
+                                                             gint               bytes,
+                                                             const guint8      *data);
 
 
 G_END_DECLS
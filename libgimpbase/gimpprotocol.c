@@ -311,6 +311,17 @@ gp_proc_run_write (GIOChannel *channel,
   return TRUE;
 }
 
+gsize
+gp_proc_run_get_size (GPProcRun *proc_run)
+{
+  GimpWireMessage msg;
+
+  msg.type = GP_PROC_RUN;
+  msg.data = proc_run;
+
+  return gimp_wire_get_msg_size (&msg);
+}
+
 gboolean
 gp_proc_return_write (GIOChannel   *channel,
                       GPProcReturn *proc_return,
@@ -330,6 +341,18 @@ gp_proc_return_write (GIOChannel   *channel,
   return TRUE;
 }
 
+gboolean
+gp_proc_return_append (GByteArray   *buffer,
+                       GPProcReturn *proc_return)
+{
+  GimpWireMessage msg;
+
+  msg.type = GP_PROC_RETURN;
+  msg.data = proc_return;
+
+  return gimp_wire_append_msg (buffer, &msg);
+}
+
 gboolean
 gp_temp_proc_run_write (GIOChannel *channel,
                         GPProcRun  *proc_run,
@@ -499,7 +522,7 @@ _gp_config_read (GIOChannel      *channel,
                               user_data))
     goto cleanup;
   if (! _gimp_wire_read_int8 (channel,
-                              (guint8 *) &config->gimp_reserved_5, 1,
+                              (guint8 *) &config->persistent, 1,
                               user_data))
     goto cleanup;
   if (! _gimp_wire_read_int8 (channel,
@@ -591,7 +614,7 @@ _gp_config_write (GIOChannel      *channel,
                                user_data))
     return;
   if (! _gimp_wire_write_int8 (channel,
-                               (const guint8 *) &config->gimp_reserved_5, 1,
+                               (const guint8 *) &config->persistent, 1,
                                user_data))
     return;
   if (! _gimp_wire_write_int8 (channel,
@@ -855,6 +878,9 @@ _gp_proc_run_read (GIOChannel      *channel,
   if (! _gimp_wire_read_string (channel, &proc_run->name, 1, user_data))
     goto cleanup;
 
+  if (! _gimp_wire_read_int32 (channel, &proc_run->request_id, 1, user_data))
+    goto cleanup;
+
   _gp_params_read (channel,
                    &proc_run->params, (guint *) &proc_run->nparams,
                    user_data);
@@ -877,6 +903,9 @@ _gp_proc_run_write (GIOChannel      *channel,
   if (! _gimp_wire_write_string (channel, &proc_run->name, 1, user_data))
     return;
 
+  if (! _gimp_wire_write_int32 (channel, &proc_run->request_id, 1, user_data))
+    return;
+
   _gp_params_write (channel, proc_run->params, proc_run->nparams, user_data);
 }
 
@@ -906,6 +935,10 @@ _gp_proc_return_read (GIOChannel      *channel,
   if (! _gimp_wire_read_string (channel, &proc_return->name, 1, user_data))
     goto cleanup;
 
+  if (! _gimp_wire_read_int32 (channel, &proc_return->request_id, 1,
+                               user_data))
+    goto cleanup;
+
   _gp_params_read (channel,
                    &proc_return->params, (guint *) &proc_return->nparams,
                    user_data);
@@ -928,6 +961,10 @@ _gp_proc_return_write (GIOChannel      *channel,
   if (! _gimp_wire_write_string (channel, &proc_return->name, 1, user_data))
     return;
 
+  if (! _gimp_wire_write_int32 (channel, &proc_return->request_id, 1,
+                                user_data))
+    return;
+
   _gp_params_write (channel,
                     proc_return->params, proc_return->nparams, user_data);
 }
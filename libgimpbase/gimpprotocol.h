@@ -26,7 +26,7 @@ G_BEGIN_DECLS
 
 /* Increment every time the protocol changes
  */
-#define GIMP_PROTOCOL_VERSION  0x0014
+#define GIMP_PROTOCOL_VERSION  0x0016
 
 
 enum
@@ -69,7 +69,7 @@ struct _GPConfig
   gint8    check_type;
   gint8    show_help_button;
   gint8    use_cpu_accel;
-  gint8    gimp_reserved_5;
+  gint8    persistent;
   gint8    gimp_reserved_6;
   gint8    gimp_reserved_7;
   gint8    gimp_reserved_8;
@@ -153,6 +153,7 @@ struct _GPParamDef
 struct _GPProcRun
 {
   gchar   *name;
+  guint32  request_id;  /* 0 for calls waiting for their return */
   guint32  nparams;
   GPParam *params;
 };
@@ -160,6 +161,7 @@ struct _GPProcRun
 struct _GPProcReturn
 {
   gchar   *name;
+  guint32  request_id;  /* the request_id of the GPProcRun */
   guint32  nparams;
   GPParam *params;
 };
@@ -205,9 +207,12 @@ gboolean  gp_tile_data_write        (GIOChannel      *channel,
 gboolean  gp_proc_run_write         (GIOChannel      *channel,
                                      GPProcRun       *proc_run,
                                      gpointer         user_data);
+gsize     gp_proc_run_get_size      (GPProcRun       *proc_run);
 gboolean  gp_proc_return_write      (GIOChannel      *channel,
                                      GPProcReturn    *proc_return,
                                      gpointer         user_data);
+gboolean  gp_proc_return_append     (GByteArray      *buffer,
+                                     GPProcReturn    *proc_return);
 gboolean  gp_temp_proc_run_write    (GIOChannel      *channel,
                                      GPProcRun       *proc_run,
                                      gpointer         user_data);
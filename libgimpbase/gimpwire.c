@@ -22,12 +22,30 @@
 
 #include <glib-object.h>
 
+#ifdef G_OS_UNIX
+#include <errno.h>
+#include <sys/uio.h>
+#endif
+
 #include <libgimpcolor/gimpcolortypes.h>
 
 #include "gimpwire.h"
 
 
+/*  Every message is sent as a frame: its type and the length of its
+ *  payload, followed by the payload.  Knowing the length, the reader
+ *  can fetch the payload in few large reads without ever reading
+ *  into the next message, and the writer can send blocks of at least
+ *  GIMP_WIRE_DIRECT_SIZE bytes straight from the message data.
+ */
+#define GIMP_WIRE_HEADER_SIZE       8
+#define GIMP_WIRE_DIRECT_SIZE       4096
+#define GIMP_WIRE_READ_BUFFER_SIZE  4096
+#define GIMP_WIRE_MAX_IOV           64
+
+
 typedef struct _GimpWireHandler  GimpWireHandler;
+typedef struct _GimpWireSegment  GimpWireSegment;
 
 struct _GimpWireHandler
 {
@@ -37,6 +55,13 @@ struct _GimpWireHandler
   GimpWireDestroyFunc destroy_func;
 };
 
+struct _GimpWireSegment
+{
+  const guint8 *data;    /*  NULL for data in wire_frame  */
+  gsize         offset;
+  gsize         size;
+};
+
 
 static GHashTable        *wire_ht         = NULL;
 static GimpWireIOFunc     wire_read_func  = NULL;
@@ -44,8 +69,46 @@ static GimpWireIOFunc     wire_write_func = NULL;
 static GimpWireFlushFunc  wire_flush_func = NULL;
 static gboolean           wire_error_val  = FALSE;
 
+/*  the frame of the message being written  */
+static GByteArray        *wire_frame      = NULL;
+static GArray            *wire_segments   = NULL;
+static gboolean           wire_framing    = FALSE;
+static gboolean           wire_direct     = FALSE;
+
+/*  the payload of the message being read  */
+static guint8             wire_read_buffer[GIMP_WIRE_READ_BUFFER_SIZE];
+static gsize              wire_read_start     = 0;
+static gsize              wire_read_end       = 0;
+static gsize              wire_read_remaining = 0;
+static gboolean           wire_reading        = FALSE;
+
+
+static void      gimp_wire_init          (void);
+
+static gboolean  gimp_wire_frame_build   (GIOChannel      *channel,
+                                          GimpWireMessage *msg,
+                                          gpointer         user_data,
+                                          gsize           *length);
+static guint8  * gimp_wire_frame_reserve (gsize            size);
+static void      gimp_wire_frame_append  (const guint8    *data,
+                                          gsize            size);
+static gboolean  gimp_wire_frame_write   (GIOChannel      *channel,
+                                          gpointer         user_data);
+#ifdef G_OS_UNIX
+static gboolean  gimp_wire_frame_writev  (GIOChannel      *channel);
+#endif
+static gboolean  gimp_wire_frame_read    (GIOChannel      *channel,
+                                          guint8          *buf,
+                                          gsize            count,
+                                          gpointer         user_data);
+static gboolean  gimp_wire_frame_skip    (GIOChannel      *channel,
+                                          gpointer         user_data);
 
-static void  gimp_wire_init (void);
+static guint8  * gimp_wire_write_begin   (gsize            size);
+static gboolean  gimp_wire_write_end     (GIOChannel      *channel,
+                                          guint8          *data,
+                                          gsize            size,
+                                          gpointer         user_data);
 
 
 void
@@ -250,6 +313,7 @@ gimp_wire_read_msg (GIOChannel      *channel,
                     gpointer         user_data)
 {
   GimpWireHandler *handler;
+  guint32          header[2];
 
   if (G_UNLIKELY (! wire_ht))
     g_error ("gimp_wire_read_msg: the wire protocol has not been initialized");
@@ -257,17 +321,33 @@ gimp_wire_read_msg (GIOChannel      *channel,
   if (wire_error_val)
     return !wire_error_val;
 
-  if (! _gimp_wire_read_int32 (channel, &msg->type, 1, user_data))
+  if (! gimp_wire_read (channel,
+                        (guint8 *) header, GIMP_WIRE_HEADER_SIZE, user_data))
     return FALSE;
 
+  msg->type = g_ntohl (header[0]);
+
   handler = g_hash_table_lookup (wire_ht, &msg->type);
 
   if (G_UNLIKELY (! handler))
     g_error ("gimp_wire_read_msg: could not find handler for message: %d",
              msg->type);
 
+  wire_read_start     = 0;
+  wire_read_end       = 0;
+  wire_read_remaining = g_ntohl (header[1]);
+  wire_reading        = TRUE;
+
   (* handler->read_func) (channel, msg, user_data);
 
+  /*  drop whatever the handler didn't read, so a peer may append
+   *  fields to a message without confusing us
+   */
+  if (! wire_error_val)
+    gimp_wire_frame_skip (channel, user_data);
+
+  wire_reading = FALSE;
+
   return !wire_error_val;
 }
 
@@ -276,26 +356,74 @@ gimp_wire_write_msg (GIOChannel      *channel,
                      GimpWireMessage *msg,
                      gpointer         user_data)
 {
-  GimpWireHandler *handler;
-
-  if (G_UNLIKELY (! wire_ht))
-    g_error ("gimp_wire_write_msg: the wire protocol has not been initialized");
+  guint32 header[2];
+  gsize   length;
 
   if (wire_error_val)
     return !wire_error_val;
 
-  handler = g_hash_table_lookup (wire_ht, &msg->type);
+  if (! gimp_wire_frame_build (channel, msg, user_data, &length))
+    return FALSE;
 
-  if (G_UNLIKELY (! handler))
-    g_error ("gimp_wire_write_msg: could not find handler for message: %d",
-             msg->type);
+  header[0] = g_htonl (msg->type);
+  header[1] = g_htonl (length);
+
+  memcpy (wire_frame->data, header, GIMP_WIRE_HEADER_SIZE);
+
+  return gimp_wire_frame_write (channel, user_data);
+}
+
+/*  the number of bytes gimp_wire_write_msg() sends for @msg, including
+ *  the header, or 0 if @msg can't be sent
+ */
+gsize
+gimp_wire_get_msg_size (GimpWireMessage *msg)
+{
+  gsize length;
 
-  if (! _gimp_wire_write_int32 (channel, &msg->type, 1, user_data))
+  if (wire_error_val)
+    return 0;
+
+  if (! gimp_wire_frame_build (NULL, msg, NULL, &length))
+    return 0;
+
+  return GIMP_WIRE_HEADER_SIZE + length;
+}
+
+/*  appends the frame gimp_wire_write_msg() sends for @msg to @buffer,
+ *  for callers that send it later, when the channel can take it
+ */
+gboolean
+gimp_wire_append_msg (GByteArray      *buffer,
+                      GimpWireMessage *msg)
+{
+  guint32 header[2];
+  gsize   length;
+  guint   i;
+
+  if (wire_error_val)
+    return !wire_error_val;
+
+  if (! gimp_wire_frame_build (NULL, msg, NULL, &length))
     return FALSE;
 
-  (* handler->write_func) (channel, msg, user_data);
+  header[0] = g_htonl (msg->type);
+  header[1] = g_htonl (length);
 
-  return !wire_error_val;
+  memcpy (wire_frame->data, header, GIMP_WIRE_HEADER_SIZE);
+
+  for (i = 0; i < wire_segments->len; i++)
+    {
+      GimpWireSegment *segment = &g_array_index (wire_segments,
+                                                 GimpWireSegment, i);
+      const guint8    *data;
+
+      data = segment->data ? segment->data : wire_frame->data + segment->offset;
+
+      g_byte_array_append (buffer, data, segment->size);
+    }
+
+  return TRUE;
 }
 
 void
@@ -371,6 +499,9 @@ _gimp_wire_read_int8 (GIOChannel *channel,
 {
   g_return_val_if_fail (count >= 0, FALSE);
 
+  if (wire_reading)
+    return gimp_wire_frame_read (channel, data, count, user_data);
+
   return gimp_wire_read (channel, data, count, user_data);
 }
 
@@ -380,35 +511,24 @@ _gimp_wire_read_double (GIOChannel *channel,
                         gint        count,
                         gpointer    user_data)
 {
-  gdouble *t;
-  guint8   tmp[8];
-  gint     i;
-
   g_return_val_if_fail (count >= 0, FALSE);
 
-  t = (gdouble *) tmp;
-
-  for (i = 0; i < count; i++)
+  if (count > 0)
     {
-#if (G_BYTE_ORDER == G_LITTLE_ENDIAN)
-      gint j;
-#endif
-
-      if (! _gimp_wire_read_int8 (channel, tmp, 8, user_data))
+      if (! _gimp_wire_read_int8 (channel,
+                                  (guint8 *) data, count * 8, user_data))
         return FALSE;
 
 #if (G_BYTE_ORDER == G_LITTLE_ENDIAN)
-      for (j = 0; j < 4; j++)
+      while (count--)
         {
-          guint8 swap;
+          union { gdouble d; guint64 i; } tmp;
 
-          swap       = tmp[j];
-          tmp[j]     = tmp[7 - j];
-          tmp[7 - j] = swap;
+          memcpy (&tmp, data, 8);
+          tmp.i = GUINT64_FROM_BE (tmp.i);
+          *data++ = tmp.d;
         }
 #endif
-
-      data[i] = *t;
     }
 
   return TRUE;
@@ -482,16 +602,17 @@ _gimp_wire_write_int32 (GIOChannel    *channel,
 
   if (count > 0)
     {
-      gint i;
+      guint8 *dest = gimp_wire_write_begin (count * 4);
+      gint    i;
 
       for (i = 0; i < count; i++)
         {
           guint32 tmp = g_htonl (data[i]);
 
-          if (! _gimp_wire_write_int8 (channel,
-                                       (const guint8 *) &tmp, 4, user_data))
-            return FALSE;
+          memcpy (dest + i * 4, &tmp, 4);
         }
+
+      return gimp_wire_write_end (channel, dest, count * 4, user_data);
     }
 
   return TRUE;
@@ -507,16 +628,17 @@ _gimp_wire_write_int16 (GIOChannel    *channel,
 
   if (count > 0)
     {
-      gint i;
+      guint8 *dest = gimp_wire_write_begin (count * 2);
+      gint    i;
 
       for (i = 0; i < count; i++)
         {
           guint16 tmp = g_htons (data[i]);
 
-          if (! _gimp_wire_write_int8 (channel,
-                                       (const guint8 *) &tmp, 2, user_data))
-            return FALSE;
+          memcpy (dest + i * 2, &tmp, 2);
         }
+
+      return gimp_wire_write_end (channel, dest, count * 2, user_data);
     }
 
   return TRUE;
@@ -530,6 +652,13 @@ _gimp_wire_write_int8 (GIOChannel   *channel,
 {
   g_return_val_if_fail (count >= 0, FALSE);
 
+  if (wire_framing)
+    {
+      gimp_wire_frame_append (data, count);
+
+      return TRUE;
+    }
+
   return gimp_wire_write (channel, data, count, user_data);
 }
 
@@ -539,47 +668,24 @@ _gimp_wire_write_double (GIOChannel    *channel,
                          gint           count,
                          gpointer       user_data)
 {
-  gdouble *t;
-  guint8   tmp[8];
-  gint     i;
-#if (G_BYTE_ORDER == G_LITTLE_ENDIAN)
-  gint     j;
-#endif
-
   g_return_val_if_fail (count >= 0, FALSE);
 
-  t = (gdouble *) tmp;
-
-  for (i = 0; i < count; i++)
+  if (count > 0)
     {
-      *t = data[i];
+      guint8 *dest = gimp_wire_write_begin (count * 8);
+      gint    i;
 
-#if (G_BYTE_ORDER == G_LITTLE_ENDIAN)
-      for (j = 0; j < 4; j++)
+      for (i = 0; i < count; i++)
         {
-          guint8 swap;
+          union { gdouble d; guint64 i; } tmp;
 
-          swap       = tmp[j];
-          tmp[j]     = tmp[7 - j];
-          tmp[7 - j] = swap;
-        }
-#endif
+          tmp.d = data[i];
+          tmp.i = GUINT64_TO_BE (tmp.i);
 
-      if (! _gimp_wire_write_int8 (channel, tmp, 8, user_data))
-        return FALSE;
-
-#if 0
-      {
-        gint k;
-
-        g_print ("Wire representation of %f:\t", data[i]);
-
-        for (k = 0; k < 8; k++)
-          g_print ("%02x ", tmp[k]);
+          memcpy (dest + i * 8, &tmp, 8);
+        }
 
-        g_print ("\n");
-      }
-#endif
+      return gimp_wire_write_end (channel, dest, count * 8, user_data);
     }
 
   return TRUE;
@@ -645,6 +751,321 @@ static void
 gimp_wire_init (void)
 {
   if (! wire_ht)
-    wire_ht = g_hash_table_new ((GHashFunc) gimp_wire_hash,
-                                (GCompareFunc) gimp_wire_compare);
+    {
+      wire_ht = g_hash_table_new ((GHashFunc) gimp_wire_hash,
+                                  (GCompareFunc) gimp_wire_compare);
+
+      wire_frame    = g_byte_array_new ();
+      wire_segments = g_array_new (FALSE, FALSE, sizeof (GimpWireSegment));
+    }
+}
+
+/*  runs @msg's write function into wire_frame, leaving room for the
+ *  header, and returns the payload length
+ */
+static gboolean
+gimp_wire_frame_build (GIOChannel      *channel,
+                       GimpWireMessage *msg,
+                       gpointer         user_data,
+                       gsize           *length)
+{
+  GimpWireHandler *handler;
+
+  if (G_UNLIKELY (! wire_ht))
+    g_error ("gimp_wire_write_msg: the wire protocol has not been initialized");
+
+  handler = g_hash_table_lookup (wire_ht, &msg->type);
+
+  if (G_UNLIKELY (! handler))
+    g_error ("gimp_wire_write_msg: could not find handler for message: %d",
+             msg->type);
+
+  g_byte_array_set_size (wire_frame, 0);
+  g_array_set_size (wire_segments, 0);
+
+  wire_framing = TRUE;
+  wire_direct  = FALSE;
+
+  /*  the header is filled in once the length is known  */
+  gimp_wire_frame_reserve (GIMP_WIRE_HEADER_SIZE);
+
+  (* handler->write_func) (channel, msg, user_data);
+
+  wire_framing = FALSE;
+
+  if (wire_error_val)
+    return FALSE;
+
+  *length = wire_frame->len - GIMP_WIRE_HEADER_SIZE;
+
+  if (wire_direct)
+    {
+      guint i;
+
+      for (i = 0; i < wire_segments->len; i++)
+        {
+          GimpWireSegment *segment = &g_array_index (wire_segments,
+                                                     GimpWireSegment, i);
+
+          if (segment->data)
+            *length += segment->size;
+        }
+    }
+
+  if (G_UNLIKELY (*length > G_MAXUINT32))
+    {
+      g_warning ("%s: gimp_wire_write_msg(): message too large",
+                 g_get_prgname ());
+      wire_error_val = TRUE;
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static guint8 *
+gimp_wire_frame_reserve (gsize size)
+{
+  gsize offset = wire_frame->len;
+
+  if (wire_segments->len > 0 &&
+      ! g_array_index (wire_segments, GimpWireSegment,
+                       wire_segments->len - 1).data)
+    {
+      g_array_index (wire_segments, GimpWireSegment,
+                     wire_segments->len - 1).size += size;
+    }
+  else
+    {
+      GimpWireSegment segment = { NULL, offset, size };
+
+      g_array_append_val (wire_segments, segment);
+    }
+
+  g_byte_array_set_size (wire_frame, offset + size);
+
+  return wire_frame->data + offset;
+}
+
+static void
+gimp_wire_frame_append (const guint8 *data,
+                        gsize         size)
+{
+  if (size >= GIMP_WIRE_DIRECT_SIZE)
+    {
+      /*  large blocks are referenced, not copied, the message
+       *  outlives the frame
+       */
+      GimpWireSegment segment = { data, 0, size };
+
+      g_array_append_val (wire_segments, segment);
+
+      wire_direct = TRUE;
+    }
+  else if (size > 0)
+    {
+      memcpy (gimp_wire_frame_reserve (size), data, size);
+    }
+}
+
+static gboolean
+gimp_wire_frame_write (GIOChannel *channel,
+                       gpointer    user_data)
+{
+  guint i;
+
+#ifdef G_OS_UNIX
+  /*  send frames with large blocks in one go, bypassing the write
+   *  buffer of the writer, which only needs to be flushed first
+   */
+  if (wire_direct && (wire_flush_func || ! wire_write_func))
+    {
+      if (wire_flush_func && ! gimp_wire_flush (channel, user_data))
+        {
+          wire_error_val = TRUE;
+          return FALSE;
+        }
+
+      return gimp_wire_frame_writev (channel);
+    }
+#endif
+
+  for (i = 0; i < wire_segments->len; i++)
+    {
+      GimpWireSegment *segment = &g_array_index (wire_segments,
+                                                 GimpWireSegment, i);
+      const guint8    *data;
+
+      data = segment->data ? segment->data : wire_frame->data + segment->offset;
+
+      if (! gimp_wire_write (channel, data, segment->size, user_data))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+#ifdef G_OS_UNIX
+static gboolean
+gimp_wire_frame_writev (GIOChannel *channel)
+{
+  GimpWireSegment *segments   = (GimpWireSegment *) wire_segments->data;
+  guint            n_segments = wire_segments->len;
+  guint            i          = 0;
+  gsize            skip       = 0;
+  gint             fd;
+
+  fd = g_io_channel_unix_get_fd (channel);
+
+  while (i < n_segments)
+    {
+      struct iovec iov[GIMP_WIRE_MAX_IOV];
+      gint         n_iov;
+      gssize       bytes;
+
+      for (n_iov = 0;
+           n_iov < GIMP_WIRE_MAX_IOV && i + n_iov < n_segments;
+           n_iov++)
+        {
+          GimpWireSegment *segment = &segments[i + n_iov];
+          const guint8    *data;
+
+          data = segment->data ? segment->data : wire_frame->data + segment->offset;
+
+          iov[n_iov].iov_base = (gpointer) data;
+          iov[n_iov].iov_len  = segment->size;
+        }
+
+      iov[0].iov_base  = (guint8 *) iov[0].iov_base + skip;
+      iov[0].iov_len  -= skip;
+
+      do
+        {
+          bytes = writev (fd, iov, n_iov);
+        }
+      while (G_UNLIKELY (bytes < 0 && (errno == EINTR || errno == EAGAIN)));
+
+      if (G_UNLIKELY (bytes < 0))
+        {
+          g_warning ("%s: gimp_wire_write(): error: %s",
+                     g_get_prgname (), g_strerror (errno));
+          wire_error_val = TRUE;
+          return FALSE;
+        }
+
+      while (i < n_segments && (gsize) bytes >= segments[i].size - skip)
+        {
+          bytes -= segments[i].size - skip;
+          skip   = 0;
+          i++;
+        }
+
+      skip += bytes;
+    }
+
+  return TRUE;
+}
+#endif
+
+static gboolean
+gimp_wire_frame_read (GIOChannel *channel,
+                      guint8     *buf,
+                      gsize       count,
+                      gpointer    user_data)
+{
+  if (G_UNLIKELY (count > wire_read_end - wire_read_start +
+                          wire_read_remaining))
+    {
+      g_warning ("%s: gimp_wire_read(): message too short",
+                 g_get_prgname ());
+      wire_error_val = TRUE;
+      return FALSE;
+    }
+
+  while (count > 0)
+    {
+      gsize bytes = wire_read_end - wire_read_start;
+
+      if (bytes == 0)
+        {
+          /*  large reads go straight to their destination  */
+          if (count >= GIMP_WIRE_READ_BUFFER_SIZE)
+            {
+              if (! gimp_wire_read (channel, buf, count, user_data))
+                return FALSE;
+
+              wire_read_remaining -= count;
+
+              return TRUE;
+            }
+
+          bytes = MIN (wire_read_remaining, GIMP_WIRE_READ_BUFFER_SIZE);
+
+          if (! gimp_wire_read (channel, wire_read_buffer, bytes, user_data))
+            return FALSE;
+
+          wire_read_start      = 0;
+          wire_read_end        = bytes;
+          wire_read_remaining -= bytes;
+        }
+
+      bytes = MIN (bytes, count);
+
+      memcpy (buf, wire_read_buffer + wire_read_start, bytes);
+
+      wire_read_start += bytes;
+      buf             += bytes;
+      count           -= bytes;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+gimp_wire_frame_skip (GIOChannel *channel,
+                      gpointer    user_data)
+{
+  wire_read_start = wire_read_end = 0;
+
+  while (wire_read_remaining > 0)
+    {
+      gsize bytes = MIN (wire_read_remaining, GIMP_WIRE_READ_BUFFER_SIZE);
+
+      if (! gimp_wire_read (channel, wire_read_buffer, bytes, user_data))
+        return FALSE;
+
+      wire_read_remaining -= bytes;
+    }
+
+  return TRUE;
+}
+
+/*  typed values are converted to wire byte order right into the
+ *  frame, outside of a message into a temporary block
+ */
+static guint8 *
+gimp_wire_write_begin (gsize size)
+{
+  if (wire_framing)
+    return gimp_wire_frame_reserve (size);
+
+  return g_malloc (size);
+}
+
+static gboolean
+gimp_wire_write_end (GIOChannel *channel,
+                     guint8     *data,
+                     gsize       size,
+                     gpointer    user_data)
+{
+  gboolean success;
+
+  if (wire_framing)
+    return TRUE;
+
+  success = gimp_wire_write (channel, data, size, user_data);
+
+  g_free (data);
+
+  return success;
 }
@@ -77,6 +77,9 @@ gboolean  gimp_wire_read_msg      (GIOChannel          *channel,
 gboolean  gimp_wire_write_msg     (GIOChannel          *channel,
                                    GimpWireMessage *msg,
                                    gpointer         user_data);
+gsize     gimp_wire_get_msg_size  (GimpWireMessage *msg);
+gboolean  gimp_wire_append_msg    (GByteArray      *buffer,
+                                   GimpWireMessage *msg);
 
 void      gimp_wire_destroy       (GimpWireMessage *msg);
 
@@ -144,6 +144,8 @@ query (void)
                           G_N_ELEMENTS (args), 0,
                           args, NULL);
 
+  /*  scripts call us over and over again, don't restart every time  */
+  gimp_plugin_set_persistent ();
 }
 
 static void
@@ -186,7 +188,10 @@ run (const gchar      *name,
 
       /* initialize pixel regions and buffer */
       if (! unsharp_mask_dialog (drawable))
-        return;
+        {
+          gimp_drawable_detach (drawable);
+          return;
+        }
 
       break;
 
@@ -218,8 +223,6 @@ run (const gchar      *name,
 
   if (status == GIMP_PDB_SUCCESS)
     {
-      drawable = gimp_drawable_get (param[2].data.d_drawable);
-
       /* here we go */
       unsharp_mask (drawable, unsharp_params.radius, unsharp_params.amount);
 
@@ -229,11 +232,13 @@ run (const gchar      *name,
       if (run_mode == GIMP_RUN_INTERACTIVE)
         gimp_set_data (PLUG_IN_PROC,
                        &unsharp_params, sizeof (UnsharpMaskParams));
-
-      gimp_drawable_detach(drawable);
-      values[0].data.d_status = status;
     }
 
+  /*  the plug-in keeps running between calls, don't leak the drawable  */
+  gimp_drawable_detach (drawable);
+
+  values[0].data.d_status = status;
+
 #ifdef TIMER
   g_printerr ("%f seconds\n", g_timer_elapsed (timer, NULL));
   g_timer_destroy (timer);
@@ -49,15 +49,42 @@
 
 #undef cons
 
+typedef struct
+{
+  GimpPDBProcType  proc_type;
+  gint             n_params;
+  gint             n_return_vals;
+  GimpPDBArgType  *params;
+  GimpPDBArgType  *return_vals;
+
+  /*  all params are numbers or strings  */
+  gboolean         simple_params;
+} ProcSignature;
+
+
 static void     ts_init_constants                (scheme    *sc);
 static void     ts_init_procedures               (scheme    *sc,
                                                   gboolean   register_scipts);
 static void     convert_string                   (gchar     *str);
 static pointer  script_fu_marshal_procedure_call (scheme    *sc,
                                                   pointer    a);
+static gint     script_fu_marshal_simple_args    (scheme    *sc,
+                                                  pointer    a,
+                                                  const ProcSignature *signature,
+                                                  GimpParam *args);
 static void     script_fu_marshal_destroy_args   (GimpParam *params,
                                                   gint       n_params);
 
+static ProcSignature * proc_signature_new        (GimpPDBProcType  proc_type,
+                                                  gint             n_params,
+                                                  gint             n_return_vals);
+static void     proc_signature_free              (ProcSignature   *signature);
+static void     proc_signature_update_simple     (ProcSignature   *signature);
+static gboolean proc_signature_is_temporary      (const gchar     *proc_name,
+                                                  ProcSignature   *signature);
+static const ProcSignature *
+                proc_signature_lookup            (const gchar     *proc_name);
+
 static pointer  script_fu_register_call          (scheme    *sc,
                                                   pointer    a);
 static pointer  script_fu_menu_register_call     (scheme    *sc,
@@ -209,6 +236,11 @@ static const NamedConstant const old_constants[] =
 
 static scheme sc;
 
+/*  procedure name -> ProcSignature, saves a proc-info round trip
+ *  to the core for each call of a PDB procedure
+ */
+static GHashTable *proc_signatures = NULL;
+
 
 void
 tinyscheme_init (const gchar *path,
@@ -229,6 +261,10 @@ tinyscheme_init (const gchar *path,
   init_ftx (&sc);
   script_fu_regex_init (&sc);
 
+  proc_signatures = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                           (GDestroyNotify) g_free,
+                                           (GDestroyNotify) proc_signature_free);
+
   /* register in the interpreter the gimp functions and types. */
   ts_init_constants (&sc);
   ts_init_procedures (&sc, register_scripts);
@@ -343,6 +379,18 @@ ts_gstring_output_func (TsOutputType  type,
   g_string_append_len (gstr, string, len);
 }
 
+/* Forget the cached signatures of temporary procedures, needs to be
+ * called whenever temporary procedures are installed or uninstalled.
+ */
+void
+ts_forget_proc_signatures (void)
+{
+  if (proc_signatures)
+    g_hash_table_foreach_remove (proc_signatures,
+                                 (GHRFunc) proc_signature_is_temporary,
+                                 NULL);
+}
+
 
 /*  private functions  */
 
@@ -467,6 +515,10 @@ ts_init_procedures (scheme   *sc,
 {
   gchar   **proc_list;
   gint      num_procs;
+  guint8   *signatures;
+  gint      num_bytes;
+  GString  *defines;
+  gint      offset;
   gint      i;
   pointer   symbol;
 
@@ -505,69 +557,71 @@ ts_init_procedures (scheme   *sc,
                                                       script_fu_marshal_procedure_call));
   sc->vptr->setimmutable (symbol);
 
-  gimp_procedural_db_query (".*", ".*", ".*", ".*", ".*", ".*", ".*",
-                            &num_procs, &proc_list);
+  /*  fetch all procedure signatures at once, querying each procedure
+   *  separately costs several round trips to the core per procedure
+   */
+  if (! gimp_procedural_db_proc_signatures (&num_procs, &proc_list,
+                                            &num_bytes, &signatures))
+    return;
+
+  defines = g_string_new (NULL);
 
   /*  Register each procedure as a scheme func  */
-  for (i = 0; i < num_procs; i++)
+  for (i = 0, offset = 0; i < num_procs; i++)
     {
-      gchar           *proc_blurb;
-      gchar           *proc_help;
-      gchar           *proc_author;
-      gchar           *proc_copyright;
-      gchar           *proc_date;
-      GimpPDBProcType  proc_type;
-      gint             n_params;
-      gint             n_return_vals;
-      GimpParamDef    *params;
-      GimpParamDef    *return_vals;
-
-      /*  lookup the procedure  */
-      if (gimp_procedural_db_proc_info (proc_list[i],
-                                        &proc_blurb,
-                                        &proc_help,
-                                        &proc_author,
-                                        &proc_copyright,
-                                        &proc_date,
-                                        &proc_type,
-                                        &n_params, &n_return_vals,
-                                        &params, &return_vals))
-        {
-          gchar *buff;
+      ProcSignature *signature;
+      gint           n_params;
+      gint           n_return_vals;
+      gint           j;
 
-          /* Build a define that will call the foreign function.
-           * The Scheme statement was suggested by Simon Budig.
-           */
-          if (n_params == 0)
-            {
-              buff = g_strdup_printf (" (define (%s)"
-                                      " (gimp-proc-db-call \"%s\"))",
-                                      proc_list[i], proc_list[i]);
-            }
-          else
-            {
-              buff = g_strdup_printf (" (define %s (lambda x"
-                                      " (apply gimp-proc-db-call (cons \"%s\" x))))",
-                                      proc_list[i], proc_list[i]);
-            }
+      if (offset + 3 > num_bytes)
+        break;
 
-          /*  Execute the 'define'  */
-          sc->vptr->load_string (sc, buff);
+      n_params      = signatures[offset + 1];
+      n_return_vals = signatures[offset + 2];
 
-          g_free (buff);
+      if (offset + 3 + n_params + n_return_vals > num_bytes)
+        break;
 
-          /*  free the queried information  */
-          g_free (proc_blurb);
-          g_free (proc_help);
-          g_free (proc_author);
-          g_free (proc_copyright);
-          g_free (proc_date);
+      /*  the signatures also seed the marshaller's cache  */
+      signature = proc_signature_new (signatures[offset], n_params, n_return_vals);
 
-          gimp_destroy_paramdefs (params, n_params);
-          gimp_destroy_paramdefs (return_vals, n_return_vals);
+      for (j = 0; j < n_params; j++)
+        signature->params[j] = signatures[offset + 3 + j];
+
+      for (j = 0; j < n_return_vals; j++)
+        signature->return_vals[j] = signatures[offset + 3 + n_params + j];
+
+      proc_signature_update_simple (signature);
+
+      g_hash_table_replace (proc_signatures, g_strdup (proc_list[i]), signature);
+
+      offset += 3 + n_params + n_return_vals;
+
+      /* Build a define that will call the foreign function.
+       * The Scheme statement was suggested by Simon Budig.
+       */
+      if (n_params == 0)
+        {
+          g_string_append_printf (defines,
+                                  " (define (%s)"
+                                  " (gimp-proc-db-call \"%s\"))",
+                                  proc_list[i], proc_list[i]);
+        }
+      else
+        {
+          g_string_append_printf (defines,
+                                  " (define %s (lambda x"
+                                  " (apply gimp-proc-db-call (cons \"%s\" x))))",
+                                  proc_list[i], proc_list[i]);
         }
     }
 
+  /*  Execute all the 'define's in one go  */
+  sc->vptr->load_string (sc, defines->str);
+
+  g_string_free (defines, TRUE);
+  g_free (signatures);
   g_strfreev (proc_list);
 }
 
@@ -610,24 +664,19 @@ static pointer
 script_fu_marshal_procedure_call (scheme  *sc,
                                   pointer  a)
 {
-  GimpParam       *args;
-  GimpParam       *values = NULL;
-  gint             nvalues;
-  gchar           *proc_name;
-  gchar           *proc_blurb;
-  gchar           *proc_help;
-  gchar           *proc_author;
-  gchar           *proc_copyright;
-  gchar           *proc_date;
-  GimpPDBProcType  proc_type;
-  gint             nparams;
-  gint             nreturn_vals;
-  GimpParamDef    *params;
-  GimpParamDef    *return_vals;
-  gchar            error_str[1024];
-  gint             i;
-  gint             success = TRUE;
-  pointer          return_val = sc->NIL;
+  GimpParam            *args;
+  GimpParam            *values = NULL;
+  gint                  nvalues;
+  gchar                *proc_name;
+  const ProcSignature  *signature;
+  gint                  nparams;
+  gint                  nargs;
+  const GimpPDBArgType *params;
+  gboolean              simple_params;
+  gchar                 error_str[1024];
+  gint                  i;
+  gint                  success = TRUE;
+  pointer               return_val = sc->NIL;
 
 #if DEBUG_MARSHALL
 /* These three #defines are from Tinyscheme (tinyscheme/scheme.c) */
@@ -668,16 +717,25 @@ script_fu_marshal_procedure_call (scheme  *sc,
   /*  report the current command  */
   script_fu_interface_report_cc (proc_name);
 
-  /*  Attempt to fetch the procedure from the database  */
-  if (! gimp_procedural_db_proc_info (proc_name,
-                                      &proc_blurb,
-                                      &proc_help,
-                                      &proc_author,
-                                      &proc_copyright,
-                                      &proc_date,
-                                      &proc_type,
-                                      &nparams, &nreturn_vals,
-                                      &params, &return_vals))
+  /*  Attempt to fetch the procedure's signature, from the cache
+   *  or from the database
+   */
+  signature = proc_signature_lookup (proc_name);
+
+  nargs = sc->vptr->list_length (sc, a) - 1;
+
+  /*  The cached signature may be stale, a temporary procedure may
+   *  have been installed again with other arguments, so query it
+   *  once more before reporting the wrong number of arguments
+   */
+  if (signature && nargs != signature->n_params)
+    {
+      g_hash_table_remove (proc_signatures, proc_name);
+
+      signature = proc_signature_lookup (proc_name);
+    }
+
+  if (! signature)
     {
 #ifdef DEBUG_MARSHALL
       g_printerr ("  Invalid procedure name\n");
@@ -687,28 +745,23 @@ script_fu_marshal_procedure_call (scheme  *sc,
       return foreign_error (sc, error_str, 0);
     }
 
-  /* Free the name and the description which are of no use here.  */
-  for (i = 0; i < nparams; i++)
-    {
-      g_free (params[i].name);
-      g_free (params[i].description);
-    }
-  for (i = 0; i < nreturn_vals; i++)
-    {
-      g_free (return_vals[i].name);
-      g_free (return_vals[i].description);
-    }
+  /*  A nested call may drop the signature from the cache, only
+   *  use it up to running the procedure
+   */
+  nparams       = signature->n_params;
+  params        = signature->params;
+  simple_params = signature->simple_params;
 
   /*  Check the supplied number of arguments  */
-  if ((sc->vptr->list_length (sc, a) - 1) != nparams)
+  if (nargs != nparams)
     {
 #if DEBUG_MARSHALL
       g_printerr ("  Invalid number of arguments (expected %d but received %d)",
-                  nparams, (sc->vptr->list_length (sc, a) - 1));
+                  nparams, nargs);
 #endif
       g_snprintf (error_str, sizeof (error_str),
                   "Invalid number of arguments for %s (expected %d but received %d)",
-                  proc_name, nparams, (sc->vptr->list_length (sc, a) - 1));
+                  proc_name, nparams, nargs);
       return foreign_error (sc, error_str, 0);
     }
 
@@ -718,7 +771,19 @@ script_fu_marshal_procedure_call (scheme  *sc,
   else
     args = NULL;
 
-  for (i = 0; i < nparams; i++)
+  i = 0;
+
+  /*  Most calls only pass numbers and strings, marshal them without
+   *  going through the general case below
+   */
+  if (simple_params)
+    {
+      i = script_fu_marshal_simple_args (sc, a, signature, args);
+
+      success = (i == nparams);
+    }
+
+  for (; success && i < nparams; i++)
     {
       gint32  n_elements;
       pointer vector;
@@ -731,20 +796,20 @@ script_fu_marshal_procedure_call (scheme  *sc,
         const gchar *type_name;
 
         gimp_enum_get_value (GIMP_TYPE_PDB_ARG_TYPE,
-                             params[i].type,
+                             params[i],
                              &type_name, NULL, NULL, NULL);
 
         g_printerr ("    param %d - expecting type %s (%d)\n",
-                    i + 1, type_name, params[i].type);
+                    i + 1, type_name, params[i]);
         g_printerr ("      passed arg is type %s (%d)\n",
                     ts_types[ type(sc->vptr->pair_car (a)) ],
                     type(sc->vptr->pair_car (a)));
       }
 #endif
 
-      args[i].type = params[i].type;
+      args[i].type = params[i];
 
-      switch (params[i].type)
+      switch (params[i])
         {
         case GIMP_PDB_INT32:
         case GIMP_PDB_DISPLAY:
@@ -1324,6 +1389,11 @@ script_fu_marshal_procedure_call (scheme  *sc,
       break;
 
     case GIMP_PDB_CALLING_ERROR:
+      /*  the procedure may have gone away or changed, a temporary
+       *  procedure of some other plug-in for example
+       */
+      g_hash_table_remove (proc_signatures, proc_name);
+
       if (nvalues > 1 && values[1].type == GIMP_PDB_STRING)
         {
           g_snprintf (error_str, sizeof (error_str),
@@ -1353,14 +1423,14 @@ script_fu_marshal_procedure_call (scheme  *sc,
             const gchar *type_name;
 
             gimp_enum_get_value (GIMP_TYPE_PDB_ARG_TYPE,
-                                 return_vals[i].type,
+                                 values[i + 1].type,
                                  &type_name, NULL, NULL, NULL);
 
             g_printerr ("      value %d is type %s (%d)\n",
-                        i, type_name, return_vals[i].type);
+                        i, type_name, values[i + 1].type);
           }
 #endif
-          switch (return_vals[i].type)
+          switch (values[i + 1].type)
             {
             case GIMP_PDB_INT32:
             case GIMP_PDB_DISPLAY:
@@ -1614,16 +1684,10 @@ script_fu_marshal_procedure_call (scheme  *sc,
   gimp_destroy_params (values, nvalues);
 
   /*  free up arguments and values  */
-  script_fu_marshal_destroy_args (args, nparams);
-
-  /*  free the query information  */
-  g_free (proc_blurb);
-  g_free (proc_help);
-  g_free (proc_author);
-  g_free (proc_copyright);
-  g_free (proc_date);
-  g_free (params);
-  g_free (return_vals);
+  if (simple_params)
+    g_free (args);
+  else
+    script_fu_marshal_destroy_args (args, nparams);
 
   /*  if we're in server mode, listen for additional commands for 10 ms  */
   if (script_fu_server_get_mode ())
@@ -1698,6 +1762,172 @@ script_fu_marshal_destroy_args (GimpParam *params,
   g_free (params);
 }
 
+/* Marshals arguments of the types checked by proc_signature_update_simple().
+ * Returns the number of arguments marshalled, less than the number of
+ * params if an argument has the wrong type.
+ */
+static gint
+script_fu_marshal_simple_args (scheme              *sc,
+                               pointer              a,
+                               const ProcSignature *signature,
+                               GimpParam           *args)
+{
+  gint i;
+
+  for (i = 0; i < signature->n_params; i++)
+    {
+      pointer arg;
+
+      a   = sc->vptr->pair_cdr (a);
+      arg = sc->vptr->pair_car (a);
+
+      args[i].type = signature->params[i];
+
+      switch (signature->params[i])
+        {
+        case GIMP_PDB_STRING:
+          if (! sc->vptr->is_string (arg))
+            return i;
+
+          args[i].data.d_string = sc->vptr->string_value (arg);
+          break;
+
+        case GIMP_PDB_FLOAT:
+          if (! sc->vptr->is_number (arg))
+            return i;
+
+          args[i].data.d_float = sc->vptr->rvalue (arg);
+          break;
+
+        default:
+          if (! sc->vptr->is_number (arg))
+            return i;
+
+          args[i].data.d_int32 = sc->vptr->ivalue (arg);
+          break;
+        }
+    }
+
+  return i;
+}
+
+static ProcSignature *
+proc_signature_new (GimpPDBProcType proc_type,
+                    gint            n_params,
+                    gint            n_return_vals)
+{
+  ProcSignature *signature = g_slice_new0 (ProcSignature);
+
+  signature->proc_type     = proc_type;
+  signature->n_params      = n_params;
+  signature->n_return_vals = n_return_vals;
+  signature->params        = g_new0 (GimpPDBArgType, n_params + n_return_vals);
+  signature->return_vals   = signature->params + n_params;
+
+  return signature;
+}
+
+static void
+proc_signature_free (ProcSignature *signature)
+{
+  g_free (signature->params);
+
+  g_slice_free (ProcSignature, signature);
+}
+
+static void
+proc_signature_update_simple (ProcSignature *signature)
+{
+  gint i;
+
+  signature->simple_params = TRUE;
+
+  for (i = 0; i < signature->n_params; i++)
+    {
+      switch (signature->params[i])
+        {
+        case GIMP_PDB_INT32:
+        case GIMP_PDB_FLOAT:
+        case GIMP_PDB_STRING:
+        case GIMP_PDB_DISPLAY:
+        case GIMP_PDB_IMAGE:
+        case GIMP_PDB_ITEM:
+        case GIMP_PDB_LAYER:
+        case GIMP_PDB_CHANNEL:
+        case GIMP_PDB_DRAWABLE:
+        case GIMP_PDB_SELECTION:
+        case GIMP_PDB_VECTORS:
+          break;
+
+        default:
+          signature->simple_params = FALSE;
+          return;
+        }
+    }
+}
+
+static gboolean
+proc_signature_is_temporary (const gchar   *proc_name,
+                             ProcSignature *signature)
+{
+  return signature->proc_type == GIMP_TEMPORARY;
+}
+
+static const ProcSignature *
+proc_signature_lookup (const gchar *proc_name)
+{
+  ProcSignature   *signature;
+  gchar           *proc_blurb;
+  gchar           *proc_help;
+  gchar           *proc_author;
+  gchar           *proc_copyright;
+  gchar           *proc_date;
+  GimpPDBProcType  proc_type;
+  gint             nparams;
+  gint             nreturn_vals;
+  GimpParamDef    *params;
+  GimpParamDef    *return_vals;
+  gint             i;
+
+  signature = g_hash_table_lookup (proc_signatures, proc_name);
+
+  if (signature)
+    return signature;
+
+  if (! gimp_procedural_db_proc_info (proc_name,
+                                      &proc_blurb,
+                                      &proc_help,
+                                      &proc_author,
+                                      &proc_copyright,
+                                      &proc_date,
+                                      &proc_type,
+                                      &nparams, &nreturn_vals,
+                                      &params, &return_vals))
+    return NULL;
+
+  signature = proc_signature_new (proc_type, nparams, nreturn_vals);
+
+  for (i = 0; i < nparams; i++)
+    signature->params[i] = params[i].type;
+
+  for (i = 0; i < nreturn_vals; i++)
+    signature->return_vals[i] = return_vals[i].type;
+
+  proc_signature_update_simple (signature);
+
+  g_hash_table_insert (proc_signatures, g_strdup (proc_name), signature);
+
+  g_free (proc_blurb);
+  g_free (proc_help);
+  g_free (proc_author);
+  g_free (proc_copyright);
+  g_free (proc_date);
+  gimp_destroy_paramdefs (params, nparams);
+  gimp_destroy_paramdefs (return_vals, nreturn_vals);
+
+  return signature;
+}
+
 static pointer
 script_fu_register_call (scheme  *sc,
                          pointer  a)
@@ -32,6 +32,8 @@ const gchar * ts_get_success_msg      (void);
 
 void          ts_interpret_stdin      (void);
 
+void          ts_forget_proc_signatures (void);
+
 /* if the return value is 0, success. error otherwise. */
 gint          ts_interpret_string     (const gchar  *expr);
 
@@ -102,6 +102,11 @@ script_fu_find_scripts (const gchar *path)
       g_tree_destroy (script_tree);
     }
 
+  /*  The scripts' temporary procedures come and go, don't keep
+   *  their signatures around
+   */
+  ts_forget_proc_signatures ();
+
   if (! path)
     return;
 
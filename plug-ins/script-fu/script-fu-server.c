@@ -82,9 +82,10 @@ typedef short sa_family_t;	/* Not defined by winsock */
 #define RESPONSE_HEADER 4
 #define MAGIC           'G'
 
-#ifndef HAVE_DIFFTIME
-#define difftime(a,b) (((gdouble)(a)) - ((gdouble)(b)))
-#endif
+/*  with worker processes, clients get an error response instead of
+ *  waiting behind this many queued requests
+ */
+#define MAX_QUEUE_LENGTH 64
 
 #ifndef NO_FD_SET
 #  define SELECT_MASK fd_set
@@ -127,18 +128,28 @@ typedef short sa_family_t;	/* Not defined by winsock */
 
 typedef struct
 {
-  gchar *command;
-  gint   filedes;
-  gint   request_no;
+  gchar  *command;
+  gint    filedes;
+  gint    request_no;
+  gint64  queue_time;
 } SFCommand;
 
+typedef struct
+{
+  gint       filedes;     /*  -1 if the worker went away          */
+  SFCommand *cmd;         /*  the request in progress, or NULL    */
+  gint64     start_time;
+} SFWorker;
+
 typedef struct
 {
   GtkWidget *port_entry;
   GtkWidget *log_entry;
+  GtkWidget *workers_entry;
 
   gint       port;
   gchar     *logfile;
+  gint       workers;
 
   gboolean   run;
 } ServerInterface;
@@ -157,15 +168,34 @@ typedef union
  */
 
 static void      server_start       (gint         port,
-                                     const gchar *logfile);
+                                     const gchar *logfile,
+                                     gint         n_requested_workers);
+static gint      start_workers      (gint         n_requested_workers);
+static void      dispatch_commands  (void);
 static gboolean  execute_command    (SFCommand   *cmd);
+static void      free_command       (SFCommand   *cmd);
 static gint      read_from_client   (gint         filedes);
+static gint      read_from_worker   (SFWorker    *worker);
+static gchar   * read_command       (gint         filedes);
+static gboolean  recv_bytes         (gint         filedes,
+                                     gchar       *buffer,
+                                     gint         len);
+static gboolean  send_bytes         (gint         filedes,
+                                     const gchar *buffer,
+                                     gint         len);
+static gboolean  send_response      (gint         filedes,
+                                     gboolean     error,
+                                     GString     *response);
+static gboolean  init_socket_api    (void);
 static gint      make_socket        (const struct addrinfo
                                                  *ai);
 static void      server_log         (const gchar *format,
                                      ...) G_GNUC_PRINTF (1, 2);
 static void      server_quit        (void);
 
+static const gchar * server_progress_install   (void);
+static void          server_progress_uninstall (const gchar *progress);
+
 static gboolean  server_interface   (void);
 static void      response_callback  (GtkWidget   *widget,
                                      gint         response_id,
@@ -179,9 +209,11 @@ static gint         server_socks[2],
                     server_socks_used = 0;
 static const gint   server_socks_len = sizeof (server_socks) /
                                        sizeof (server_socks[0]);
-static GList       *command_queue   = NULL;
-static gint         queue_length    = 0;
+static GQueue       command_queue   = G_QUEUE_INIT;
 static gint         request_no      = 0;
+static gint         worker_sock     = -1;
+static SFWorker    *workers         = NULL;
+static gint         n_workers       = 0;
 static FILE        *server_log_file = NULL;
 static GHashTable  *clients         = NULL;
 static gboolean     script_fu_done  = FALSE;
@@ -191,9 +223,11 @@ static ServerInterface sint =
 {
   NULL,  /*  port entry widget    */
   NULL,  /*  log entry widget     */
+  NULL,  /*  workers entry widget */
 
   10008, /*  default port number  */
   NULL,  /*  use stdout           */
+  0,     /*  no worker processes  */
 
   FALSE  /*  run                  */
 };
@@ -238,7 +272,7 @@ script_fu_server_run (const gchar      *name,
           server_mode = TRUE;
 
           /*  Start the server  */
-          server_start (sint.port, sint.logfile);
+          server_start (sint.port, sint.logfile, sint.workers);
         }
       break;
 
@@ -247,7 +281,8 @@ script_fu_server_run (const gchar      *name,
       server_mode = TRUE;
 
       /*  Start the server  */
-      server_start (params[1].data.d_int32, params[2].data.d_string);
+      server_start (params[1].data.d_int32, params[2].data.d_string,
+                    nparams > 3 ? params[3].data.d_int32 : 0);
       break;
 
     case GIMP_RUN_WITH_LAST_VALS:
@@ -265,6 +300,90 @@ script_fu_server_run (const gchar      *name,
   values[0].data.d_status = status;
 }
 
+void
+script_fu_server_worker_run (const gchar      *name,
+                             gint              nparams,
+                             const GimpParam  *params,
+                             gint             *nreturn_vals,
+                             GimpParam       **return_vals)
+{
+  static GimpParam    values[1];
+  GimpPDBStatusType   status = GIMP_PDB_SUCCESS;
+  struct sockaddr_in  server;
+  const gchar        *progress;
+  gchar              *command;
+  gint                sock;
+
+  *nreturn_vals = 1;
+  *return_vals  = values;
+
+  values[0].type = GIMP_PDB_STATUS;
+
+  server_log_file = stderr;
+
+  /*  Connect to the server's local port before acknowledging the
+   *  start, the server accepts the connection after that
+   */
+  if (! init_socket_api ())
+    {
+      values[0].data.d_status = GIMP_PDB_EXECUTION_ERROR;
+      return;
+    }
+
+  sock = socket (AF_INET, SOCK_STREAM, 0);
+
+  memset (&server, 0, sizeof (server));
+  server.sin_family      = AF_INET;
+  server.sin_port        = g_htons (params[1].data.d_int32);
+  server.sin_addr.s_addr = g_htonl (INADDR_LOOPBACK);
+
+  if (sock < 0 ||
+      connect (sock, (struct sockaddr *) &server, sizeof (server)) < 0)
+    {
+      print_socket_api_error ("connect");
+
+      values[0].data.d_status = GIMP_PDB_EXECUTION_ERROR;
+      return;
+    }
+
+  ts_set_run_mode (GIMP_RUN_NONINTERACTIVE);
+  ts_set_print_flag (1);
+
+  gimp_extension_ack ();
+
+  progress = server_progress_install ();
+
+  /*  Serve requests until the server closes the connection  */
+  while ((command = read_command (sock)))
+    {
+      GString  *response = g_string_new (NULL);
+      gboolean  error;
+
+      ts_register_output_func (ts_gstring_output_func, response);
+
+      error = (ts_interpret_string (command) != 0);
+
+      if (! error && response->len == 0)
+        g_string_assign (response, ts_get_success_msg ());
+
+      g_free (command);
+
+      if (! send_response (sock, error, response))
+        status = GIMP_PDB_EXECUTION_ERROR;
+
+      g_string_free (response, TRUE);
+
+      if (status != GIMP_PDB_SUCCESS)
+        break;
+    }
+
+  server_progress_uninstall (progress);
+
+  CLOSESOCKET (sock);
+
+  values[0].data.d_status = status;
+}
+
 static void
 script_fu_server_add_fd (gpointer key,
                          gpointer value,
@@ -285,6 +404,7 @@ script_fu_server_read_fd (gpointer key,
       if (read_from_client (fd) < 0)
         {
           GList *list;
+          gint   i;
 
           server_log ("Server: disconnect from host %s.\n", (gchar *) value);
 
@@ -292,14 +412,20 @@ script_fu_server_read_fd (gpointer key,
 
           /*  Invalidate the file descriptor for pending commands
               from the disconnected client.  */
-          for (list = command_queue; list; list = list->next)
+          for (list = command_queue.head; list; list = list->next)
             {
-              SFCommand *cmd = (SFCommand *) command_queue->data;
+              SFCommand *cmd = (SFCommand *) list->data;
 
               if (cmd->filedes == fd)
                 cmd->filedes = -1;
             }
 
+          for (i = 0; i < n_workers; i++)
+            {
+              if (workers[i].cmd && workers[i].cmd->filedes == fd)
+                workers[i].cmd->filedes = -1;
+            }
+
           return TRUE;  /*  remove this client from the hash table  */
         }
     }
@@ -330,6 +456,12 @@ script_fu_server_listen (gint timeout)
     }
   g_hash_table_foreach (clients, script_fu_server_add_fd, &fds);
 
+  for (sockno = 0; sockno < n_workers; sockno++)
+    {
+      if (workers[sockno].cmd)
+        FD_SET (workers[sockno].filedes, &fds);
+    }
+
   /* Block until input arrives on one or more active sockets
      or timeout occurs. */
 
@@ -394,6 +526,15 @@ script_fu_server_listen (gint timeout)
 
   /* Service the client sockets. */
   g_hash_table_foreach_remove (clients, script_fu_server_read_fd, &fds);
+
+  /* Collect the responses of finished workers. */
+  for (sockno = 0; sockno < n_workers; sockno++)
+    {
+      SFWorker *worker = &workers[sockno];
+
+      if (worker->cmd && FD_ISSET (worker->filedes, &fds))
+        read_from_worker (worker);
+    }
 }
 
 static void
@@ -449,7 +590,8 @@ server_progress_uninstall (const gchar *progress)
 
 static void
 server_start (gint         port,
-              const gchar *logfile)
+              const gchar *logfile,
+              gint         n_requested_workers)
 {
   struct addrinfo *ai,
                   *ai_curr;
@@ -506,6 +648,14 @@ server_start (gint         port,
 
   progress = server_progress_install ();
 
+  if (n_requested_workers > 0)
+    {
+      n_workers = start_workers (n_requested_workers);
+
+      server_log ("Started %d of %d worker processes\n",
+                  n_workers, n_requested_workers);
+    }
+
   server_log ("Script-Fu server initialized and listening...\n");
 
   /*  Loop until the server is finished  */
@@ -513,40 +663,155 @@ server_start (gint         port,
     {
       script_fu_server_listen (0);
 
-      while (command_queue)
+      dispatch_commands ();
+    }
+
+  server_progress_uninstall (progress);
+
+  server_quit ();
+}
+
+/*  Starts worker processes which connect back to a local port,
+ *  returns the number of workers which could be started
+ */
+static gint
+start_workers (gint n_requested_workers)
+{
+  struct addrinfo    hints;
+  struct addrinfo   *ai;
+  struct sockaddr_in addr;
+  socklen_t          size = sizeof (addr);
+  gint               i;
+
+  memset (&hints, 0, sizeof (hints));
+  hints.ai_family   = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+
+  if (getaddrinfo ("127.0.0.1", "0", &hints, &ai) != 0)
+    return 0;
+
+  worker_sock = make_socket (ai);
+  freeaddrinfo (ai);
+
+  if (listen (worker_sock, n_requested_workers) < 0 ||
+      getsockname (worker_sock, (struct sockaddr *) &addr, &size) < 0)
+    {
+      print_socket_api_error ("listen");
+      return 0;
+    }
+
+  workers = g_new0 (SFWorker, n_requested_workers);
+
+  for (i = 0; i < n_requested_workers; i++)
+    {
+      GimpParam *values;
+      gint       n_values;
+      gboolean   success;
+
+      /*  returns as soon as the worker acknowledged its start  */
+      values = gimp_run_procedure ("extension-script-fu-server-worker",
+                                   &n_values,
+                                   GIMP_PDB_INT32, GIMP_RUN_NONINTERACTIVE,
+                                   GIMP_PDB_INT32, (gint) g_ntohs (addr.sin_port),
+                                   GIMP_PDB_END);
+
+      success = (values[0].data.d_status == GIMP_PDB_SUCCESS);
+
+      gimp_destroy_params (values, n_values);
+
+      if (! success)
+        break;
+
+      workers[i].filedes = accept (worker_sock, NULL, NULL);
+
+      if (workers[i].filedes < 0)
         {
-          SFCommand *cmd = (SFCommand *) command_queue->data;
+          print_socket_api_error ("accept");
+          break;
+        }
+    }
 
-          /*  Process the command  */
-          execute_command (cmd);
+  return i;
+}
 
-          /*  Remove the command from the list  */
-          command_queue = g_list_remove (command_queue, cmd);
-          queue_length--;
+/*  Hands queued commands to idle workers, or executes them right
+ *  here if there are no workers
+ */
+static void
+dispatch_commands (void)
+{
+  gint n_alive = 0;
+  gint i;
 
-          /*  Free the request  */
-          g_free (cmd->command);
-          g_free (cmd);
-      }
+  for (i = 0; i < n_workers; i++)
+    {
+      SFWorker  *worker = &workers[i];
+      guchar     buffer[COMMAND_HEADER];
+      SFCommand *cmd;
+      gint       len;
+
+      if (worker->filedes < 0)
+        continue;
+
+      n_alive++;
+
+      if (worker->cmd || g_queue_is_empty (&command_queue))
+        continue;
+
+      cmd = g_queue_pop_head (&command_queue);
+      len = strlen (cmd->command);
+
+      buffer[MAGIC_BYTE]     = MAGIC;
+      buffer[CMD_LEN_H_BYTE] = (guchar) (len >> 8);
+      buffer[CMD_LEN_L_BYTE] = (guchar) (len & 0xFF);
+
+      worker->cmd        = cmd;
+      worker->start_time = g_get_monotonic_time ();
+
+      if (! send_bytes (worker->filedes, (gchar *) buffer, COMMAND_HEADER) ||
+          ! send_bytes (worker->filedes, cmd->command, len))
+        {
+          /*  handled like a worker which died while executing  */
+          read_from_worker (worker);
+          continue;
+        }
+
+      server_log ("Request #%d dispatched to worker %d\n",
+                  cmd->request_no, i);
     }
 
-  server_progress_uninstall (progress);
+  if (n_workers > 0 && n_alive == 0)
+    {
+      server_log ("No worker processes left, executing requests "
+                  "in the server\n");
 
-  server_quit ();
+      g_free (workers);
+      workers   = NULL;
+      n_workers = 0;
+    }
+
+  /*  without workers, run everything in this process  */
+  if (n_workers == 0)
+    {
+      while (! g_queue_is_empty (&command_queue))
+        {
+          SFCommand *cmd = g_queue_pop_head (&command_queue);
+
+          execute_command (cmd);
+          free_command (cmd);
+        }
+    }
 }
 
 static gboolean
 execute_command (SFCommand *cmd)
 {
-  guchar    buffer[RESPONSE_HEADER];
   GString  *response;
-  time_t    clock1;
-  time_t    clock2;
+  gint64    start_time;
   gboolean  error;
-  gint      i;
 
   server_log ("Processing request #%d\n", cmd->request_no);
-  time (&clock1);
+  start_time = g_get_monotonic_time ();
 
   response = g_string_new (NULL);
   ts_register_output_func (ts_gstring_output_func, response);
@@ -556,7 +821,7 @@ execute_command (SFCommand *cmd)
     {
       error = TRUE;
 
-      server_log ("%s\n", response->str);
+      server_log ("Request #%d failed: %s\n", cmd->request_no, response->str);
     }
   else
     {
@@ -564,83 +829,200 @@ execute_command (SFCommand *cmd)
 
       if (response->len == 0)
         g_string_assign (response, ts_get_success_msg ());
-
-      time (&clock2);
-      server_log ("Request #%d processed in %f seconds, finishing on %s",
-                  cmd->request_no, difftime (clock2, clock1), ctime (&clock2));
     }
 
-  buffer[MAGIC_BYTE]     = MAGIC;
-  buffer[ERROR_BYTE]     = error ? TRUE : FALSE;
-  buffer[RSP_LEN_H_BYTE] = (guchar) (response->len >> 8);
-  buffer[RSP_LEN_L_BYTE] = (guchar) (response->len & 0xFF);
+  server_log ("Request #%d processed in %.3f seconds, "
+              "%.3f seconds in queue\n",
+              cmd->request_no,
+              (g_get_monotonic_time () - start_time) / 1000000.0,
+              (start_time - cmd->queue_time) / 1000000.0);
 
   /*  Write the response to the client  */
-  for (i = 0; i < RESPONSE_HEADER; i++)
-    if (cmd->filedes > 0 && send (cmd->filedes, buffer + i, 1, 0) < 0)
-      {
-        /*  Write error  */
-        print_socket_api_error ("send");
-        return FALSE;
-      }
-
-  for (i = 0; i < response->len; i++)
-    if (cmd->filedes > 0 && send (cmd->filedes, response->str + i, 1, 0) < 0)
-      {
-        /*  Write error  */
-        print_socket_api_error ("send");
-        return FALSE;
-      }
+  if (cmd->filedes > 0)
+    send_response (cmd->filedes, error, response);
 
   g_string_free (response, TRUE);
 
   return FALSE;
 }
 
+static void
+free_command (SFCommand *cmd)
+{
+  g_free (cmd->command);
+  g_slice_free (SFCommand, cmd);
+}
+
 static gint
 read_from_client (gint filedes)
 {
   SFCommand *cmd;
-  guchar     buffer[COMMAND_HEADER];
   gchar     *command;
   gchar     *clientaddr;
   time_t     clock;
-  gint       command_len;
-  gint       nbytes;
-  gint       i;
 
-  for (i = 0; i < COMMAND_HEADER;)
+  command = read_command (filedes);
+
+  if (! command)
+    return -1;
+
+  /*  Get the client address from the address/socket table  */
+  clientaddr = g_hash_table_lookup (clients, GINT_TO_POINTER (filedes));
+
+  /*  Don't let the queue grow without bounds when there are workers,
+   *  the clients are better off retrying later
+   */
+  if (n_workers > 0 && command_queue.length >= MAX_QUEUE_LENGTH)
     {
-      nbytes = recv (filedes, buffer + i, COMMAND_HEADER - i, 0);
+      GString *response = g_string_new ("Script-Fu server is busy, "
+                                        "too many requests queued");
 
-      if (nbytes < 0)
-        {
-#ifndef G_OS_WIN32
-          if (errno == EINTR)
-            continue;
-#endif
-          server_log ("Error reading command header.\n");
-          return -1;
-        }
+      server_log ("Rejected request from IP address %s, "
+                  "[Request queue length: %d]\n",
+                  clientaddr ? clientaddr : "<invalid>",
+                  command_queue.length);
 
-      if (nbytes == 0)
-        return -1;  /* EOF */
+      send_response (filedes, TRUE, response);
 
-      i += nbytes;
+      g_string_free (response, TRUE);
+      g_free (command);
+
+      return 0;
+    }
+
+  cmd = g_slice_new (SFCommand);
+
+  cmd->filedes    = filedes;
+  cmd->command    = command;
+  cmd->request_no = request_no ++;
+  cmd->queue_time = g_get_monotonic_time ();
+
+  /*  Add the command to the queue  */
+  g_queue_push_tail (&command_queue, cmd);
+
+  time (&clock);
+  server_log ("Received request #%d from IP address %s: %s on %s,"
+              "[Request queue length: %d]",
+              cmd->request_no,
+                  clientaddr ? clientaddr : "<invalid>",
+                      cmd->command, ctime (&clock), command_queue.length);
+
+  return 0;
+}
+
+/*  Reads a worker's response and passes it on to the client  */
+static gint
+read_from_worker (SFWorker *worker)
+{
+  SFCommand *cmd = worker->cmd;
+  guchar     buffer[RESPONSE_HEADER];
+  gchar     *response;
+  gint       response_len;
+  gint       index = worker - workers;
+
+  worker->cmd = NULL;
+
+  if (! recv_bytes (worker->filedes, (gchar *) buffer, RESPONSE_HEADER) ||
+      buffer[MAGIC_BYTE] != MAGIC)
+    {
+      GString *error = g_string_new ("Script-Fu worker process died");
+
+      server_log ("Worker %d went away while processing request #%d\n",
+                  index, cmd->request_no);
+
+      if (cmd->filedes > 0)
+        send_response (cmd->filedes, TRUE, error);
+
+      g_string_free (error, TRUE);
+      free_command (cmd);
+
+      CLOSESOCKET (worker->filedes);
+      worker->filedes = -1;
+
+      return -1;
+    }
+
+  response_len = (buffer[RSP_LEN_H_BYTE] << 8) | buffer[RSP_LEN_L_BYTE];
+  response     = g_new (gchar, response_len);
+
+  if (! recv_bytes (worker->filedes, response, response_len))
+    response_len = -1;
+
+  if (buffer[ERROR_BYTE])
+    server_log ("Request #%d failed in worker %d: %.*s\n",
+                cmd->request_no, index, MAX (response_len, 0), response);
+
+  server_log ("Request #%d processed by worker %d in %.3f seconds, "
+              "%.3f seconds in queue\n",
+              cmd->request_no, index,
+              (g_get_monotonic_time () - worker->start_time) / 1000000.0,
+              (worker->start_time - cmd->queue_time) / 1000000.0);
+
+  /*  Pass the response on as it is  */
+  if (cmd->filedes > 0 && response_len >= 0)
+    {
+      if (send_bytes (cmd->filedes, (gchar *) buffer, RESPONSE_HEADER))
+        send_bytes (cmd->filedes, response, response_len);
+    }
+
+  g_free (response);
+  free_command (cmd);
+
+  if (response_len < 0)
+    {
+      CLOSESOCKET (worker->filedes);
+      worker->filedes = -1;
+
+      return -1;
     }
 
+  return 0;
+}
+
+/*  Reads one command in the wire format described above, returns
+ *  NULL on errors or when the connection was closed
+ */
+static gchar *
+read_command (gint filedes)
+{
+  guchar  buffer[COMMAND_HEADER];
+  gchar  *command;
+  gint    command_len;
+
+  if (! recv_bytes (filedes, (gchar *) buffer, COMMAND_HEADER))
+    return NULL;
+
   if (buffer[MAGIC_BYTE] != MAGIC)
     {
       server_log ("Error in script-fu command transmission.\n");
-      return -1;
+      return NULL;
     }
 
   command_len = (buffer [CMD_LEN_H_BYTE] << 8) | buffer [CMD_LEN_L_BYTE];
   command = g_new (gchar, command_len + 1);
 
-  for (i = 0; i < command_len;)
+  if (! recv_bytes (filedes, command, command_len))
     {
-      nbytes = recv (filedes, command + i, command_len - i, 0);
+      server_log ("Error reading command of %d bytes.\n", command_len);
+      g_free (command);
+      return NULL;
+    }
+
+  command[command_len] = '\0';
+
+  return command;
+}
+
+static gboolean
+recv_bytes (gint   filedes,
+            gchar *buffer,
+            gint   len)
+{
+  gint i;
+
+  for (i = 0; i < len;)
+    {
+      gint nbytes = recv (filedes, buffer + i, len - i, 0);
 
       if (nbytes <= 0)
         {
@@ -648,47 +1030,68 @@ read_from_client (gint filedes)
           if (nbytes < 0 && errno == EINTR)
             continue;
 #endif
-           server_log ("Error reading command.  Read %d out of %d bytes.\n",
-                       i, command_len);
-           g_free (command);
-           return -1;
+          if (nbytes < 0)
+            print_socket_api_error ("recv");
+
+          return FALSE;
         }
 
       i += nbytes;
     }
 
-  command[command_len] = '\0';
-  cmd = g_new (SFCommand, 1);
+  return TRUE;
+}
 
-  cmd->filedes    = filedes;
-  cmd->command    = command;
-  cmd->request_no = request_no ++;
+static gboolean
+send_bytes (gint         filedes,
+            const gchar *buffer,
+            gint         len)
+{
+  gint i;
 
-  /*  Add the command to the queue  */
-  command_queue = g_list_append (command_queue, cmd);
-  queue_length ++;
+  for (i = 0; i < len;)
+    {
+      gint nbytes = send (filedes, buffer + i, len - i, 0);
 
-  /*  Get the client address from the address/socket table  */
-  clientaddr = g_hash_table_lookup (clients, GINT_TO_POINTER (cmd->filedes));
-  time (&clock);
-  server_log ("Received request #%d from IP address %s: %s on %s,"
-              "[Request queue length: %d]",
-              cmd->request_no,
-                  clientaddr ? clientaddr : "<invalid>",
-                      cmd->command, ctime (&clock), queue_length);
+      if (nbytes < 0)
+        {
+#ifndef G_OS_WIN32
+          if (errno == EINTR)
+            continue;
+#endif
+          print_socket_api_error ("send");
+          return FALSE;
+        }
 
-  return 0;
+      i += nbytes;
+    }
+
+  return TRUE;
 }
 
-static gint
-make_socket (const struct addrinfo *ai)
+static gboolean
+send_response (gint      filedes,
+               gboolean  error,
+               GString  *response)
 {
-  gint                    sock;
-  gint                    v = 1;
+  guchar buffer[RESPONSE_HEADER];
+  gint   len = MIN (response->len, G_MAXUINT16);
+
+  buffer[MAGIC_BYTE]     = MAGIC;
+  buffer[ERROR_BYTE]     = error ? TRUE : FALSE;
+  buffer[RSP_LEN_H_BYTE] = (guchar) (len >> 8);
+  buffer[RSP_LEN_L_BYTE] = (guchar) (len & 0xFF);
+
+  return (send_bytes (filedes, (gchar *) buffer, RESPONSE_HEADER) &&
+          send_bytes (filedes, response->str, len));
+}
 
+static gboolean
+init_socket_api (void)
+{
   /*  Win32 needs the winsock library initialized.  */
 #ifdef G_OS_WIN32
-  static gboolean    winsock_initialized = FALSE;
+  static gboolean winsock_initialized = FALSE;
 
   if (! winsock_initialized)
     {
@@ -702,11 +1105,23 @@ make_socket (const struct addrinfo *ai)
       else
         {
           print_socket_api_error ("WSAStartup");
-          gimp_quit ();
+          return FALSE;
         }
     }
 #endif
 
+  return TRUE;
+}
+
+static gint
+make_socket (const struct addrinfo *ai)
+{
+  gint                    sock;
+  gint                    v = 1;
+
+  if (! init_socket_api ())
+    gimp_quit ();
+
   /* Create the socket. */
   sock = socket (ai->ai_family, ai->ai_socktype, ai->ai_protocol);
   if (sock < 0)
@@ -782,17 +1197,28 @@ server_quit (void)
       clients = NULL;
     }
 
-  while (command_queue)
+  /*  The workers quit when their connection is closed  */
+  for (sockno = 0; sockno < n_workers; sockno++)
     {
-      SFCommand *cmd = command_queue->data;
+      if (workers[sockno].cmd)
+        free_command (workers[sockno].cmd);
 
-      g_free (cmd->command);
-      g_free (cmd);
+      if (workers[sockno].filedes >= 0)
+        CLOSESOCKET (workers[sockno].filedes);
     }
 
-  g_list_free (command_queue);
-  command_queue = NULL;
-  queue_length  = 0;
+  g_free (workers);
+  workers   = NULL;
+  n_workers = 0;
+
+  if (worker_sock >= 0)
+    {
+      CLOSESOCKET (worker_sock);
+      worker_sock = -1;
+    }
+
+  while (! g_queue_is_empty (&command_queue))
+    free_command (g_queue_pop_head (&command_queue));
 
   /*  Close the server log file  */
   if (server_log_file != stdout)
@@ -832,8 +1258,8 @@ server_interface (void)
                     G_CALLBACK (gtk_main_quit),
                     NULL);
 
-  /*  The table to hold port & logfile entries  */
-  table = gtk_table_new (2, 2, FALSE);
+  /*  The table to hold port, logfile & workers entries  */
+  table = gtk_table_new (3, 2, FALSE);
   gtk_table_set_col_spacings (GTK_TABLE (table), 6);
   gtk_table_set_row_spacings (GTK_TABLE (table), 6);
   gtk_container_set_border_width (GTK_CONTAINER (table), 12);
@@ -853,6 +1279,13 @@ server_interface (void)
                              _("Server logfile:"), 0.0, 0.5,
                              sint.log_entry, 1, FALSE);
 
+  /*  The number of worker processes, 0 runs requests in the server  */
+  sint.workers_entry = gtk_entry_new ();
+  gtk_entry_set_text (GTK_ENTRY (sint.workers_entry), "0");
+  gimp_table_attach_aligned (GTK_TABLE (table), 0, 2,
+                             _("Worker processes:"), 0.0, 0.5,
+                             sint.workers_entry, 1, FALSE);
+
   gtk_widget_show (table);
   gtk_widget_show (dlg);
 
@@ -872,6 +1305,7 @@ response_callback (GtkWidget *widget,
 
       sint.port    = atoi (gtk_entry_get_text (GTK_ENTRY (sint.port_entry)));
       sint.logfile = g_strdup (gtk_entry_get_text (GTK_ENTRY (sint.log_entry)));
+      sint.workers = atoi (gtk_entry_get_text (GTK_ENTRY (sint.workers_entry)));
       sint.run     = TRUE;
     }
 
@@ -19,14 +19,19 @@
 #define __SCRIPT_FU_SERVER_H__
 
 
-void  script_fu_server_run      (const gchar      *name,
-				 gint              nparams,
-				 const GimpParam  *params,
-				 gint             *nreturn_vals,
-				 GimpParam       **return_vals);
-void  script_fu_server_listen   (gint              timeout);
-gint  script_fu_server_get_mode (void);
-void  script_fu_server_quit     (void);
+void  script_fu_server_run        (const gchar      *name,
+                                  gint              nparams,
+                                  const GimpParam  *params,
+                                  gint             *nreturn_vals,
+                                  GimpParam       **return_vals);
+void  script_fu_server_worker_run (const gchar      *name,
+                                  gint              nparams,
+                                  const GimpParam  *params,
+                                  gint             *nreturn_vals,
+                                  GimpParam       **return_vals);
+void  script_fu_server_listen     (gint              timeout);
+gint  script_fu_server_get_mode   (void);
+void  script_fu_server_quit       (void);
 
 
 #endif /*  __SCRIPT_FU_SERVER__  */
@@ -93,6 +93,20 @@ script_fu_query (void)
     { GIMP_PDB_STRING, "logfile",  "The file to log server activity to"       }
   };
 
+  static const GimpParamDef server_pool_args[] =
+  {
+    { GIMP_PDB_INT32,  "run-mode", "The run mode { RUN-NONINTERACTIVE (1) }"  },
+    { GIMP_PDB_INT32,  "port",     "The port on which to listen for requests" },
+    { GIMP_PDB_STRING, "logfile",  "The file to log server activity to"       },
+    { GIMP_PDB_INT32,  "workers",  "The number of interpreter processes"      }
+  };
+
+  static const GimpParamDef server_worker_args[] =
+  {
+    { GIMP_PDB_INT32,  "run-mode", "The run mode { RUN-NONINTERACTIVE (1) }"  },
+    { GIMP_PDB_INT32,  "port",     "The local port of the server to serve"    }
+  };
+
   gimp_plugin_domain_register (GETTEXT_PACKAGE "-script-fu", NULL);
 
   gimp_install_procedure ("extension-script-fu",
@@ -151,6 +165,36 @@ script_fu_query (void)
   gimp_plugin_menu_register ("plug-in-script-fu-server",
                              "<Image>/Filters/Languages/Script-Fu");
 
+  gimp_install_procedure ("plug-in-script-fu-server-pool",
+                          "Server for remote Script-Fu operation, running "
+                          "requests concurrently",
+                          "Like plug-in-script-fu-server, but requests are "
+                          "executed by a pool of 'workers' Script-Fu "
+                          "processes, so a slow request doesn't block "
+                          "the other clients.",
+                          "GIMP Development Team <gimp-developer-list@gnome.org>",
+                          "GIMP Development Team",
+                          "2026",
+                          NULL,
+                          NULL,
+                          GIMP_PLUGIN,
+                          G_N_ELEMENTS (server_pool_args), 0,
+                          server_pool_args, NULL);
+
+  gimp_install_procedure ("extension-script-fu-server-worker",
+                          "Worker process of the Script-Fu server",
+                          "Connects to a Script-Fu server's local port "
+                          "and evaluates the requests it is sent.  Only "
+                          "to be started by the server.",
+                          "GIMP Development Team <gimp-developer-list@gnome.org>",
+                          "GIMP Development Team",
+                          "2026",
+                          NULL,
+                          NULL,
+                          GIMP_EXTENSION,
+                          G_N_ELEMENTS (server_worker_args), 0,
+                          server_worker_args, NULL);
+
   gimp_install_procedure ("plug-in-script-fu-eval",
                           "Evaluate scheme code",
                           "Evaluate the code under the scheme interpreter "
@@ -243,7 +287,8 @@ script_fu_run (const gchar      *name,
       script_fu_console_run (name, nparams, param,
                              nreturn_vals, return_vals);
     }
-  else if (strcmp (name, "plug-in-script-fu-server") == 0)
+  else if (strcmp (name, "plug-in-script-fu-server")      == 0 ||
+           strcmp (name, "plug-in-script-fu-server-pool") == 0)
     {
       /*
        *  The script-fu server for remote operation
@@ -252,6 +297,15 @@ script_fu_run (const gchar      *name,
       script_fu_server_run (name, nparams, param,
                             nreturn_vals, return_vals);
     }
+  else if (strcmp (name, "extension-script-fu-server-worker") == 0)
+    {
+      /*
+       *  One of the script-fu server's interpreter processes
+       */
+
+      script_fu_server_worker_run (name, nparams, param,
+                                   nreturn_vals, return_vals);
+    }
   else if (strcmp (name, "plug-in-script-fu-eval") == 0)
     {
       /*